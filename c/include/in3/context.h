@@ -91,6 +91,8 @@ typedef struct in3_ctx {
   cache_entry_t*  cache;              /**<optional cache-entries.  These entries will be freed when cleaning up the context.*/
   struct in3_ctx* required;           /**< pointer to the next required context. if not NULL the data from this context need get finished first, before being able to resume this context. */
   in3_t*          client;             /**< reference to the client*/
+  uint64_t        deadline;           /**< the time in ms (see current_ms()) when the request must be finished, or 0 if there is no deadline. required contexts inherit the deadline of their parent. */
+  uint64_t        started;            /**< the time in ms (see current_ms()) when the ctx was created. */
 } in3_ctx_t;
 
 /**
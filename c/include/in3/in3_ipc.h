@@ -0,0 +1,71 @@
+/*******************************************************************************
+ * This file is part of the Incubed project.
+ * Sources: https://github.com/slockit/in3-c
+ * 
+ * Copyright (C) 2018-2020 slock.it GmbH, Blockchains LLC
+ * 
+ * 
+ * COMMERCIAL LICENSE USAGE
+ * 
+ * Licensees holding a valid commercial license may use this file in accordance 
+ * with the commercial license agreement provided with the Software or, alternatively, 
+ * in accordance with the terms contained in a written agreement between you and 
+ * slock.it GmbH/Blockchains LLC. For licensing terms and conditions or further 
+ * information please contact slock.it at in3@slock.it.
+ * 	
+ * Alternatively, this file may be used under the AGPL license as follows:
+ *    
+ * AGPL LICENSE USAGE
+ * 
+ * This program is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Affero General Public License as published by the Free Software 
+ * Foundation, either version 3 of the License, or (at your option) any later version.
+ *  
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY 
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A 
+ * PARTICULAR PURPOSE. See the GNU Affero General Public License for more details.
+ * [Permissions of this strong copyleft license are conditioned on making available 
+ * complete source code of licensed works and modifications, which include larger 
+ * works using a licensed work, under the same license. Copyright and license notices 
+ * must be preserved. Contributors provide an express grant of patent rights.]
+ * You should have received a copy of the GNU Affero General Public License along 
+ * with this program. If not, see <https://www.gnu.org/licenses/>.
+ *******************************************************************************/
+
+// @PUBLIC_HEADER
+/** @file 
+ * transport-handler using unix domain sockets (ipc).
+ */
+
+#ifndef in3_ipc_h__
+#define in3_ipc_h__
+
+#include "client.h"
+
+/**
+ * a transport function sending json-rpc-requests over unix domain sockets to nodes running on the same host.
+ * 
+ * Urls in the nodelist starting with `ipc://` are handled by this transport ( like `ipc:///home/user/.ethereum/geth.ipc` ).
+ * The payload is written as it is without any http-headers and the response ends with the first complete json-value,
+ * so batch-requests (json-arrays) are supported as well. Connections are kept open and reused for the next request.
+ * 
+ * All other urls are passed to the fallback transport (see `in3_register_ipc`), so a nodelist may contain both types of urls.
+ * 
+ * You can use it by setting the transport-function-pointer in the in3_t->transport to this function:
+ * 
+ * ```c
+ * #include <in3/in3_ipc.h>
+ * ...
+ * c->transport = send_ipc;
+ * ```
+ */
+in3_ret_t send_ipc(in3_request_t* req);
+
+/**
+ * registers ipc as a default transport.
+ * 
+ * urls, which are not ipc-urls will be send using the fallback transport. If the fallback is NULL, those requests will fail.
+ */
+void in3_register_ipc(in3_transport_send fallback /**< the transport used for non-ipc-urls like `send_curl` */);
+
+#endif // in3_ipc_h__
@@ -0,0 +1,128 @@
+/*******************************************************************************
+ * This file is part of the Incubed project.
+ * Sources: https://github.com/slockit/in3-c
+ * 
+ * Copyright (C) 2018-2020 slock.it GmbH, Blockchains LLC
+ * 
+ * 
+ * COMMERCIAL LICENSE USAGE
+ * 
+ * Licensees holding a valid commercial license may use this file in accordance 
+ * with the commercial license agreement provided with the Software or, alternatively, 
+ * in accordance with the terms contained in a written agreement between you and 
+ * slock.it GmbH/Blockchains LLC. For licensing terms and conditions or further 
+ * information please contact slock.it at in3@slock.it.
+ * 	
+ * Alternatively, this file may be used under the AGPL license as follows:
+ *    
+ * AGPL LICENSE USAGE
+ * 
+ * This program is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Affero General Public License as published by the Free Software 
+ * Foundation, either version 3 of the License, or (at your option) any later version.
+ *  
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY 
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A 
+ * PARTICULAR PURPOSE. See the GNU Affero General Public License for more details.
+ * [Permissions of this strong copyleft license are conditioned on making available 
+ * complete source code of licensed works and modifications, which include larger 
+ * works using a licensed work, under the same license. Copyright and license notices 
+ * must be preserved. Contributors provide an express grant of patent rights.]
+ * You should have received a copy of the GNU Affero General Public License along 
+ * with this program. If not, see <https://www.gnu.org/licenses/>.
+ *******************************************************************************/
+
+// @PUBLIC_HEADER
+/** @file
+ * node statistics and verified blockhashes shared by all processes of a host.
+ * 
+ * Each process learns the latency of the nodes, which nodes to blacklist and which blockhashes are already verified.
+ * If several processes use the same chain (like a prefork server), they can attach to the same shared memory segment,
+ * so a node blacklisted by one process will not be asked by the others and a verified blockhash is known by all of them.
+ * 
+ * The segment is created with `shm_open` and only updated with atomic operations, so no locks are needed and a crashed process can not block the others.
+ * It holds a slot for up to `IN3_SHARED_MAX_NODES` nodes (found by their address) and a ring of the last `IN3_SHARED_MAX_HASHES` verified blockhashes.
+ * Before the client picks the nodes for a request, the weights and the verified hashes of the chain are updated from the segment.
+ * 
+ * This is only available if the library was build with the SHARED_STATS-option (posix only).
+ * 
+ * ```c
+ * in3_t* c = in3_for_chain(CHAIN_ID_MAINNET);
+ * if (in3_shared_stats_attach(c, CHAIN_ID_MAINNET, "myapp") != IN3_OK) 
+ *    in3_log_warn("shared stats are not available");
+ * ```
+ * */
+
+#include "client.h"
+#include <stdint.h>
+
+#ifndef IN3_SHARED_STATS_H
+#define IN3_SHARED_STATS_H
+
+#define IN3_SHARED_VERSION    1   /**< the version of the layout of the segment. Processes with a different version can not attach. */
+#define IN3_SHARED_MAX_NODES  256 /**< max number of nodes per segment. Nodes which do not fit are only tracked by the process itself. */
+#define IN3_SHARED_MAX_HASHES 64  /**< number of verified blockhashes kept in the ring of the segment */
+
+#ifdef SHARED_STATS
+
+/**
+ * attaches the chain to the shared segment `/in3-<name>-<chain_id>`, which is created if it does not exist yet.
+ * 
+ * The current weights and verified hashes of the chain are added to the segment, if the nodes are not known yet.
+ * The segment is detached when the client is freed.
+ * 
+ * @returns IN3_OK, IN3_EFIND if the chain is not registered or IN3_EUNKNOWN if the segment could not be opened or has a different layout.
+ */
+NONULL in3_ret_t in3_shared_stats_attach(
+    in3_t*      c,        /**< the incubed client */
+    chain_id_t  chain_id, /**< the chain */
+    const char* name      /**< the name of the segment, which must be the same for all processes sharing the stats */
+);
+
+/** detaches the chain from the shared segment. The segment itself stays until it is removed with `in3_shared_stats_unlink`. */
+NONULL void in3_shared_stats_detach(
+    in3_chain_t* chain /**< the chain */
+);
+
+/** removes the segment, so the next process attaching will start with empty stats. Processes already attached keep their mapping. */
+NONULL in3_ret_t in3_shared_stats_unlink(
+    const char* name,    /**< the name of the segment */
+    chain_id_t  chain_id /**< the chain */
+);
+
+/** updates the weights and verified hashes of the chain with the values of the shared segment. */
+NONULL void in3_shared_sync(
+    in3_chain_t* chain,              /**< the chain */
+    uint16_t     max_verified_hashes /**< the size of `chain->verified_hashes` */
+);
+
+/** adds a response time of the node to the shared segment. */
+NONULL void in3_shared_add_response_time(
+    const in3_chain_t* chain, /**< the chain */
+    const in3_node_t*  node,  /**< the node */
+    uint32_t           time   /**< the response time in ms */
+);
+
+/** sets the blacklisted_until-value of the node in the shared segment. */
+NONULL void in3_shared_blacklist(
+    const in3_chain_t* chain,   /**< the chain */
+    const uint8_t*     address, /**< the address of the node */
+    uint64_t           until    /**< the unix timestamp until the node is blacklisted or 0 to remove it from the blacklist */
+);
+
+/** adds a verified blockhash to the ring of the shared segment. */
+NONULL void in3_shared_add_verified(
+    const in3_chain_t* chain,  /**< the chain */
+    uint64_t           number, /**< the blocknumber */
+    const bytes32_t    hash    /**< the blockhash */
+);
+
+#else
+#define in3_shared_stats_detach(chain)                   ((void) (chain))
+#define in3_shared_sync(chain, max)                      ((void) (chain), (void) (max))
+#define in3_shared_add_response_time(chain, node, time)  ((void) (chain), (void) (node), (void) (time))
+#define in3_shared_blacklist(chain, address, until)      ((void) (chain), (void) (address), (void) (until))
+#define in3_shared_add_verified(chain, number, hash)     ((void) (chain), (void) (number), (void) (hash))
+#endif
+
+#endif
@@ -0,0 +1,89 @@
+/*******************************************************************************
+ * This file is part of the Incubed project.
+ * Sources: https://github.com/slockit/in3-c
+ * 
+ * Copyright (C) 2018-2020 slock.it GmbH, Blockchains LLC
+ * 
+ * 
+ * COMMERCIAL LICENSE USAGE
+ * 
+ * Licensees holding a valid commercial license may use this file in accordance 
+ * with the commercial license agreement provided with the Software or, alternatively, 
+ * in accordance with the terms contained in a written agreement between you and 
+ * slock.it GmbH/Blockchains LLC. For licensing terms and conditions or further 
+ * information please contact slock.it at in3@slock.it.
+ * 	
+ * Alternatively, this file may be used under the AGPL license as follows:
+ *    
+ * AGPL LICENSE USAGE
+ * 
+ * This program is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Affero General Public License as published by the Free Software 
+ * Foundation, either version 3 of the License, or (at your option) any later version.
+ *  
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY 
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A 
+ * PARTICULAR PURPOSE. See the GNU Affero General Public License for more details.
+ * [Permissions of this strong copyleft license are conditioned on making available 
+ * complete source code of licensed works and modifications, which include larger 
+ * works using a licensed work, under the same license. Copyright and license notices 
+ * must be preserved. Contributors provide an express grant of patent rights.]
+ * You should have received a copy of the GNU Affero General Public License along 
+ * with this program. If not, see <https://www.gnu.org/licenses/>.
+ *******************************************************************************/
+
+// @PUBLIC_HEADER
+/** @file
+ * snapshots of the state of a client.
+ * 
+ * A snapshot holds the configuration and the state of all chains (nodelists, weights, verified blockhashes, whitelists)
+ * in a compact binary format. Loading it only reads the buffer, so a short-lived process can mmap a snapshot written by an earlier run
+ * and start without parsing a configuration, reading the cache key by key or updating the nodelist.
+ * 
+ * Signer, storage, transport and the private key are not part of the snapshot. 
+ * State managed by the verifiers (like the validator history) is still read from the storage handler when needed.
+ * 
+ * ```c
+ * // after the client is configured and has been used
+ * bytes_t* snapshot = in3_snapshot_save(c);
+ * write_file("in3.snapshot", snapshot);
+ * b_free(snapshot);
+ * 
+ * // in the next process
+ * in3_t* c = in3_for_chain(0);
+ * bytes_t data = mmap_file("in3.snapshot");
+ * if (in3_snapshot_load(c, &data) != IN3_OK) in3_configure(c, config);
+ * ```
+ * */
+
+#include "bytes.h"
+#include "client.h"
+
+#ifndef IN3_SNAPSHOT_H
+#define IN3_SNAPSHOT_H
+
+#define IN3_SNAPSHOT_VERSION 1 /**< the version of the binary format. Snapshots with a different version are rejected. */
+
+/**
+ * writes the configuration and the state of all chains.
+ * 
+ * @returns the snapshot, which must be freed with `b_free`.
+ */
+NONULL bytes_t* in3_snapshot_save(
+    in3_t* c /**< the incubed client */
+);
+
+/**
+ * restores the configuration and the state of the chains from a snapshot.
+ * 
+ * Chains which are not part of the client yet will be registered. The data is only read, so it may point to a mapped file.
+ * The snapshot is checked completely before the client is changed, so if it is invalid, the client stays untouched.
+ * 
+ * @returns IN3_OK, IN3_EVERS if it was written by a different version or IN3_EINVALDT if the data is invalid.
+ */
+NONULL in3_ret_t in3_snapshot_load(
+    in3_t*         c,   /**< the incubed client */
+    const bytes_t* data /**< the snapshot */
+);
+
+#endif
@@ -0,0 +1,134 @@
+/*******************************************************************************
+ * This file is part of the Incubed project.
+ * Sources: https://github.com/slockit/in3-c
+ * 
+ * Copyright (C) 2018-2020 slock.it GmbH, Blockchains LLC
+ * 
+ * 
+ * COMMERCIAL LICENSE USAGE
+ * 
+ * Licensees holding a valid commercial license may use this file in accordance 
+ * with the commercial license agreement provided with the Software or, alternatively, 
+ * in accordance with the terms contained in a written agreement between you and 
+ * slock.it GmbH/Blockchains LLC. For licensing terms and conditions or further 
+ * information please contact slock.it at in3@slock.it.
+ * 	
+ * Alternatively, this file may be used under the AGPL license as follows:
+ *    
+ * AGPL LICENSE USAGE
+ * 
+ * This program is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Affero General Public License as published by the Free Software 
+ * Foundation, either version 3 of the License, or (at your option) any later version.
+ *  
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY 
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A 
+ * PARTICULAR PURPOSE. See the GNU Affero General Public License for more details.
+ * [Permissions of this strong copyleft license are conditioned on making available 
+ * complete source code of licensed works and modifications, which include larger 
+ * works using a licensed work, under the same license. Copyright and license notices 
+ * must be preserved. Contributors provide an express grant of patent rights.]
+ * You should have received a copy of the GNU Affero General Public License along 
+ * with this program. If not, see <https://www.gnu.org/licenses/>.
+ *******************************************************************************/
+
+// @PUBLIC_HEADER
+/** @file
+ * statistics about the requests handled by all clients of the process.
+ * 
+ * The registry is shared by all clients and may be updated from any thread without locking.
+ * Each metric is identified by its type and a label (like the method or the url of a node).
+ * Collecting the statistics can be turned off with the STATS-option, in which case `in3_get_stats` only returns the transport statistics.
+ * */
+
+#include "client.h"
+#include <stdint.h>
+
+#ifndef IN3_STATS_H
+#define IN3_STATS_H
+
+#ifndef IN3_STATS_MAX_ENTRIES
+#define IN3_STATS_MAX_ENTRIES 256 /**< max number of different labels for all metrics. If the registry is full, the label `other` is used. */
+#endif
+#define IN3_STATS_LABEL_LEN 48 /**< max length of a label including the terminating zero. longer labels will be cut. */
+#define IN3_STATS_BUCKETS 16   /**< number of buckets of a histogram */
+
+/** the type of a metric */
+typedef enum {
+  IN3_STAT_REQUESTS          = 0, /**< counter for the rpc-requests with the method as label */
+  IN3_STAT_TRANSPORT_LATENCY = 1, /**< histogram of the response time of the nodes with the url as label */
+  IN3_STAT_VERIFICATION      = 2, /**< histogram of the time to verify a response with the type of the verifier as label */
+  IN3_STAT_CACHE_HIT         = 3, /**< counter for found entries in the storage with the name of the cache as label */
+  IN3_STAT_CACHE_MISS        = 4, /**< counter for missing entries in the storage with the name of the cache as label */
+  IN3_STAT_BLACKLISTED       = 5, /**< counter for blacklisted nodes with the url as label */
+  IN3_STAT_NODELIST_UPDATE   = 6, /**< histogram of the duration of a nodelist update with the chain id as label */
+  IN3_STAT_TYPES             = 7  /**< number of types */
+} in3_stat_type_t;
+
+/** a counter or histogram */
+typedef struct in3_stat {
+  in3_stat_type_t type;                       /**< the type of metric */
+  char            label[IN3_STATS_LABEL_LEN]; /**< the label */
+  uint64_t        count;                      /**< the value of a counter or the number of observations of a histogram */
+  uint64_t        sum;                        /**< the sum of all observed values in us (only histograms) */
+  uint64_t        buckets[IN3_STATS_BUCKETS]; /**< the number of observations less or equal than `in3_stats_buckets[i]`, which are not in a lower bucket. (only histograms) */
+} in3_stat_t;
+
+/** a snapshot of the statistics */
+typedef struct in3_stats {
+  in3_stat_t*           entries;   /**< the metrics */
+  uint32_t              len;       /**< number of metrics */
+  in3_transport_stats_t transport; /**< the bytes sent and received by the transports */
+} in3_stats_t;
+
+/** the upper bounds of the buckets of a histogram in us */
+extern const uint64_t in3_stats_buckets[IN3_STATS_BUCKETS];
+
+/** returns true if the metric is a histogram */
+static inline bool in3_stats_is_histogram(in3_stat_type_t type) {
+  return type == IN3_STAT_TRANSPORT_LATENCY || type == IN3_STAT_VERIFICATION || type == IN3_STAT_NODELIST_UPDATE;
+}
+
+#ifdef STATS
+/** adds a value to a counter */
+void in3_stats_add(
+    in3_stat_type_t type,  /**< the type of metric */
+    const char*     label, /**< the label */
+    uint64_t        value  /**< the value to add */
+);
+
+/** adds an observation to a histogram */
+void in3_stats_observe(
+    in3_stat_type_t type,  /**< the type of metric */
+    const char*     label, /**< the label */
+    uint64_t        us     /**< the observed time in us */
+);
+
+/** returns the current time in us, which is used to measure durations */
+uint64_t in3_stats_time();
+#else
+#define in3_stats_add(type, label, value) ((void) (type), (void) (label), (void) (value))
+#define in3_stats_observe(type, label, us) ((void) (type), (void) (label), (void) (us))
+#define in3_stats_time()                   0
+#endif
+
+/**
+ * returns a snapshot of the statistics since the start of the process or the last reset.
+ * 
+ * The result must be freed with `in3_stats_free`.
+ */
+in3_stats_t* in3_get_stats();
+
+/** frees the snapshot. */
+void in3_stats_free(
+    in3_stats_t* stats /**< the snapshot */
+);
+
+/**
+ * resets all metrics.
+ * 
+ * Since the labels are removed, this must not be called while other threads are using clients.
+ */
+void in3_stats_reset();
+
+#endif
@@ -2,6 +2,7 @@
 #include "../../core/client/client.h"
 #include "../../core/client/context_internal.h"
 #include "../../core/client/keys.h"
+#include "../../core/client/stats.h"
 #include "../../core/util/bytes.h"
 #include "../../core/util/data.h"
 #include "../../core/util/mem.h"
@@ -88,6 +89,7 @@ in3_ret_t ens_resolve(in3_ctx_t* parent, char* name, const address_t registry, i
     cachekey = alloca(strlen(name) + 5);
     sprintf(cachekey, "ens:%s:%i", name, type);
     bytes_t* cached = parent->client->cache->get_item(parent->client->cache->cptr, cachekey);
+    in3_stats_add(cached ? IN3_STAT_CACHE_HIT : IN3_STAT_CACHE_MISS, "ens", 1);
     if (cached) {
       memcpy(dst, cached->data, 20);
       b_free(cached);
@@ -34,109 +34,709 @@
 
 #include "http_server.h"
 #include "../../core/client/context.h"
+#include "../../core/client/stats.h"
 #include "../../core/util/colors.h"
 #include "../../core/util/mem.h"
+#include "../../core/util/stringbuilder.h"
 #include <arpa/inet.h>
+#include <errno.h>
 #include <fcntl.h>
 #include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <pthread.h>
 #include <signal.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <strings.h>
 #include <sys/socket.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <unistd.h>
+#ifdef __linux__
+#include <sys/epoll.h>
+#else
+#include <poll.h>
+#endif
 
-#define MAX_CON 100
-
-static int listenfd, clients[MAX_CON];
-
-//client connection
-static void respond(int s, in3_t* in3) {
-  char* buf  = malloc(65535);
-  int   rcvd = recv(clients[s], buf, 65535, 0);
-
-  if (rcvd < 0) // receive error
-    fprintf(stderr, ("recv() error\n"));
-  else if (rcvd == 0) // receive socket closedMAX_CON
-    fprintf(stderr, "Client disconnected upexpectedly.\n");
-  else // message received
-  {
-    buf[rcvd] = '\0';
-
-    char* method = strtok(buf, " \t\r\n");
-    char* uri    = method ? strtok(NULL, " \t") : NULL;
-    char* prot   = uri ? strtok(NULL, " \t\r\n") : NULL;
-    char* rest   = prot ? strstr(prot + strlen(prot) + 1, "\n\r\n") : NULL;
-
-    dup2(clients[s], STDOUT_FILENO);
-    close(clients[s]);
-    if (rest) {
-      rest += 3;
-      if (strlen(rest) > 2 && (rest[0] == '{' || rest[0] == '[')) {
-        // execute in3
-        in3_ctx_t* ctx = ctx_new(in3, rest);
-        if (ctx == NULL)
-          printf("HTTP/1.1 500 Not Handled\r\n\r\nInvalid request.\r\n");
-        else if (ctx->error)
-          printf("HTTP/1.1 500 Not Handled\r\n\r\n%s\r\n", ctx->error);
-        else {
-          // execute it
-          fprintf(stderr, "RPC %s\n", d_get_string(ctx->request_context->result, "method")); //conceal typing and save position
-          if (in3_send_ctx(ctx) == IN3_OK) {
-            // the request was succesfull, so we delete interim errors (which can happen in case in3 had to retry)
-            if (ctx->error) _free(ctx->error);
-            ctx->error            = NULL;
-            str_range_t range     = d_to_json(ctx->responses[0]);
-            range.data[range.len] = 0;
-
-            // remove in3
-            char* end = strstr(range.data, ",\"in3\":");
-            if (end) {
-              *end   = '}';
-              end[1] = 0;
-            }
-            range.len = strlen(range.data);
-            printf("HTTP/1.1 200\r\nContent-Type: application/json; charset=utf-8\r\nContent-Length: %i\r\n\r\n%s\r\n", (int) range.len, range.data);
-          } else if (ctx->error)
-            printf("HTTP/1.1 500 Not Handled\r\n\r\n%s\r\n", ctx->error);
-          else
-            printf("HTTP/1.1 500 Not Handled\r\n\r\nCould not execute\r\n");
-        }
-        if (ctx)
-          ctx_free(ctx);
-
-      } else
-        rest = NULL;
-    }
-
-    if (!rest)
-      printf("HTTP/1.1 500 Not Handled\r\n\r\nThe server has no handler to the request.\r\n");
-
-    // tidy up
-    fflush(stdout);
-    shutdown(STDOUT_FILENO, SHUT_WR);
-    close(STDOUT_FILENO);
-  }
-
-  //Closing SOCKET
-  shutdown(clients[s], SHUT_RDWR); //All further send and recieve operations are DISABLED...
-  close(clients[s]);
-  clients[s] = -1;
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+#define HTTP_WORKERS 32               // number of threads executing requests, which mostly wait for the nodes.
+#define HTTP_MAX_EVENTS 64            // max number of events handled with one call
+#define HTTP_MAX_PIPELINE 16          // max number of requests per connection handled at the same time
+#define HTTP_READ_BUFFER 16384        // bytes to read with one call
+#define HTTP_MAX_HEADER 65536         // max size of the request header
+#define HTTP_MAX_BODY (32 << 20)      // max size of a request body
+#define CONTENT_JSON "application/json; charset=utf-8"
+#define CONTENT_TEXT "text/plain"
+#define CONTENT_METRICS "text/plain; version=0.0.4; charset=utf-8"
+
+struct http_req;
+
+/** a single rpc-request executed by a worker */
+typedef struct http_job {
+  struct http_req* req;    /**< the http-request this job belongs to */
+  char*            rpc;    /**< the rpc-request */
+  char*            result; /**< the rpc-response */
+  struct http_job* next;   /**< next job in the queue */
+} http_job_t;
+
+/** a http-request, which may contain a batch of rpc-requests */
+typedef struct http_req {
+  struct http_con* con;        /**< the connection */
+  http_job_t*      jobs;       /**< the rpc-requests */
+  int              len;        /**< number of rpc-requests */
+  int              pending;    /**< number of rpc-requests which are not finished yet */
+  bool             batch;      /**< if true, the response is an array */
+  bool             keep_alive; /**< if false, the connection will be closed after sending the response */
+  const char*      status;     /**< the status if the request is answered without executing it */
+  const char*      message;    /**< the response if the request is answered without executing it */
+  char*            body;       /**< the response if it was created when the request was received (like the metrics) */
+  struct http_req* next;       /**< next pipelined request of the connection */
+} http_req_t;
+
+/** a connection of a http-client */
+typedef struct http_con {
+  int         fd;         /**< the socket or -1 if the connection was closed while the workers were still busy */
+  sb_t        in;         /**< the received data, which are not handled yet */
+  sb_t        out;        /**< the data to send */
+  size_t      out_sent;   /**< number of bytes sent from out */
+  http_req_t* reqs;       /**< the requests, which are not answered yet in the order they were received */
+  int         reqs_len;   /**< number of requests not answered yet */
+  bool        closing;    /**< no more requests will be accepted and the connection will be closed as soon as all responses are sent */
+  bool        eof;        /**< the client will not send any more data */
+  bool        continued;  /**< the 100-continue has been sent for the current request */
+  bool        want_write; /**< true if we wait for the socket to be writeable */
+} http_con_t;
+
+/** the queue passing jobs between the event loop and the workers */
+typedef struct {
+  pthread_mutex_t lock;    /**< protects the lists */
+  pthread_cond_t  cond;    /**< signaled when there is a new job */
+  http_job_t*     first;   /**< first job to handle */
+  http_job_t*     last;    /**< last job to handle */
+  http_job_t*     done;    /**< handled jobs */
+  int             wake[2]; /**< pipe used by the workers to wake up the event loop */
+} http_queue_t;
+
+static http_queue_t       queue = {.lock = PTHREAD_MUTEX_INITIALIZER, .cond = PTHREAD_COND_INITIALIZER};
+static pthread_mutex_t    client_lock = PTHREAD_MUTEX_INITIALIZER; // the client is shared by all workers
+static in3_t*             client      = NULL;                      // the shared client
+static int                listenfd;
+static uint64_t           http_requests    = 0; // number of requests received
+static uint64_t           http_connections = 0; // number of open connections
+
+#ifdef __linux__
+static int epfd;
+static void ev_init() {
+  epfd = epoll_create1(0);
+}
+static void ev_set(int fd, void* ptr, bool read, bool write, int op) {
+  struct epoll_event ev = {.events = (read ? EPOLLIN : 0) | (write ? EPOLLOUT : 0), .data.ptr = ptr};
+  epoll_ctl(epfd, op, fd, &ev);
+}
+#define ev_add(fd, ptr) ev_set(fd, ptr, true, false, EPOLL_CTL_ADD)
+#define ev_mod(fd, ptr, read, write) ev_set(fd, ptr, read, write, EPOLL_CTL_MOD)
+#define ev_del(fd) epoll_ctl(epfd, EPOLL_CTL_DEL, fd, NULL)
+static int ev_wait(void** ptrs, int* readable, int* writeable) {
+  struct epoll_event events[HTTP_MAX_EVENTS];
+  int                n = epoll_wait(epfd, events, HTTP_MAX_EVENTS, -1);
+  for (int i = 0; i < n; i++) {
+    ptrs[i]      = events[i].data.ptr;
+    readable[i]  = events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR);
+    writeable[i] = events[i].events & EPOLLOUT;
+  }
+  return n;
+}
+#else
+// fallback for systems without epoll
+static struct pollfd* ev_fds  = NULL;
+static void**         ev_ptrs = NULL;
+static int            ev_len = 0, ev_size = 0;
+static void           ev_init() {}
+static void           ev_add(int fd, void* ptr) {
+  if (ev_len == ev_size) {
+    ev_fds  = _realloc(ev_fds, sizeof(struct pollfd) * (ev_size + 64), sizeof(struct pollfd) * ev_size);
+    ev_ptrs = _realloc(ev_ptrs, sizeof(void*) * (ev_size + 64), sizeof(void*) * ev_size);
+    ev_size += 64;
+  }
+  ev_fds[ev_len]    = (struct pollfd){.fd = fd, .events = POLLIN};
+  ev_ptrs[ev_len++] = ptr;
+}
+static void ev_mod(int fd, void* ptr, bool read, bool write) {
+  UNUSED_VAR(ptr);
+  for (int i = 0; i < ev_len; i++) {
+    if (ev_fds[i].fd == fd) ev_fds[i].events = (read ? POLLIN : 0) | (write ? POLLOUT : 0);
+  }
+}
+static void ev_del(int fd) {
+  for (int i = 0; i < ev_len; i++) {
+    if (ev_fds[i].fd != fd) continue;
+    ev_fds[i]  = ev_fds[--ev_len];
+    ev_ptrs[i] = ev_ptrs[ev_len];
+    return;
+  }
+}
+static int ev_wait(void** ptrs, int* readable, int* writeable) {
+  int n = 0;
+  if (poll(ev_fds, ev_len, -1) <= 0) return 0;
+  for (int i = 0; i < ev_len && n < HTTP_MAX_EVENTS; i++) {
+    if (!ev_fds[i].revents) continue;
+    ptrs[n]        = ev_ptrs[i];
+    readable[n]    = ev_fds[i].revents & (POLLIN | POLLHUP | POLLERR);
+    writeable[n++] = ev_fds[i].revents & POLLOUT;
+  }
+  return n;
 }
+#endif
 
-void http_run_server(const char* port, in3_t* in3) {
-  struct sockaddr_in clientaddr;
-  socklen_t          addrlen;
-  int                s = 0;
+static bool set_nonblocking(int fd) {
+  int flags = fcntl(fd, F_GETFL, 0);
+  return flags >= 0 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0;
+}
+
+static void add_header(sb_t* sb, const char* status, const char* content_type, size_t len, bool keep_alive) {
+  char header[200];
+  sprintf(header, "HTTP/1.1 %s\r\nContent-Type: %s\r\nContent-Length: %u\r\nConnection: %s\r\n\r\n",
+          status, content_type, (unsigned int) len, keep_alive ? "keep-alive" : "close");
+  sb_add_chars(sb, header);
+}
+
+static bool is_ws(char c) {
+  return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+static const char* skip_ws(const char* p, const char* end) {
+  while (p < end && is_ws(*p)) p++;
+  return p;
+}
+
+/** returns the position of the comma or closing bracket after the json-value starting at p or NULL if there is none. */
+static const char* value_end(const char* p, const char* end) {
+  int  depth  = 0;
+  bool string = false;
+  for (; p < end; p++) {
+    if (string) {
+      if (*p == '\\')
+        p++;
+      else if (*p == '"')
+        string = false;
+      continue;
+    }
+    switch (*p) {
+      case '"': string = true; break;
+      case '{':
+      case '[': depth++; break;
+      case '}':
+      case ']':
+        if (!depth--) return p;
+        break;
+      case ',':
+        if (!depth) return p;
+        break;
+    }
+  }
+  return NULL;
+}
+
+/** finds the value of a property of a json-object without parsing it. */
+static bool find_property(const char* data, const char* name, str_range_t* val) {
+  const char *end = data + strlen(data), *p = skip_ws(data, end);
+  size_t      l   = strlen(name);
+  if (p == end || *p != '{') return false;
+  // since the colon is not a delimiter, the end of the value is also the end of the property
+  for (p = skip_ws(p + 1, end); p < end && *p == '"';) {
+    const char* e = value_end(p, end);
+    if (!e) return false;
+    if ((size_t)(e - p) > l + 2 && !strncmp(p + 1, name, l) && p[l + 1] == '"') {
+      const char* v = skip_ws(p + l + 2, e);
+      if (v == e || *v != ':') return false;
+      v = skip_ws(v + 1, e);
+      while (e > v && is_ws(e[-1])) e--;
+      *val = (str_range_t){.data = (char*) v, .len = e - v};
+      return true;
+    }
+    if (*e == '}') return false;
+    p = skip_ws(e + 1, end);
+  }
+  return false;
+}
+
+/** executes a rpc-request. This function is called by the workers. */
+static char* execute(char* rpc) {
+  pthread_mutex_lock(&client_lock);
+  char* res = in3_client_exec_req(client, rpc);
+  pthread_mutex_unlock(&client_lock);
+  if (!res) res = _strdupn("{\"jsonrpc\":\"2.0\",\"id\":null,\"error\":{\"code\":-32603,\"message\":\"Could not execute\"}}", -1);
 
+  // responses created by the client itself do not use the id of the request, but the clients need it to match the responses of a batch.
+  str_range_t id, res_id;
+  if (find_property(rpc, "id", &id) && find_property(res, "id", &res_id) && (id.len != res_id.len || strncmp(id.data, res_id.data, id.len))) {
+    size_t start = res_id.data - res;
+    char*  tmp   = _malloc(strlen(res) - res_id.len + id.len + 1);
+    memcpy(tmp, res, start);
+    memcpy(tmp + start, id.data, id.len);
+    strcpy(tmp + start + id.len, res_id.data + res_id.len);
+    _free(res);
+    res = tmp;
+  }
+  return res;
+}
+
+/** worker thread executing the jobs from the queue */
+static void* worker(void* arg) {
+  UNUSED_VAR(arg);
+  while (true) {
+    pthread_mutex_lock(&queue.lock);
+    while (!queue.first) pthread_cond_wait(&queue.cond, &queue.lock);
+    http_job_t* job = queue.first;
+    queue.first     = job->next;
+    if (!queue.first) queue.last = NULL;
+    pthread_mutex_unlock(&queue.lock);
+
+    job->result = execute(job->rpc);
+
+    pthread_mutex_lock(&queue.lock);
+    job->next  = queue.done;
+    queue.done = job;
+    pthread_mutex_unlock(&queue.lock);
+    if (write(queue.wake[1], "", 1) < 0 && errno != EAGAIN) perror("write() error");
+  }
+  return NULL;
+}
+
+/** passes all rpc-requests of the request to the workers, so they are executed concurrently */
+static void add_jobs(http_req_t* req) {
+  pthread_mutex_lock(&queue.lock);
+  for (int i = 0; i < req->len; i++) {
+    if (queue.last)
+      queue.last->next = req->jobs + i;
+    else
+      queue.first = req->jobs + i;
+    queue.last = req->jobs + i;
+  }
+  pthread_cond_broadcast(&queue.cond);
+  pthread_mutex_unlock(&queue.lock);
+}
+
+static void free_req(http_req_t* req) {
+  for (int i = 0; i < req->len; i++) {
+    if (req->jobs[i].rpc) _free(req->jobs[i].rpc);
+    if (req->jobs[i].result) _free(req->jobs[i].result);
+  }
+  if (req->jobs) _free(req->jobs);
+  if (req->body) _free(req->body);
+  _free(req);
+}
+
+static void free_con(http_con_t* con) {
+  while (con->reqs) {
+    http_req_t* req = con->reqs;
+    con->reqs       = req->next;
+    free_req(req);
+  }
+  _free(con->in.data);
+  _free(con->out.data);
+  _free(con);
+}
+
+/** returns true if a worker is still executing a job of the connection */
+static bool is_busy(http_con_t* con) {
+  for (http_req_t* req = con->reqs; req; req = req->next) {
+    if (req->pending) return true;
+  }
+  return false;
+}
+
+static void close_con(http_con_t* con) {
+  ev_del(con->fd);
+  close(con->fd);
+  con->fd = -1;
+  http_connections--;
+  if (!is_busy(con)) free_con(con); // otherwise the connection will be freed as soon as the workers are done.
+}
+
+/** appends a new request to the connection, so the responses are sent in the same order */
+static http_req_t* add_req(http_con_t* con, int len, bool keep_alive) {
+  http_req_t* req = _calloc(1, sizeof(http_req_t));
+  req->con        = con;
+  req->len        = req->pending = len;
+  req->keep_alive = keep_alive;
+  if (len) req->jobs = _calloc(len, sizeof(http_job_t));
+  for (int i = 0; i < len; i++) req->jobs[i].req = req;
+
+  http_req_t** p = &con->reqs;
+  while (*p) p = &(*p)->next;
+  *p = req;
+  con->reqs_len++;
+  if (!keep_alive) con->closing = true;
+  return req;
+}
+
+/** adds the responses of all finished requests at the beginning of the list to the output */
+static void add_responses(http_con_t* con) {
+  while (con->reqs && !con->reqs->pending) {
+    http_req_t* req = con->reqs;
+    con->reqs       = req->next;
+    con->reqs_len--;
+    if (req->body) {
+      add_header(&con->out, req->status, CONTENT_METRICS, strlen(req->body), req->keep_alive);
+      sb_add_chars(&con->out, req->body);
+    } else if (!req->len) {
+      add_header(&con->out, req->status, CONTENT_TEXT, strlen(req->message), req->keep_alive);
+      sb_add_chars(&con->out, req->message);
+    } else {
+      size_t len = req->batch ? req->len + 1 : 0; // brackets and commas
+      for (int i = 0; i < req->len; i++) len += strlen(req->jobs[i].result);
+      add_header(&con->out, "200 OK", CONTENT_JSON, len, req->keep_alive);
+      if (req->batch) sb_add_char(&con->out, '[');
+      for (int i = 0; i < req->len; i++) {
+        if (i) sb_add_char(&con->out, ',');
+        sb_add_chars(&con->out, req->jobs[i].result);
+      }
+      if (req->batch) sb_add_char(&con->out, ']');
+    }
+    free_req(req);
+  }
+}
+
+/** sends as much data as possible and returns false if the connection was closed. */
+static bool flush_con(http_con_t* con) {
+  while (con->out_sent < con->out.len) {
+    ssize_t n = send(con->fd, con->out.data + con->out_sent, con->out.len - con->out_sent, MSG_NOSIGNAL);
+    if (n < 0 && errno == EINTR) continue;
+    if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+    if (n <= 0) {
+      close_con(con);
+      return false;
+    }
+    con->out_sent += n;
+  }
+  bool pending = con->out_sent < con->out.len;
+  if (!pending) con->out.len = con->out_sent = 0;
+  if (!pending && !con->reqs && (con->closing || con->eof)) {
+    close_con(con);
+    return false;
+  }
+  if (pending != con->want_write) ev_mod(con->fd, con, !con->eof, pending);
+  con->want_write = pending;
+  return true;
+}
+
+/** returns the length of the header including the empty line or 0 if not complete yet */
+static size_t header_len(const sb_t* sb) {
+  for (size_t i = 3; i < sb->len; i++) {
+    if (sb->data[i] == '\n' && sb->data[i - 1] == '\r' && sb->data[i - 2] == '\n' && sb->data[i - 3] == '\r') return i + 1;
+  }
+  return 0;
+}
+
+/** finds the value of the header or returns NULL */
+static char* find_header(char* header, size_t len, const char* name, size_t* val_len) {
+  size_t l = strlen(name);
+  for (char *p = header, *end = header + len; p < end;) {
+    char* eol = p;
+    while (eol < end && *eol != '\r' && *eol != '\n') eol++;
+    if ((size_t)(eol - p) > l && p[l] == ':' && strncasecmp(p, name, l) == 0) {
+      p += l + 1;
+      while (p < eol && (*p == ' ' || *p == '\t')) p++;
+      *val_len = eol - p;
+      return p;
+    }
+    p = eol + 1;
+    while (p < end && *p == '\n') p++;
+  }
+  return NULL;
+}
+
+static bool has_token(const char* val, size_t len, const char* token) {
+  size_t l = strlen(token);
+  for (size_t i = 0; i + l <= len; i++) {
+    if (strncasecmp(val + i, token, l) == 0) return true;
+  }
+  return false;
+}
+
+static void add_error(http_con_t* con, const char* status, const char* message) {
+  http_req_t* req = add_req(con, 0, false);
+  req->status     = status;
+  req->message    = message;
+}
+
+/**
+ * splits a batch into the rpc-requests without parsing them, since the json-parser may only be used while holding the client.
+ * returns the number of rpc-requests and -1 if this is not an array.
+ */
+static int split_batch(const char* data, size_t len, str_range_t* ranges) {
+  const char *p = skip_ws(data, data + len), *end = data + len;
+  int         n = 0;
+  if (p == end || *p != '[') return -1;
+  p = skip_ws(p + 1, end);
+  if (p < end && *p == ']') return skip_ws(p + 1, end) == end ? 0 : -1;
+  while (p < end) {
+    const char* e = value_end(p, end);
+    if (!e) return -1;
+    if (ranges) ranges[n] = (str_range_t){.data = (char*) p, .len = e - p};
+    n++;
+    if (*e == ']') return skip_ws(e + 1, end) == end ? n : -1;
+    p = skip_ws(e + 1, end);
+  }
+  return -1;
+}
+
+/** creates the jobs for a json-rpc body, which is either a single request or a batch */
+static void add_rpc(http_con_t* con, char* body, size_t len, bool keep_alive) {
+  int n = split_batch(body, len, NULL);
+  if (n == 0) {
+    // an empty batch is answered with a single error
+    http_req_t* req   = add_req(con, 1, keep_alive);
+    req->pending      = 0;
+    req->jobs->result = _strdupn("{\"jsonrpc\":\"2.0\",\"id\":null,\"error\":{\"code\":-32600,\"message\":\"Invalid Request\"}}", -1);
+    return;
+  }
+  if (n < 0) {
+    // a single request or invalid json, which will be reported by the client
+    http_req_t* req = add_req(con, 1, keep_alive);
+    req->jobs->rpc  = _strdupn(body, len);
+    add_jobs(req);
+    return;
+  }
+
+  str_range_t* ranges = _malloc(sizeof(str_range_t) * n);
+  http_req_t*  req    = add_req(con, n, keep_alive);
+  split_batch(body, len, ranges);
+  for (int i = 0; i < n; i++) req->jobs[i].rpc = _strdupn(ranges[i].data, ranges[i].len);
+  req->batch = true;
+  _free(ranges);
+  add_jobs(req);
+}
+
+/** name, description and label of each metric in the prometheus format */
+static const char* metrics[IN3_STAT_TYPES][3] = {
+    {"in3_rpc_requests_total", "number of rpc-requests per method", "method"},
+    {"in3_transport_latency_seconds", "response time of the nodes", "node"},
+    {"in3_verification_seconds", "time to verify a response", "verifier"},
+    {"in3_cache_hits_total", "number of entries found in the storage", "cache"},
+    {"in3_cache_misses_total", "number of entries not found in the storage", "cache"},
+    {"in3_blacklisted_total", "number of times a node was blacklisted", "node"},
+    {"in3_nodelist_update_seconds", "duration of the nodelist updates", "chain"}};
+
+static void add_metric_header(sb_t* sb, const char* name, const char* help, const char* type) {
+  char tmp[300];
+  sprintf(tmp, "# HELP %s %s\n# TYPE %s %s\n", name, help, name, type);
+  sb_add_chars(sb, tmp);
+}
+
+static void add_metric_value(sb_t* sb, const char* name, const char* suffix, const char* label, const char* value, const char* le, double val) {
+  char tmp[100];
+  sb_add_chars(sb, name);
+  sb_add_chars(sb, suffix);
+  if (label) {
+    sb_add_char(sb, '{');
+    sb_add_chars(sb, label);
+    sb_add_chars(sb, "=\"");
+    for (const char* c = value; *c; c++) {
+      if (*c == '"' || *c == '\\') sb_add_char(sb, '\\');
+      if (*c == '\n')
+        sb_add_chars(sb, "\\n");
+      else
+        sb_add_char(sb, *c);
+    }
+    sb_add_char(sb, '"');
+    if (le) {
+      sb_add_chars(sb, ",le=\"");
+      sb_add_chars(sb, le);
+      sb_add_char(sb, '"');
+    }
+    sb_add_char(sb, '}');
+  }
+  sprintf(tmp, " %.15g\n", val);
+  sb_add_chars(sb, tmp);
+}
+
+/** creates the metrics in the prometheus text format */
+static char* create_metrics() {
+  in3_stats_t* stats = in3_get_stats();
+  sb_t         sb    = {0};
+  char         le[30];
+  uint32_t     i     = 0;
+  for (int type = 0; type < IN3_STAT_TYPES; type++) {
+    const char* name = metrics[type][0];
+    add_metric_header(&sb, name, metrics[type][1], in3_stats_is_histogram(type) ? "histogram" : "counter");
+    for (; i < stats->len && stats->entries[i].type == (in3_stat_type_t) type; i++) {
+      in3_stat_t* stat = stats->entries + i;
+      if (!in3_stats_is_histogram(type)) {
+        add_metric_value(&sb, name, "", metrics[type][2], stat->label, NULL, stat->count);
+        continue;
+      }
+      uint64_t count = 0;
+      for (int b = 0; b < IN3_STATS_BUCKETS; b++) {
+        count += stat->buckets[b];
+        sprintf(le, "%g", in3_stats_buckets[b] / 1000000.0);
+        add_metric_value(&sb, name, "_bucket", metrics[type][2], stat->label, le, count);
+      }
+      add_metric_value(&sb, name, "_bucket", metrics[type][2], stat->label, "+Inf", stat->count);
+      add_metric_value(&sb, name, "_sum", metrics[type][2], stat->label, NULL, stat->sum / 1000000.0);
+      add_metric_value(&sb, name, "_count", metrics[type][2], stat->label, NULL, stat->count);
+    }
+  }
+
+  add_metric_header(&sb, "in3_transport_sent_bytes_total", "number of bytes sent to the nodes before compression", "counter");
+  add_metric_value(&sb, "in3_transport_sent_bytes_total", "", NULL, NULL, NULL, stats->transport.bytes_sent);
+  add_metric_header(&sb, "in3_transport_sent_wire_bytes_total", "number of bytes sent to the nodes after compression", "counter");
+  add_metric_value(&sb, "in3_transport_sent_wire_bytes_total", "", NULL, NULL, NULL, stats->transport.bytes_sent_wire);
+  add_metric_header(&sb, "in3_transport_received_bytes_total", "number of bytes received from the nodes after decompression", "counter");
+  add_metric_value(&sb, "in3_transport_received_bytes_total", "", NULL, NULL, NULL, stats->transport.bytes_received);
+  add_metric_header(&sb, "in3_transport_received_wire_bytes_total", "number of bytes received from the nodes before decompression", "counter");
+  add_metric_value(&sb, "in3_transport_received_wire_bytes_total", "", NULL, NULL, NULL, stats->transport.bytes_received_wire);
+  add_metric_header(&sb, "in3_http_requests_total", "number of http-requests received by the server", "counter");
+  add_metric_value(&sb, "in3_http_requests_total", "", NULL, NULL, NULL, http_requests);
+  add_metric_header(&sb, "in3_http_connections", "number of open connections to the server", "gauge");
+  add_metric_value(&sb, "in3_http_connections", "", NULL, NULL, NULL, http_connections);
+
+  in3_stats_free(stats);
+  return sb.data;
+}
+
+/**
+ * parses the next complete request from the input buffer and either passes it to the workers or responds directly.
+ * returns false if there is no complete request yet.
+ */
+static bool next_request(http_con_t* con) {
+  size_t hlen = header_len(&con->in);
+  if (!hlen) {
+    if (con->in.len > HTTP_MAX_HEADER) add_error(con, "431 Request Header Fields Too Large", "The header is too large.");
+    return false;
+  }
+
+  char*  header     = con->in.data;
+  char*  line       = memchr(header, '\n', hlen);
+  size_t len      = 0;
+  char*  val      = NULL;
+  size_t body_len = 0;
+
+  // the protocol is the last word of the request line
+  bool keep_alive = line && line - header > 9 && strncmp(line - 9, "HTTP/1.1", 8) == 0;
+  if ((val = find_header(line, hlen - (line - header), "Connection", &len)))
+    keep_alive = has_token(val, len, "keep-alive") || (keep_alive && !has_token(val, len, "close"));
+  if (find_header(line, hlen - (line - header), "Transfer-Encoding", &len)) {
+    add_error(con, "411 Length Required", "Chunked requests are not supported.");
+    return false;
+  }
+  if ((val = find_header(line, hlen - (line - header), "Content-Length", &len))) body_len = strtoul(val, NULL, 10);
+  if (body_len > HTTP_MAX_BODY) {
+    add_error(con, "413 Payload Too Large", "The request is too large.");
+    return false;
+  }
+
+  if (con->in.len < hlen + body_len) {
+    // wait for the rest of the body
+    if (!con->continued && (val = find_header(line, hlen - (line - header), "Expect", &len)) && has_token(val, len, "100-continue")) {
+      sb_add_chars(&con->out, "HTTP/1.1 100 Continue\r\n\r\n");
+      con->continued = true;
+    }
+    return false;
+  }
+
+  char* body = header + hlen;
+  http_requests++;
+  if (body_len > 1 && (*body == '{' || *body == '['))
+    add_rpc(con, body, body_len, keep_alive);
+  else if (strncmp(header, "GET /metrics", 12) == 0 && (header[12] == ' ' || header[12] == '?')) {
+    http_req_t* req = add_req(con, 0, keep_alive);
+    req->status     = "200 OK";
+    req->body       = create_metrics();
+  } else {
+    http_req_t* req = add_req(con, 0, keep_alive);
+    req->status     = "500 Not Handled";
+    req->message    = "The server has no handler to the request.";
+  }
+
+  // remove the request from the buffer
+  con->in.len -= hlen + body_len;
+  memmove(con->in.data, con->in.data + hlen + body_len, con->in.len);
+  con->in.data[con->in.len] = 0;
+  con->continued            = false;
+  return true;
+}
+
+/** handles all complete requests in the buffer and sends the finished responses. returns false if the connection was closed. */
+static bool process_con(http_con_t* con) {
+  while (con->reqs_len < HTTP_MAX_PIPELINE && !con->closing && next_request(con)) {}
+  add_responses(con);
+  return flush_con(con);
+}
+
+/** called if data can be read from the connection and returns false if the connection was closed. */
+static bool read_con(http_con_t* con) {
+  char buf[HTTP_READ_BUFFER];
+  if (con->eof) {
+    // we only get here if the client hung up completely.
+    close_con(con);
+    return false;
+  }
+  while (!con->eof) {
+    ssize_t n = recv(con->fd, buf, sizeof(buf), 0);
+    if (n < 0 && errno == EINTR) continue;
+    if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+    if (n < 0) {
+      close_con(con);
+      return false;
+    }
+    if (n == 0) {
+      // the client will not send any more requests, but we still respond to the ones we already received.
+      con->eof = true;
+      ev_mod(con->fd, con, false, con->want_write);
+      break;
+    }
+    sb_add_range(&con->in, buf, 0, n);
+    if (con->in.len > HTTP_MAX_HEADER + HTTP_MAX_BODY) {
+      close_con(con);
+      return false;
+    }
+  }
+  return process_con(con);
+}
+
+/** called if a worker finished a job */
+static void finish_job(http_job_t* job) {
+  http_req_t* req = job->req;
+  http_con_t* con = req->con;
+  if (--req->pending) return;
+  if (con->fd >= 0)
+    process_con(con);
+  else if (!is_busy(con))
+    free_con(con); // the connection was closed while the workers were busy
+}
+
+static void accept_cons() {
+  while (true) {
+    struct sockaddr_in clientaddr;
+    socklen_t          addrlen = sizeof(clientaddr);
+    int                fd      = accept(listenfd, (struct sockaddr*) &clientaddr, &addrlen);
+    if (fd < 0) {
+      if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) perror("accept() error");
+      if (errno != EINTR) return;
+      continue;
+    }
+    int option = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &option, sizeof(option));
+    set_nonblocking(fd);
+    http_con_t* con = _calloc(1, sizeof(http_con_t));
+    con->fd         = fd;
+    http_connections++;
+    ev_add(fd, con);
+  }
+}
+
+void http_run_server(const char* port, in3_t* in3) {
   printf(
       "Server started %shttp://127.0.0.1:%s%s\n",
       COLORT_LIGHTGREEN, port, COLORT_RESET);
 
-  for (int i = 0; i < MAX_CON; i++) clients[i] = -1;
-
   // start the serevr
   struct addrinfo hints, *res, *p;
 
@@ -164,27 +764,59 @@ void http_run_server(const char* port, in3_t* in3) {
   freeaddrinfo(res);
 
   // listen for incoming connections
-  if (listen(listenfd, 1000000) != 0) {
+  if (listen(listenfd, SOMAXCONN) != 0 || !set_nonblocking(listenfd)) {
     perror("listen() error");
     exit(1);
   }
-  // Ignore SIGCHLD to avoid zombie threads
-  signal(SIGCHLD, SIG_IGN);
+  if (pipe(queue.wake) != 0 || !set_nonblocking(queue.wake[0]) || !set_nonblocking(queue.wake[1])) {
+    perror("pipe() error");
+    exit(1);
+  }
+  signal(SIGPIPE, SIG_IGN);
 
-  // ACCEPT connections
-  while (1) {
-    addrlen    = sizeof(clientaddr);
-    clients[s] = accept(listenfd, (struct sockaddr*) &clientaddr, &addrlen);
+  // all workers share the same client, which is locked for the whole request,
+  // since a nodelist update would free the nodes a waiting request still points to
+  client = in3;
+  for (int i = 0; i < HTTP_WORKERS; i++) {
+    pthread_t t;
+    if (pthread_create(&t, NULL, worker, NULL) != 0) {
+      perror("pthread_create() error");
+      exit(1);
+    }
+    pthread_detach(t);
+  }
 
-    if (clients[s] < 0) {
-      perror("accept() error");
-    } else {
-      if (fork() == 0) {
-        respond(s, in3);
-        exit(0);
+  ev_init();
+  ev_add(listenfd, &listenfd);
+  ev_add(queue.wake[0], queue.wake);
+
+  void* ptrs[HTTP_MAX_EVENTS];
+  int   readable[HTTP_MAX_EVENTS], writeable[HTTP_MAX_EVENTS];
+  while (true) {
+    int n = ev_wait(ptrs, readable, writeable);
+    if (n < 0 && errno != EINTR) perror("wait() error");
+    for (int i = 0; i < n; i++) {
+      if (ptrs[i] == &listenfd)
+        accept_cons();
+      else if (ptrs[i] == queue.wake) {
+        char buf[256];
+        while (read(queue.wake[0], buf, sizeof(buf)) > 0) {}
+      } else {
+        http_con_t* con = ptrs[i];
+        if (readable[i] && !read_con(con)) continue;
+        if (writeable[i]) flush_con(con);
       }
     }
 
-    while (clients[s] != -1) s = (s + 1) % MAX_CON;
+    // handle the finished requests
+    pthread_mutex_lock(&queue.lock);
+    http_job_t* done = queue.done;
+    queue.done       = NULL;
+    pthread_mutex_unlock(&queue.lock);
+    while (done) {
+      http_job_t* job = done;
+      done            = done->next;
+      finish_job(job);
+    }
   }
 }
@@ -0,0 +1,195 @@
+/*******************************************************************************
+ * This file is part of the Incubed project.
+ * Sources: https://github.com/slockit/in3-c
+ * 
+ * Copyright (C) 2018-2020 slock.it GmbH, Blockchains LLC
+ * 
+ * 
+ * COMMERCIAL LICENSE USAGE
+ * 
+ * Licensees holding a valid commercial license may use this file in accordance 
+ * with the commercial license agreement provided with the Software or, alternatively, 
+ * in accordance with the terms contained in a written agreement between you and 
+ * slock.it GmbH/Blockchains LLC. For licensing terms and conditions or further 
+ * information please contact slock.it at in3@slock.it.
+ * 	
+ * Alternatively, this file may be used under the AGPL license as follows:
+ *    
+ * AGPL LICENSE USAGE
+ * 
+ * This program is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Affero General Public License as published by the Free Software 
+ * Foundation, either version 3 of the License, or (at your option) any later version.
+ *  
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY 
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A 
+ * PARTICULAR PURPOSE. See the GNU Affero General Public License for more details.
+ * [Permissions of this strong copyleft license are conditioned on making available 
+ * complete source code of licensed works and modifications, which include larger 
+ * works using a licensed work, under the same license. Copyright and license notices 
+ * must be preserved. Contributors provide an express grant of patent rights.]
+ * You should have received a copy of the GNU Affero General Public License along 
+ * with this program. If not, see <https://www.gnu.org/licenses/>.
+ *******************************************************************************/
+
+#include "async_storage.h"
+#include "../../core/util/mem.h"
+#include "../../core/util/utils.h"
+#include <pthread.h>
+#include <string.h>
+
+/** a value waiting to be written */
+typedef struct pending_write {
+  char*                 key;   /**< the key */
+  bytes_t*              value; /**< the latest value for the key */
+  struct pending_write* next;  /**< the next write in the queue */
+} pending_write_t;
+
+typedef struct {
+  in3_storage_handler_t handler; /**< the wrapped handler */
+  pthread_mutex_t       lock;    /**< protects queue, writing and stop */
+  pthread_mutex_t       io;      /**< serializes the calls to the wrapped handler */
+  pthread_cond_t        changed; /**< signaled when a write is queued or done */
+  pending_write_t*      queue;   /**< the writes in the order they have been queued */
+  pending_write_t*      writing; /**< the write currently executed by the thread */
+  bool                  stop;    /**< if true the thread stops once the queue is empty */
+  pthread_t             thread;  /**< the thread executing the writes */
+} async_storage_t;
+
+static void free_write(pending_write_t* w) {
+  _free(w->key);
+  b_free(w->value);
+  _free(w);
+}
+
+static pending_write_t* find_write(async_storage_t* s, const char* key) {
+  for (pending_write_t* w = s->queue; w; w = w->next) {
+    if (!strcmp(w->key, key)) return w;
+  }
+  return s->writing && !strcmp(s->writing->key, key) ? s->writing : NULL;
+}
+
+static void* write_behind(void* arg) {
+  async_storage_t* s = arg;
+  pthread_mutex_lock(&s->lock);
+  while (true) {
+    while (!s->queue && !s->stop) pthread_cond_wait(&s->changed, &s->lock);
+    if (!s->queue) break;
+
+    pending_write_t* w = s->writing = s->queue;
+    s->queue                        = w->next;
+    pthread_mutex_unlock(&s->lock);
+
+    pthread_mutex_lock(&s->io);
+    s->handler.set_item(s->handler.cptr, w->key, w->value);
+    pthread_mutex_unlock(&s->io);
+
+    pthread_mutex_lock(&s->lock);
+    s->writing = NULL;
+    free_write(w);
+    pthread_cond_broadcast(&s->changed);
+  }
+  pthread_mutex_unlock(&s->lock);
+  return NULL;
+}
+
+static bytes_t* async_get_item(void* cptr, const char* key) {
+  async_storage_t* s = cptr;
+  pthread_mutex_lock(&s->lock);
+  pending_write_t* w   = find_write(s, key);
+  bytes_t*         res = w ? b_dup(w->value) : NULL;
+  pthread_mutex_unlock(&s->lock);
+  if (w) return res;
+
+  pthread_mutex_lock(&s->io);
+  res = s->handler.get_item(s->handler.cptr, key);
+  pthread_mutex_unlock(&s->io);
+  return res;
+}
+
+static void async_set_item(void* cptr, const char* key, bytes_t* value) {
+  async_storage_t* s = cptr;
+  pthread_mutex_lock(&s->lock);
+  pending_write_t* w = find_write(s, key);
+  if (w && w != s->writing) {
+    // not written yet, so we simply replace the value
+    b_free(w->value);
+    w->value = b_dup(value);
+  } else {
+    pending_write_t** last = &s->queue;
+    while (*last) last = &(*last)->next;
+    *last          = _calloc(1, sizeof(pending_write_t));
+    (*last)->key   = _strdupn(key, -1);
+    (*last)->value = b_dup(value);
+    pthread_cond_broadcast(&s->changed);
+  }
+  pthread_mutex_unlock(&s->lock);
+}
+
+static void async_clear(void* cptr) {
+  async_storage_t* s = cptr;
+  pthread_mutex_lock(&s->lock);
+  while (s->queue) {
+    pending_write_t* w = s->queue;
+    s->queue           = w->next;
+    free_write(w);
+  }
+  // a running write must be finished before we clear, or it would land afterwards
+  while (s->writing) pthread_cond_wait(&s->changed, &s->lock);
+
+  // holding the lock keeps the thread from starting the next write until the clear is done
+  pthread_mutex_lock(&s->io);
+  if (s->handler.clear) s->handler.clear(s->handler.cptr);
+  pthread_mutex_unlock(&s->io);
+  pthread_mutex_unlock(&s->lock);
+}
+
+static void flush(async_storage_t* s) {
+  pthread_mutex_lock(&s->lock);
+  while (s->queue || s->writing) pthread_cond_wait(&s->changed, &s->lock);
+  pthread_mutex_unlock(&s->lock);
+}
+
+static void async_free(void* cptr) {
+  async_storage_t* s = cptr;
+  pthread_mutex_lock(&s->lock);
+  s->stop = true;
+  pthread_cond_broadcast(&s->changed);
+  pthread_mutex_unlock(&s->lock);
+
+  // the thread writes all pending values before it stops
+  pthread_join(s->thread, NULL);
+  if (s->handler.free) s->handler.free(s->handler.cptr);
+  pthread_cond_destroy(&s->changed);
+  pthread_mutex_destroy(&s->io);
+  pthread_mutex_destroy(&s->lock);
+  _free(s);
+}
+
+in3_storage_handler_t* storage_async(in3_t* c) {
+  if (!c->cache) return NULL;
+  async_storage_t* s = _calloc(1, sizeof(async_storage_t));
+  s->handler         = *c->cache;
+  pthread_mutex_init(&s->lock, NULL);
+  pthread_mutex_init(&s->io, NULL);
+  pthread_cond_init(&s->changed, NULL);
+  if (pthread_create(&s->thread, NULL, write_behind, s)) {
+    pthread_cond_destroy(&s->changed);
+    pthread_mutex_destroy(&s->io);
+    pthread_mutex_destroy(&s->lock);
+    _free(s);
+    return NULL;
+  }
+
+  // the handler is changed in place, since it may be shared with other clients
+  c->cache->get_item = async_get_item;
+  c->cache->set_item = async_set_item;
+  c->cache->clear    = async_clear;
+  c->cache->free     = async_free;
+  c->cache->cptr     = s;
+  return c->cache;
+}
+
+void storage_async_flush(in3_storage_handler_t* handler) {
+  if (handler && handler->get_item == async_get_item) flush(handler->cptr);
+}
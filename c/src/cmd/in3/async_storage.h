@@ -0,0 +1,57 @@
+/*******************************************************************************
+ * This file is part of the Incubed project.
+ * Sources: https://github.com/slockit/in3-c
+ * 
+ * Copyright (C) 2018-2020 slock.it GmbH, Blockchains LLC
+ * 
+ * 
+ * COMMERCIAL LICENSE USAGE
+ * 
+ * Licensees holding a valid commercial license may use this file in accordance 
+ * with the commercial license agreement provided with the Software or, alternatively, 
+ * in accordance with the terms contained in a written agreement between you and 
+ * slock.it GmbH/Blockchains LLC. For licensing terms and conditions or further 
+ * information please contact slock.it at in3@slock.it.
+ * 	
+ * Alternatively, this file may be used under the AGPL license as follows:
+ *    
+ * AGPL LICENSE USAGE
+ * 
+ * This program is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Affero General Public License as published by the Free Software 
+ * Foundation, either version 3 of the License, or (at your option) any later version.
+ *  
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY 
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A 
+ * PARTICULAR PURPOSE. See the GNU Affero General Public License for more details.
+ * [Permissions of this strong copyleft license are conditioned on making available 
+ * complete source code of licensed works and modifications, which include larger 
+ * works using a licensed work, under the same license. Copyright and license notices 
+ * must be preserved. Contributors provide an express grant of patent rights.]
+ * You should have received a copy of the GNU Affero General Public License along 
+ * with this program. If not, see <https://www.gnu.org/licenses/>.
+ *******************************************************************************/
+
+/** 
+ * storage handler writing values in a background thread.
+ *
+ * The wrapped handler is called by one thread only, so it does not need to be threadsafe.
+ * Multiple writes to the same key are combined as long as the value has not been written yet.
+ * Values which are still waiting to be written are returned by get_item, so reading stays consistent.
+ */
+
+#include "../../core/client/client.h"
+
+/**
+ * replaces the storage handler of the client with a handler which queues all writes and returns immediately.
+ *
+ * All pending writes are executed when the client is freed or when calling `storage_async_flush`.
+ *
+ * @returns the new storage handler or NULL if the client has no storage handler or the thread could not be started.
+ */
+in3_storage_handler_t* storage_async(in3_t* c);
+
+/**
+ * waits until all pending writes are done.
+ */
+void storage_async_flush(in3_storage_handler_t* handler);
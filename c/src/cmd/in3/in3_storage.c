@@ -1,4 +1,3 @@
-
 /*******************************************************************************
  * This file is part of the Incubed project.
  * Sources: https://github.com/slockit/in3-c
@@ -36,21 +35,67 @@
 #include "in3_storage.h"
 #include "../../core/client/client.h"
 #include "../../core/util/mem.h"
+#include "../../core/util/utils.h"
 
+#include <fcntl.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/stat.h>
+#include <sys/types.h>
 
 #if defined(_WIN32)
 #include <direct.h>
-#include <dirent.h>
+#include <io.h>
+#ifdef __MINGW32__
+#include <unistd.h>
+#endif
 #else
-#include <ftw.h>
-#include <sys/stat.h>
-#include <sys/types.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <unistd.h>
 #endif
 
-static char* _HOME_DIR = NULL;
+#ifndef O_BINARY
+#define O_BINARY 0
+#endif
+
+#define STORE_FILE       "cache.db"
+#define HEADER_SIZE      8       /**< the magic bytes and the version */
+#define RECORD_HEADER    12      /**< checksum, key length and value length, each as uint32 little endian */
+#define MIN_COMPACT_SIZE 0x10000 /**< files smaller than this are never compacted */
+#define MAP_ALIGN        0x10000 /**< the mapping is rounded up to this size, so appending does not need a new mapping every time */
+#define FNV_OFFSET       2166136261u
+#define FNV_PRIME        16777619u
+
+static const uint8_t HEADER[HEADER_SIZE] = {'I', 'N', '3', 'S', 1, 0, 0, 0};
+
+/** an entry in the index pointing to the latest record of a key. */
+typedef struct {
+  uint32_t hash;   /**< the hash of the key */
+  uint32_t len;    /**< the length of the record or 0 if the slot is free */
+  uint64_t offset; /**< the offset of the record within the file */
+} entry_t;
+
+struct in3_store {
+  char*    path;     /**< the path of the file */
+  int      fd;       /**< the file or -1 if not opened yet */
+  int      lock_fd;  /**< the lockfile used to synchronize processes */
+  uint8_t* data;     /**< the content of the file */
+  size_t   mapped;   /**< the size of the mapping, which may be larger than the file */
+  size_t   size;     /**< the number of verified and indexed bytes */
+  size_t   live;     /**< the number of bytes used by the current records */
+  entry_t* index;    /**< hashtable with open addressing */
+  uint32_t capacity; /**< the number of slots in the index (always a power of 2) */
+  uint32_t used;     /**< the number of used slots */
+#ifndef _WIN32
+  ino_t ino; /**< the inode of the opened file, used to detect a compaction by another process */
+#endif
+};
+
+static char*        _HOME_DIR      = NULL;
+static in3_store_t* _DEFAULT_STORE = NULL;
+
 static char* get_storage_dir() {
   if (_HOME_DIR == NULL) {
 #if defined(_WIN32)
@@ -73,94 +118,310 @@ static char* get_storage_dir() {
   return _HOME_DIR;
 }
 
-static char* create_path(const char* key) {
-  char* path = _malloc(strlen(get_storage_dir()) + strlen(key) + 5);
-  sprintf(path, "%s%s", get_storage_dir(), key);
-  return path;
+static in3_store_t* get_store(void* cptr) {
+  if (cptr) return cptr;
+  if (!_DEFAULT_STORE) {
+    char* path = _malloc(strlen(get_storage_dir()) + strlen(STORE_FILE) + 1);
+    sprintf(path, "%s%s", get_storage_dir(), STORE_FILE);
+    _DEFAULT_STORE = store_open(path);
+    _free(path);
+  }
+  return _DEFAULT_STORE;
 }
 
-bytes_t* storage_get_item(void* cptr, const char* key) {
-  UNUSED_VAR(cptr);
-  char* path = create_path(key);
-
-  FILE* file = fopen(path, "r");
-  if (file) {
-    size_t   allocated = 1024;
-    size_t   len       = 0;
-    uint8_t* buffer    = _malloc(1024);
-    size_t   r;
-
-    while (1) {
-      r = fread(buffer + len, 1, allocated - len, file);
-      len += r;
-      if (feof(file)) break;
-      size_t new_alloc = allocated * 2 + 1;
-      buffer           = _realloc(buffer, new_alloc, allocated);
-      allocated        = new_alloc;
-    }
-    fclose(file);
+static inline uint32_t read_u32(const uint8_t* p) {
+  return (uint32_t) p[0] | ((uint32_t) p[1] << 8) | ((uint32_t) p[2] << 16) | ((uint32_t) p[3] << 24);
+}
+
+static inline void write_u32(uint8_t* p, uint32_t val) {
+  p[0] = val & 0xff;
+  p[1] = (val >> 8) & 0xff;
+  p[2] = (val >> 16) & 0xff;
+  p[3] = (val >> 24) & 0xff;
+}
+
+static uint32_t fnv(const uint8_t* data, size_t len) {
+  uint32_t h = FNV_OFFSET;
+  for (size_t i = 0; i < len; i++) h = (h ^ data[i]) * FNV_PRIME;
+  return h;
+}
+
+static bool write_at(int fd, const uint8_t* data, size_t len, size_t offset) {
+#if defined(_WIN32)
+  if (lseek(fd, (long) offset, SEEK_SET) < 0) return false;
+#endif
+  while (len) {
+#if defined(_WIN32)
+    int n = write(fd, data, (unsigned int) len);
+#else
+    ssize_t n = pwrite(fd, data, len, (off_t) offset);
+#endif
+    if (n <= 0) return false;
+    data += n;
+    len -= n;
+    offset += n;
+  }
+  return true;
+}
+
+static void lock(in3_store_t* s, bool exclusive) {
+#if defined(_WIN32)
+  UNUSED_VAR(s);
+  UNUSED_VAR(exclusive);
+#else
+  if (s->lock_fd >= 0) flock(s->lock_fd, exclusive ? LOCK_EX : LOCK_SH);
+#endif
+}
 
-    bytes_t* res = _malloc(sizeof(bytes_t));
-    res->data    = buffer;
-    res->len     = len;
-    return res;
+static void unlock(in3_store_t* s) {
+#if defined(_WIN32)
+  UNUSED_VAR(s);
+#else
+  if (s->lock_fd >= 0) flock(s->lock_fd, LOCK_UN);
+#endif
+}
+
+static void close_file(in3_store_t* s) {
+  if (s->data) {
+#if defined(_WIN32)
+    _free(s->data);
+#else
+    munmap(s->data, s->mapped);
+#endif
   }
-  return NULL;
+  if (s->fd >= 0) close(s->fd);
+  if (s->index) memset(s->index, 0, s->capacity * sizeof(entry_t));
+  s->fd     = -1;
+  s->data   = NULL;
+  s->mapped = 0;
+  s->size   = 0;
+  s->live   = 0;
+  s->used   = 0;
 }
 
-void storage_set_item(void* cptr, const char* key, bytes_t* content) {
-  UNUSED_VAR(cptr);
-  char* path = create_path(key);
-  FILE* file = fopen(path, "wb");
-  if (file) {
-    fwrite(content->data, sizeof(uint8_t), content->len, file);
-    fclose(file);
+static bool open_file(in3_store_t* s) {
+  struct stat st;
+  uint8_t     header[HEADER_SIZE];
+  s->fd = open(s->path, O_RDWR | O_CREAT | O_BINARY, 0666);
+  if (s->fd < 0) return false;
+  if (fstat(s->fd, &st)) return false;
+#ifndef _WIN32
+  s->ino = st.st_ino;
+#endif
+
+  // a new or unknown file will be initialized, since it only holds cached data
+  if (st.st_size < HEADER_SIZE || lseek(s->fd, 0, SEEK_SET) || read(s->fd, header, HEADER_SIZE) != HEADER_SIZE || memcmp(header, HEADER, HEADER_SIZE)) {
+    if (ftruncate(s->fd, 0) || !write_at(s->fd, HEADER, HEADER_SIZE, 0)) return false;
   }
-  _free(path);
+  s->size = HEADER_SIZE;
+  return true;
 }
 
+/** makes sure the first `size` bytes of the file are accessible in s->data. */
+static bool map_file(in3_store_t* s, size_t size) {
 #if defined(_WIN32)
-static void rm_recurs(const char* path) {
-  struct dirent* entry = NULL;
-  DIR*           dir   = NULL;
-  dir                  = opendir(path);
-  while ((entry = readdir(dir))) {
-    DIR*  sub_dir       = NULL;
-    FILE* file          = NULL;
-    char  abs_path[270] = {0};
-    if (*(entry->d_name) != '.') {
-      sprintf(abs_path, "%s/%s", path, entry->d_name);
-      if ((sub_dir = opendir(abs_path))) {
-        closedir(sub_dir);
-        rm_recurs(abs_path);
-      } else {
-        if ((file = fopen(abs_path, "r"))) {
-          fclose(file);
-          remove(abs_path);
-        }
-      }
+  // without mmap we read the bytes we have not verified yet, since an interrupted write may have been replaced.
+  s->data   = _realloc(s->data, size, s->mapped);
+  s->mapped = size;
+  if (lseek(s->fd, (long) s->size, SEEK_SET) < 0) return false;
+  for (size_t pos = s->size; pos < size;) {
+    int n = read(s->fd, s->data + pos, (unsigned int) (size - pos));
+    if (n <= 0) return false;
+    pos += n;
+  }
+#else
+  if (size <= s->mapped) return true;
+  if (s->data) munmap(s->data, s->mapped);
+  s->mapped = (size * 2 + MAP_ALIGN - 1) & ~((size_t) MAP_ALIGN - 1);
+  s->data   = mmap(NULL, s->mapped, PROT_READ, MAP_SHARED, s->fd, 0);
+  if (s->data == MAP_FAILED) {
+    s->data   = NULL;
+    s->mapped = 0;
+    return false;
+  }
+#endif
+  return true;
+}
+
+static entry_t* find_entry(in3_store_t* s, uint32_t hash, const uint8_t* key, uint32_t key_len) {
+  for (uint32_t i = hash & (s->capacity - 1);; i = (i + 1) & (s->capacity - 1)) {
+    entry_t* e = s->index + i;
+    if (!e->len) return e;
+    if (e->hash == hash && read_u32(s->data + e->offset + 4) == key_len && !memcmp(s->data + e->offset + RECORD_HEADER, key, key_len)) return e;
+  }
+}
+
+static void grow_index(in3_store_t* s) {
+  uint32_t capacity = s->capacity ? s->capacity * 2 : 64;
+  entry_t* index    = _calloc(capacity, sizeof(entry_t));
+  for (uint32_t n = 0; n < s->capacity; n++) {
+    if (!s->index[n].len) continue;
+    uint32_t i = s->index[n].hash & (capacity - 1);
+    while (index[i].len) i = (i + 1) & (capacity - 1);
+    index[i] = s->index[n];
+  }
+  if (s->index) _free(s->index);
+  s->index    = index;
+  s->capacity = capacity;
+}
+
+/** verifies and indexes all complete records up to the given size. */
+static void scan(in3_store_t* s, size_t size) {
+  while (s->size + RECORD_HEADER <= size) {
+    uint8_t* record  = s->data + s->size;
+    uint32_t key_len = read_u32(record + 4);
+    uint64_t len     = (uint64_t) RECORD_HEADER + key_len + read_u32(record + 8);
+    if (s->size + len > size || fnv(record + 4, len - 4) != read_u32(record)) break;
+
+    if ((s->used + 1) * 2 > s->capacity) grow_index(s);
+    uint32_t hash = fnv(record + RECORD_HEADER, key_len);
+    entry_t* e    = find_entry(s, hash, record + RECORD_HEADER, key_len);
+    if (e->len)
+      s->live -= e->len;
+    else
+      s->used++;
+    e->hash   = hash;
+    e->len    = (uint32_t) len;
+    e->offset = s->size;
+    s->live += len;
+    s->size += len;
+  }
+}
+
+/** updates the index with the records written since the last call. Must be called while holding the lock. */
+static bool refresh(in3_store_t* s, size_t* file_size) {
+  struct stat st;
+#ifndef _WIN32
+  // the file may have been replaced by another process
+  if (s->fd >= 0 && (stat(s->path, &st) || st.st_ino != s->ino)) close_file(s);
+#endif
+  if (s->fd < 0 && !open_file(s)) {
+    close_file(s);
+    return false;
+  }
+  if (fstat(s->fd, &st)) return false;
+  if ((size_t) st.st_size < s->size) {
+    // truncated by somebody else, so we start all over
+    close_file(s);
+    return refresh(s, file_size);
+  }
+  if ((size_t) st.st_size > s->size) {
+    if (!map_file(s, st.st_size)) {
+      close_file(s);
+      return false;
     }
+    scan(s, st.st_size);
   }
-  remove(path);
+  if (file_size) *file_size = st.st_size;
+  return true;
 }
+
+/** writes all current records (or none if cleared) to a new file and replaces the old one. Must be called while holding the exclusive lock. */
+static void compact(in3_store_t* s, bool clear) {
+  size_t   len = HEADER_SIZE + (clear ? 0 : s->live), pos = HEADER_SIZE;
+  uint8_t* buf = _malloc(len);
+  char*    tmp = _malloc(strlen(s->path) + 5);
+  memcpy(buf, HEADER, HEADER_SIZE);
+  for (uint32_t i = 0; i < s->capacity && !clear; i++) {
+    if (!s->index[i].len) continue;
+    memcpy(buf + pos, s->data + s->index[i].offset, s->index[i].len);
+    pos += s->index[i].len;
+  }
+  sprintf(tmp, "%s.tmp", s->path);
+
+  // the new file must be complete on disk before it replaces the old one
+  int  fd = open(tmp, O_RDWR | O_CREAT | O_TRUNC | O_BINARY, 0666);
+  bool ok = fd >= 0 && write_at(fd, buf, len, 0);
+#if defined(_WIN32)
+  ok = ok && !_commit(fd);
 #else
-static int unlink_cb(const char* fpath, const struct stat* sb, int typeflag, struct FTW* ftwbuf) {
-  UNUSED_VAR(sb);
-  UNUSED_VAR(typeflag);
-  UNUSED_VAR(ftwbuf);
-  return remove(fpath);
+  ok = ok && !fsync(fd);
+#endif
+  if (fd >= 0) close(fd);
+  close_file(s);
+#if defined(_WIN32)
+  if (ok) remove(s->path);
+#endif
+  if (!ok || rename(tmp, s->path)) remove(tmp);
+
+  _free(tmp);
+  _free(buf);
+  refresh(s, NULL);
+}
+
+in3_store_t* store_open(const char* path) {
+  in3_store_t* s = _calloc(1, sizeof(in3_store_t));
+  char*        lock_path = _malloc(strlen(path) + 6);
+  sprintf(lock_path, "%s.lock", path);
+  s->path    = _strdupn(path, -1);
+  s->fd      = -1;
+  s->lock_fd = open(lock_path, O_RDWR | O_CREAT | O_BINARY, 0666);
+  _free(lock_path);
+
+  lock(s, false);
+  bool ok = refresh(s, NULL);
+  unlock(s);
+  if (ok) return s;
+  store_close(s);
+  return NULL;
 }
 
-static void rm_recurs(const char* dir) {
-  nftw(dir, unlink_cb, 64, FTW_DEPTH | FTW_PHYS);
+void store_close(in3_store_t* s) {
+  close_file(s);
+  if (s->lock_fd >= 0) close(s->lock_fd);
+  if (s->index) _free(s->index);
+  _free(s->path);
+  _free(s);
+}
+
+bytes_t* storage_get_item(void* cptr, const char* key) {
+  in3_store_t* s = get_store(cptr);
+  if (!s) return NULL;
+
+  bytes_t* res = NULL;
+  lock(s, false);
+  if (refresh(s, NULL) && s->used) {
+    uint32_t key_len = strlen(key);
+    entry_t* e       = find_entry(s, fnv((uint8_t*) key, key_len), (uint8_t*) key, key_len);
+    if (e->len) res = b_new(s->data + e->offset + RECORD_HEADER + key_len, e->len - RECORD_HEADER - key_len);
+  }
+  unlock(s);
+  return res;
+}
+
+void storage_set_item(void* cptr, const char* key, bytes_t* content) {
+  in3_store_t* s = get_store(cptr);
+  if (!s) return;
+
+  uint32_t key_len = strlen(key);
+  size_t   len     = RECORD_HEADER + key_len + content->len, file_size = 0;
+  uint8_t* record  = _malloc(len);
+  write_u32(record + 4, key_len);
+  write_u32(record + 8, content->len);
+  memcpy(record + RECORD_HEADER, key, key_len);
+  if (content->len) memcpy(record + RECORD_HEADER + key_len, content->data, content->len);
+  write_u32(record, fnv(record + 4, len - 4));
+
+  lock(s, true);
+  if (refresh(s, &file_size)) {
+    entry_t* e = s->used ? find_entry(s, fnv(record + RECORD_HEADER, key_len), record + RECORD_HEADER, key_len) : NULL;
+
+    // values like the nodelist are written again even if they did not change
+    if (!e || e->len != len || memcmp(s->data + e->offset, record, len)) {
+      // cut off what is left of an interrupted write
+      bool ok = file_size == s->size || !ftruncate(s->fd, s->size);
+      if (ok && write_at(s->fd, record, len, s->size)) refresh(s, NULL);
+      if (s->size > MIN_COMPACT_SIZE && s->live * 2 < s->size) compact(s, false);
+    }
+  }
+  unlock(s);
+  _free(record);
 }
-#endif
 
 void storage_clear(void* cptr) {
-  UNUSED_VAR(cptr);
-  rm_recurs(get_storage_dir());
-  // recreate storage dir
-  free(_HOME_DIR);
-  _HOME_DIR = NULL;
-  get_storage_dir();
+  in3_store_t* s = get_store(cptr);
+  if (!s) return;
+  lock(s, true);
+  compact(s, true);
+  unlock(s);
 }
@@ -33,13 +33,46 @@
  *******************************************************************************/
 
 /** 
- * storage handler storing cache in the home-dir/.in3
+ * storage handler storing the cache in a single file (home-dir/.in3/cache.db).
+ *
+ * The file is an append-only log of records, which is mapped into memory and indexed on open.
+ * Each record is protected by a checksum, so an interrupted write is simply ignored and cut off by the next writer.
+ * Once more than half of the file is taken by outdated values, it gets compacted by writing a new file and renaming it.
+ * Access from multiple processes is synchronized with a lock file.
  */
 
 #include "../../core/client/client.h"
 
+/** a key-value store backed by a single file. */
+typedef struct in3_store in3_store_t;
+
+/**
+ * opens (or creates) a store.
+ *
+ * @returns the store or NULL if the file could not be opened.
+ */
+in3_store_t* store_open(const char* path);
+
+/** closes a store and frees all resources. */
+void store_close(in3_store_t* store);
+
+/**
+ * reads a value from the store.
+ * 
+ * `cptr` may be a store opened with `store_open` or NULL for the default store in home-dir/.in3/cache.db.
+ */
 bytes_t* storage_get_item(void* cptr, const char* key);
 
+/**
+ * writes a value to the store.
+ * 
+ * `cptr` may be a store opened with `store_open` or NULL for the default store in home-dir/.in3/cache.db.
+ */
 void storage_set_item(void* cptr, const char* key, bytes_t* content);
 
-void storage_clear(void* cptr);
\ No newline at end of file
+/**
+ * removes all values from the store.
+ * 
+ * `cptr` may be a store opened with `store_open` or NULL for the default store in home-dir/.in3/cache.db.
+ */
+void storage_clear(void* cptr);
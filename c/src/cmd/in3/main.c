@@ -51,6 +51,9 @@
 #else
 #include "../../transport/http/in3_http.h"
 #endif
+#ifdef USE_IPC
+#include "../../transport/ipc/in3_ipc.h"
+#endif
 #ifdef IN3_SERVER
 #include "../http-server/http_server.h"
 #endif
@@ -70,6 +73,7 @@
 #include "../../signer/pk-signer/signer.h"
 #include "../../verifier/eth1/nano/chainspec.h"
 #include "../../verifier/in3_init.h"
+#include "async_storage.h"
 #include "in3_storage.h"
 #include "recorder.h"
 #include <inttypes.h>
@@ -598,7 +602,9 @@ static in3_ret_t debug_transport(in3_request_t* req) {
       exit(EXIT_SUCCESS);
     }
   }
-#ifdef USE_CURL
+#if defined(USE_IPC)
+  in3_ret_t r = send_ipc(req);
+#elif defined(USE_CURL)
   in3_ret_t r = send_curl(req);
 #else
   in3_ret_t r = send_http(req);
@@ -616,9 +622,16 @@ static in3_ret_t debug_transport(in3_request_t* req) {
   }
   return r;
 }
+static in3_storage_handler_t* async_cache = NULL;
+static void                   flush_cache() {
+  storage_async_flush(async_cache);
+}
+
 static char*     test_name = NULL;
 static in3_ret_t test_transport(in3_request_t* req) {
-#ifdef USE_CURL
+#if defined(USE_IPC)
+  in3_ret_t r = send_ipc(req);
+#elif defined(USE_CURL)
   in3_ret_t r = send_curl(req);
 #else
   in3_ret_t r = send_http(req);
@@ -723,6 +736,10 @@ int main(int argc, char* argv[]) {
   // use the storagehandler to cache data in .in3
   in3_set_storage_handler(c, storage_get_item, storage_set_item, storage_clear, NULL);
 
+  // write the cache in the background, but make sure it is complete before we exit
+  async_cache = storage_async(c);
+  atexit(flush_cache);
+
   // check env
   if (getenv("IN3_PK")) {
     hex_to_bytes(getenv("IN3_PK"), -1, pk, 32);
@@ -986,7 +1003,7 @@ int main(int argc, char* argv[]) {
           char*       urls[1];
           urls[0] = health_url;
           sprintf(health_url, "%s/health", chain->nodelist[i].url);
-          in3_request_t r;
+          in3_request_t r         = {0};
           in3_ctx_t     ctx       = {0};
           ctx.raw_response        = _calloc(sizeof(in3_response_t), 1);
           ctx.raw_response->state = IN3_WAITING;
@@ -173,8 +173,9 @@ void rec_clear_in(void* cptr) {
 }
 
 bytes_t* rec_get_item_out(void* cptr, const char* key) {
+  UNUSED_VAR(cptr);
   if (!rec.cache) return NULL;
-  bytes_t* found = rec.cache->get_item(cptr, key);
+  bytes_t* found = rec.cache->get_item(rec.cache->cptr, key);
   fprintf(rec.f, ":: cache %s %i\n", key, found ? 1 : 0);
   if (found) {
     char* hex = alloca(found->len * 2 + 1);
@@ -182,16 +183,27 @@ bytes_t* rec_get_item_out(void* cptr, const char* key) {
     fprintf(rec.f, "%s\n\n", hex);
   } else
     fprintf(rec.f, "\n");
+  fflush(rec.f);
 
   return found;
 }
 
 void rec_set_item_out(void* cptr, const char* key, bytes_t* content) {
-  if (rec.cache) rec.cache->set_item(cptr, key, content);
+  UNUSED_VAR(cptr);
+  if (rec.cache) rec.cache->set_item(rec.cache->cptr, key, content);
 }
 
 void rec_clear_out(void* cptr) {
-  if (rec.cache) rec.cache->clear(cptr);
+  UNUSED_VAR(cptr);
+  if (rec.cache) rec.cache->clear(rec.cache->cptr);
+}
+
+void rec_free_out(void* cptr) {
+  UNUSED_VAR(cptr);
+  if (!rec.cache) return;
+  if (rec.cache->free) rec.cache->free(rec.cache->cptr);
+  _free(rec.cache);
+  rec.cache = NULL;
 }
 uint64_t static_time(void* t) {
   UNUSED_VAR(t);
@@ -208,7 +220,7 @@ void recorder_write_start(in3_t* c, char* file, int argc, char* argv[]) {
   fprintf(rec.f, ":: cmd");
   for (int i = 0; i < argc; i++) fprintf(rec.f, " %s", strcmp(argv[i], "-fo") ? argv[i] : "-fi");
   fprintf(rec.f, "\n\n");
-  in3_set_storage_handler(c, rec_get_item_out, rec_set_item_out, rec_clear_out, &rec);
+  in3_set_storage_handler(c, rec_get_item_out, rec_set_item_out, rec_clear_out, &rec)->free = rec_free_out;
   fprintf(rec.f, ":: time %u\n\n", (uint32_t) in3_time(NULL));
 }
 
@@ -39,14 +39,21 @@
 #include "../util/utils.h"
 #include "context.h"
 #include "nodelist.h"
+#include "verified_hashes.h"
 #include "stdio.h"
 #include <inttypes.h>
 #include <string.h>
 
 #define NODE_LIST_KEY "nodelist_%d"
 #define WHITTE_LIST_KEY "_0x%s"
-#define CACHE_VERSION 6
+#define DELTA_KEY "_delta"
+#define VERIFIED_KEY "verified_%d"
+#define CACHE_VERSION 9
 #define MAX_KEYLEN 200
+#define NODELIST_HEADER 41 // version, generation, contract, last_block, number of nodes and length of the urls
+#define NODE_SIZE 48       // capacity, index, deposit, props, address and offset of the url
+#define DELTA_HEADER 9     // version, generation and number of weights
+#define VERIFIED_HEADER 5  // version and number of verified hashes
 
 /**
  * generates and writes the cachekey
@@ -73,12 +80,141 @@ in3_ret_t in3_cache_init(in3_t* c) {
   return IN3_OK;
 }
 
+/** the state of the nodelist as last written to the cache, which is used to only write the changed weights */
+typedef struct {
+  uint32_t           gen;     /**< hash of the node addresses of the stored nodelist, which must match the delta */
+  uintptr_t          nodes;   /**< fingerprint of the nodes in memory, used to detect a changed nodelist */
+  uint32_t           len;     /**< number of nodes */
+  in3_node_weight_t* weights; /**< the weights as they are stored in the nodelist */
+  uint64_t           hashes;  /**< fingerprint of the stored verified hashes */
+} cache_state_t;
+
+/** hashes the addresses of all nodes, so the delta can only be applied to the same nodes */
+static uint32_t hash_addresses(const in3_chain_t* chain) {
+  uint32_t h = 2166136261u;
+  for (unsigned int i = 0; i < chain->nodelist_length; i++) {
+    const bytes_t* address = chain->nodelist[i].address;
+    for (uint32_t n = 0; address && n + 4 <= address->len; n += 4) {
+      uint32_t word;
+      memcpy(&word, address->data + n, 4);
+      h = (h ^ word) * 16777619u;
+    }
+  }
+  return h;
+}
+
+/** since adding, removing or updating a node replaces its address or url, the pointers are enough to detect a change of the nodelist */
+static uintptr_t fingerprint(const in3_chain_t* chain) {
+  uintptr_t h = (uintptr_t) chain->nodelist;
+  for (unsigned int i = 0; i < chain->nodelist_length; i++) h = h * 31 + (uintptr_t) chain->nodelist[i].address + (uintptr_t) chain->nodelist[i].url + chain->nodelist[i].props;
+  return h;
+}
+
+static cache_state_t* get_state(in3_chain_t* chain) {
+  if (!chain->cache_state) chain->cache_state = _calloc(1, sizeof(cache_state_t));
+  return chain->cache_state;
+}
+
+/** remembers the nodelist and the weights as written to (or read from) the cache. */
+static void set_state(in3_chain_t* chain, uint32_t gen, const in3_node_weight_t* weights) {
+  cache_state_t* state = get_state(chain);
+  if (state->len != chain->nodelist_length) {
+    _free(state->weights);
+    state->weights = chain->nodelist_length ? _malloc(chain->nodelist_length * sizeof(in3_node_weight_t)) : NULL;
+  }
+  state->gen   = gen;
+  state->nodes = fingerprint(chain);
+  state->len   = chain->nodelist_length;
+  if (state->len) memcpy(state->weights, weights, state->len * sizeof(in3_node_weight_t));
+}
+
+void in3_cache_free_state(in3_chain_t* chain) {
+  cache_state_t* state = chain->cache_state;
+  if (!state) return;
+  _free(state->weights);
+  _free(state);
+  chain->cache_state = NULL;
+}
+
+/** since blocks are only added or replaced, the sum of the blocknumbers and the first bytes of the hashes detects a change. */
+static uint64_t hashes_fingerprint(const in3_chain_t* chain, uint_fast16_t len) {
+  uint64_t h = len;
+  for (uint_fast16_t i = 0; i < len; i++) {
+    uint64_t word;
+    memcpy(&word, chain->verified_hashes[i].hash, 8);
+    h += chain->verified_hashes[i].block_number ^ word;
+  }
+  return h;
+}
+
+/** reads the verified hashes, which are stored independent of the nodelist, since they change with almost every verified response. */
+static void update_verified_hashes(in3_t* c, in3_chain_t* chain) {
+  char key[MAX_KEYLEN];
+  sprintf(key, VERIFIED_KEY, chain->chain_id);
+  bytes_t* b = c->cache->get_item(c->cache->cptr, key);
+  in3_stats_add(b ? IN3_STAT_CACHE_HIT : IN3_STAT_CACHE_MISS, "verified_hashes", 1);
+  if (!b) return;
+
+  const uint32_t hashes = b->len >= VERIFIED_HEADER ? bytes_to_int(b->data + 1, 4) : 0;
+  if (b->len >= VERIFIED_HEADER && b->data[0] == CACHE_VERSION && hashes <= 0xFFFF && b->len == VERIFIED_HEADER + (size_t) hashes * sizeof(in3_verified_hash_t)) {
+    in3_verified_hash_t vh;
+    for (uint32_t i = 0; i < hashes; i++) {
+      memcpy(&vh, b->data + VERIFIED_HEADER + i * sizeof(in3_verified_hash_t), sizeof(in3_verified_hash_t));
+      in3_verified_hashes_add(chain, c->max_verified_hashes, vh.block_number, vh.hash);
+    }
+    get_state(chain)->hashes = hashes_fingerprint(chain, in3_verified_hashes_len(chain, c->max_verified_hashes));
+  }
+  b_free(b);
+}
+
+/** writes the verified hashes, if they changed since they were stored. */
+static void store_verified_hashes(in3_t* c, in3_chain_t* chain) {
+  const uint_fast16_t len         = in3_verified_hashes_len(chain, c->max_verified_hashes);
+  const uint64_t      fingerprint = hashes_fingerprint(chain, len);
+  cache_state_t*      state       = get_state(chain);
+  if (state->hashes == fingerprint) return;
+
+  char key[MAX_KEYLEN];
+  sprintf(key, VERIFIED_KEY, chain->chain_id);
+  bytes_builder_t* bb = bb_newl(VERIFIED_HEADER + len * sizeof(in3_verified_hash_t) + 1);
+  bb_write_byte(bb, CACHE_VERSION);
+  bb_write_int(bb, len);
+  if (len) bb_write_raw_bytes(bb, chain->verified_hashes, len * sizeof(in3_verified_hash_t));
+  c->cache->set_item(c->cache->cptr, key, &bb->b);
+  state->hashes = fingerprint;
+  bb_free(bb);
+}
+
+/** applies the weights which changed after the nodelist was written. */
+static void update_weights(in3_t* c, in3_chain_t* chain, const char* key, uint32_t gen) {
+  char dkey[MAX_KEYLEN + 8];
+  sprintf(dkey, "%s" DELTA_KEY, key);
+  bytes_t* b = c->cache->get_item(c->cache->cptr, dkey);
+  if (!b) return;
+
+  // the delta must belong to the nodelist and have exactly the size of its content
+  const uint32_t count = b->len >= DELTA_HEADER ? bytes_to_int(b->data + 5, 4) : 0;
+  if (b->len < DELTA_HEADER || b->data[0] != CACHE_VERSION || bytes_to_int(b->data + 1, 4) != gen || count > chain->nodelist_length ||
+      b->len != DELTA_HEADER + (size_t) count * (4 + sizeof(in3_node_weight_t))) {
+    b_free(b);
+    return;
+  }
+
+  const uint8_t* p = b->data + DELTA_HEADER;
+  for (uint32_t i = 0; i < count; i++, p += 4 + sizeof(in3_node_weight_t)) {
+    const uint32_t index = bytes_to_int(p, 4);
+    if (index < chain->nodelist_length) memcpy(chain->weights + index, p + 4, sizeof(in3_node_weight_t));
+  }
+  b_free(b);
+}
+
 /**
  * updates the nodlist from the cache.
  */
 in3_ret_t in3_cache_update_nodelist(in3_t* c, in3_chain_t* chain) {
   // it is ok not to have a storage
   if (!c->cache) return IN3_OK;
+  update_verified_hashes(c, chain);
 
   // define the key to use
   char key[MAX_KEYLEN];
@@ -86,51 +222,65 @@ in3_ret_t in3_cache_update_nodelist(in3_t* c, in3_chain_t* chain) {
 
   // get from cache
   bytes_t* b = c->cache->get_item(c->cache->cptr, key);
+  in3_stats_add(b ? IN3_STAT_CACHE_HIT : IN3_STAT_CACHE_MISS, "nodelist", 1);
   if (!b) return IN3_OK;
 
-  // so we have a result... let's decode it.
-  int    node_count;
-  size_t pos = 0;
-
   // version check
-  if (b_read_byte(b, &pos) != CACHE_VERSION) {
+  if (!b->len || b->data[0] != CACHE_VERSION) {
     b_free(b);
     return IN3_EVERS;
   }
 
+  // all parts have a fixed size, so we only need to check the total length once and can read everything in place.
+  const uint8_t* d           = b->data;
+  const uint32_t node_count  = b->len >= NODELIST_HEADER ? bytes_to_int(d + 33, 4) : 0;
+  const uint32_t strings_len = b->len >= NODELIST_HEADER ? bytes_to_int(d + 37, 4) : 0;
+  const uint8_t* nodes       = d + NODELIST_HEADER;
+  const uint8_t* weights     = nodes + (size_t) node_count * NODE_SIZE;
+  const char*    strings     = (const char*) weights + (size_t) node_count * sizeof(in3_node_weight_t);
+  if (b->len < NODELIST_HEADER || node_count > 0xFFFFFF ||
+      b->len != NODELIST_HEADER + (size_t) node_count * (NODE_SIZE + sizeof(in3_node_weight_t)) + strings_len ||
+      (strings_len && strings[strings_len - 1])) {
+    b_free(b);
+    return IN3_EINVALDT;
+  }
+  for (uint32_t i = 0; i < node_count; i++) {
+    if (bytes_to_int(nodes + i * NODE_SIZE + 44, 4) >= strings_len) {
+      b_free(b);
+      return IN3_EINVALDT;
+    }
+  }
+
   // clean up old
   in3_nodelist_clear(chain);
   if (chain->contract) b_free(chain->contract);
   if (chain->nodelist_upd8_params) _free(chain->nodelist_upd8_params);
 
   // fill data
-  chain->contract             = b_new_fixed_bytes(b, &pos, 20);
-  chain->last_block           = b_read_long(b, &pos);
-  chain->nodelist_length      = (node_count = b_read_int(b, &pos));
+  const uint32_t gen          = bytes_to_int(d + 1, 4);
+  chain->contract             = b_new(d + 5, 20);
+  chain->last_block           = bytes_to_long(d + 25, 8);
+  chain->nodelist_length      = node_count;
   chain->nodelist             = _calloc(node_count, sizeof(in3_node_t));
   chain->weights              = _calloc(node_count, sizeof(in3_node_weight_t));
   chain->nodelist_upd8_params = NULL;
-  memcpy(chain->weights, b->data + pos, node_count * sizeof(in3_node_weight_t));
-  pos += node_count * sizeof(in3_node_weight_t);
-
-  for (int i = 0; i < node_count; i++) {
-    in3_node_t* n = chain->nodelist + i;
-    n->capacity   = b_read_int(b, &pos);
-    n->index      = b_read_int(b, &pos);
-    n->deposit    = b_read_long(b, &pos);
-    n->props      = b_read_long(b, &pos);
-    n->address    = b_new_fixed_bytes(b, &pos, 20);
-    n->url        = b_new_chars(b, &pos);
+  memcpy(chain->weights, weights, node_count * sizeof(in3_node_weight_t));
+
+  for (uint32_t i = 0; i < node_count; i++) {
+    const uint8_t* p = nodes + i * NODE_SIZE;
+    in3_node_t*    n = chain->nodelist + i;
+    n->capacity      = bytes_to_int(p, 4);
+    n->index         = bytes_to_int(p + 4, 4);
+    n->deposit       = bytes_to_long(p + 8, 8);
+    n->props         = bytes_to_long(p + 16, 8);
+    n->address       = b_new(p + 24, 20);
+    n->url           = _strdupn(strings + bytes_to_int(p + 44, 4), -1);
     BIT_CLEAR(n->attrs, ATTR_WHITELISTED);
   }
-
-  // read verified hashes
-  const unsigned int hashes = b_read_int(b, &pos);
-  if (!chain->verified_hashes && hashes) chain->verified_hashes = _calloc(c->max_verified_hashes, sizeof(in3_verified_hash_t));
-  if (hashes)
-    memcpy(chain->verified_hashes, b->data + pos, sizeof(in3_verified_hash_t) * (min(hashes, c->max_verified_hashes)));
-
+  set_state(chain, gen, chain->weights);
   b_free(b);
+
+  update_weights(c, chain, key, gen);
   return IN3_OK;
 }
 
@@ -138,51 +288,95 @@ in3_ret_t in3_cache_store_nodelist(in3_t* c, in3_chain_t* chain) {
   // it is ok not to have a storage
   if (!c->cache) return IN3_OK;
 
+  // all parts have a fixed size except the urls at the end, so we can calculate the size upfront
+  uint32_t strings_len = 0;
+  for (unsigned int i = 0; i < chain->nodelist_length; i++) strings_len += strlen(chain->nodelist[i].url) + 1;
+  bytes_builder_t* bb = bb_newl(NODELIST_HEADER + chain->nodelist_length * (NODE_SIZE + sizeof(in3_node_weight_t)) + strings_len + 1);
+
   // write to bytes_buffer
-  bytes_builder_t* bb = bb_new();
   bb_write_byte(bb, CACHE_VERSION);          // Version flag
+  bb_write_int(bb, 0);                       // generation, which is set at the end
   bb_write_fixed_bytes(bb, chain->contract); // 20 bytes fixed
   bb_write_long(bb, chain->last_block);
   bb_write_int(bb, chain->nodelist_length);
-  bb_write_raw_bytes(bb, chain->weights, chain->nodelist_length * sizeof(in3_node_weight_t));
+  bb_write_int(bb, strings_len);
 
-  for (unsigned int i = 0; i < chain->nodelist_length; i++) {
+  for (unsigned int i = 0, offset = 0; i < chain->nodelist_length; i++) {
     const in3_node_t* n = chain->nodelist + i;
     bb_write_int(bb, n->capacity);
     bb_write_int(bb, n->index);
     bb_write_long(bb, n->deposit);
     bb_write_long(bb, n->props);
     bb_write_fixed_bytes(bb, n->address);
-    bb_write_chars(bb, n->url, strlen(n->url));
+    bb_write_int(bb, offset);
+    offset += strlen(n->url) + 1;
   }
+  bb_write_raw_bytes(bb, chain->weights, chain->nodelist_length * sizeof(in3_node_weight_t));
+  for (unsigned int i = 0; i < chain->nodelist_length; i++) bb_write_chars(bb, chain->nodelist[i].url, strlen(chain->nodelist[i].url));
 
-  // verified hashes
-  int count = 0;
-  if (chain->verified_hashes) {
-    count = c->max_verified_hashes;
-    for (int i = 0; i < count; i++) {
-      if (!chain->verified_hashes[i].block_number) {
-        count = i;
-        break;
-      }
-    }
-    bb_write_int(bb, count);
-    bb_write_raw_bytes(bb, chain->verified_hashes, count * sizeof(in3_verified_hash_t));
-  } else
-    bb_write_int(bb, 0);
+  // the generation identifies the nodes, so a delta written for a different nodelist is ignored
+  const uint32_t gen = hash_addresses(chain);
+  int_to_bytes(gen, bb->b.data + 1);
 
   // create key
-  char key[200];
+  char key[MAX_KEYLEN + 8];
   write_cache_key(key, chain->chain_id, chain->contract->data);
 
   // store it and ignore return value since failing when writing cache should not stop us.
   c->cache->set_item(c->cache->cptr, key, &bb->b);
+  set_state(chain, gen, chain->weights);
+
+  // the weights are part of the nodelist now, so we remove an older delta
+  bb_clear(bb);
+  bb_write_byte(bb, CACHE_VERSION);
+  bb_write_int(bb, gen);
+  bb_write_int(bb, 0);
+  strcat(key, DELTA_KEY);
+  c->cache->set_item(c->cache->cptr, key, &bb->b);
 
   // clear buffer
   bb_free(bb);
   return IN3_OK;
 }
 
+in3_ret_t in3_cache_store_weights(in3_t* c, in3_chain_t* chain) {
+  // it is ok not to have a storage
+  if (!c->cache) return IN3_OK;
+  store_verified_hashes(c, chain);
+
+  // if the nodelist changed since we stored it, we need to store all
+  const cache_state_t* state = chain->cache_state;
+  if (!state || !chain->nodelist_length || state->len != chain->nodelist_length || state->nodes != fingerprint(chain))
+    return in3_cache_store_nodelist(c, chain);
+
+  uint32_t count = 0;
+  for (unsigned int i = 0; i < state->len; i++) {
+    if (memcmp(state->weights + i, chain->weights + i, sizeof(in3_node_weight_t))) count++;
+  }
+  // if more than half of the weights changed, we write the whole nodelist, which keeps the following deltas small
+  if (count > state->len / 2) return in3_cache_store_nodelist(c, chain);
+
+  bytes_builder_t* bb = bb_newl(DELTA_HEADER + count * (4 + sizeof(in3_node_weight_t)) + 1);
+  bb_write_byte(bb, CACHE_VERSION);
+  bb_write_int(bb, state->gen);
+  bb_write_int(bb, count);
+  for (unsigned int i = 0; i < state->len; i++) {
+    if (!memcmp(state->weights + i, chain->weights + i, sizeof(in3_node_weight_t))) continue;
+    bb_write_int(bb, i);
+    bb_write_raw_bytes(bb, chain->weights + i, sizeof(in3_node_weight_t));
+  }
+
+  // create key
+  char key[MAX_KEYLEN + 8];
+  write_cache_key(key, chain->chain_id, chain->contract->data);
+  strcat(key, DELTA_KEY);
+
+  // store it and ignore return value since failing when writing cache should not stop us.
+  c->cache->set_item(c->cache->cptr, key, &bb->b);
+  bb_free(bb);
+  return IN3_OK;
+}
+
 in3_ret_t in3_cache_update_whitelist(in3_t* c, in3_chain_t* chain) {
   // it is ok not to have a storage
   if (!c->cache || !chain->whitelist) return IN3_OK;
@@ -195,6 +389,7 @@ in3_ret_t in3_cache_update_whitelist(in3_t* c, in3_chain_t* chain) {
 
   // get from cache
   bytes_t* data = c->cache->get_item(c->cache->cptr, key);
+  in3_stats_add(data ? IN3_STAT_CACHE_HIT : IN3_STAT_CACHE_MISS, "whitelist", 1);
   if (data) {
     size_t pos = 0;
 
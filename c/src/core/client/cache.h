@@ -61,7 +61,7 @@ in3_ret_t in3_cache_update_nodelist(
 /**
  * stores the nodelist to thes cache. 
  * 
- * It will be automatically called if the nodelist has changed and read from the nodes or the weight of a node changed.
+ * It will be automatically called if the nodelist has changed and read from the nodes.
  * 
  */
 in3_ret_t in3_cache_store_nodelist(
@@ -69,6 +69,25 @@ in3_ret_t in3_cache_store_nodelist(
     in3_chain_t* chain /**< the chain upating to cache */
 );
 
+/**
+ * stores the weights and verified hashes of the nodes to the cache.
+ * 
+ * It will be automatically called after a request, since the weights of the nodes change with each response.
+ * Only the weights which changed since the nodelist was stored are written as a delta.
+ * If the nodelist itself changed or too many weights changed, the whole nodelist will be stored instead.
+ */
+in3_ret_t in3_cache_store_weights(
+    in3_t*       c,    /**< the client */
+    in3_chain_t* chain /**< the chain upating to cache */
+);
+
+/**
+ * frees the state kept to detect changed weights.
+ */
+void in3_cache_free_state(
+    in3_chain_t* chain /**< the chain */
+);
+
 /**
  * reads the whitelist from cache.
  *
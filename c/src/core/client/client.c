@@ -282,12 +282,15 @@ int in3_get_request_urls_len(
 }
 
 /**
- * getter to retrieve the urls list length from a in3_request_t struct
+ * getter to retrieve the timeout in ms of a in3_request_t struct
  */
 uint32_t in3_get_request_timeout(
     in3_request_t* request /**< request struct */
 ) {
-  return request->ctx->client->timeout;
+  if (!request->timeouts || !request->urls_len) return request->ctx->client->timeout;
+  uint32_t timeout = 0;
+  for (unsigned int i = 0; i < request->urls_len; i++) timeout = max(timeout, request->timeouts[i]);
+  return timeout;
 }
 
 /**
@@ -127,7 +127,8 @@ typedef enum {
   FLAGS_HTTP             = 0x10, /**< the client will try to use http instead of https  */
   FLAGS_STATS            = 0x20, /**< nodes will keep track of the stats (default=true)  */
   FLAGS_NODE_LIST_NO_SIG = 0x40, /**< nodelist update request will not automatically ask for signatures and proof */
-  FLAGS_BOOT_WEIGHTS     = 0x80  /**< if true the client will initialize the first weights from the nodelist given by the nodelist.*/
+  FLAGS_BOOT_WEIGHTS     = 0x80, /**< if true the client will initialize the first weights from the nodelist given by the nodelist.*/
+  FLAGS_ADAPTIVE_TIMEOUT = 0x100 /**< if true the timeout for each node is calculated from its last response times instead of using the configured timeout for all nodes. */
 } in3_flags_type_t;
 
 /**
@@ -154,6 +155,11 @@ typedef struct in3_node {
   uint8_t          attrs;    /**< bitmask of internal attributes */
 } in3_node_t;
 
+/**
+ * number of response times stored for each node in order to calculate the timeout.
+ */
+#define IN3_NODE_LATENCY_SAMPLES 16
+
 /**
  * Weight or reputation of a node.
  * 
@@ -162,9 +168,12 @@ typedef struct in3_node {
  * These weights will also be stored in the cache (if available)
  */
 typedef struct in3_node_weight {
-  uint32_t response_count;      /**< counter for responses */
-  uint32_t total_response_time; /**< total of all response times */
-  uint64_t blacklisted_until;   /**< if >0 this node is blacklisted until k. k is a unix timestamp */
+  uint32_t response_count;                    /**< counter for responses */
+  uint32_t total_response_time;               /**< total of all response times */
+  uint64_t blacklisted_until;                 /**< if >0 this node is blacklisted until k. k is a unix timestamp */
+  uint32_t latency[IN3_NODE_LATENCY_SAMPLES]; /**< ring buffer with the last response times in ms, used to calculate the timeout for this node */
+  uint8_t  latency_len;                       /**< number of valid entries in latency */
+  uint8_t  latency_pos;                       /**< the index in latency to write the next response time to */
 #ifdef PAY
   uint32_t price; /**< the price per request unit */
   uint64_t payed; /**< already payed */
@@ -234,10 +243,12 @@ typedef struct in3_chain {
   bytes_t*             contract;        /**< the address of the registry contract */
   bytes32_t            registry_id;     /**< the identifier of the registry */
   uint8_t              version;         /**< version of the chain */
-  in3_verified_hash_t* verified_hashes; /**< contains the list of already verified blockhashes */
+  in3_verified_hash_t* verified_hashes; /**< contains the list of already verified blockhashes sorted by blocknumber (see verified_hashes.h) */
   in3_whitelist_t*     whitelist;       /**< if set the whitelist of the addresses. */
   uint16_t             avg_block_time;  /**< average block time (seconds) for this chain (calculated internally) */
   void*                conf;            /**< this configuration will be set by the verifiers and allow to add special structs here.*/
+  void*                cache_state;     /**< the weights as last stored in the cache, used to only write the changed weights (see cache.c) */
+  void*                shared;          /**< if attached, the shared memory segment with the weights and verified hashes of all processes of the host (see shared_stats.h) */
   struct {
     address_t node;           /**< node that reported the last_block which necessitated a nodeList update */
     uint64_t  exp_last_block; /**< the last_block when the nodelist last changed reported by this node */
@@ -270,6 +281,13 @@ typedef void (*in3_storage_clear)(
     void* cptr /**< a custom pointer as set in the storage handler*/
 );
 
+/**
+ * storage handler function called when the client is freed.
+ **/
+typedef void (*in3_storage_free)(
+    void* cptr /**< a custom pointer as set in the storage handler*/
+);
+
 /** 
  * storage handler to handle cache.
  **/
@@ -278,6 +296,7 @@ typedef struct in3_storage_handler {
   in3_storage_set_item set_item; /**< function pointer setting a stored value for the given key.*/
   in3_storage_clear    clear;    /**< function pointer clearing all contents of cache.*/
   void*                cptr;     /**< custom pointer which will be passed to functions */
+  in3_storage_free     free;     /**< optional function pointer called by in3_free, which may flush and release the storage.*/
 } in3_storage_handler_t;
 
 #define IN3_SIGN_ERR_REJECTED -1 /**< return value used by the signer if the the signature-request was rejected. */
@@ -407,12 +426,25 @@ typedef struct in3_request {
   in3_req_action_t action;   /**< the action the transport should execute */
   struct in3_ctx*  ctx;      /**< the current context */
   void*            cptr;     /**< a custom ptr to hold information during */
+  uint32_t*        timeouts; /**< the timeout in ms for each url, based on the response times of the node and the remaining time until the deadline. (only set for REQ_ACTION_SEND, may be NULL)*/
 } in3_request_t;
 
 /** the transport function to be implemented by the transport provider.
  */
 typedef in3_ret_t (*in3_transport_send)(in3_request_t* request);
 
+/**
+ * statistics about the data transfered by all transports.
+ * 
+ * The `_wire`-values count the bytes actually sent or received, which are smaller than the payloads if compression was used.
+ */
+typedef struct in3_transport_stats {
+  uint64_t bytes_sent;          /**< number of payload bytes sent */
+  uint64_t bytes_sent_wire;     /**< number of bytes sent after compression */
+  uint64_t bytes_received;      /**< number of (decoded) response bytes received */
+  uint64_t bytes_received_wire; /**< number of bytes received before decompression */
+} in3_transport_stats_t;
+
 /**
  * Filter type used internally when managing filters.
  */
@@ -449,7 +481,7 @@ struct in3_t_ {
   uint32_t               cache_timeout;        /**< number of seconds requests can be cached. */
   uint16_t               node_limit;           /**< the limit of nodes to store in the client. */
   void*                  key;                  /**< the client key to sign requests (pointer to 32bytes private key seed) */
-  uint32_t               max_code_cache;       /**< number of max bytes used to cache the code in memory */
+  uint32_t               max_code_cache;       /**< number of max bytes used to cache the code in memory, like the code decoded by the evm (0 uses a default of 1MB) */
   uint32_t               max_block_cache;      /**< number of number of blocks cached  in memory */
   in3_proof_t            proof;                /**< the type of proof used */
   uint8_t                request_count;        /**< the number of request send when getting a first answer */
@@ -460,11 +492,12 @@ struct in3_t_ {
   uint_fast16_t          max_attempts;         /**< the max number of attempts before giving up*/
   uint_fast16_t          max_verified_hashes;  /**< max number of verified hashes to cache */
   uint32_t               timeout;              /**< specifies the number of milliseconds before the request times out. increasing may be helpful if the device uses a slow connection. */
+  uint32_t               deadline;             /**< the max number of milliseconds a request may take including all retries and required subrequests. 0 means there is no limit, so each attempt may take up to `timeout` ms. */
   chain_id_t             chain_id;             /**< servers to filter for the given chain. The chain-id based on EIP-155.*/
   in3_storage_handler_t* cache;                /**< a cache handler offering 2 functions ( setItem(string,string), getItem(string) ) */
   in3_signer_t*          signer;               /**< signer-struct managing a wallet */
   in3_transport_send     transport;            /**< the transporthandler sending requests */
-  uint_fast8_t           flags;                /**< a bit mask with flags defining the behavior of the incubed client. See the FLAG...-defines*/
+  uint_fast16_t          flags;                /**< a bit mask with flags defining the behavior of the incubed client. See the FLAG...-defines*/
   in3_chain_t*           chains;               /**< chain spec and nodeList definitions*/
   uint16_t               chains_length;        /**< number of configured chains */
   in3_filter_handler_t*  filters;              /**< filter handler */
@@ -646,6 +679,23 @@ void in3_set_default_transport(
     in3_transport_send transport /**< the default transport-function. */
 );
 
+/**
+ * adds the number of bytes sent and received to the transport statistics.
+ * 
+ * This function is called by the transports and is threadsafe.
+ */
+void in3_transport_stats_add(
+    uint64_t sent,         /**< number of payload bytes */
+    uint64_t sent_wire,    /**< number of bytes actually sent */
+    uint64_t received,     /**< number of decoded bytes received */
+    uint64_t received_wire /**< number of bytes actually received */
+);
+
+/**
+ * returns the statistics of all transports since the start of the process.
+ */
+in3_transport_stats_t in3_get_transport_stats();
+
 /**
  * defines a default storage handler which is used when creating a new client.
  */
@@ -721,7 +771,9 @@ int in3_get_request_urls_len(
 );
 
 /**
- * getter to retrieve the urls list length from a in3_request_t struct
+ * getter to retrieve the timeout in ms of a in3_request_t struct.
+ * 
+ * This is the longest timeout of all urls, which is limited by the deadline of the request.
  */
 uint32_t in3_get_request_timeout(
     in3_request_t* request /**< request struct */
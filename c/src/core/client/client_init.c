@@ -40,6 +40,7 @@
 #include "cache.h"
 #include "client.h"
 #include "nodelist.h"
+#include "verified_hashes.h"
 #include "verifier.h"
 #include <assert.h>
 #include <stdlib.h>
@@ -114,6 +115,7 @@ void in3_register_payment(
 static in3_transport_send     default_transport = NULL;
 static in3_storage_handler_t* default_storage   = NULL;
 static in3_signer_t*          default_signer    = NULL;
+static in3_transport_stats_t  transport_stats   = {0};
 
 /**
  * defines a default transport which is used when creating a new client.
@@ -122,6 +124,23 @@ void in3_set_default_transport(in3_transport_send transport) {
   default_transport = transport;
 }
 
+#if defined(__GNUC__) || defined(__clang__)
+#define STATS_ADD(field, val) __sync_fetch_and_add(&transport_stats.field, val)
+#else
+#define STATS_ADD(field, val) transport_stats.field += val
+#endif
+
+void in3_transport_stats_add(uint64_t sent, uint64_t sent_wire, uint64_t received, uint64_t received_wire) {
+  if (sent) STATS_ADD(bytes_sent, sent);
+  if (sent_wire) STATS_ADD(bytes_sent_wire, sent_wire);
+  if (received) STATS_ADD(bytes_received, received);
+  if (received_wire) STATS_ADD(bytes_received_wire, received_wire);
+}
+
+in3_transport_stats_t in3_get_transport_stats() {
+  return transport_stats;
+}
+
 /**
  * defines a default storage handler which is used when creating a new client.
  */
@@ -152,6 +171,8 @@ static uint16_t avg_block_time_for_chain_id(chain_id_t id) {
 
 IN3_EXPORT_TEST void initChain(in3_chain_t* chain, chain_id_t chain_id, char* contract, char* registry_id, uint8_t version, int boot_node_count, in3_chain_type_t type, char* wl_contract) {
   chain->conf                 = NULL;
+  chain->shared               = NULL;
+  chain->cache_state          = NULL;
   chain->chain_id             = chain_id;
   chain->init_addresses       = NULL;
   chain->last_block           = 0;
@@ -199,6 +220,8 @@ static void initNode(in3_chain_t* chain, int node_index, char* address, char* ur
   weight->blacklisted_until   = 0;
   weight->response_count      = 0;
   weight->total_response_time = 0;
+  weight->latency_len         = 0;
+  weight->latency_pos         = 0;
 }
 
 static void init_ipfs(in3_chain_t* chain) {
@@ -277,6 +300,7 @@ static in3_ret_t in3_client_init(in3_t* c, chain_id_t chain_id) {
   c->chains               = _malloc(sizeof(in3_chain_t) * c->chains_length);
   c->filters              = NULL;
   c->timeout              = 10000;
+  c->deadline             = 0;
 
   in3_chain_t* chain = c->chains;
 
@@ -328,6 +352,8 @@ in3_ret_t in3_client_register_chain(in3_t* c, chain_id_t chain_id, in3_chain_typ
     if (c->chains == NULL) return IN3_ENOMEM;
     chain                       = c->chains + c->chains_length;
     chain->conf                 = NULL;
+    chain->shared               = NULL;
+    chain->cache_state          = NULL;
     chain->nodelist             = NULL;
     chain->nodelist_length      = 0;
     chain->weights              = NULL;
@@ -405,6 +431,8 @@ in3_ret_t in3_client_add_node(in3_t* c, chain_id_t chain_id, char* url, in3_node
   weight->blacklisted_until   = 0;
   weight->response_count      = 0;
   weight->total_response_time = 0;
+  weight->latency_len         = 0;
+  weight->latency_pos         = 0;
   return IN3_OK;
 }
 
@@ -459,13 +487,18 @@ void in3_free(in3_t* a) {
         verifier->free_chain(a, a->chains + i);
     }
     if (a->chains[i].verified_hashes) _free(a->chains[i].verified_hashes);
+    in3_shared_stats_detach(a->chains + i);
+    in3_cache_free_state(a->chains + i);
     in3_nodelist_clear(a->chains + i);
     b_free(a->chains[i].contract);
     whitelist_free(a->chains[i].whitelist);
     _free(a->chains[i].nodelist_upd8_params);
   }
   if (a->signer && a->signer != default_signer) _free(a->signer);
-  if (a->cache && a->cache != default_storage) _free(a->cache);
+  if (a->cache && a->cache != default_storage) {
+    if (a->cache->free) a->cache->free(a->cache->cptr);
+    _free(a->cache);
+  }
   if (a->chains) _free(a->chains);
 
   if (a->filters) {
@@ -588,6 +621,8 @@ char* in3_get_config(in3_t* c) {
   add_uint(sb, ',', "maxCodeCache", c->max_code_cache);
   add_uint(sb, ',', "maxVerifiedHashes", c->max_verified_hashes);
   add_uint(sb, ',', "timeout", c->timeout);
+  add_uint(sb, ',', "deadline", c->deadline);
+  add_bool(sb, ',', "adaptiveTimeout", c->flags & FLAGS_ADAPTIVE_TIMEOUT);
   add_uint(sb, ',', "minDeposit", c->min_deposit);
   add_uint(sb, ',', "nodeProps", c->node_props);
   add_uint(sb, ',', "nodeLimit", c->node_limit);
@@ -702,19 +737,17 @@ char* in3_configure(in3_t* c, const char* config) {
       memcpy(c->key = _calloc(32, 1), token->data, token->len);
     } else if (token->key == key("maxVerifiedHashes")) {
       EXPECT_TOK_U16(token);
-      in3_chain_t* chain = in3_find_chain(c, c->chain_id);
-      EXPECT_CFG(chain, "chain not found");
-      if (c->max_verified_hashes < d_long(token)) {
-        chain->verified_hashes = _realloc(chain->verified_hashes,
-                                          sizeof(in3_verified_hash_t) * d_long(token),
-                                          sizeof(in3_verified_hash_t) * c->max_verified_hashes);
-        // clear newly allocated memory
-        memset(chain->verified_hashes + c->max_verified_hashes, 0, (d_long(token) - c->max_verified_hashes) * sizeof(in3_verified_hash_t));
-      }
+      for (int i = 0; i < c->chains_length; i++) in3_verified_hashes_resize(c->chains + i, c->max_verified_hashes, d_long(token));
       c->max_verified_hashes = d_long(token);
     } else if (token->key == key("timeout")) {
       EXPECT_TOK_U32(token);
       c->timeout = d_long(token);
+    } else if (token->key == key("deadline")) {
+      EXPECT_TOK_U32(token);
+      c->deadline = d_long(token);
+    } else if (token->key == key("adaptiveTimeout")) {
+      EXPECT_TOK_BOOL(token);
+      BITMASK_SET_BOOL(c->flags, FLAGS_ADAPTIVE_TIMEOUT, (d_int(token) ? true : false));
     } else if (token->key == key("minDeposit")) {
       EXPECT_TOK_U64(token);
       c->min_deposit = d_long(token);
@@ -837,17 +870,11 @@ char* in3_configure(in3_t* c, const char* config) {
           } else if (cp.token->key == key("verifiedHashes")) {
             EXPECT_TOK_ARR(cp.token);
             EXPECT_TOK(cp.token, (unsigned) d_len(cp.token) <= c->max_verified_hashes, "expected array len <= maxVerifiedHashes");
-            if (!chain->verified_hashes)
-              chain->verified_hashes = _calloc(c->max_verified_hashes, sizeof(in3_verified_hash_t));
-            else
-              // clear extra verified_hashes (preceding ones will be overwritten anyway)
-              memset(chain->verified_hashes + d_len(cp.token), 0, (c->max_verified_hashes - d_len(cp.token)) * sizeof(in3_verified_hash_t));
-            int i = 0;
-            for (d_iterator_t n = d_iter(cp.token); n.left; d_iter_next(&n), i++) {
+            if (chain->verified_hashes) memset(chain->verified_hashes, 0, c->max_verified_hashes * sizeof(in3_verified_hash_t));
+            for (d_iterator_t n = d_iter(cp.token); n.left; d_iter_next(&n)) {
               EXPECT_TOK_U64(d_get(n.token, key("block")));
               EXPECT_TOK_B256(d_get(n.token, key("hash")));
-              chain->verified_hashes[i].block_number = d_get_longk(n.token, key("block"));
-              memcpy(chain->verified_hashes[i].hash, d_get_byteskl(n.token, key("hash"), 32)->data, 32);
+              in3_verified_hashes_add(chain, c->max_verified_hashes, d_get_longk(n.token, key("block")), d_get_byteskl(n.token, key("hash"), 32)->data);
             }
           } else if (cp.token->key == key("nodeList")) {
             EXPECT_TOK_ARR(cp.token);
@@ -40,6 +40,7 @@
 #include "client.h"
 #include "context_internal.h"
 #include "keys.h"
+#include "stats.h"
 #include <stdio.h>
 #include <string.h>
 
@@ -50,6 +51,8 @@ in3_ctx_t* ctx_new(in3_t* client, const char* req_data) {
   if (!ctx) return NULL;
   ctx->client             = client;
   ctx->verification_state = IN3_WAITING;
+  ctx->started            = current_ms();
+  ctx->deadline           = client->deadline ? ctx->started + client->deadline : 0;
   client->pending++;
 
   if (req_data != NULL) {
@@ -73,6 +76,8 @@ in3_ctx_t* ctx_new(in3_t* client, const char* req_data) {
         ctx->requests[i] = t;
     } else
       ctx_set_error(ctx, "The Request is not a valid structure!", IN3_EINVAL);
+
+    for (uint_fast16_t i = 0; i < ctx->len; i++) in3_stats_add(IN3_STAT_REQUESTS, d_get_stringk(ctx->requests[i], K_METHOD), 1);
   }
   return ctx;
 }
@@ -45,6 +45,9 @@
 #include "context_internal.h"
 #include "keys.h"
 #include "nodelist.h"
+#include "shared_stats.h"
+#include "stats.h"
+#include "verified_hashes.h"
 #include "verifier.h"
 #include <stdint.h>
 #include <string.h>
@@ -144,6 +147,25 @@ static void free_urls(char** urls, int len, bool free_items) {
   _free(urls);
 }
 
+/** returns the blocknumber the request refers to or 0 if it is unknown (like `latest`) or the method does not take a block. */
+static uint64_t request_block_number(d_token_t* request_token) {
+  d_token_t*  params = d_get(request_token, K_PARAMS);
+  const char* method = d_get_stringk(request_token, K_METHOD);
+  if (!method || d_type(params) != T_ARRAY) return 0;
+
+  // the position of the block-parameter, which is the first argument of the `...ByNumber`-methods
+  int pos = -1;
+  if (strstr(method, "ByNumber") || strstr(method, "ByBlockNumber"))
+    pos = 0;
+  else if (!strcmp(method, "eth_getBalance") || !strcmp(method, "eth_getCode") || !strcmp(method, "eth_getTransactionCount") || !strcmp(method, "eth_call"))
+    pos = 1;
+  else if (!strcmp(method, "eth_getStorageAt") || !strcmp(method, "eth_getProof"))
+    pos = 2;
+
+  d_token_t* block = pos < 0 ? NULL : d_get_at(params, pos);
+  return d_type(block) == T_INTEGER || (d_type(block) == T_BYTES && d_len(block) <= 8) ? d_long(block) : 0;
+}
+
 static int add_bytes_to_hash(struct SHA3_CTX* msg_hash, void* data, int len) {
   if (msg_hash) sha3_Update(msg_hash, data, len);
   return len;
@@ -239,18 +261,9 @@ NONULL static in3_ret_t ctx_create_payload(in3_ctx_t* c, sb_t* sb, bool multicha
 
       // do we have verified hashes?
       if (chain->verified_hashes) {
-        uint_fast16_t l = rc->max_verified_hashes;
-        for (uint_fast16_t i = 0; i < l; i++) {
-          if (!chain->verified_hashes[i].block_number) {
-            l = i;
-            break;
-          }
-        }
-        if (l) {
-          bytes_t* hashes = alloca(sizeof(bytes_t) * l);
-          for (uint_fast16_t i = 0; i < l; i++) hashes[i] = bytes(chain->verified_hashes[i].hash, 32);
-          sb_add_bytes(sb, ",\"verifiedHashes\":", hashes, l, true);
-        }
+        bytes_t             hashes[IN3_ADVERTISED_HASHES];
+        const uint_fast16_t l = in3_verified_hashes_select(chain, rc->max_verified_hashes, request_block_number(request_token), rc->finality, hashes, IN3_ADVERTISED_HASHES);
+        if (l) sb_add_bytes(sb, ",\"verifiedHashes\":", hashes, l, true);
       }
 
 #ifdef PAY
@@ -270,7 +283,7 @@ NONULL static void update_nodelist_cache(in3_ctx_t* ctx) {
   // we don't update weights for local chains.
   if (!ctx->client->cache || ctx->client->chain_id == CHAIN_ID_LOCAL) return;
   chain_id_t chain_id = ctx->client->chain_id;
-  in3_cache_store_nodelist(ctx->client, in3_find_chain(ctx->client, chain_id));
+  in3_cache_store_weights(ctx->client, in3_find_chain(ctx->client, chain_id));
 }
 
 NONULL static in3_ret_t ctx_parse_response(in3_ctx_t* ctx, char* response_data, int len) {
@@ -307,6 +320,8 @@ NONULL static void blacklist_node(in3_chain_t* chain, node_match_t* node_weight)
     // blacklist the node
     w->blacklisted_until = in3_time(NULL) + BLACKLISTTIME;
     node_weight->blocked = true;
+    in3_shared_blacklist(chain, ctx_get_node(chain, node_weight)->address->data, w->blacklisted_until);
+    in3_stats_add(IN3_STAT_BLACKLISTED, ctx_get_node(chain, node_weight)->url, 1);
     in3_log_debug("Blacklisting node for unverifiable response: %s\n", ctx_get_node(chain, node_weight)->url);
   }
 }
@@ -380,7 +395,10 @@ static void clean_up_ctx(in3_ctx_t* ctx, node_match_t* node, in3_chain_t* chain)
   if (ctx->response_context) json_free(ctx->response_context);
   ctx->error           = NULL;
   in3_node_weight_t* w = node ? ctx_get_node_weight(chain, node) : NULL;
-  if (w) w->blacklisted_until = 0; // we reset the blacklisted, because if the response was correct, no need to blacklist, otherwise we will set the blacklisted_until anyway
+  if (w && w->blacklisted_until) {
+    w->blacklisted_until = 0; // we reset the blacklisted, because if the response was correct, no need to blacklist, otherwise we will set the blacklisted_until anyway
+    in3_shared_blacklist(chain, ctx_get_node(chain, node)->address->data, 0);
+  }
 }
 
 static in3_ret_t handle_payment(in3_ctx_t* ctx, node_match_t* node, int index) {
@@ -416,6 +434,18 @@ static in3_ret_t handle_payment(in3_ctx_t* ctx, node_match_t* node, int index) {
   return IN3_OK;
 }
 
+static const char* verifier_name(const in3_verifier_t* verifier) {
+  switch (verifier->type) {
+    case CHAIN_ETH: return "eth";
+    case CHAIN_SUBSTRATE: return "substrate";
+    case CHAIN_IPFS: return "ipfs";
+    case CHAIN_BTC: return "btc";
+    case CHAIN_EOS: return "eos";
+    case CHAIN_IOTA: return "iota";
+    default: return "generic";
+  }
+}
+
 static in3_ret_t verify_response(in3_ctx_t* ctx, in3_chain_t* chain, in3_verifier_t* verifier, node_match_t* node, in3_response_t* response) {
   in3_ret_t res = IN3_OK;
 
@@ -466,7 +496,9 @@ static in3_ret_t verify_response(in3_ctx_t* ctx, in3_chain_t* chain, in3_verifie
 
     // we only verify, if there is a verifier, but also a node, which means we do not verify internal responses.
     if (verifier && node) {
+      uint64_t start = in3_stats_time();
       res = ctx->verification_state = verifier->verify(&vc);
+      if (res != IN3_WAITING) in3_stats_observe(IN3_STAT_VERIFICATION, verifier_name(verifier), in3_stats_time() - start);
       if (res == IN3_WAITING)
         return res;
       if (res) {
@@ -492,8 +524,9 @@ static void handle_times(in3_chain_t* chain, node_match_t* node, in3_response_t*
   if (!node || node->blocked || !response || !response->time) return;
   in3_node_weight_t* w = ctx_get_node_weight(chain, node);
   if (!w) return;
-  w->response_count++;
-  w->total_response_time += response->time;
+  in3_stats_observe(IN3_STAT_TRANSPORT_LATENCY, ctx_get_node(chain, node)->url, (uint64_t) response->time * 1000);
+  in3_node_add_response_time(w, response->time);
+  in3_shared_add_response_time(chain, ctx_get_node(chain, node), response->time);
   response->time = 0; // make sure we count the time only once
 }
 
@@ -581,9 +614,22 @@ NONULL in3_request_t* in3_create_request(in3_ctx_t* ctx) {
     }
   }
 
+  // the timeout may not exceed the remaining time until the deadline
+  uint32_t timeout = ctx->client->timeout;
+  if (ctx->deadline) {
+    const uint64_t now = current_ms();
+    if (now >= ctx->deadline) {
+      ctx_set_error(ctx, "the deadline of the request has been exceeded", IN3_ETIMEOUT);
+      return NULL;
+    }
+    const uint32_t left = (uint32_t) (ctx->deadline - now);
+    if (!timeout || timeout > left) timeout = left;
+  }
+
   in3_ret_t     res;
   int           nodes_count = ctx_nodes_len(ctx->nodes);
   char**        urls        = nodes_count ? _malloc(sizeof(char*) * nodes_count) : NULL;
+  uint32_t*     timeouts    = nodes_count ? _malloc(sizeof(uint32_t) * nodes_count) : NULL;
   node_match_t* node        = ctx->nodes;
   in3_chain_t*  chain       = in3_find_chain(ctx->client, ctx->client->chain_id);
   bool          multichain  = false;
@@ -591,6 +637,7 @@ NONULL in3_request_t* in3_create_request(in3_ctx_t* ctx) {
   for (int n = 0; n < nodes_count; n++) {
     in3_node_t* node_data = ctx_get_node(chain, node);
     urls[n]               = node_data->url;
+    timeouts[n]           = (ctx->client->flags & FLAGS_ADAPTIVE_TIMEOUT) ? in3_node_calculate_timeout(ctx_get_node_weight(chain, node), timeout) : timeout;
 
     // if the multichain-prop is set we need to specify the chain_id in the request
     if (in3_node_props_get(node_data->props, NODE_PROP_MULTICHAIN)) multichain = true;
@@ -608,6 +655,7 @@ NONULL in3_request_t* in3_create_request(in3_ctx_t* ctx) {
     // we clean up
     sb_free(payload);
     free_urls(urls, nodes_count, ctx->client->flags & FLAGS_HTTP);
+    if (timeouts) _free(timeouts);
     // since we cannot return an error, we set the error in the context and return NULL, indicating the error.
     ctx_set_error(ctx, "could not generate the payload", res);
     return NULL;
@@ -621,6 +669,7 @@ NONULL in3_request_t* in3_create_request(in3_ctx_t* ctx) {
   request->urls          = urls;
   request->action        = REQ_ACTION_SEND;
   request->cptr          = NULL;
+  request->timeouts      = timeouts;
 
   if (!nodes_count) nodes_count = 1; // at least one result, because for internal response we don't need nodes, but a result big enough.
   ctx->raw_response = _calloc(sizeof(in3_response_t), nodes_count);
@@ -636,6 +685,7 @@ NONULL void request_free(in3_request_t* req) {
   // free resources
   free_urls(req->urls, req->urls_len, req->ctx->client->flags & FLAGS_HTTP);
   _free(req->payload);
+  if (req->timeouts) _free(req->timeouts);
   _free(req);
 }
 
@@ -878,6 +928,7 @@ in3_ret_t ctx_add_required(in3_ctx_t* parent, in3_ctx_t* ctx) {
   //  printf(" ++ add required %s > %s\n", ctx_name(parent), ctx_name(ctx));
   ctx->required    = parent->required;
   parent->required = ctx;
+  if (parent->deadline && (!ctx->deadline || ctx->deadline > parent->deadline)) ctx->deadline = parent->deadline;
   return in3_ctx_execute(ctx);
 }
 
@@ -994,6 +1045,10 @@ in3_ret_t in3_ctx_execute(in3_ctx_t* ctx) {
       // we count this is an attempt
       ctx->attempt++;
 
+      // if there is no time left for another attempt, we give up with a timeout
+      if (ctx->deadline && current_ms() >= ctx->deadline)
+        return ctx_set_error(ctx, "the deadline of the request has been exceeded", IN3_ETIMEOUT);
+
       // should we retry?
       if (ctx->attempt < ctx->client->max_attempts) {
         in3_log_debug("Retrying send request...\n");
@@ -51,6 +51,9 @@
 #define DIFFTIME(t1, t0) (double) (t1 > t0 ? t1 - t0 : 0)
 #define BLACKLISTTIME DAY
 #define BLACKLISTWEIGHT 7 * DAY
+#define NODE_TIMEOUT_FACTOR 3     // the timeout of a node is the 90th percentile of its response times multiplied with this factor
+#define NODE_TIMEOUT_MIN 1000      // we never use a lower timeout, since a single slow response should not blacklist the node
+#define NODE_TIMEOUT_MIN_SAMPLES 4 // min number of response times before we adjust the timeout
 
 NONULL static void free_nodeList(in3_node_t* nodelist, int count) {
   // clean chain..
@@ -220,6 +223,12 @@ NONULL static in3_ret_t update_nodelist(in3_t* c, in3_chain_t* chain, in3_ctx_t*
   in3_ctx_t* ctx = ctx_find_required(parent_ctx, "in3_nodeList");
 
   if (ctx) {
+    if ((in3_ctx_state(ctx) == CTX_ERROR || in3_ctx_state(ctx) == CTX_SUCCESS) && ctx->started) {
+      char label[12];
+      sprintf(label, "0x%x", (unsigned int) chain->chain_id);
+      in3_stats_observe(IN3_STAT_NODELIST_UPDATE, label, (current_ms() - ctx->started) * 1000);
+      ctx->started = 0; // makes sure we count it only once, even if the ctx is kept after an error
+    }
     if (in3_ctx_state(ctx) == CTX_ERROR || (in3_ctx_state(ctx) == CTX_SUCCESS && !d_get(ctx->responses[0], K_RESULT))) {
       // blacklist node that gave us an error response for nodelist (if not first update)
       // and clear nodelist params
@@ -371,6 +380,31 @@ uint32_t in3_node_calculate_weight(in3_node_weight_t* n, uint32_t capa, uint64_t
   return (0xFFFF / avg) * blacklist_factor / 100;
 }
 
+void in3_node_add_response_time(in3_node_weight_t* n, uint32_t time) {
+  n->response_count++;
+  n->total_response_time += time;
+  n->latency[n->latency_pos % IN3_NODE_LATENCY_SAMPLES] = time;
+  n->latency_pos                                        = (n->latency_pos + 1) % IN3_NODE_LATENCY_SAMPLES;
+  if (n->latency_len < IN3_NODE_LATENCY_SAMPLES) n->latency_len++;
+}
+
+uint32_t in3_node_calculate_timeout(const in3_node_weight_t* n, uint32_t max_timeout) {
+  if (!n || !max_timeout || n->latency_len < NODE_TIMEOUT_MIN_SAMPLES) return max_timeout;
+
+  // sort the last response times
+  uint32_t  sorted[IN3_NODE_LATENCY_SAMPLES];
+  const int len = min(n->latency_len, IN3_NODE_LATENCY_SAMPLES);
+  for (int i = 0; i < len; i++) {
+    int j = i;
+    for (; j > 0 && sorted[j - 1] > n->latency[i]; j--) sorted[j] = sorted[j - 1];
+    sorted[j] = n->latency[i];
+  }
+
+  // nearest rank of the 90th percentile
+  const uint32_t p90 = sorted[(len * 9 + 9) / 10 - 1];
+  return min(max(p90 * NODE_TIMEOUT_FACTOR, NODE_TIMEOUT_MIN), max_timeout);
+}
+
 node_match_t* in3_node_list_fill_weight(in3_t* c, chain_id_t chain_id, in3_node_t* all_nodes, in3_node_weight_t* weights,
                                         int len, uint64_t now, uint32_t* total_weight, int* total_found,
                                         in3_node_filter_t filter) {
@@ -465,6 +499,9 @@ SKIP_UPDATE:
     if (res < 0) return res;
   }
 
+  // take the weights and verified hashes other processes have learned
+  in3_shared_sync(chain, ctx->client->max_verified_hashes);
+
   // now update the results
   *nodelist_length = chain->nodelist_length;
   *nodelist        = chain->nodelist;
@@ -499,8 +536,11 @@ in3_ret_t in3_node_list_pick_nodes(in3_ctx_t* ctx, node_match_t** nodes, int req
 
     // if morethan 50% of the nodes are blacklisted, we remove the mark and try again
     if (blacklisted > all_nodes_len / 2) {
-      for (int i = 0; i < all_nodes_len; i++)
+      in3_chain_t* chain = in3_find_chain(ctx->client, ctx->client->chain_id);
+      for (int i = 0; i < all_nodes_len; i++) {
         weights[i].blacklisted_until = 0;
+        if (all_nodes[i].address) in3_shared_blacklist(chain, all_nodes[i].address->data, 0);
+      }
       found = in3_node_list_fill_weight(ctx->client, ctx->client->chain_id, all_nodes, weights, all_nodes_len, now, &total_weight, &total_found, filter);
     }
 
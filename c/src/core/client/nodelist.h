@@ -40,6 +40,8 @@
 #include "../util/mem.h"
 #include "client.h"
 #include "context.h"
+#include "shared_stats.h"
+#include "stats.h"
 #include <time.h>
 
 #ifndef NODELIST_H
@@ -74,6 +76,20 @@ NONULL node_match_t* in3_node_list_fill_weight(in3_t* c, chain_id_t chain_id, in
  * calculates the weight for a node.
  */
 NONULL uint32_t in3_node_calculate_weight(in3_node_weight_t* n, uint32_t capa, uint64_t now);
+
+/**
+ * adds the response time of a node to its statistics.
+ */
+NONULL void in3_node_add_response_time(in3_node_weight_t* n, uint32_t time);
+
+/**
+ * calculates the timeout for a node.
+ * 
+ * As soon as enough response times are known, the timeout is a multiple of the 90th percentile of the last response times,
+ * but never more than `max_timeout`. It is only used if the `adaptiveTimeout` flag is set.
+ */
+uint32_t in3_node_calculate_timeout(const in3_node_weight_t* n, uint32_t max_timeout);
+
 /**
  * picks (based on the config) a random number of nodes and returns them as weightslist.
  */
@@ -98,8 +114,11 @@ NONULL static inline bool nodelist_not_first_upd8(const in3_chain_t* chain) {
 
 NONULL static inline void blacklist_node_addr(const in3_chain_t* chain, const address_t node_addr, uint64_t secs_from_now) {
   for (unsigned int i = 0; i < chain->nodelist_length; ++i)
-    if (!memcmp(chain->nodelist[i].address->data, node_addr, chain->nodelist[i].address->len))
+    if (!memcmp(chain->nodelist[i].address->data, node_addr, chain->nodelist[i].address->len)) {
       chain->weights[i].blacklisted_until = in3_time(NULL) + secs_from_now;
+      in3_shared_blacklist(chain, node_addr, chain->weights[i].blacklisted_until);
+      in3_stats_add(IN3_STAT_BLACKLISTED, chain->nodelist[i].url, 1);
+    }
 }
 
 #endif
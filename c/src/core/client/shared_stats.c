@@ -0,0 +1,261 @@
+/*******************************************************************************
+ * This file is part of the Incubed project.
+ * Sources: https://github.com/slockit/in3-c
+ * 
+ * Copyright (C) 2018-2020 slock.it GmbH, Blockchains LLC
+ * 
+ * 
+ * COMMERCIAL LICENSE USAGE
+ * 
+ * Licensees holding a valid commercial license may use this file in accordance 
+ * with the commercial license agreement provided with the Software or, alternatively, 
+ * in accordance with the terms contained in a written agreement between you and 
+ * slock.it GmbH/Blockchains LLC. For licensing terms and conditions or further 
+ * information please contact slock.it at in3@slock.it.
+ * 	
+ * Alternatively, this file may be used under the AGPL license as follows:
+ *    
+ * AGPL LICENSE USAGE
+ * 
+ * This program is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Affero General Public License as published by the Free Software 
+ * Foundation, either version 3 of the License, or (at your option) any later version.
+ *  
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY 
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A 
+ * PARTICULAR PURPOSE. See the GNU Affero General Public License for more details.
+ * [Permissions of this strong copyleft license are conditioned on making available 
+ * complete source code of licensed works and modifications, which include larger 
+ * works using a licensed work, under the same license. Copyright and license notices 
+ * must be preserved. Contributors provide an express grant of patent rights.]
+ * You should have received a copy of the GNU Affero General Public License along 
+ * with this program. If not, see <https://www.gnu.org/licenses/>.
+ *******************************************************************************/
+
+#include "shared_stats.h"
+
+#ifdef SHARED_STATS
+
+#include "../util/mem.h"
+#include "../util/utils.h"
+#include "verified_hashes.h"
+#include <fcntl.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define SHARED_MAGIC  (0x494e3300 | IN3_SHARED_VERSION) /* "IN3" + version */
+#define SLOT_FREE     0
+#define SLOT_WRITING  1
+#define SLOT_READY    2
+#define MAX_SPINS     100000 /* a slot still in state SLOT_WRITING after that many checks belongs to a crashed process and is skipped */
+#define SAMPLES       IN3_NODE_LATENCY_SAMPLES
+
+#define ATOMIC_ADD(field, val)      __sync_fetch_and_add(&(field), val)
+#define ATOMIC_CAS(field, old, val) __sync_bool_compare_and_swap(&(field), old, val)
+#define MEMORY_BARRIER()            __sync_synchronize()
+
+/** the stats of a node. Once the address is written (state is SLOT_READY), it will not change. */
+typedef struct {
+  volatile uint32_t state;
+  uint8_t           address[20];
+  volatile uint32_t response_count;
+  volatile uint32_t total_response_time;
+  volatile uint64_t blacklisted_until;
+  volatile uint32_t latency_pos; // number of samples ever added, so the next sample is written to latency_pos % SAMPLES
+  volatile uint32_t latency[SAMPLES];
+} shared_node_t;
+
+/** a verified blockhash. seq is odd while the entry is written and `2 * index + 2` afterwards. */
+typedef struct {
+  volatile uint64_t seq;
+  uint64_t          block_number;
+  bytes32_t         hash;
+} shared_hash_t;
+
+/** the layout of the segment. A segment filled with zeros is a valid empty segment. */
+typedef struct {
+  volatile uint32_t magic;
+  volatile uint64_t hash_pos; // number of hashes ever added
+  shared_node_t     nodes[IN3_SHARED_MAX_NODES];
+  shared_hash_t     hashes[IN3_SHARED_MAX_HASHES];
+} segment_t;
+
+/** the mapping of a process, which is stored in chain->shared */
+typedef struct {
+  segment_t* seg;
+  uint64_t   hash_pos; // the position of the ring up to which all hashes are merged into the chain
+} shared_t;
+
+static void segment_name(char* dst, size_t len, const char* name, chain_id_t chain_id) {
+  snprintf(dst, len, "/in3-%s-%" PRIx32, name, chain_id);
+}
+
+static uint32_t hash(const uint8_t* address) {
+  uint32_t h = 2166136261u;
+  for (int i = 0; i < 20; i++) h = (h ^ address[i]) * 16777619u;
+  return h;
+}
+
+static void init_node(shared_node_t* n, const uint8_t* address, const in3_node_weight_t* w) {
+  const uint32_t len = min(w->latency_len, SAMPLES);
+  memcpy(n->address, address, 20);
+  n->response_count      = w->response_count;
+  n->total_response_time = w->total_response_time;
+  n->blacklisted_until   = w->blacklisted_until;
+  // copy the samples in the order they were added
+  for (uint32_t i = 0; i < len; i++) n->latency[i] = w->latency[(w->latency_pos + SAMPLES - len + i) % SAMPLES];
+  n->latency_pos = len;
+  MEMORY_BARRIER();
+  n->state = SLOT_READY;
+}
+
+/** finds the node. If it does not exist yet and a weight is passed, a new slot is created with the values of the weight. */
+static shared_node_t* find_node(segment_t* seg, const uint8_t* address, const in3_node_weight_t* seed) {
+  const uint32_t h = hash(address);
+  for (uint32_t n = 0; n < IN3_SHARED_MAX_NODES; n++) {
+    shared_node_t* node = seg->nodes + (h + n) % IN3_SHARED_MAX_NODES;
+    if (node->state == SLOT_FREE) {
+      if (!seed) return NULL;
+      if (ATOMIC_CAS(node->state, SLOT_FREE, SLOT_WRITING)) {
+        init_node(node, address, seed);
+        return node;
+      }
+    }
+    for (int i = 0; node->state == SLOT_WRITING && i < MAX_SPINS; i++) {} // another process is writing the address right now
+    if (node->state == SLOT_READY && memcmp(node->address, address, 20) == 0) return node;
+  }
+  return NULL;
+}
+
+static void read_node(const shared_node_t* n, in3_node_weight_t* w) {
+  const uint32_t pos     = n->latency_pos;
+  w->response_count      = n->response_count;
+  w->total_response_time = n->total_response_time;
+  w->blacklisted_until   = n->blacklisted_until;
+  w->latency_len         = min(pos, SAMPLES);
+  w->latency_pos         = pos % SAMPLES;
+  for (int i = 0; i < SAMPLES; i++) w->latency[i] = n->latency[i];
+}
+
+static void merge_hash(in3_chain_t* chain, uint16_t max, uint64_t number, const uint8_t* hash) {
+  if (!in3_verified_hashes_find(chain, max, number)) in3_verified_hashes_add(chain, max, number, hash);
+}
+
+static const uint8_t* node_address(const in3_node_t* node) {
+  return node->address && node->address->len == 20 ? node->address->data : NULL;
+}
+
+in3_ret_t in3_shared_stats_attach(in3_t* c, chain_id_t chain_id, const char* name) {
+  in3_chain_t* chain = in3_find_chain(c, chain_id);
+  if (!chain) return IN3_EFIND;
+
+  char path[128];
+  segment_name(path, sizeof(path), name, chain_id);
+  int fd = shm_open(path, O_RDWR | O_CREAT, 0600);
+  if (fd < 0) return IN3_EUNKNOWN;
+
+  // a new segment has a size of 0, so whoever comes first sets the size, which fills it with zeros.
+  struct stat st;
+  if (fstat(fd, &st) || (st.st_size == 0 && ftruncate(fd, sizeof(segment_t))) || fstat(fd, &st) || st.st_size != (off_t) sizeof(segment_t)) {
+    close(fd);
+    return IN3_EUNKNOWN;
+  }
+  segment_t* seg = mmap(NULL, sizeof(segment_t), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if (seg == MAP_FAILED) return IN3_EUNKNOWN;
+  if (seg->magic != SHARED_MAGIC && !ATOMIC_CAS(seg->magic, 0, SHARED_MAGIC) && seg->magic != SHARED_MAGIC) {
+    munmap(seg, sizeof(segment_t));
+    return IN3_EUNKNOWN;
+  }
+
+  in3_shared_stats_detach(chain);
+  shared_t* sh  = _calloc(1, sizeof(shared_t));
+  sh->seg       = seg;
+  chain->shared = sh;
+
+  // share what we know so far
+  const uint_fast16_t len = in3_verified_hashes_len(chain, c->max_verified_hashes);
+  for (uint_fast16_t i = 0; i < len; i++)
+    in3_shared_add_verified(chain, chain->verified_hashes[i].block_number, chain->verified_hashes[i].hash);
+  in3_shared_sync(chain, c->max_verified_hashes);
+  return IN3_OK;
+}
+
+void in3_shared_stats_detach(in3_chain_t* chain) {
+  shared_t* sh = chain->shared;
+  if (!sh) return;
+  munmap(sh->seg, sizeof(segment_t));
+  _free(sh);
+  chain->shared = NULL;
+}
+
+in3_ret_t in3_shared_stats_unlink(const char* name, chain_id_t chain_id) {
+  char path[128];
+  segment_name(path, sizeof(path), name, chain_id);
+  return shm_unlink(path) ? IN3_EFIND : IN3_OK;
+}
+
+void in3_shared_sync(in3_chain_t* chain, uint16_t max_verified_hashes) {
+  shared_t* sh = chain->shared;
+  if (!sh) return;
+
+  for (unsigned int i = 0; i < chain->nodelist_length; i++) {
+    const uint8_t* address = node_address(chain->nodelist + i);
+    shared_node_t* node    = address ? find_node(sh->seg, address, chain->weights + i) : NULL;
+    if (node) read_node(node, chain->weights + i);
+  }
+
+  // merge the hashes added since the last sync
+  const uint64_t pos = sh->seg->hash_pos;
+  if (!max_verified_hashes || pos == sh->hash_pos) return;
+  uint64_t done = pos;
+  for (uint64_t i = max(sh->hash_pos, pos > IN3_SHARED_MAX_HASHES ? pos - IN3_SHARED_MAX_HASHES : 0); i < pos; i++) {
+    shared_hash_t* entry = sh->seg->hashes + i % IN3_SHARED_MAX_HASHES;
+    bytes32_t      hash;
+    const uint64_t seq    = entry->seq;
+    MEMORY_BARRIER();
+    const uint64_t number = entry->block_number;
+    memcpy(hash, entry->hash, 32);
+    MEMORY_BARRIER();
+    if (seq == i * 2 + 2 && entry->seq == seq)
+      merge_hash(chain, max_verified_hashes, number, hash);
+    else if (seq < i * 2 + 2 && done == pos)
+      done = i; // still written, so we try again next time
+  }
+  sh->hash_pos = done;
+}
+
+void in3_shared_add_response_time(const in3_chain_t* chain, const in3_node_t* node, uint32_t time) {
+  const shared_t* sh      = chain->shared;
+  const uint8_t*  address = node_address(node);
+  shared_node_t*  n       = sh && address ? find_node(sh->seg, address, NULL) : NULL;
+  if (!n) return;
+  n->latency[ATOMIC_ADD(n->latency_pos, 1) % SAMPLES] = time;
+  ATOMIC_ADD(n->response_count, 1);
+  ATOMIC_ADD(n->total_response_time, time);
+}
+
+void in3_shared_blacklist(const in3_chain_t* chain, const uint8_t* address, uint64_t until) {
+  const shared_t* sh = chain->shared;
+  shared_node_t*  n  = sh ? find_node(sh->seg, address, NULL) : NULL;
+  if (n) n->blacklisted_until = until;
+}
+
+void in3_shared_add_verified(const in3_chain_t* chain, uint64_t number, const bytes32_t hash) {
+  const shared_t* sh = chain->shared;
+  if (!sh) return;
+  const uint64_t i     = ATOMIC_ADD(sh->seg->hash_pos, 1);
+  shared_hash_t* entry = sh->seg->hashes + i % IN3_SHARED_MAX_HASHES;
+  entry->seq           = i * 2 + 1;
+  MEMORY_BARRIER();
+  entry->block_number = number;
+  memcpy(entry->hash, hash, 32);
+  MEMORY_BARRIER();
+  entry->seq = i * 2 + 2;
+}
+
+#endif
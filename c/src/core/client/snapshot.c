@@ -0,0 +1,332 @@
+/*******************************************************************************
+ * This file is part of the Incubed project.
+ * Sources: https://github.com/slockit/in3-c
+ * 
+ * Copyright (C) 2018-2020 slock.it GmbH, Blockchains LLC
+ * 
+ * 
+ * COMMERCIAL LICENSE USAGE
+ * 
+ * Licensees holding a valid commercial license may use this file in accordance 
+ * with the commercial license agreement provided with the Software or, alternatively, 
+ * in accordance with the terms contained in a written agreement between you and 
+ * slock.it GmbH/Blockchains LLC. For licensing terms and conditions or further 
+ * information please contact slock.it at in3@slock.it.
+ * 	
+ * Alternatively, this file may be used under the AGPL license as follows:
+ *    
+ * AGPL LICENSE USAGE
+ * 
+ * This program is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Affero General Public License as published by the Free Software 
+ * Foundation, either version 3 of the License, or (at your option) any later version.
+ *  
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY 
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A 
+ * PARTICULAR PURPOSE. See the GNU Affero General Public License for more details.
+ * [Permissions of this strong copyleft license are conditioned on making available 
+ * complete source code of licensed works and modifications, which include larger 
+ * works using a licensed work, under the same license. Copyright and license notices 
+ * must be preserved. Contributors provide an express grant of patent rights.]
+ * You should have received a copy of the GNU Affero General Public License along 
+ * with this program. If not, see <https://www.gnu.org/licenses/>.
+ *******************************************************************************/
+
+#include "snapshot.h"
+#include "../util/mem.h"
+#include "../util/utils.h"
+#include "nodelist.h"
+#include "verified_hashes.h"
+#include <string.h>
+
+#define SNAPSHOT_MAGIC "IN3S"
+
+/** reads a snapshot without trusting it, so every read is checked against the length. */
+typedef struct {
+  const bytes_t* data;    /**< the snapshot */
+  size_t         pos;     /**< the current position */
+  bool           invalid; /**< true if a read went past the end */
+} reader_t;
+
+static const uint8_t* take(reader_t* r, size_t len) {
+  if (r->invalid || len > r->data->len - r->pos) {
+    r->invalid = true;
+    return NULL;
+  }
+  r->pos += len;
+  return r->data->data + r->pos - len;
+}
+
+static uint8_t read_byte(reader_t* r) {
+  const uint8_t* p = take(r, 1);
+  return p ? *p : 0;
+}
+
+static uint32_t read_int(reader_t* r) {
+  const uint8_t* p = take(r, 4);
+  return p ? bytes_to_int(p, 4) : 0;
+}
+
+static uint64_t read_long(reader_t* r) {
+  const uint8_t* p = take(r, 8);
+  return p ? ((uint64_t) bytes_to_int(p, 4) << 32) | bytes_to_int(p + 4, 4) : 0;
+}
+
+static void write_chain(bytes_builder_t* bb, in3_t* c, in3_chain_t* chain) {
+  bb_write_int(bb, chain->chain_id);
+  bb_write_byte(bb, chain->type);
+  bb_write_long(bb, chain->last_block);
+  bb_write_fixed_bytes(bb, chain->contract);
+  bb_write_raw_bytes(bb, chain->registry_id, 32);
+  bb_write_byte(bb, chain->version);
+  bb_write_int(bb, chain->avg_block_time);
+
+  // whitelist
+  bb_write_byte(bb, chain->whitelist ? 1 : 0);
+  if (chain->whitelist) {
+    bb_write_raw_bytes(bb, chain->whitelist->contract, 20);
+    bb_write_long(bb, chain->whitelist->last_block);
+    bb_write_byte(bb, chain->whitelist->needs_update);
+    bb_write_int(bb, chain->whitelist->addresses.len);
+    bb_write_fixed_bytes(bb, &chain->whitelist->addresses);
+  }
+
+  // pending nodelist update
+  bb_write_byte(bb, chain->nodelist_upd8_params ? 1 : 0);
+  if (chain->nodelist_upd8_params) {
+    bb_write_raw_bytes(bb, chain->nodelist_upd8_params->node, 20);
+    bb_write_long(bb, chain->nodelist_upd8_params->exp_last_block);
+    bb_write_long(bb, chain->nodelist_upd8_params->timestamp);
+  }
+
+  // nodes with their weights
+  bb_write_int(bb, chain->nodelist_length);
+  for (unsigned int i = 0; i < chain->nodelist_length; i++) {
+    const in3_node_t* n = chain->nodelist + i;
+    bb_write_fixed_bytes(bb, n->address);
+    bb_write_long(bb, n->deposit);
+    bb_write_int(bb, n->index);
+    bb_write_int(bb, n->capacity);
+    bb_write_long(bb, n->props);
+    bb_write_byte(bb, n->attrs);
+    bb_write_int(bb, strlen(n->url));
+    bb_write_raw_bytes(bb, n->url, strlen(n->url));
+
+    const in3_node_weight_t* w = chain->weights + i;
+    bb_write_int(bb, w->response_count);
+    bb_write_int(bb, w->total_response_time);
+    bb_write_long(bb, w->blacklisted_until);
+    bb_write_byte(bb, w->latency_pos);
+    bb_write_byte(bb, w->latency_len);
+    for (int j = 0; j < w->latency_len; j++) bb_write_int(bb, w->latency[j]);
+  }
+
+  // verified hashes
+  const uint32_t count = in3_verified_hashes_len(chain, c->max_verified_hashes);
+  bb_write_int(bb, count);
+  for (uint32_t i = 0; i < count; i++) {
+    bb_write_long(bb, chain->verified_hashes[i].block_number);
+    bb_write_raw_bytes(bb, chain->verified_hashes[i].hash, 32);
+  }
+}
+
+bytes_t* in3_snapshot_save(in3_t* c) {
+  bytes_builder_t* bb = bb_newl(1024);
+  bb_write_raw_bytes(bb, SNAPSHOT_MAGIC, 4);
+  bb_write_byte(bb, IN3_SNAPSHOT_VERSION);
+
+  // configuration
+  bb_write_int(bb, c->chain_id);
+  bb_write_int(bb, c->flags);
+  bb_write_byte(bb, c->proof);
+  bb_write_byte(bb, c->request_count);
+  bb_write_byte(bb, c->signature_count);
+  bb_write_byte(bb, c->replace_latest_block);
+  bb_write_int(bb, c->finality);
+  bb_write_int(bb, c->max_attempts);
+  bb_write_int(bb, c->max_verified_hashes);
+  bb_write_int(bb, c->node_limit);
+  bb_write_int(bb, c->cache_timeout);
+  bb_write_int(bb, c->max_code_cache);
+  bb_write_int(bb, c->max_block_cache);
+  bb_write_int(bb, c->timeout);
+  bb_write_int(bb, c->deadline);
+  bb_write_long(bb, c->min_deposit);
+  bb_write_long(bb, c->node_props);
+
+  bb_write_int(bb, c->chains_length);
+  for (int i = 0; i < c->chains_length; i++) write_chain(bb, c, c->chains + i);
+
+  return bb_move_to_bytes(bb);
+}
+
+/** reads a chain and updates the client if apply is true. */
+static void read_chain(in3_t* c, reader_t* r, bool apply) {
+  chain_id_t       chain_id       = read_int(r);
+  in3_chain_type_t type           = read_byte(r);
+  uint64_t         last_block     = read_long(r);
+  const uint8_t*   contract       = take(r, 20);
+  const uint8_t*   registry_id    = take(r, 32);
+  uint8_t          version        = read_byte(r);
+  uint16_t         avg_block_time = read_int(r);
+
+  const uint8_t *wl_contract = NULL, *wl_addresses = NULL;
+  uint64_t       wl_last_block   = 0;
+  bool           wl_needs_update = false;
+  uint32_t       wl_len          = 0;
+  if (read_byte(r)) {
+    wl_contract     = take(r, 20);
+    wl_last_block   = read_long(r);
+    wl_needs_update = read_byte(r);
+    wl_len          = read_int(r);
+    wl_addresses    = take(r, wl_len);
+  }
+
+  const uint8_t* upd8_node           = NULL;
+  uint64_t       upd8_exp_last_block = 0, upd8_timestamp = 0;
+  if (read_byte(r)) {
+    upd8_node           = take(r, 20);
+    upd8_exp_last_block = read_long(r);
+    upd8_timestamp      = read_long(r);
+  }
+
+  if (r->invalid) return;
+  in3_chain_t* chain = NULL;
+  if (apply) {
+    in3_client_register_chain(c, chain_id, type, (uint8_t*) contract, (uint8_t*) registry_id, version, (uint8_t*) wl_contract);
+    chain                 = in3_find_chain(c, chain_id);
+    chain->last_block     = last_block;
+    chain->avg_block_time = avg_block_time;
+    if (chain->whitelist) {
+      chain->whitelist->last_block   = wl_last_block;
+      chain->whitelist->needs_update = wl_needs_update;
+      chain->whitelist->addresses    = bytes(wl_len ? _malloc(wl_len) : NULL, wl_len);
+      if (wl_len) memcpy(chain->whitelist->addresses.data, wl_addresses, wl_len);
+    }
+    if (upd8_node) {
+      chain->nodelist_upd8_params = _malloc(sizeof(*(chain->nodelist_upd8_params)));
+      memcpy(chain->nodelist_upd8_params->node, upd8_node, 20);
+      chain->nodelist_upd8_params->exp_last_block = upd8_exp_last_block;
+      chain->nodelist_upd8_params->timestamp      = upd8_timestamp;
+    }
+    in3_nodelist_clear(chain);
+    chain->nodelist        = NULL;
+    chain->weights         = NULL;
+    chain->nodelist_length = 0;
+  }
+
+  // nodes
+  uint32_t nodes = read_int(r);
+  if (apply && nodes) {
+    chain->nodelist        = _calloc(nodes, sizeof(in3_node_t));
+    chain->weights         = _calloc(nodes, sizeof(in3_node_weight_t));
+    chain->nodelist_length = nodes;
+  }
+  for (uint32_t i = 0; i < nodes && !r->invalid; i++) {
+    const uint8_t* address  = take(r, 20);
+    uint64_t       deposit  = read_long(r);
+    uint32_t       index    = read_int(r);
+    uint32_t       capacity = read_int(r);
+    uint64_t       props    = read_long(r);
+    uint8_t        attrs    = read_byte(r);
+    uint32_t       url_len  = read_int(r);
+    const uint8_t* url      = take(r, url_len);
+
+    in3_node_weight_t w   = {0};
+    w.response_count      = read_int(r);
+    w.total_response_time = read_int(r);
+    w.blacklisted_until   = read_long(r);
+    w.latency_pos         = read_byte(r);
+    w.latency_len         = read_byte(r);
+    for (int j = 0; j < w.latency_len; j++) {
+      uint32_t latency = read_int(r);
+      if (j < IN3_NODE_LATENCY_SAMPLES) w.latency[j] = latency;
+    }
+    if (!apply) continue;
+
+    // the number of samples may have been different when the snapshot was written
+    if (w.latency_len > IN3_NODE_LATENCY_SAMPLES) w.latency_len = IN3_NODE_LATENCY_SAMPLES;
+    if (w.latency_pos >= IN3_NODE_LATENCY_SAMPLES) w.latency_pos = 0;
+
+    in3_node_t* n = chain->nodelist + i;
+    n->address    = b_new(address, 20);
+    n->deposit    = deposit;
+    n->index      = index;
+    n->capacity   = capacity;
+    n->props      = props;
+    n->attrs      = attrs;
+    n->url        = _strdupn((char*) url, url_len);
+    chain->weights[i] = w;
+  }
+
+  // verified hashes
+  uint32_t hashes = read_int(r);
+  if (apply && chain->verified_hashes) memset(chain->verified_hashes, 0, c->max_verified_hashes * sizeof(in3_verified_hash_t));
+  for (uint32_t i = 0; i < hashes && !r->invalid; i++) {
+    uint64_t       block_number = read_long(r);
+    const uint8_t* hash         = take(r, 32);
+    if (apply && hash) in3_verified_hashes_add(chain, c->max_verified_hashes, block_number, hash);
+  }
+}
+
+/** reads the snapshot and updates the client if apply is true. */
+static in3_ret_t read_snapshot(in3_t* c, reader_t* r, bool apply) {
+  const uint8_t* magic = take(r, 4);
+  if (!magic || memcmp(magic, SNAPSHOT_MAGIC, 4)) return IN3_EINVALDT;
+  if (read_byte(r) != IN3_SNAPSHOT_VERSION) return IN3_EVERS;
+
+  chain_id_t    chain_id             = read_int(r);
+  uint_fast16_t flags                = read_int(r);
+  in3_proof_t   proof                = read_byte(r);
+  uint8_t       request_count        = read_byte(r);
+  uint8_t       signature_count      = read_byte(r);
+  uint8_t       replace_latest_block = read_byte(r);
+  uint16_t      finality             = read_int(r);
+  uint_fast16_t max_attempts         = read_int(r);
+  uint_fast16_t max_verified_hashes  = read_int(r);
+  uint16_t      node_limit           = read_int(r);
+  uint32_t      cache_timeout        = read_int(r);
+  uint32_t      max_code_cache       = read_int(r);
+  uint32_t      max_block_cache      = read_int(r);
+  uint32_t      timeout              = read_int(r);
+  uint32_t      deadline             = read_int(r);
+  uint64_t      min_deposit          = read_long(r);
+  uint64_t      node_props           = read_long(r);
+  if (r->invalid) return IN3_EINVALDT;
+
+  if (apply) {
+    // the verified hashes of all chains must fit the new size
+    for (int i = 0; i < c->chains_length; i++) in3_verified_hashes_resize(c->chains + i, c->max_verified_hashes, max_verified_hashes);
+    c->chain_id             = chain_id;
+    c->flags                = flags;
+    c->proof                = proof;
+    c->request_count        = request_count;
+    c->signature_count      = signature_count;
+    c->replace_latest_block = replace_latest_block;
+    c->finality             = finality;
+    c->max_attempts         = max_attempts;
+    c->max_verified_hashes  = max_verified_hashes;
+    c->node_limit           = node_limit;
+    c->cache_timeout        = cache_timeout;
+    c->max_code_cache       = max_code_cache;
+    c->max_block_cache      = max_block_cache;
+    c->timeout              = timeout;
+    c->deadline             = deadline;
+    c->min_deposit          = min_deposit;
+    c->node_props           = node_props;
+  }
+
+  uint32_t chains = read_int(r);
+  for (uint32_t i = 0; i < chains && !r->invalid; i++) read_chain(c, r, apply);
+  return r->invalid || r->pos != r->data->len ? IN3_EINVALDT : IN3_OK;
+}
+
+in3_ret_t in3_snapshot_load(in3_t* c, const bytes_t* data) {
+  // we check the whole snapshot before changing anything
+  reader_t  r   = {.data = data, .pos = 0, .invalid = false};
+  in3_ret_t res = read_snapshot(c, &r, false);
+  if (res != IN3_OK) return res;
+
+  r = (reader_t){.data = data, .pos = 0, .invalid = false};
+  return read_snapshot(c, &r, true);
+}
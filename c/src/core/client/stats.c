@@ -0,0 +1,172 @@
+/*******************************************************************************
+ * This file is part of the Incubed project.
+ * Sources: https://github.com/slockit/in3-c
+ * 
+ * Copyright (C) 2018-2020 slock.it GmbH, Blockchains LLC
+ * 
+ * 
+ * COMMERCIAL LICENSE USAGE
+ * 
+ * Licensees holding a valid commercial license may use this file in accordance 
+ * with the commercial license agreement provided with the Software or, alternatively, 
+ * in accordance with the terms contained in a written agreement between you and 
+ * slock.it GmbH/Blockchains LLC. For licensing terms and conditions or further 
+ * information please contact slock.it at in3@slock.it.
+ * 	
+ * Alternatively, this file may be used under the AGPL license as follows:
+ *    
+ * AGPL LICENSE USAGE
+ * 
+ * This program is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Affero General Public License as published by the Free Software 
+ * Foundation, either version 3 of the License, or (at your option) any later version.
+ *  
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY 
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A 
+ * PARTICULAR PURPOSE. See the GNU Affero General Public License for more details.
+ * [Permissions of this strong copyleft license are conditioned on making available 
+ * complete source code of licensed works and modifications, which include larger 
+ * works using a licensed work, under the same license. Copyright and license notices 
+ * must be preserved. Contributors provide an express grant of patent rights.]
+ * You should have received a copy of the GNU Affero General Public License along 
+ * with this program. If not, see <https://www.gnu.org/licenses/>.
+ *******************************************************************************/
+
+
+#include "stats.h"
+#include "../util/mem.h"
+#include "../util/utils.h"
+#include <stdlib.h>
+#include <string.h>
+#ifndef __ZEPHYR__
+#include <sys/time.h>
+#endif
+
+const uint64_t in3_stats_buckets[IN3_STATS_BUCKETS] = {100, 250, 500, 1000, 2500, 5000, 10000, 25000, 50000, 100000, 250000, 500000, 1000000, 2500000, 5000000, 10000000};
+
+#ifdef STATS
+
+#define SLOT_FREE    0
+#define SLOT_WRITING 1
+#define SLOT_READY   2
+
+/** an entry of the registry. Once the label is written (state is SLOT_READY), it will not change until the registry is reset. */
+typedef struct {
+  volatile uint32_t state;
+  in3_stat_t        stat;
+} slot_t;
+
+static slot_t slots[IN3_STATS_MAX_ENTRIES];
+static slot_t others[IN3_STAT_TYPES]; // used, if there are no free slots left.
+
+#if defined(__GNUC__) || defined(__clang__)
+#define ATOMIC_ADD(field, val)      __sync_fetch_and_add(&(field), val)
+#define ATOMIC_CAS(field, old, val) __sync_bool_compare_and_swap(&(field), old, val)
+#define MEMORY_BARRIER()            __sync_synchronize()
+#else
+static inline bool cas(volatile uint32_t* p, uint32_t old, uint32_t val) {
+  if (*p != old) return false;
+  *p = val;
+  return true;
+}
+#define ATOMIC_ADD(field, val)      (field) += (val)
+#define ATOMIC_CAS(field, old, val) cas(&(field), old, val)
+#define MEMORY_BARRIER()
+#endif
+
+static uint32_t hash(in3_stat_type_t type, const char* label) {
+  uint32_t h = 2166136261u ^ type;
+  for (const char* c = label; *c && c < label + IN3_STATS_LABEL_LEN - 1; c++) h = (h ^ (uint8_t) *c) * 16777619u;
+  return h;
+}
+
+static void init_slot(slot_t* slot, in3_stat_type_t type, const char* label) {
+  slot->stat.type = type;
+  strncpy(slot->stat.label, label, IN3_STATS_LABEL_LEN - 1);
+  MEMORY_BARRIER();
+  slot->state = SLOT_READY;
+}
+
+/** finds the entry for the label or creates it. */
+static in3_stat_t* find_stat(in3_stat_type_t type, const char* label) {
+  if (!label) label = "";
+  uint32_t h = hash(type, label);
+  for (uint32_t n = 0; n < IN3_STATS_MAX_ENTRIES; n++) {
+    slot_t* slot = slots + (h + n) % IN3_STATS_MAX_ENTRIES;
+    if (slot->state == SLOT_FREE && ATOMIC_CAS(slot->state, SLOT_FREE, SLOT_WRITING)) {
+      init_slot(slot, type, label);
+      return &slot->stat;
+    }
+    while (slot->state == SLOT_WRITING) {} // another thread is writing the label right now
+    if (slot->stat.type == type && strncmp(slot->stat.label, label, IN3_STATS_LABEL_LEN - 1) == 0) return &slot->stat;
+  }
+
+  // the registry is full
+  slot_t* other = others + type;
+  if (other->state == SLOT_FREE && ATOMIC_CAS(other->state, SLOT_FREE, SLOT_WRITING)) init_slot(other, type, "other");
+  return &other->stat;
+}
+
+void in3_stats_add(in3_stat_type_t type, const char* label, uint64_t value) {
+  ATOMIC_ADD(find_stat(type, label)->count, value);
+}
+
+void in3_stats_observe(in3_stat_type_t type, const char* label, uint64_t us) {
+  in3_stat_t* stat = find_stat(type, label);
+  ATOMIC_ADD(stat->count, 1);
+  ATOMIC_ADD(stat->sum, us);
+  for (int i = 0; i < IN3_STATS_BUCKETS; i++) {
+    if (us > in3_stats_buckets[i]) continue;
+    ATOMIC_ADD(stat->buckets[i], 1);
+    break;
+  }
+}
+
+uint64_t in3_stats_time() {
+#ifndef __ZEPHYR__
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec * 1000000L + tv.tv_usec;
+#else
+  return current_ms() * 1000;
+#endif
+}
+
+static int compare_stats(const void* a, const void* b) {
+  const in3_stat_t *x = a, *y = b;
+  return x->type == y->type ? strcmp(x->label, y->label) : (int) x->type - (int) y->type;
+}
+
+in3_stats_t* in3_get_stats() {
+  in3_stats_t* stats = _calloc(1, sizeof(in3_stats_t));
+  stats->entries     = _malloc(sizeof(in3_stat_t) * (IN3_STATS_MAX_ENTRIES + IN3_STAT_TYPES));
+  for (int i = 0; i < IN3_STATS_MAX_ENTRIES + IN3_STAT_TYPES; i++) {
+    slot_t* slot = i < IN3_STATS_MAX_ENTRIES ? slots + i : others + i - IN3_STATS_MAX_ENTRIES;
+    if (slot->state == SLOT_READY) stats->entries[stats->len++] = slot->stat;
+  }
+  qsort(stats->entries, stats->len, sizeof(in3_stat_t), compare_stats);
+  stats->transport = in3_get_transport_stats();
+  return stats;
+}
+
+void in3_stats_reset() {
+  memset(slots, 0, sizeof(slots));
+  memset(others, 0, sizeof(others));
+}
+
+#else
+
+in3_stats_t* in3_get_stats() {
+  in3_stats_t* stats = _calloc(1, sizeof(in3_stats_t));
+  stats->transport   = in3_get_transport_stats();
+  return stats;
+}
+
+void in3_stats_reset() {}
+
+#endif
+
+void in3_stats_free(in3_stats_t* stats) {
+  if (stats->entries) _free(stats->entries);
+  _free(stats);
+}
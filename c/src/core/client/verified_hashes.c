@@ -0,0 +1,131 @@
+/*******************************************************************************
+ * This file is part of the Incubed project.
+ * Sources: https://github.com/slockit/in3-c
+ * 
+ * Copyright (C) 2018-2020 slock.it GmbH, Blockchains LLC
+ * 
+ * 
+ * COMMERCIAL LICENSE USAGE
+ * 
+ * Licensees holding a valid commercial license may use this file in accordance 
+ * with the commercial license agreement provided with the Software or, alternatively, 
+ * in accordance with the terms contained in a written agreement between you and 
+ * slock.it GmbH/Blockchains LLC. For licensing terms and conditions or further 
+ * information please contact slock.it at in3@slock.it.
+ * 	
+ * Alternatively, this file may be used under the AGPL license as follows:
+ *    
+ * AGPL LICENSE USAGE
+ * 
+ * This program is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Affero General Public License as published by the Free Software 
+ * Foundation, either version 3 of the License, or (at your option) any later version.
+ *  
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY 
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A 
+ * PARTICULAR PURPOSE. See the GNU Affero General Public License for more details.
+ * [Permissions of this strong copyleft license are conditioned on making available 
+ * complete source code of licensed works and modifications, which include larger 
+ * works using a licensed work, under the same license. Copyright and license notices 
+ * must be preserved. Contributors provide an express grant of patent rights.]
+ * You should have received a copy of the GNU Affero General Public License along 
+ * with this program. If not, see <https://www.gnu.org/licenses/>.
+ *******************************************************************************/
+
+#include "verified_hashes.h"
+#include "../util/mem.h"
+#include "../util/utils.h"
+#include <string.h>
+
+/** returns the index of the first entry with a blocknumber >= block_number (within the len entries). */
+static uint_fast16_t lower_bound(const in3_verified_hash_t* hashes, uint_fast16_t len, uint64_t block_number) {
+  uint_fast16_t lo = 0, hi = len;
+  while (lo < hi) {
+    const uint_fast16_t mid = (lo + hi) / 2;
+    if (hashes[mid].block_number < block_number)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  return lo;
+}
+
+uint_fast16_t in3_verified_hashes_len(const in3_chain_t* chain, uint_fast16_t max) {
+  if (!chain->verified_hashes) return 0;
+  // the empty entries are at the end, so we search the first one
+  uint_fast16_t lo = 0, hi = max;
+  while (lo < hi) {
+    const uint_fast16_t mid = (lo + hi) / 2;
+    if (chain->verified_hashes[mid].block_number)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  return lo;
+}
+
+in3_verified_hash_t* in3_verified_hashes_find(const in3_chain_t* chain, uint_fast16_t max, uint64_t block_number) {
+  const uint_fast16_t len = in3_verified_hashes_len(chain, max);
+  const uint_fast16_t i   = lower_bound(chain->verified_hashes, len, block_number);
+  return i < len && chain->verified_hashes[i].block_number == block_number ? chain->verified_hashes + i : NULL;
+}
+
+in3_verified_hash_t* in3_verified_hashes_range(const in3_chain_t* chain, uint_fast16_t max, uint64_t from, uint64_t to, uint_fast16_t* len) {
+  const uint_fast16_t count = in3_verified_hashes_len(chain, max);
+  const uint_fast16_t start = lower_bound(chain->verified_hashes, count, from);
+  const uint_fast16_t end   = to < from ? start : lower_bound(chain->verified_hashes, count, to == UINT64_MAX ? to : to + 1);
+  *len                      = end - start;
+  return *len ? chain->verified_hashes + start : NULL;
+}
+
+bool in3_verified_hashes_add(in3_chain_t* chain, uint_fast16_t max, uint64_t block_number, const bytes32_t hash) {
+  if (!max || !block_number) return false;
+  if (!chain->verified_hashes) chain->verified_hashes = _calloc(max, sizeof(in3_verified_hash_t));
+
+  in3_verified_hash_t* hashes = chain->verified_hashes;
+  const uint_fast16_t  len    = in3_verified_hashes_len(chain, max);
+  uint_fast16_t        i      = lower_bound(hashes, len, block_number);
+  if (i < len && hashes[i].block_number == block_number) {
+    memcpy(hashes[i].hash, hash, 32);
+    return true;
+  }
+
+  if (len == max) {
+    // full, so we remove the oldest block and insert before the next one
+    if (i == 0) return false;
+    memmove(hashes, hashes + 1, --i * sizeof(in3_verified_hash_t));
+  } else
+    memmove(hashes + i + 1, hashes + i, (len - i) * sizeof(in3_verified_hash_t));
+
+  hashes[i].block_number = block_number;
+  memcpy(hashes[i].hash, hash, 32);
+  return true;
+}
+
+void in3_verified_hashes_resize(in3_chain_t* chain, uint_fast16_t old_max, uint_fast16_t new_max) {
+  if (!chain->verified_hashes || old_max == new_max) return;
+  if (!new_max) {
+    _free(chain->verified_hashes);
+    chain->verified_hashes = NULL;
+    return;
+  }
+  const uint_fast16_t len = in3_verified_hashes_len(chain, old_max);
+  if (len > new_max) memmove(chain->verified_hashes, chain->verified_hashes + len - new_max, new_max * sizeof(in3_verified_hash_t));
+  chain->verified_hashes = _realloc(chain->verified_hashes, sizeof(in3_verified_hash_t) * new_max, sizeof(in3_verified_hash_t) * old_max);
+  if (new_max > len) memset(chain->verified_hashes + len, 0, (new_max - len) * sizeof(in3_verified_hash_t));
+}
+
+uint_fast16_t in3_verified_hashes_select(const in3_chain_t* chain, uint_fast16_t max, uint64_t block_number, uint16_t finality, bytes_t* dst, uint_fast16_t dst_len) {
+  uint_fast16_t        n = 0, range_len = 0;
+  in3_verified_hash_t* range = block_number ? in3_verified_hashes_range(chain, max, block_number, block_number + finality, &range_len) : NULL;
+  for (uint_fast16_t i = 0; i < range_len && n < dst_len; i++) dst[n++] = bytes(range[i].hash, 32);
+
+  // fill up with the newest blocks, which are the most likely to be requested next
+  const uint_fast16_t len = in3_verified_hashes_len(chain, max);
+  for (uint_fast16_t i = len; i > 0 && n < dst_len; i--) {
+    const in3_verified_hash_t* vh = chain->verified_hashes + i - 1;
+    if (range && vh >= range && vh < range + range_len) continue;
+    dst[n++] = bytes((uint8_t*) vh->hash, 32);
+  }
+  return n;
+}
@@ -0,0 +1,110 @@
+/*******************************************************************************
+ * This file is part of the Incubed project.
+ * Sources: https://github.com/slockit/in3-c
+ * 
+ * Copyright (C) 2018-2020 slock.it GmbH, Blockchains LLC
+ * 
+ * 
+ * COMMERCIAL LICENSE USAGE
+ * 
+ * Licensees holding a valid commercial license may use this file in accordance 
+ * with the commercial license agreement provided with the Software or, alternatively, 
+ * in accordance with the terms contained in a written agreement between you and 
+ * slock.it GmbH/Blockchains LLC. For licensing terms and conditions or further 
+ * information please contact slock.it at in3@slock.it.
+ * 	
+ * Alternatively, this file may be used under the AGPL license as follows:
+ *    
+ * AGPL LICENSE USAGE
+ * 
+ * This program is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Affero General Public License as published by the Free Software 
+ * Foundation, either version 3 of the License, or (at your option) any later version.
+ *  
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY 
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A 
+ * PARTICULAR PURPOSE. See the GNU Affero General Public License for more details.
+ * [Permissions of this strong copyleft license are conditioned on making available 
+ * complete source code of licensed works and modifications, which include larger 
+ * works using a licensed work, under the same license. Copyright and license notices 
+ * must be preserved. Contributors provide an express grant of patent rights.]
+ * You should have received a copy of the GNU Affero General Public License along 
+ * with this program. If not, see <https://www.gnu.org/licenses/>.
+ *******************************************************************************/
+
+/** @file
+ * the store of verified blockhashes of a chain.
+ * 
+ * `chain->verified_hashes` holds up to `maxVerifiedHashes` entries sorted by blocknumber, followed by empty entries (with blocknumber 0).
+ * Finding a hash or a range of blocks is a binary search. If the store is full, the oldest block is removed.
+ * The store is written to the storage handler by `in3_cache_store_weights` whenever it changed.
+ * */
+
+#include "client.h"
+
+#ifndef IN3_VERIFIED_HASHES_H
+#define IN3_VERIFIED_HASHES_H
+
+#ifndef IN3_ADVERTISED_HASHES
+#define IN3_ADVERTISED_HASHES 8 /**< max number of verified hashes sent to the node with each request */
+#endif
+
+/** returns the number of verified hashes. */
+NONULL uint_fast16_t in3_verified_hashes_len(
+    const in3_chain_t* chain, /**< the chain */
+    uint_fast16_t      max    /**< the size of the store (`maxVerifiedHashes`) */
+);
+
+/** finds the verified hash of a block or returns NULL. */
+NONULL in3_verified_hash_t* in3_verified_hashes_find(
+    const in3_chain_t* chain,       /**< the chain */
+    uint_fast16_t      max,         /**< the size of the store (`maxVerifiedHashes`) */
+    uint64_t           block_number /**< the block */
+);
+
+/** returns the verified hashes with a blocknumber within [from, to] or NULL if there are none. */
+NONULL in3_verified_hash_t* in3_verified_hashes_range(
+    const in3_chain_t* chain, /**< the chain */
+    uint_fast16_t      max,   /**< the size of the store (`maxVerifiedHashes`) */
+    uint64_t           from,  /**< the first block */
+    uint64_t           to,    /**< the last block */
+    uint_fast16_t*     len    /**< the number of hashes found */
+);
+
+/** 
+ * adds a verified hash. 
+ * 
+ * If the block is already stored, its hash is replaced. If the store is full, the oldest block is removed.
+ * returns false, if the block is older than all blocks of a full store and was not added.
+ */
+NONULL bool in3_verified_hashes_add(
+    in3_chain_t*    chain,        /**< the chain */
+    uint_fast16_t   max,          /**< the size of the store (`maxVerifiedHashes`) */
+    uint64_t        block_number, /**< the block */
+    const bytes32_t hash          /**< the blockhash */
+);
+
+/** changes the size of the store and keeps the newest blocks, if it shrinks. */
+NONULL void in3_verified_hashes_resize(
+    in3_chain_t*  chain,   /**< the chain */
+    uint_fast16_t old_max, /**< the current size of the store */
+    uint_fast16_t new_max  /**< the new size */
+);
+
+/**
+ * selects the verified hashes to send to the node with a request. 
+ * 
+ * If the request refers to a block, the hashes of this block and the following finality blocks come first, 
+ * since the node does not need to sign them. The remaining places are filled with the newest blocks.
+ * returns the number of hashes written to dst.
+ */
+NONULL uint_fast16_t in3_verified_hashes_select(
+    const in3_chain_t* chain,        /**< the chain */
+    uint_fast16_t      max,          /**< the size of the store (`maxVerifiedHashes`) */
+    uint64_t           block_number, /**< the block requested or 0 if unknown */
+    uint16_t           finality,     /**< the number of finality blocks */
+    bytes_t*           dst,          /**< the hashes to send */
+    uint_fast16_t      dst_len       /**< max number of hashes to select */
+);
+
+#endif
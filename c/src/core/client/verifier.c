@@ -44,6 +44,7 @@ void in3_register_verifier(in3_verifier_t* verifier) {
   if (existing) {
     existing->pre_handle = verifier->pre_handle;
     existing->verify     = verifier->verify;
+    if (verifier->free_chain) existing->free_chain = verifier->free_chain;
   } else {
     verifier->next = verifiers;
     verifiers      = verifier;
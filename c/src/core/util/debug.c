@@ -100,6 +100,7 @@ char* in3_errmsg(in3_ret_t err /**< the error code */) {
     case IN3_EPAYMENT_REQUIRED: return "payment required";
     case IN3_ENODEVICE: return "no hardware wallet connected";
     case IN3_EAPDU: return "error in usb communication protocol";
+    case IN3_ETIMEOUT: return "the deadline of the request has been exceeded";
   }
   return NULL;
 #else
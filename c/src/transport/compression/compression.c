@@ -0,0 +1,132 @@
+/*******************************************************************************
+ * This file is part of the Incubed project.
+ * Sources: https://github.com/slockit/in3-c
+ * 
+ * Copyright (C) 2018-2020 slock.it GmbH, Blockchains LLC
+ * 
+ * 
+ * COMMERCIAL LICENSE USAGE
+ * 
+ * Licensees holding a valid commercial license may use this file in accordance 
+ * with the commercial license agreement provided with the Software or, alternatively, 
+ * in accordance with the terms contained in a written agreement between you and 
+ * slock.it GmbH/Blockchains LLC. For licensing terms and conditions or further 
+ * information please contact slock.it at in3@slock.it.
+ * 	
+ * Alternatively, this file may be used under the AGPL license as follows:
+ *    
+ * AGPL LICENSE USAGE
+ * 
+ * This program is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Affero General Public License as published by the Free Software 
+ * Foundation, either version 3 of the License, or (at your option) any later version.
+ *  
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY 
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A 
+ * PARTICULAR PURPOSE. See the GNU Affero General Public License for more details.
+ * [Permissions of this strong copyleft license are conditioned on making available 
+ * complete source code of licensed works and modifications, which include larger 
+ * works using a licensed work, under the same license. Copyright and license notices 
+ * must be preserved. Contributors provide an express grant of patent rights.]
+ * You should have received a copy of the GNU Affero General Public License along 
+ * with this program. If not, see <https://www.gnu.org/licenses/>.
+ *******************************************************************************/
+
+#include "compression.h"
+#include "../../core/util/mem.h"
+#include <string.h>
+#include <zlib.h>
+
+#define INFLATE_BUFFER 16384
+
+struct in3_inflate {
+  z_stream z;       /**< the zlib-stream */
+  bool     raw;     /**< true if the data is raw deflate without zlib-header */
+  bool     started; /**< true if data was successfully decoded */
+  bool     done;    /**< true if the end of the stream was reached */
+  sb_t     head;    /**< the data received before anything was decoded, which is decoded again if it turns out to be raw deflate */
+};
+
+bytes_t* in3_gzip(const char* data, size_t len) {
+  z_stream z;
+  memset(&z, 0, sizeof(z));
+  // 15 + 16 means max window size with a gzip-header
+  if (deflateInit2(&z, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK) return NULL;
+
+  uLong    max = deflateBound(&z, len);
+  bytes_t* res = b_new(NULL, max);
+  z.next_in    = (Bytef*) data;
+  z.avail_in   = len;
+  z.next_out   = res->data;
+  z.avail_out  = max;
+  int ret      = deflate(&z, Z_FINISH);
+  res->len     = max - z.avail_out;
+  deflateEnd(&z);
+
+  if (ret != Z_STREAM_END) {
+    b_free(res);
+    return NULL;
+  }
+  return res;
+}
+
+in3_inflate_t* in3_inflate_new() {
+  in3_inflate_t* z = _calloc(1, sizeof(in3_inflate_t));
+  // 15 + 32 means max window size and automatic detection of the gzip- or zlib-header
+  if (inflateInit2(&z->z, 15 + 32) != Z_OK) {
+    _free(z);
+    return NULL;
+  }
+  return z;
+}
+
+int in3_inflate(in3_inflate_t* z, const char* data, size_t len, sb_t* dst) {
+  uint8_t buffer[INFLATE_BUFFER];
+  if (z->done) return 1;
+  if (!z->started && !z->raw && len) sb_add_range(&z->head, data, 0, len);
+  z->z.next_in  = (Bytef*) data;
+  z->z.avail_in = len;
+
+  while (z->z.avail_in) {
+    z->z.next_out  = buffer;
+    z->z.avail_out = sizeof(buffer);
+    int ret        = inflate(&z->z, Z_NO_FLUSH);
+
+    // some servers send deflate without the zlib-header, so we try again as raw deflate with all data received so far.
+    if (ret == Z_DATA_ERROR && !z->started && !z->raw) {
+      inflateEnd(&z->z);
+      memset(&z->z, 0, sizeof(z_stream));
+      if (inflateInit2(&z->z, -15) != Z_OK) return -1;
+      sb_t head = z->head;
+      memset(&z->head, 0, sizeof(sb_t));
+      z->raw  = true;
+      int res = in3_inflate(z, head.data, head.len, dst);
+      _free(head.data);
+      return res;
+    }
+    if (ret != Z_OK && ret != Z_STREAM_END && ret != Z_BUF_ERROR) return -1;
+
+    size_t n = sizeof(buffer) - z->z.avail_out;
+    if (n) {
+      z->started = true;
+      sb_add_range(dst, (char*) buffer, 0, n);
+    }
+    if (z->started && z->head.data) {
+      _free(z->head.data);
+      memset(&z->head, 0, sizeof(sb_t));
+    }
+    if (ret == Z_STREAM_END) {
+      z->done = true;
+      return 1;
+    }
+    if (ret == Z_BUF_ERROR && !n) break;
+  }
+  return 0;
+}
+
+void in3_inflate_free(in3_inflate_t* z) {
+  if (!z) return;
+  inflateEnd(&z->z);
+  if (z->head.data) _free(z->head.data);
+  _free(z);
+}
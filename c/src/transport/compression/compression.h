@@ -0,0 +1,79 @@
+/*******************************************************************************
+ * This file is part of the Incubed project.
+ * Sources: https://github.com/slockit/in3-c
+ * 
+ * Copyright (C) 2018-2020 slock.it GmbH, Blockchains LLC
+ * 
+ * 
+ * COMMERCIAL LICENSE USAGE
+ * 
+ * Licensees holding a valid commercial license may use this file in accordance 
+ * with the commercial license agreement provided with the Software or, alternatively, 
+ * in accordance with the terms contained in a written agreement between you and 
+ * slock.it GmbH/Blockchains LLC. For licensing terms and conditions or further 
+ * information please contact slock.it at in3@slock.it.
+ * 	
+ * Alternatively, this file may be used under the AGPL license as follows:
+ *    
+ * AGPL LICENSE USAGE
+ * 
+ * This program is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Affero General Public License as published by the Free Software 
+ * Foundation, either version 3 of the License, or (at your option) any later version.
+ *  
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY 
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A 
+ * PARTICULAR PURPOSE. See the GNU Affero General Public License for more details.
+ * [Permissions of this strong copyleft license are conditioned on making available 
+ * complete source code of licensed works and modifications, which include larger 
+ * works using a licensed work, under the same license. Copyright and license notices 
+ * must be preserved. Contributors provide an express grant of patent rights.]
+ * You should have received a copy of the GNU Affero General Public License along 
+ * with this program. If not, see <https://www.gnu.org/licenses/>.
+ *******************************************************************************/
+
+/** @file 
+ * gzip/deflate helper used by the transports in order to compress requests and decode responses.
+ * 
+ * The sources are compiled into the transport using them and only if zlib is available (`USE_ZLIB`).
+ */
+
+#ifndef in3_compression_h__
+#define in3_compression_h__
+
+#include "../../core/util/bytes.h"
+#include "../../core/util/stringbuilder.h"
+#include <stdbool.h>
+#include <stddef.h>
+
+/** the Accept-Encoding-header-value supported by the decoder */
+#define IN3_ACCEPT_ENCODING "gzip, deflate"
+
+/** the state of a streaming decoder */
+typedef struct in3_inflate in3_inflate_t;
+
+/**
+ * compresses the data with gzip.
+ * 
+ * returns the compressed data, which must be freed with `b_free`, or NULL if the compression failed.
+ */
+bytes_t* in3_gzip(const char* data, size_t len);
+
+/**
+ * creates a streaming decoder for gzip or deflate encoded data.
+ */
+in3_inflate_t* in3_inflate_new();
+
+/**
+ * decodes the next part of the encoded data and appends the result to the stringbuilder.
+ * 
+ * returns 1 if the end of the stream was reached, 0 if more data is expected and a negative value if the data is invalid.
+ */
+int in3_inflate(in3_inflate_t* z, const char* data, size_t len, sb_t* dst);
+
+/**
+ * frees the decoder.
+ */
+void in3_inflate_free(in3_inflate_t* z);
+
+#endif // in3_compression_h__
@@ -41,6 +41,9 @@
 #include "../../core/util/utils.h"
 #include <curl/curl.h>
 #include <string.h>
+#ifdef USE_ZLIB
+#include "../compression/compression.h"
+#endif
 
 #ifndef CURL_MAX_PARALLEL
 #define CURL_MAX_PARALLEL 50
@@ -49,9 +52,52 @@ typedef struct {
   CURLM*             cm;
   uint32_t           start;
   struct curl_slist* headers;
+  bytes_t*           body;        /**< the compressed payload or NULL if it was not compressed */
+  size_t             payload_len; /**< length of the uncompressed payload */
 
 } in3_curl_t;
 
+static uint32_t compress_min_size = 0;
+
+void in3_curl_compress_requests(uint32_t min_size) {
+  compress_min_size = min_size;
+}
+
+/** compresses the payload if enabled and large enough and adds the headers */
+static bytes_t* compress_payload(const char* payload, size_t len, struct curl_slist** headers) {
+#ifdef USE_ZLIB
+  if (!compress_min_size || len < compress_min_size) return NULL;
+  bytes_t* body = in3_gzip(payload, len);
+  if (body) *headers = curl_slist_append(*headers, "Content-Encoding: gzip");
+  return body;
+#else
+  UNUSED_VAR(payload);
+  UNUSED_VAR(len);
+  UNUSED_VAR(headers);
+  return NULL;
+#endif
+}
+
+static void set_payload(CURL* curl, const char* payload, bytes_t* body) {
+  if (body) {
+    curl_easy_setopt(curl, CURLOPT_POSTFIELDS, (char*) body->data);
+    curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE, (long) body->len);
+  } else if (payload && *payload) {
+    curl_easy_setopt(curl, CURLOPT_POSTFIELDS, payload);
+    curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE, (long) strlen(payload));
+  }
+#ifdef USE_ZLIB
+  // an empty string lets curl offer all encodings it supports and decodes the response while receiving it.
+  curl_easy_setopt(curl, CURLOPT_ACCEPT_ENCODING, "");
+#endif
+}
+
+static void update_stats(CURL* curl, size_t payload_len, bytes_t* body, in3_response_t* r) {
+  curl_off_t received = 0;
+  curl_easy_getinfo(curl, CURLINFO_SIZE_DOWNLOAD_T, &received);
+  in3_transport_stats_add(payload_len, body ? body->len : payload_len, r->data.len, (uint64_t) received);
+}
+
 /*
 struct MemoryStruct {
   char *memory = NULL;
@@ -64,21 +110,18 @@ static size_t WriteMemoryCallback(void* contents, size_t size, size_t nmemb, voi
   return size * nmemb;
 }
 
-static void readDataNonBlocking(CURLM* cm, const char* url, const char* payload, struct curl_slist* headers, in3_response_t* r, uint32_t timeout) {
+static void readDataNonBlocking(CURLM* cm, const char* url, const char* payload, bytes_t* body, struct curl_slist* headers, in3_response_t* r, uint32_t timeout) {
   CURL*     curl;
   CURLMcode res;
 
   curl = curl_easy_init();
   if (curl) {
     curl_easy_setopt(curl, CURLOPT_URL, url);
-    if (payload && *payload) {
-      curl_easy_setopt(curl, CURLOPT_POSTFIELDS, payload);
-      curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE, (long) strlen(payload));
-    }
+    set_payload(curl, payload, body);
     curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
     curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteMemoryCallback);
     curl_easy_setopt(curl, CURLOPT_WRITEDATA, (void*) r);
-    curl_easy_setopt(curl, CURLOPT_TIMEOUT, (uint64_t) timeout / 1000L);
+    curl_easy_setopt(curl, CURLOPT_TIMEOUT_MS, (long) timeout);
     curl_easy_setopt(curl, CURLOPT_PRIVATE, (void*) r);
 
     /* Perform the request, res will get the return code */
@@ -122,6 +165,7 @@ in3_ret_t receive_next(in3_request_t* req) {
             sb_add_chars(&response->data, "returned with invalid status code");
           response->state = IN3_ERPC;
         }
+        update_stats(e, c->payload_len, c->body, response);
         curl_multi_remove_handle(c->cm, e);
         curl_easy_cleanup(e);
         response->time = current_ms() - c->start;
@@ -140,6 +184,7 @@ in3_ret_t cleanup(in3_curl_t* c) {
 
   curl_slist_free_all(c->headers);
   curl_multi_cleanup(c->cm);
+  if (c->body) b_free(c->body);
   _free(c);
   return IN3_OK;
 }
@@ -154,11 +199,13 @@ in3_ret_t send_curl_nonblocking(in3_request_t* req) {
   struct curl_slist* headers = curl_slist_append(NULL, "Accept: application/json");
   if (req->payload && *req->payload)
     headers = curl_slist_append(headers, "Content-Type: application/json");
-  headers    = curl_slist_append(headers, "charsets: utf-8");
-  c->headers = curl_slist_append(headers, "User-Agent: in3 curl " IN3_VERSION);
+  headers        = curl_slist_append(headers, "charsets: utf-8");
+  c->payload_len = req->payload ? strlen(req->payload) : 0;
+  c->body        = compress_payload(req->payload, c->payload_len, &headers);
+  c->headers     = curl_slist_append(headers, "User-Agent: in3 curl " IN3_VERSION);
 
   // create requests
-  for (unsigned int i = 0; i < req->urls_len; i++) readDataNonBlocking(c->cm, req->urls[i], req->payload, c->headers, req->ctx->raw_response + i, req->ctx->client->timeout);
+  for (unsigned int i = 0; i < req->urls_len; i++) readDataNonBlocking(c->cm, req->urls[i], req->payload, c->body, c->headers, req->ctx->raw_response + i, req->timeouts ? req->timeouts[i] : req->ctx->client->timeout);
   in3_ret_t res = receive_next(req);
   if (req->urls_len == 1) {
     cleanup(c);
@@ -173,21 +220,20 @@ static void readDataBlocking(const char* url, char* payload, in3_response_t* r,
 
   curl = curl_easy_init();
   if (curl) {
-    curl_easy_setopt(curl, CURLOPT_URL, url);
-    if (payload && *payload) {
-      curl_easy_setopt(curl, CURLOPT_POSTFIELDS, payload);
-      curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE, (long) strlen(payload));
-    }
-    struct curl_slist* headers = NULL;
-    headers                    = curl_slist_append(headers, "Accept: application/json");
+    size_t             payload_len = payload ? strlen(payload) : 0;
+    struct curl_slist* headers     = NULL;
+    headers                        = curl_slist_append(headers, "Accept: application/json");
     if (payload && *payload)
       headers = curl_slist_append(headers, "Content-Type: application/json");
-    headers = curl_slist_append(headers, "charsets: utf-8");
-    headers = curl_slist_append(headers, "User-Agent: in3 curl " IN3_VERSION);
+    headers       = curl_slist_append(headers, "charsets: utf-8");
+    headers       = curl_slist_append(headers, "User-Agent: in3 curl " IN3_VERSION);
+    bytes_t* body = compress_payload(payload, payload_len, &headers);
+    curl_easy_setopt(curl, CURLOPT_URL, url);
+    set_payload(curl, payload, body);
     curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
     curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteMemoryCallback);
     curl_easy_setopt(curl, CURLOPT_WRITEDATA, (void*) r);
-    curl_easy_setopt(curl, CURLOPT_TIMEOUT, (uint64_t) timeout / 1000L);
+    curl_easy_setopt(curl, CURLOPT_TIMEOUT_MS, (long) timeout);
 
     /* Perform the request, res will get the return code */
     res = curl_easy_perform(curl);
@@ -199,6 +245,8 @@ static void readDataBlocking(const char* url, char* payload, in3_response_t* r,
     } else
       r->state = IN3_OK;
 
+    update_stats(curl, payload_len, body, r);
+    if (body) b_free(body);
     curl_slist_free_all(headers);
     /* always cleanup */
     curl_easy_cleanup(curl);
@@ -226,7 +274,7 @@ in3_ret_t send_curl(in3_request_t* req) {
 #ifdef CURL_BLOCKING
   in3_ret_t res;
   uint64_t  start = current_ms();
-  res             = send_curl_blocking((const char**) req->urls, req->urls_len, req->payload, req->ctx->raw_response, req->ctx->client->timeout);
+  res             = send_curl_blocking((const char**) req->urls, req->urls_len, req->payload, req->ctx->raw_response, in3_get_request_timeout(req));
   uint32_t t      = (uint32_t)(current_ms() - start);
   for (int i = 0; i < req->urls_len; i++) req->ctx->raw_response[i].time = t;
   return res;
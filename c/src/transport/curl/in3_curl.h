@@ -60,4 +60,13 @@ in3_ret_t send_curl(in3_request_t* req);
  */
 void in3_register_curl();
 
+/**
+ * activates the compression of requests.
+ * 
+ * If the payload is larger than `min_size` bytes, it will be sent gzip-compressed (`Content-Encoding: gzip`).
+ * Only use this if the nodes accept compressed requests. Passing 0 turns it off (default).
+ * This has only an effect if the transport was built with `USE_ZLIB`, which also requests and decodes compressed responses.
+ */
+void in3_curl_compress_requests(uint32_t min_size);
+
 #endif // in3_curl_h__
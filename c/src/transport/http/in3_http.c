@@ -36,205 +36,713 @@
 #include <stdlib.h> /* exit, atoi, malloc, free */
 #include <string.h> /* memcpy, memset */
 #include <time.h>
-#include <unistd.h> /* read, write, close */
 #ifdef _WIN32
 // clang-format off
 #include <winsock2.h>
 #include <windows.h>
 #include <ws2tcpip.h>
 // clang-format on
+#define poll                  WSAPoll
+#define close_socket(s)       closesocket(s)
+#define last_socket_error()   WSAGetLastError()
+#define SOCKET_WOULD_BLOCK(e) ((e) == WSAEWOULDBLOCK || (e) == WSAEINPROGRESS)
+#define SOCKET_INTERRUPTED(e) ((e) == WSAEINTR)
+#define strncasecmp           _strnicmp
+typedef SOCKET in3_socket_t;
 #else
-#include <netdb.h>      /* struct hostent, gethostbyname */
-#include <netinet/in.h> /* struct sockaddr_in, struct sockaddr */
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>       /* struct addrinfo, getaddrinfo */
+#include <netinet/in.h>  /* struct sockaddr_in, struct sockaddr */
+#include <netinet/tcp.h> /* TCP_NODELAY */
+#include <poll.h>
+#include <strings.h>
 #include <sys/socket.h> /* socket, connect */
+#include <unistd.h>     /* read, write, close */
+#define close_socket(s)       close(s)
+#define last_socket_error()   errno
+#define SOCKET_WOULD_BLOCK(e) ((e) == EINPROGRESS || (e) == EAGAIN || (e) == EWOULDBLOCK)
+#define SOCKET_INTERRUPTED(e) ((e) == EINTR)
+#define INVALID_SOCKET        -1
+typedef int in3_socket_t;
+#endif
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
 #endif
 #include "../../core/client/client.h"
 #include "../../core/client/context.h"
+#include "../../core/client/version.h"
+#include "../../core/util/log.h"
 #include "../../core/util/mem.h"
 #include "../../core/util/utils.h"
 #include "in3_http.h"
+#ifdef USE_ZLIB
+#include "../compression/compression.h"
+#endif
 
-in3_ret_t send_http(in3_request_t* req) {
-  for (int n = 0; n < req->urls_len; n++) {
-
-    struct hostent*    server;
-    struct sockaddr_in serv_addr;
-    int                received, bytes, sent, total;
-    char *             message = alloca(strlen(req->payload) + 200), response[4096], *url = req->urls[n], host[256];
-    uint64_t           start = current_ms();
-
-    (void) received;
-    (void) bytes;
-    (void) sent;
-
-    // parse url
-    if (strncmp(url, "http://", 7)) {
-      in3_ctx_add_response(req->ctx, n, true, "invalid url must sart with http", -1);
-      continue;
-    }
+#ifndef HTTP_MAX_IDLE_CONNECTIONS
+#define HTTP_MAX_IDLE_CONNECTIONS 16 /**< max number of keep-alive connections kept open between requests */
+#endif
+#ifndef HTTP_IDLE_TIMEOUT
+#define HTTP_IDLE_TIMEOUT 30000 /**< time in ms an idle connection is kept before it is closed */
+#endif
+#ifndef HTTP_DNS_CACHE_SIZE
+#define HTTP_DNS_CACHE_SIZE 16 /**< number of resolved hosts to cache */
+#endif
+#ifndef HTTP_DNS_TTL
+#define HTTP_DNS_TTL 300000 /**< time in ms a resolved address is cached */
+#endif
+#ifndef HTTP_READ_BUFFER
+#define HTTP_READ_BUFFER 16384 /**< size of the buffer used for each recv */
+#endif
+#ifndef HTTP_MAX_HEADER
+#define HTTP_MAX_HEADER 65536 /**< max size of the response header */
+#endif
 
-    // parse url
-    char* path = strchr(url + 7, '/');
-    if (path)
-      strncpy(host, url + 7, path - (url + 7));
-    else {
-      path = "/";
-      strcpy(host, url + 7);
-    }
-    int   portno = 80;
-    char* port   = strchr(host, ':');
-    if (port) {
-      *port  = 0;
-      portno = atoi(port + 1);
-    }
+/** the state of a single connection */
+typedef enum {
+  HTTP_CONNECTING  = 0, /**< waiting for the non-blocking connect to finish */
+  HTTP_SENDING     = 1, /**< writing the request */
+  HTTP_RECV_HEADER = 2, /**< reading the response header */
+  HTTP_RECV_BODY   = 3, /**< reading the response body */
+  HTTP_DONE        = 4  /**< the response has been stored */
+} http_state_t;
+
+/** a connection to one url */
+typedef struct {
+  in3_socket_t    fd;             /**< the socket */
+  http_state_t    state;          /**< current state */
+  char*           host;           /**< the host (used as key for the keep-alive pool) */
+  uint16_t        port;           /**< the port */
+  bool            reused;         /**< true if taken from the keep-alive pool */
+  bool            keep_alive;     /**< true if the server allows to reuse the connection */
+  bool            chunked;        /**< true for Transfer-Encoding: chunked */
+  bool            chunk_trailer;  /**< true if the last chunk was read and we are waiting for the trailer */
+  int64_t         content_length; /**< -1 if the body ends with the connection */
+  int64_t         body_received;  /**< number of body bytes received (before decoding) */
+  int64_t         chunk_left;     /**< bytes left in the current chunk, -1 if the chunk-size-line is expected next */
+  int             status;         /**< the http status code */
+  sb_t            request;        /**< the http request */
+  size_t          sent;           /**< number of bytes already sent */
+  sb_t            buffer;         /**< unprocessed bytes (header or chunk framing) */
+  size_t          payload_len;    /**< length of the uncompressed payload */
+  size_t          body_len;       /**< length of the payload as sent */
+#ifdef USE_ZLIB
+  in3_inflate_t* inflate; /**< decoder if the response is compressed */
+#endif
+  uint64_t        start;          /**< time the request was started */
+  uint64_t        deadline;       /**< time when the request times out */
+  in3_response_t* response;       /**< the response to fill */
+} http_con_t;
+
+/** the state of a request, which is stored in the cptr of the in3_request_t */
+typedef struct {
+  http_con_t*    cons; /**< one connection per url */
+  struct pollfd* fds;  /**< the poll-entries for all pending connections */
+  int            len;  /**< number of connections */
+} in3_http_t;
+
+/** a cached dns-entry */
+typedef struct {
+  char*                   host;     /**< hostname */
+  uint16_t                port;     /**< port */
+  struct sockaddr_storage addr;     /**< the resolved address */
+  socklen_t               addr_len; /**< length of the address */
+  uint64_t                expires;  /**< time until this entry is valid */
+} http_dns_t;
+
+/** an idle connection, which may be reused */
+typedef struct {
+  char*        host;  /**< hostname */
+  uint16_t     port;  /**< port */
+  in3_socket_t fd;    /**< the open socket */
+  uint64_t     since; /**< time when the connection became idle */
+} http_idle_t;
 
-    // create message
-    sprintf(message, "POST %s HTTP/1.0\r\nHost: %s\r\nContent-Type: application/json\r\nContent-Length: %d\r\n\r\n%s", path, host, (int) strlen(req->payload), req->payload);
-    total = strlen(message);
+static http_dns_t  dns_cache[HTTP_DNS_CACHE_SIZE];
+static http_idle_t idle_pool[HTTP_MAX_IDLE_CONNECTIONS];
+static uint32_t    compress_min_size = 0;
+
+// the caches are shared by all clients, so we guard them with a simple spin lock.
+#if defined(__GNUC__) || defined(__clang__)
+static volatile int cache_lock = 0;
+#define LOCK_CACHE()                                 \
+  while (__sync_lock_test_and_set(&cache_lock, 1)) { \
+  }
+#define UNLOCK_CACHE() __sync_lock_release(&cache_lock)
+#else
+#define LOCK_CACHE()
+#define UNLOCK_CACHE()
+#endif
 
-/* create the socket */
 #ifdef _WIN32
-    (void) (total); // unused var
+static volatile int wsa_started = 0;
+
+static void wsa_cleanup() {
+  WSACleanup();
+}
+
+/** starts winsock once for all requests. Since pooled connections outlive the requests, it is only cleaned up when the process exits. */
+static bool wsa_startup() {
+  if (wsa_started) return true;
+  LOCK_CACHE();
+  if (!wsa_started) {
     WSADATA wsa;
-    SOCKET  s;
+    if (WSAStartup(MAKEWORD(2, 2), &wsa) == 0) {
+      atexit(wsa_cleanup);
+      wsa_started = 1;
+    }
+  }
+  UNLOCK_CACHE();
+  return wsa_started;
+}
+#endif
+
+static bool set_nonblocking(in3_socket_t fd) {
+#ifdef _WIN32
+  u_long mode = 1;
+  return ioctlsocket(fd, FIONBIO, &mode) == 0;
+#else
+  int flags = fcntl(fd, F_GETFL, 0);
+  return flags >= 0 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0;
+#endif
+}
 
-    if (WSAStartup(MAKEWORD(2, 2), &wsa) != 0) {
-      in3_ctx_add_response(req->ctx, n, true, "no socket available", -1);
-      continue;
+static bool resolve(const char* host, uint16_t port, struct sockaddr_storage* addr, socklen_t* addr_len) {
+  uint64_t now = current_ms();
+  int      n   = -1;
+  LOCK_CACHE();
+  for (int i = 0; i < HTTP_DNS_CACHE_SIZE; i++) {
+    if (dns_cache[i].host && dns_cache[i].port == port && strcmp(dns_cache[i].host, host) == 0) {
+      if (dns_cache[i].expires > now) {
+        memcpy(addr, &dns_cache[i].addr, dns_cache[i].addr_len);
+        *addr_len = dns_cache[i].addr_len;
+        UNLOCK_CACHE();
+        return true;
+      }
+      n = i;
+      break;
     }
+  }
+  UNLOCK_CACHE();
+
+  char            port_str[8];
+  struct addrinfo hints, *res = NULL;
+  memset(&hints, 0, sizeof(hints));
+  hints.ai_family   = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  sprintf(port_str, "%u", (unsigned) port);
+  if (getaddrinfo(host, port_str, &hints, &res) || !res) return false;
+  memcpy(addr, res->ai_addr, res->ai_addrlen);
+  *addr_len = (socklen_t) res->ai_addrlen;
+  freeaddrinfo(res);
 
-    //Create a socket
-    if ((s = socket(AF_INET, SOCK_STREAM, 0)) == INVALID_SOCKET) {
-      in3_ctx_add_response(req->ctx, n, true, "could not create the socket", -1);
-      continue;
+  LOCK_CACHE();
+  if (n < 0) {
+    // take a free slot or the one expiring first
+    n = 0;
+    for (int i = 0; i < HTTP_DNS_CACHE_SIZE; i++) {
+      if (!dns_cache[i].host) {
+        n = i;
+        break;
+      }
+      if (dns_cache[i].expires < dns_cache[n].expires) n = i;
     }
+  }
+  if (dns_cache[n].host) _free(dns_cache[n].host);
+  dns_cache[n].host     = _strdupn(host, -1);
+  dns_cache[n].port     = port;
+  dns_cache[n].addr     = *addr;
+  dns_cache[n].addr_len = *addr_len;
+  dns_cache[n].expires  = now + HTTP_DNS_TTL;
+  UNLOCK_CACHE();
+  return true;
+}
 
-    server                    = gethostbyname(host);
-    serv_addr.sin_addr.s_addr = inet_addr(server->h_addr);
-    serv_addr.sin_family      = AF_INET;
-    serv_addr.sin_port        = htons(portno);
-    memset(&serv_addr, 0, sizeof(serv_addr));
-    serv_addr.sin_family = AF_INET;
-    serv_addr.sin_port   = htons(portno);
-    memcpy(&serv_addr.sin_addr.s_addr, server->h_addr, server->h_length);
-    //Connect to remote server
-    if (connect(s, (struct sockaddr*) &serv_addr, sizeof(serv_addr)) < 0) {
-      in3_ctx_add_response(req->ctx, n, true, "Connection failed", -1);
-      continue;
+/** returns a idle connection to the given host or INVALID_SOCKET if there is none */
+static in3_socket_t pool_take(const char* host, uint16_t port) {
+  uint64_t     now = current_ms();
+  in3_socket_t fd  = INVALID_SOCKET;
+  LOCK_CACHE();
+  for (int i = 0; i < HTTP_MAX_IDLE_CONNECTIONS; i++) {
+    http_idle_t* p = idle_pool + i;
+    if (!p->host) continue;
+    if (p->since + HTTP_IDLE_TIMEOUT < now) {
+      close_socket(p->fd);
+      _free(p->host);
+      p->host = NULL;
+    } else if (fd == INVALID_SOCKET && p->port == port && strcmp(p->host, host) == 0) {
+      fd = p->fd;
+      _free(p->host);
+      p->host = NULL;
     }
+  }
+  UNLOCK_CACHE();
 
-    if (send(s, message, strlen(message), 0) < 0) {
-      in3_ctx_add_response(req->ctx, n, true, "Send failed", -1);
-      continue;
+  if (fd != INVALID_SOCKET) {
+    // a idle connection must not have any data to read, otherwise it was closed or is out of sync.
+    char c;
+    int  r = recv(fd, &c, 1, MSG_PEEK);
+    if (r >= 0 || !SOCKET_WOULD_BLOCK(last_socket_error())) {
+      close_socket(fd);
+      fd = INVALID_SOCKET;
     }
+  }
+  return fd;
+}
 
-    //Receive a reply from the server
-    if ((received = recv(s, response, 2000, 0)) == SOCKET_ERROR) {
-      in3_ctx_add_response(req->ctx, n, true, "Receive failed", -1);
-      continue;
+/** puts a connection back into the pool. if the pool is full, the oldest connection will be closed. */
+static void pool_put(const char* host, uint16_t port, in3_socket_t fd) {
+  int n = 0;
+  LOCK_CACHE();
+  for (int i = 0; i < HTTP_MAX_IDLE_CONNECTIONS; i++) {
+    if (!idle_pool[i].host) {
+      n = i;
+      break;
     }
+    if (idle_pool[i].since < idle_pool[n].since) n = i;
+  }
+  if (idle_pool[n].host) {
+    close_socket(idle_pool[n].fd);
+    _free(idle_pool[n].host);
+  }
+  idle_pool[n].host  = _strdupn(host, -1);
+  idle_pool[n].port  = port;
+  idle_pool[n].fd    = fd;
+  idle_pool[n].since = current_ms();
+  UNLOCK_CACHE();
+}
 
-    //Add a NULL terminating character to make it a proper string before printing
-    response[received] = '\0';
-    in3_ctx_add_response(req->ctx, n, false, response, -1);
+static void con_close(http_con_t* con) {
+  if (con->fd != INVALID_SOCKET) close_socket(con->fd);
+  con->fd = INVALID_SOCKET;
+}
 
-    closesocket(s);
-    WSACleanup();
-#else
-    int sockfd;
-    server = gethostbyname(host);
-    if (server == NULL) {
-      in3_ctx_add_response(req->ctx, n, true, "no such host", -1);
-      continue;
-    }
-    sockfd = socket(AF_INET, SOCK_STREAM, 0);
-    if (sockfd < 0) {
-      in3_ctx_add_response(req->ctx, n, true, "ERROR opening socket", -1);
-      continue;
+static void con_done(http_con_t* con, in3_ret_t state, const char* error) {
+  if (error) {
+    con->response->data.len = 0;
+    sb_add_chars(&con->response->data, error);
+  }
+  con->response->state = state;
+  con->response->time  = (uint32_t)(current_ms() - con->start);
+  con->state           = HTTP_DONE;
+  if (state != IN3_OK || !con->keep_alive) con_close(con);
+  if (state == IN3_OK) in3_transport_stats_add(con->payload_len, con->body_len, con->response->data.len, con->body_received);
+}
+
+/** opens a socket (or reuses a pooled one) and starts connecting */
+static void con_open(http_con_t* con) {
+  struct sockaddr_storage addr;
+  socklen_t               addr_len;
+
+  con->fd     = pool_take(con->host, con->port);
+  con->reused = con->fd != INVALID_SOCKET;
+  if (con->reused) {
+    con->state = HTTP_SENDING;
+    return;
+  }
+
+  if (!resolve(con->host, con->port, &addr, &addr_len)) return con_done(con, IN3_ERPC, "no such host");
+  con->fd = socket(addr.ss_family, SOCK_STREAM, 0);
+  if (con->fd == INVALID_SOCKET) return con_done(con, IN3_ERPC, "ERROR opening socket");
+  if (!set_nonblocking(con->fd)) return con_done(con, IN3_ERPC, "ERROR setting socket to non-blocking");
+#ifdef SO_NOSIGPIPE
+  int one = 1;
+  setsockopt(con->fd, SOL_SOCKET, SO_NOSIGPIPE, (void*) &one, sizeof(one));
+#endif
+  int nodelay = 1;
+  setsockopt(con->fd, IPPROTO_TCP, TCP_NODELAY, (void*) &nodelay, sizeof(nodelay));
+
+  if (connect(con->fd, (struct sockaddr*) &addr, addr_len) == 0)
+    con->state = HTTP_SENDING;
+  else if (SOCKET_WOULD_BLOCK(last_socket_error()))
+    con->state = HTTP_CONNECTING;
+  else
+    con_done(con, IN3_ERPC, "ERROR connecting");
+}
+
+/** parses the response header, which is stored in the buffer. returns the length of the header or -1 if it is incomplete. */
+static int parse_header(http_con_t* con) {
+  char* end = strstr(con->buffer.data, "\r\n\r\n");
+  if (!end) return -1;
+  *end = 0;
+
+  if (strncmp(con->buffer.data, "HTTP/1.", 7) || strlen(con->buffer.data) < 12) return -2;
+  bool http10         = con->buffer.data[7] == '0';
+  con->status         = atoi(con->buffer.data + 9);
+  con->keep_alive     = !http10;
+  con->content_length = -1;
+  con->chunk_left     = -1;
+  con->chunked        = false;
+
+  for (char* line = strstr(con->buffer.data, "\r\n"); line; line = strstr(line, "\r\n")) {
+    line += 2;
+    if (!strncasecmp(line, "content-length:", 15))
+      con->content_length = atoll(line + 15);
+    else if (!strncasecmp(line, "transfer-encoding:", 18))
+      con->chunked = str_find(line + 18, "chunked") != NULL;
+    else if (!strncasecmp(line, "content-encoding:", 17)) {
+      char* v = line + 17;
+      while (*v == ' ') v++;
+      if (!strncasecmp(v, "identity", 8)) continue;
+#ifdef USE_ZLIB
+      if (!strncasecmp(v, "gzip", 4) || !strncasecmp(v, "x-gzip", 6) || !strncasecmp(v, "deflate", 7)) {
+        if (!con->inflate) con->inflate = in3_inflate_new();
+        continue;
+      }
+#endif
+      return -3;
     }
-    /* fill in the structreq->ure */
-    memset(&serv_addr, 0, sizeof(serv_addr));
-    serv_addr.sin_family = AF_INET;
-    serv_addr.sin_port   = htons(portno);
-    memcpy(&serv_addr.sin_addr.s_addr, server->h_addr_list[0], server->h_length);
-    /* connect the socket */
-    if (connect(sockfd, (struct sockaddr*) &serv_addr, sizeof(serv_addr)) < 0) {
-      in3_ctx_add_response(req->ctx, n, true, "ERROR connecting", -1);
-      continue;
+    else if (!strncasecmp(line, "connection:", 11)) {
+      char* v = line + 11;
+      while (*v == ' ') v++;
+      if (!strncasecmp(v, "close", 5)) con->keep_alive = false;
+      if (!strncasecmp(v, "keep-alive", 10)) con->keep_alive = true;
     }
-    /* send the request */
+  }
 
-    sent = 0;
-    do {
-      bytes = write(sockfd, message + sent, total - sent);
-      if (bytes < 0) {
-        in3_ctx_add_response(req->ctx, n, true, "ERROR writing message to socket", -1);
-        continue;
+  // the body ends with the connection, so we can't reuse it.
+  if (!con->chunked && con->content_length < 0) con->keep_alive = false;
+  return end - con->buffer.data + 4;
+}
+
+/** adds body data to the response and decodes it if needed. returns false if the data could not be decoded. */
+static bool body_add(http_con_t* con, const char* data, int len) {
+  if (!len) return true;
+  con->body_received += len;
+#ifdef USE_ZLIB
+  if (con->inflate) return in3_inflate(con->inflate, data, len, &con->response->data) >= 0;
+#endif
+  sb_add_range(&con->response->data, data, 0, len);
+  return true;
+}
+
+/** processes the chunk-framing in the buffer and copies the data into the response. returns true if the last chunk was read. */
+static bool read_chunks(http_con_t* con, int* error) {
+  size_t pos = 0;
+  while (pos < con->buffer.len) {
+    char* p     = con->buffer.data + pos;
+    int   avail = con->buffer.len - pos;
+    if (con->chunk_trailer) {
+      // we skip all trailer headers until we find a empty line
+      char* eol = strstr(p, "\r\n");
+      if (!eol) break;
+      pos += eol - p + 2;
+      if (eol == p) {
+        pos = con->buffer.len;
+        return true;
       }
-      if (bytes == 0)
-        break;
-      sent += bytes;
-    } while (sent < total);
-    /* receive the response */
-    memset(response, 0, sizeof(response));
-    total    = sizeof(response) - 1;
-    received = 0;
-    do {
-      memset(response, 0, sizeof(response));
-      bytes = recv(sockfd, response, 1024, 0);
-      if (bytes < 0) {
-        in3_ctx_add_response(req->ctx, n, true, "ERROR reading response from socket", -1);
-        continue;
+    } else if (con->chunk_left < 0) {
+      char* eol = strstr(p, "\r\n");
+      if (!eol) break;
+      char* end;
+      con->chunk_left = strtoll(p, &end, 16);
+      if (end == p || con->chunk_left < 0) {
+        *error = 1;
+        return false;
       }
-      if (bytes == 0)
-        break;
-      in3_ctx_add_response(req->ctx, n, false, response, -1);
-      received += bytes;
-    } while (1);
+      pos += eol - p + 2;
+      if (con->chunk_left == 0) con->chunk_trailer = true;
+    } else if (con->chunk_left > 0) {
+      int n = avail < con->chunk_left ? avail : (int) con->chunk_left;
+      if (!body_add(con, p, n)) {
+        *error = 2;
+        return false;
+      }
+      con->chunk_left -= n;
+      pos += n;
+    } else {
+      // end of chunk data, we expect a CRLF
+      if (avail < 2) break;
+      if (p[0] != '\r' || p[1] != '\n') {
+        *error = 1;
+        return false;
+      }
+      pos += 2;
+      con->chunk_left = -1;
+    }
+  }
+
+  // remove the processed bytes
+  memmove(con->buffer.data, con->buffer.data + pos, con->buffer.len - pos + 1);
+  con->buffer.len -= pos;
+  return false;
+}
 
-    if (received == total) {
-      in3_ctx_add_response(req->ctx, n, true, "ERROR storing complete response from socket", -1);
-      continue;
+/** handles incoming data */
+static void con_feed(http_con_t* con, const char* data, int len) {
+  if (con->state == HTTP_RECV_HEADER) {
+    sb_add_range(&con->buffer, data, 0, len);
+    int header_len = parse_header(con);
+    if (header_len == -1) {
+      if (con->buffer.len > HTTP_MAX_HEADER) con_done(con, IN3_ERPC, "ERROR response header too large");
+      return;
     }
+    if (header_len == -2) return con_done(con, IN3_ERPC, "ERROR invalid HTTP Version");
+    if (header_len == -3) return con_done(con, IN3_ERPC, "ERROR unsupported Content-Encoding");
 
-    /* close the socket */
-    close(sockfd);
+    // we keep only the body in the buffer
+    size_t body_len = con->buffer.len - header_len;
+    memmove(con->buffer.data, con->buffer.data + header_len, body_len);
+    con->buffer.len            = body_len;
+    con->buffer.data[body_len] = 0;
+    con->state                 = HTTP_RECV_BODY;
+    con->response->data.len    = 0;
+    if (!con->chunked) {
+      data = con->buffer.data;
+      len  = body_len;
+    }
+  } else if (con->chunked && len)
+    sb_add_range(&con->buffer, data, 0, len);
 
-#endif
+  if (con->chunked) {
+    int error = 0;
+    if (read_chunks(con, &error)) goto finished;
+    if (error) return con_done(con, IN3_ERPC, error == 2 ? "ERROR invalid compressed data" : "ERROR invalid chunked encoding");
+    return;
+  }
 
-    req->ctx->raw_response[n].time = (uint32_t)(current_ms() - start);
+  // more data than expected means the connection is out of sync and can't be reused.
+  if (con->content_length >= 0 && con->body_received + len > con->content_length) {
+    con->keep_alive = false;
+    len             = con->content_length - con->body_received;
+  }
+  bool ok         = body_add(con, data, len);
+  con->buffer.len = 0;
+  if (!ok) return con_done(con, IN3_ERPC, "ERROR invalid compressed data");
+  if (con->content_length >= 0 && con->body_received >= con->content_length) goto finished;
+  return;
+
+finished:
+  if (con->status < 200 || con->status >= 400) {
+    if (!con->response->data.len) sb_add_chars(&con->response->data, "returned with invalid status code");
+    con->keep_alive = false;
+    return con_done(con, IN3_ERPC, NULL);
+  }
+  con_done(con, IN3_OK, NULL);
+}
 
-    // now evaluate the response
+/** the connection was closed by the server */
+static void con_eof(http_con_t* con) {
+  if (con->state == HTTP_RECV_BODY && !con->chunked && con->content_length < 0) {
+    con->keep_alive = false;
+    con_feed(con, "", 0);
+    if (con->state != HTTP_DONE) con_done(con, IN3_OK, NULL);
+    return;
+  }
+
+  // a reused connection may have been closed by the server before we sent the request, so we retry with a new one.
+  if (con->reused && (con->state == HTTP_SENDING || con->state == HTTP_RECV_HEADER) && !con->buffer.len) {
+    con_close(con);
+    con->sent = 0;
+    con_open(con);
+    return;
+  }
+  con_done(con, IN3_ERPC, "ERROR connection closed before the response was complete");
+}
 
-    char *res = req->ctx->raw_response[n].data.data, *header = strstr(res, "\r\n\r\n"), *body = header + 4;
-    if (!header) {
-      in3_ctx_add_response(req->ctx, n, true, "ERROR invalid response", -1);
-      continue;
+static void con_send(http_con_t* con) {
+  while (con->sent < con->request.len) {
+    int n = send(con->fd, con->request.data + con->sent, con->request.len - con->sent, MSG_NOSIGNAL);
+    if (n < 0) {
+      if (SOCKET_WOULD_BLOCK(last_socket_error())) return;
+      if (con->reused && !con->sent) return con_eof(con);
+      return con_done(con, IN3_ERPC, "ERROR writing message to socket");
     }
-    *header = 0;
-    header  = strstr(res, "\r\n");
-    if (!header) {
-      in3_ctx_add_response(req->ctx, n, true, "ERROR invalid response", -1);
-      continue;
+    con->sent += n;
+  }
+  con->state = HTTP_RECV_HEADER;
+}
+
+static void con_recv(http_con_t* con) {
+  char buf[HTTP_READ_BUFFER];
+  while (con->state == HTTP_RECV_HEADER || con->state == HTTP_RECV_BODY) {
+    int n = recv(con->fd, buf, sizeof(buf), 0);
+    if (n > 0)
+      con_feed(con, buf, n);
+    else if (n == 0)
+      return con_eof(con);
+    else if (SOCKET_WOULD_BLOCK(last_socket_error()))
+      return;
+    else if (con->reused && con->state == HTTP_RECV_HEADER && !con->buffer.len)
+      return con_eof(con);
+    else
+      return con_done(con, IN3_ERPC, "ERROR reading response from socket");
+  }
+}
+
+/** prepares the connection for the given url */
+static void con_init(http_con_t* con, const char* url, const char* payload, size_t payload_len, bytes_t* body, in3_response_t* response, uint32_t timeout) {
+  memset(con, 0, sizeof(http_con_t));
+  con->fd          = INVALID_SOCKET;
+  con->response    = response;
+  con->start       = current_ms();
+  con->deadline    = con->start + (timeout ? timeout : 10000);
+  con->payload_len = payload_len;
+  con->body_len    = body ? body->len : payload_len;
+
+  if (strncmp(url, "http://", 7)) return con_done(con, IN3_ERPC, "invalid url must sart with http");
+
+  // parse url
+  const char* host     = url + 7;
+  const char* path     = strchr(host, '/');
+  int         host_len = path ? (int) (path - host) : (int) strlen(host);
+  char*       port     = memchr(host, ':', host_len);
+  if (!path) path = "/";
+  con->port      = port ? (uint16_t) atoi(port + 1) : 80;
+  con->host      = _strdupn(host, port ? (int) (port - host) : host_len);
+
+  // create message
+  sb_add_chars(&con->request, payload_len ? "POST " : "GET ");
+  sb_add_chars(&con->request, path);
+  sb_add_chars(&con->request, " HTTP/1.1\r\nHost: ");
+  sb_add_range(&con->request, host, 0, host_len);
+  sb_add_chars(&con->request, "\r\nUser-Agent: in3 http " IN3_VERSION "\r\nAccept: application/json\r\nConnection: keep-alive\r\n");
+#ifdef USE_ZLIB
+  sb_add_chars(&con->request, "Accept-Encoding: " IN3_ACCEPT_ENCODING "\r\n");
+#endif
+  if (body) {
+    sb_add_chars(&con->request, "Content-Type: application/json\r\nContent-Encoding: gzip\r\nContent-Length: ");
+    sb_add_int(&con->request, body->len);
+    sb_add_chars(&con->request, "\r\n\r\n");
+    sb_add_range(&con->request, (char*) body->data, 0, body->len);
+  } else if (payload_len) {
+    sb_add_chars(&con->request, "Content-Type: application/json\r\nContent-Length: ");
+    sb_add_int(&con->request, payload_len);
+    sb_add_chars(&con->request, "\r\n\r\n");
+    sb_add_range(&con->request, payload, 0, payload_len);
+  } else
+    sb_add_chars(&con->request, "\r\n");
+
+  con_open(con);
+}
+
+static void con_free(http_con_t* con) {
+  if (con->fd != INVALID_SOCKET && con->state == HTTP_DONE && con->keep_alive && con->response && con->response->state == IN3_OK) {
+    pool_put(con->host, con->port, con->fd);
+    con->fd = INVALID_SOCKET;
+  }
+  con_close(con);
+  if (con->host) _free(con->host);
+  if (con->request.data) _free(con->request.data);
+  if (con->buffer.data) _free(con->buffer.data);
+#ifdef USE_ZLIB
+  in3_inflate_free(con->inflate);
+#endif
+}
+
+static in3_ret_t cleanup(in3_http_t* c) {
+  if (!c) return IN3_OK;
+  for (int i = 0; i < c->len; i++) con_free(c->cons + i);
+  _free(c->cons);
+  _free(c->fds);
+  _free(c);
+  return IN3_OK;
+}
+
+/** waits until the next response was received and returns its state */
+static in3_ret_t receive_next(in3_request_t* req) {
+  in3_http_t*    c   = req->cptr;
+  struct pollfd* fds = c->fds;
+
+  while (true) {
+    int      n   = 0;
+    uint64_t now = current_ms(), next_deadline = now + 1000;
+
+    for (int i = 0; i < c->len; i++) {
+      http_con_t* con = c->cons + i;
+      if (con->state == HTTP_DONE) continue;
+      if (con->deadline <= now) {
+        con_done(con, IN3_ERPC, "ERROR timeout");
+        return IN3_ERPC;
+      }
+      if (con->deadline < next_deadline) next_deadline = con->deadline;
+      fds[n].fd      = con->fd;
+      fds[n].events  = con->state == HTTP_CONNECTING || con->state == HTTP_SENDING ? POLLOUT : POLLIN;
+      fds[n].revents = 0;
+      n++;
     }
-    *header = 0;
-    header  = strtok(res, " ");
-    if (header == NULL || (strcmp(header, "HTTP/1.1") && strcmp(header, "HTTP/1.0"))) {
-      in3_ctx_add_response(req->ctx, n, true, "ERROR invalid HTTP Version", -1);
-      continue;
+    if (!n) return IN3_EFIND;
+
+    if (poll(fds, n, (int) (next_deadline - now)) < 0) {
+      if (SOCKET_INTERRUPTED(last_socket_error())) continue;
+      // we can't wait for any of the connections anymore
+      for (int i = 0; i < c->len; i++) {
+        if (c->cons[i].state != HTTP_DONE) con_done(c->cons + i, IN3_ETRANS, "ERROR waiting for the response");
+      }
+      return IN3_ETRANS;
     }
-    header     = strtok(NULL, " ");
-    int status = header ? atoi(header) : 0;
-    if (status < 200 || status >= 400) {
-      in3_ctx_add_response(req->ctx, n, true, "ERROR failed request", -1);
-      continue;
+
+    n = 0;
+    for (int i = 0; i < c->len; i++) {
+      http_con_t* con = c->cons + i;
+      if (con->state == HTTP_DONE) continue;
+      short revents = fds[n++].revents;
+      if (!revents) continue;
+
+      if (con->state == HTTP_CONNECTING) {
+        int       err = 0;
+        socklen_t len = sizeof(err);
+        if (getsockopt(con->fd, SOL_SOCKET, SO_ERROR, (void*) &err, &len) || err)
+          con_done(con, IN3_ERPC, "ERROR connecting");
+        else
+          con->state = HTTP_SENDING;
+      }
+      if (con->state == HTTP_SENDING) con_send(con);
+      if (con->state == HTTP_RECV_HEADER || con->state == HTTP_RECV_BODY) {
+        if (revents & (POLLIN | POLLHUP | POLLERR)) con_recv(con);
+      }
+      if (con->state == HTTP_DONE) return con->response->state;
     }
+  }
+}
+
+static in3_ret_t send_http_nonblocking(in3_request_t* req) {
+#ifdef _WIN32
+  if (!wsa_startup()) return IN3_ETRANS;
+#endif
+  in3_http_t* c = _malloc(sizeof(in3_http_t));
+  c->len        = req->urls_len;
+  c->cons       = _calloc(c->len ? c->len : 1, sizeof(http_con_t));
+  c->fds        = _calloc(c->len ? c->len : 1, sizeof(struct pollfd));
+  req->cptr     = c;
 
-    memmove(res, body, req->ctx->raw_response[n].data.len - (body - res) + 1);
-    req->ctx->raw_response[n].data.len -= body - res;
+  size_t   payload_len = req->payload ? strlen(req->payload) : 0;
+  bytes_t* body        = NULL;
+#ifdef USE_ZLIB
+  if (compress_min_size && payload_len >= compress_min_size) body = in3_gzip(req->payload, payload_len);
+#endif
+  for (int i = 0; i < c->len; i++) con_init(c->cons + i, req->urls[i], req->payload, payload_len, body, req->ctx->raw_response + i, req->timeouts ? req->timeouts[i] : req->ctx->client->timeout);
+  if (body) b_free(body);
+
+  // if a connection failed already, we report it as the first response
+  in3_ret_t res = IN3_EFIND;
+  for (int i = 0; i < c->len && res == IN3_EFIND; i++) {
+    if (c->cons[i].state == HTTP_DONE) res = c->cons[i].response->state;
+  }
+  if (res == IN3_EFIND) res = receive_next(req);
+  if (req->urls_len == 1) {
+    cleanup(c);
+    req->cptr = NULL;
+  }
+  return res;
+}
+
+in3_ret_t send_http(in3_request_t* req) {
+  switch (req->action) {
+    case REQ_ACTION_SEND:
+      return send_http_nonblocking(req);
+    case REQ_ACTION_RECEIVE:
+      return receive_next(req);
+    case REQ_ACTION_CLEANUP:
+      return cleanup(req->cptr);
+    default:
+      return IN3_EINVAL;
   }
+}
 
-  return 0;
+void in3_http_compress_requests(uint32_t min_size) {
+  compress_min_size = min_size;
 }
 
 void in3_register_http() {
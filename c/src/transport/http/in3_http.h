@@ -43,9 +43,13 @@
 #include "../../core/client/client.h"
 
 /**
- * a very simple transport function, which allows to send http-requests without a dependency to curl.
+ * a simple transport function, which allows to send http-requests without a dependency to curl.
  * Here each request will be transformed to http instead of https.
  * 
+ * All urls are requested in parallel using non-blocking sockets and HTTP/1.1. Connections are kept alive
+ * and reused for the next request to the same host and resolved hosts are cached.
+ * Like the curl-transport it supports the `REQ_ACTION_SEND`, `REQ_ACTION_RECEIVE` and `REQ_ACTION_CLEANUP` actions.
+ * 
  * You can use it by setting the transport-function-pointer in the in3_t->transport to this function:
  * 
  * ```c
@@ -61,4 +65,13 @@ in3_ret_t send_http(in3_request_t* req);
  */
 void in3_register_http();
 
+/**
+ * activates the compression of requests.
+ * 
+ * If the payload is larger than `min_size` bytes, it will be sent gzip-compressed (`Content-Encoding: gzip`).
+ * Only use this if the nodes accept compressed requests. Passing 0 turns it off (default).
+ * This has only an effect if the transport was built with `USE_ZLIB`, which also requests and decodes compressed responses.
+ */
+void in3_http_compress_requests(uint32_t min_size);
+
 #endif // in3_http_h__
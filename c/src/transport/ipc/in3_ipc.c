@@ -0,0 +1,458 @@
+/*******************************************************************************
+ * This file is part of the Incubed project.
+ * Sources: https://github.com/slockit/in3-c
+ * 
+ * Copyright (C) 2018-2020 slock.it GmbH, Blockchains LLC
+ * 
+ * 
+ * COMMERCIAL LICENSE USAGE
+ * 
+ * Licensees holding a valid commercial license may use this file in accordance 
+ * with the commercial license agreement provided with the Software or, alternatively, 
+ * in accordance with the terms contained in a written agreement between you and 
+ * slock.it GmbH/Blockchains LLC. For licensing terms and conditions or further 
+ * information please contact slock.it at in3@slock.it.
+ * 	
+ * Alternatively, this file may be used under the AGPL license as follows:
+ *    
+ * AGPL LICENSE USAGE
+ * 
+ * This program is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Affero General Public License as published by the Free Software 
+ * Foundation, either version 3 of the License, or (at your option) any later version.
+ *  
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY 
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A 
+ * PARTICULAR PURPOSE. See the GNU Affero General Public License for more details.
+ * [Permissions of this strong copyleft license are conditioned on making available 
+ * complete source code of licensed works and modifications, which include larger 
+ * works using a licensed work, under the same license. Copyright and license notices 
+ * must be preserved. Contributors provide an express grant of patent rights.]
+ * You should have received a copy of the GNU Affero General Public License along 
+ * with this program. If not, see <https://www.gnu.org/licenses/>.
+ *******************************************************************************/
+
+#include "in3_ipc.h"
+#include "../../core/client/client.h"
+#include "../../core/client/context.h"
+#include "../../core/util/log.h"
+#include "../../core/util/mem.h"
+#include "../../core/util/utils.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+#ifndef IPC_MAX_IDLE_CONNECTIONS
+#define IPC_MAX_IDLE_CONNECTIONS 8 /**< max number of connections kept open between requests */
+#endif
+#ifndef IPC_READ_BUFFER
+#define IPC_READ_BUFFER 16384 /**< size of the buffer used for each recv */
+#endif
+
+#define IPC_PREFIX     "ipc://"
+#define IPC_PREFIX_LEN 6
+
+/** a connection to one ipc-url */
+typedef struct {
+  int             fd;        /**< the socket */
+  char*           path;      /**< the path of the socket */
+  bool            done;      /**< true if the response has been stored */
+  bool            reused;    /**< true if the connection was taken from the pool */
+  bool            in_string; /**< framing: currently inside a json-string */
+  bool            escaped;   /**< framing: last char was a backslash within a string */
+  int             depth;     /**< framing: nesting level of objects and arrays */
+  size_t          scanned;   /**< framing: number of bytes already scanned */
+  size_t          sent;      /**< number of bytes already sent */
+  uint64_t        start;     /**< time the request was started */
+  uint64_t        deadline;  /**< time when the request times out */
+  in3_response_t* response;  /**< the response to fill */
+} ipc_con_t;
+
+/** the state of a request, which is stored in the cptr of the in3_request_t */
+typedef struct {
+  ipc_con_t*      cons;        /**< connections for the ipc-urls */
+  struct pollfd*  fds;         /**< poll entries */
+  int             len;         /**< number of ipc connections */
+  const char*     payload;     /**< the payload (only valid while sending) */
+  size_t          payload_len; /**< length of the payload */
+  char*           data;        /**< copy of the payload to send */
+  in3_ctx_t       ctx;         /**< copy of the context passed to the fallback transport */
+  int*            fb_index;    /**< index of the fallback responses within the urls of the request */
+  int             fb_len;      /**< number of urls handled by the fallback transport */
+  void*           fb_cptr;     /**< the cptr of the fallback transport */
+  in3_response_t* fb_response; /**< the responses of the fallback transport */
+  bool*           fb_copied;   /**< flags marking fallback responses already copied */
+} in3_ipc_t;
+
+/** an idle connection, which may be reused */
+typedef struct {
+  char* path; /**< the path of the socket */
+  int   fd;   /**< the open socket */
+} ipc_idle_t;
+
+static in3_transport_send fallback_transport = NULL;
+static ipc_idle_t         idle_pool[IPC_MAX_IDLE_CONNECTIONS];
+
+// the pool is shared by all clients, so we guard it with a simple spin lock.
+#if defined(__GNUC__) || defined(__clang__)
+static volatile int pool_lock = 0;
+#define LOCK_POOL()                                 \
+  while (__sync_lock_test_and_set(&pool_lock, 1)) { \
+  }
+#define UNLOCK_POOL() __sync_lock_release(&pool_lock)
+#else
+#define LOCK_POOL()
+#define UNLOCK_POOL()
+#endif
+
+static inline bool is_ipc_url(const char* url) {
+  return strncmp(url, IPC_PREFIX, IPC_PREFIX_LEN) == 0;
+}
+
+static int pool_take(const char* path) {
+  int fd = -1;
+  LOCK_POOL();
+  for (int i = 0; i < IPC_MAX_IDLE_CONNECTIONS && fd < 0; i++) {
+    if (idle_pool[i].path && strcmp(idle_pool[i].path, path) == 0) {
+      fd = idle_pool[i].fd;
+      _free(idle_pool[i].path);
+      idle_pool[i].path = NULL;
+    }
+  }
+  UNLOCK_POOL();
+
+  if (fd >= 0) {
+    // a idle connection must not have any data to read, otherwise it was closed.
+    char c;
+    if (recv(fd, &c, 1, MSG_PEEK | MSG_DONTWAIT) >= 0 || (errno != EAGAIN && errno != EWOULDBLOCK)) {
+      close(fd);
+      fd = -1;
+    }
+  }
+  return fd;
+}
+
+static void pool_put(const char* path, int fd) {
+  int n = -1;
+  LOCK_POOL();
+  for (int i = 0; i < IPC_MAX_IDLE_CONNECTIONS && n < 0; i++) {
+    if (!idle_pool[i].path) n = i;
+  }
+  if (n >= 0) {
+    idle_pool[n].path = _strdupn(path, -1);
+    idle_pool[n].fd   = fd;
+  }
+  UNLOCK_POOL();
+  if (n < 0) close(fd);
+}
+
+static void con_done(ipc_con_t* con, in3_ret_t state, const char* error) {
+  if (error) {
+    con->response->data.len = 0;
+    sb_add_chars(&con->response->data, error);
+  }
+  con->response->state = state;
+  con->response->time  = (uint32_t)(current_ms() - con->start);
+  con->done            = true;
+  if (state != IN3_OK && con->fd >= 0) {
+    close(con->fd);
+    con->fd = -1;
+  }
+}
+
+static void con_open(ipc_con_t* con) {
+  struct sockaddr_un addr;
+  if (strlen(con->path) >= sizeof(addr.sun_path)) return con_done(con, IN3_ERPC, "ipc path too long");
+
+  con->fd     = pool_take(con->path);
+  con->reused = con->fd >= 0;
+  if (con->reused) return;
+
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  strcpy(addr.sun_path, con->path);
+  con->fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (con->fd < 0) return con_done(con, IN3_ERPC, "ERROR opening socket");
+  if (connect(con->fd, (struct sockaddr*) &addr, sizeof(addr)) < 0) return con_done(con, IN3_ERPC, "ERROR connecting");
+#ifdef SO_NOSIGPIPE
+  int one = 1;
+  setsockopt(con->fd, SOL_SOCKET, SO_NOSIGPIPE, (void*) &one, sizeof(one));
+#endif
+  int flags = fcntl(con->fd, F_GETFL, 0);
+  fcntl(con->fd, F_SETFL, flags | O_NONBLOCK);
+}
+
+/** scans the new data and returns true if a complete json-value was received. */
+static bool frame_complete(ipc_con_t* con) {
+  sb_t* sb = &con->response->data;
+  for (; con->scanned < sb->len; con->scanned++) {
+    char c = sb->data[con->scanned];
+    if (con->in_string) {
+      if (con->escaped)
+        con->escaped = false;
+      else if (c == '\\')
+        con->escaped = true;
+      else if (c == '"')
+        con->in_string = false;
+    } else if (c == '"')
+      con->in_string = true;
+    else if (c == '{' || c == '[')
+      con->depth++;
+    else if ((c == '}' || c == ']') && --con->depth == 0) {
+      con->scanned++;
+      return true;
+    }
+  }
+  return false;
+}
+
+static void con_send(ipc_con_t* con, const char* data, size_t len) {
+  while (con->sent < len) {
+    ssize_t n = send(con->fd, data + con->sent, len - con->sent, MSG_NOSIGNAL);
+    if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return;
+    if (n < 0) {
+      // the server may have closed the idle connection, so we try again with a new one.
+      if (con->reused && !con->sent) {
+        close(con->fd);
+        con_open(con);
+        if (con->done) return;
+        continue;
+      }
+      return con_done(con, IN3_ERPC, "ERROR writing message to socket");
+    }
+    con->sent += n;
+  }
+}
+
+static void con_recv(ipc_con_t* con, const char* data, size_t len) {
+  char buf[IPC_READ_BUFFER];
+  while (!con->done) {
+    ssize_t n = recv(con->fd, buf, sizeof(buf), 0);
+    if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return;
+    if (n <= 0 && con->reused && !con->response->data.len) {
+      // the server closed the idle connection, so we send the request again using a new one.
+      close(con->fd);
+      con->sent = 0;
+      con_open(con);
+      if (!con->done) con_send(con, data, len);
+      continue;
+    }
+    if (n <= 0) return con_done(con, IN3_ERPC, "ERROR connection closed before the response was complete");
+    sb_add_range(&con->response->data, buf, 0, n);
+    if (frame_complete(con)) {
+      // any data after the json-value means the stream is out of sync, so we can't reuse the connection
+      sb_t* sb = &con->response->data;
+      if (con->scanned < sb->len) {
+        sb->len           = con->scanned;
+        sb->data[sb->len] = 0;
+        close(con->fd);
+        con->fd = -1;
+      }
+      con_done(con, IN3_OK, NULL);
+    }
+  }
+}
+
+static void copy_fallback_responses(in3_ipc_t* c, in3_ctx_t* ctx) {
+  for (int i = 0; i < c->fb_len; i++) {
+    if (c->fb_copied[i] || c->fb_response[i].state == IN3_WAITING) continue;
+    in3_response_t* r = ctx->raw_response + c->fb_index[i];
+    if (r->data.data) _free(r->data.data);
+    *r                     = c->fb_response[i];
+    c->fb_response[i].data = (sb_t){0};
+    c->fb_copied[i]        = true;
+  }
+}
+
+static in3_ret_t cleanup(in3_ipc_t* c) {
+  if (!c) return IN3_OK;
+  for (int i = 0; i < c->len; i++) {
+    ipc_con_t* con = c->cons + i;
+    if (con->fd >= 0 && con->done && con->response->state == IN3_OK)
+      pool_put(con->path, con->fd);
+    else if (con->fd >= 0)
+      close(con->fd);
+    _free(con->path);
+  }
+  if (c->fb_cptr && fallback_transport) {
+    in3_request_t req = {.action = REQ_ACTION_CLEANUP, .ctx = &c->ctx, .cptr = c->fb_cptr, .urls_len = 0, .urls = NULL, .payload = NULL};
+    fallback_transport(&req);
+  }
+  for (int i = 0; i < c->fb_len; i++) {
+    if (c->fb_response[i].data.data) _free(c->fb_response[i].data.data);
+  }
+  if (c->fb_len) {
+    _free(c->fb_response);
+    _free(c->fb_index);
+    _free(c->fb_copied);
+  }
+  if (c->len) {
+    _free(c->cons);
+    _free(c->fds);
+  }
+  if (c->data) _free(c->data);
+  _free(c);
+  return IN3_OK;
+}
+
+static bool is_pending(in3_ipc_t* c) {
+  for (int i = 0; i < c->len; i++) {
+    if (!c->cons[i].done) return true;
+  }
+  for (int i = 0; i < c->fb_len; i++) {
+    if (c->fb_response[i].state == IN3_WAITING) return true;
+  }
+  return false;
+}
+
+/** waits for the next ipc-response. */
+static in3_ret_t receive_ipc(in3_ipc_t* c) {
+  while (true) {
+    int      n   = 0;
+    uint64_t now = current_ms(), next_deadline = now + 1000;
+    for (int i = 0; i < c->len; i++) {
+      ipc_con_t* con = c->cons + i;
+      if (con->done) continue;
+      if (con->deadline <= now) {
+        con_done(con, IN3_ERPC, "ERROR timeout");
+        return IN3_ERPC;
+      }
+      if (con->deadline < next_deadline) next_deadline = con->deadline;
+      c->fds[n].fd      = con->fd;
+      c->fds[n].events  = con->sent < c->payload_len ? POLLOUT : POLLIN;
+      c->fds[n].revents = 0;
+      n++;
+    }
+    if (!n) return IN3_EFIND;
+    if (poll(c->fds, n, (int) (next_deadline - now)) < 0 && errno != EINTR) return IN3_ETRANS;
+
+    n = 0;
+    for (int i = 0; i < c->len; i++) {
+      ipc_con_t* con = c->cons + i;
+      if (con->done) continue;
+      if (!c->fds[n++].revents) continue;
+      if (con->sent < c->payload_len) con_send(con, c->data, c->payload_len);
+      if (!con->done && con->sent == c->payload_len) con_recv(con, c->data, c->payload_len);
+      if (con->done) return con->response->state;
+    }
+  }
+}
+
+static in3_ret_t receive_next(in3_request_t* req) {
+  in3_ipc_t* c = req->cptr;
+  in3_ret_t  res;
+
+  // local sockets answer fast, so we read them first.
+  for (int i = 0; i < c->len; i++) {
+    if (!c->cons[i].done) return receive_ipc(c);
+  }
+
+  if (!c->fb_cptr) return IN3_EFIND;
+  in3_request_t fb_req = {.action = REQ_ACTION_RECEIVE, .ctx = &c->ctx, .cptr = c->fb_cptr, .urls_len = 0, .urls = NULL, .payload = NULL};
+  res                  = fallback_transport(&fb_req);
+  copy_fallback_responses(c, req->ctx);
+  return res;
+}
+
+static in3_ret_t send_ipc_nonblocking(in3_request_t* req) {
+  in3_ipc_t* c = _calloc(1, sizeof(in3_ipc_t));
+  req->cptr    = c;
+
+  for (unsigned int i = 0; i < req->urls_len; i++) {
+    if (is_ipc_url(req->urls[i]))
+      c->len++;
+    else
+      c->fb_len++;
+  }
+
+  // the ipc-requests are written first, so the nodes can work on them while we wait for the fallback.
+  if (c->len) {
+    c->cons        = _calloc(c->len, sizeof(ipc_con_t));
+    c->fds         = _calloc(c->len, sizeof(struct pollfd));
+    c->payload_len = strlen(req->payload) + 1;
+    c->data        = _malloc(c->payload_len + 1);
+    memcpy(c->data, req->payload, c->payload_len - 1);
+    c->data[c->payload_len - 1] = '\n';
+    c->data[c->payload_len]     = 0;
+
+    for (unsigned int i = 0, n = 0; i < req->urls_len; i++) {
+      if (!is_ipc_url(req->urls[i])) continue;
+      ipc_con_t* con = c->cons + n++;
+      con->fd        = -1;
+      con->path      = _strdupn(req->urls[i] + IPC_PREFIX_LEN, -1);
+      con->response  = req->ctx->raw_response + i;
+      con->start     = current_ms();
+      con->deadline  = con->start + (req->timeouts ? req->timeouts[i] : (req->ctx->client->timeout ? req->ctx->client->timeout : 10000));
+      con_open(con);
+      if (!con->done) con_send(con, c->data, c->payload_len);
+    }
+  }
+
+  in3_ret_t res = IN3_EFIND;
+  if (c->fb_len) {
+    if (!fallback_transport) {
+      for (unsigned int i = 0; i < req->urls_len; i++) {
+        if (!is_ipc_url(req->urls[i])) in3_ctx_add_response(req->ctx, i, true, "no transport for this url", -1);
+      }
+      res       = IN3_ECONFIG;
+      c->fb_len = 0;
+    } else {
+      // the fallback writes into its own responses, which will be copied when they are done.
+      char**    urls     = _malloc(sizeof(char*) * c->fb_len);
+      uint32_t* timeouts = req->timeouts ? _malloc(sizeof(uint32_t) * c->fb_len) : NULL;
+      c->fb_index        = _malloc(sizeof(int) * c->fb_len);
+      c->fb_copied       = _calloc(c->fb_len, sizeof(bool));
+      c->fb_response     = _calloc(c->fb_len, sizeof(in3_response_t));
+      for (unsigned int i = 0, n = 0; i < req->urls_len; i++) {
+        if (is_ipc_url(req->urls[i])) continue;
+        if (timeouts) timeouts[n] = req->timeouts[i];
+        urls[n]                 = req->urls[i];
+        c->fb_response[n].state = IN3_WAITING;
+        c->fb_index[n++]        = i;
+      }
+      c->ctx              = *req->ctx;
+      c->ctx.raw_response = c->fb_response;
+
+      in3_request_t fb_req = {.action = REQ_ACTION_SEND, .ctx = &c->ctx, .cptr = NULL, .urls_len = c->fb_len, .urls = urls, .payload = req->payload, .timeouts = timeouts};
+      res                  = fallback_transport(&fb_req);
+      c->fb_cptr           = fb_req.cptr;
+      copy_fallback_responses(c, req->ctx);
+      if (timeouts) _free(timeouts);
+      _free(urls);
+    }
+  }
+
+  // if there is no response yet, we wait for the first ipc-response
+  if (res == IN3_EFIND && c->len) res = receive_ipc(c);
+
+  if (!is_pending(c)) {
+    cleanup(c);
+    req->cptr = NULL;
+  }
+  return res;
+}
+
+in3_ret_t send_ipc(in3_request_t* req) {
+  switch (req->action) {
+    case REQ_ACTION_SEND:
+      return send_ipc_nonblocking(req);
+    case REQ_ACTION_RECEIVE:
+      return req->cptr ? receive_next(req) : IN3_EFIND;
+    case REQ_ACTION_CLEANUP:
+      return cleanup(req->cptr);
+    default:
+      return IN3_EINVAL;
+  }
+}
+
+void in3_register_ipc(in3_transport_send fallback) {
+  fallback_transport = fallback;
+  in3_set_default_transport(send_ipc);
+}
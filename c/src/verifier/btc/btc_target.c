@@ -2,6 +2,7 @@
 #include "../../core/client/cache.h"
 #include "../../core/client/context_internal.h"
 #include "../../core/client/keys.h"
+#include "../../core/client/stats.h"
 #include "../../core/util/mem.h"
 #include "btc_serialize.h"
 
@@ -95,6 +96,7 @@ btc_get_conf(in3_t* c, in3_chain_t* chain) {
     tc->max_diff    = 10;
     tc->dap_limit   = 20;
     bytes_t* cached = c->cache ? c->cache->get_item(c->cache->cptr, cache_key) : NULL;
+    if (c->cache) in3_stats_add(cached ? IN3_STAT_CACHE_HIT : IN3_STAT_CACHE_MISS, "btc_target", 1);
 
     if (cached) {
       tc->data = *cached;
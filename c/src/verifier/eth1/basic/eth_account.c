@@ -38,6 +38,7 @@
 #include "../../../core/util/log.h"
 #include "../../../core/util/mem.h"
 #include "../../../third-party/crypto/bignum.h"
+#include "../../../verifier/eth1/basic/proof_cache.h"
 #include "../../../verifier/eth1/nano/eth_nano.h"
 #include "../../../verifier/eth1/nano/merkle.h"
 #include "../../../verifier/eth1/nano/rlp.h"
@@ -67,16 +68,27 @@ static in3_ret_t verify_proof(in3_vctx_t* vc, bytes_t* header, d_token_t* accoun
   else
     return vc_err(vc, "no address in the account");
 
-  proof = d_create_bytes_vec(d_get(account, K_ACCOUNT_PROOF));
-  if (!proof) return vc_err(vc, "no merkle proof for the account");
   account_raw = serialize_account(account);
+  if (is_not_existened(account)) {
+    b_free(account_raw);
+    account_raw = NULL;
+  }
 
-  if (!trie_verify_proof(&root, &path, proof, is_not_existened(account) ? NULL : account_raw)) {
+  // we only need to verify the proof, if we did not verify the same account for this state root before
+  if (!eth_proof_cache_contains(vc->chain, &root, hash, account_raw)) {
+    proof = d_create_bytes_vec(d_get(account, K_ACCOUNT_PROOF));
+    if (!proof) {
+      b_free(account_raw);
+      return vc_err(vc, "no merkle proof for the account");
+    }
+    if (!trie_verify_proof(&root, &path, proof, account_raw)) {
+      _free(proof);
+      b_free(account_raw);
+      return vc_err(vc, "invalid account proof where blockheader does not match the rootstate, which might be a microfork");
+    }
     _free(proof);
-    b_free(account_raw);
-    return vc_err(vc, "invalid account proof where blockheader does not match the rootstate, which might be a microfork");
+    eth_proof_cache_add(vc->chain, &root, hash, account_raw);
   }
-  _free(proof);
   b_free(account_raw);
 
   // now we verify the storage proofs
@@ -105,9 +117,6 @@ static in3_ret_t verify_proof(in3_vctx_t* vc, bytes_t* header, d_token_t* accoun
       d_bytes_to(d_get(p, K_KEY), hash, 32);
       sha3_to(&path, hash);
 
-      proof = d_create_bytes_vec(pt);
-      if (!proof) return vc_err(vc, "no merkle proof for the storage");
-
       // rlp encode the value.
       if (bb.b.len) {
         // remove leading zeros!
@@ -123,11 +132,17 @@ static in3_ret_t verify_proof(in3_vctx_t* vc, bytes_t* header, d_token_t* accoun
         }
       }
 
+      // the same value for the same storage root was already verified
+      if (eth_proof_cache_contains(vc->chain, &root, hash, bb.b.len ? &bb.b : NULL)) continue;
+
+      proof = d_create_bytes_vec(pt);
+      if (!proof) return vc_err(vc, "no merkle proof for the storage");
       if (!trie_verify_proof(&root, &path, proof, bb.b.len ? &bb.b : NULL)) {
         _free(proof);
         return vc_err(vc, "invalid storage proof");
       }
       _free(proof);
+      eth_proof_cache_add(vc->chain, &root, hash, bb.b.len ? &bb.b : NULL);
     }
   }
 
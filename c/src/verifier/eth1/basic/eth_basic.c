@@ -39,6 +39,7 @@
 #include "../../../core/util/mem.h"
 #include "../../../core/util/utils.h"
 #include "../../../verifier/eth1/basic/filter.h"
+#include "../../../verifier/eth1/basic/proof_cache.h"
 #include "../../../verifier/eth1/nano/eth_nano.h"
 #include "../../../verifier/eth1/nano/merkle.h"
 #include "../../../verifier/eth1/nano/rlp.h"
@@ -183,10 +184,23 @@ in3_ret_t eth_handle_intern(in3_ctx_t* ctx, in3_response_t** response) {
   return IN3_OK;
 }
 
+eth_chain_state_t* eth_chain_state(in3_chain_t* chain) {
+  if (!chain->conf) chain->conf = _calloc(1, sizeof(eth_chain_state_t));
+  return chain->conf;
+}
+
+void eth_free_chain_state(in3_t* c, in3_chain_t* chain) {
+  if (chain->type != CHAIN_ETH || !chain->conf) return;
+  eth_proof_cache_free(c, chain);
+  _free(chain->conf);
+  chain->conf = NULL;
+}
+
 void in3_register_eth_basic() {
   in3_verifier_t* v = _calloc(1, sizeof(in3_verifier_t));
   v->type           = CHAIN_ETH;
   v->pre_handle     = eth_handle_intern;
   v->verify         = in3_verify_eth_basic;
+  v->free_chain     = eth_free_chain_state;
   in3_register_verifier(v);
 }
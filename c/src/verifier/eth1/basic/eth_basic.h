@@ -78,6 +78,24 @@ in3_ret_t eth_verify_eth_getBlockTransactionCount(in3_vctx_t* vc, bytes_t* block
  */
 void in3_register_eth_basic();
 
+/**
+ * the state the eth verifiers keep with each chain as `chain->conf`.
+ */
+typedef struct {
+  void* proof_cache;  /**< the verified merkle proofs (see proof_cache.h) */
+  void* evm_programs; /**< the decoded code of the contracts executed by the evm (see verifier/eth1/evm/program.h) */
+} eth_chain_state_t;
+
+/**
+ * returns the state of the chain, which is created if it does not exist yet.
+ */
+NONULL eth_chain_state_t* eth_chain_state(in3_chain_t* chain);
+
+/**
+ * frees the state of the chain. The decoded programs of the evm must be freed before.
+ */
+void eth_free_chain_state(in3_t* c, in3_chain_t* chain);
+
 /**
  *  verify logs
  */
@@ -0,0 +1,110 @@
+/*******************************************************************************
+ * This file is part of the Incubed project.
+ * Sources: https://github.com/slockit/in3-c
+ * 
+ * Copyright (C) 2018-2020 slock.it GmbH, Blockchains LLC
+ * 
+ * 
+ * COMMERCIAL LICENSE USAGE
+ * 
+ * Licensees holding a valid commercial license may use this file in accordance 
+ * with the commercial license agreement provided with the Software or, alternatively, 
+ * in accordance with the terms contained in a written agreement between you and 
+ * slock.it GmbH/Blockchains LLC. For licensing terms and conditions or further 
+ * information please contact slock.it at in3@slock.it.
+ * 	
+ * Alternatively, this file may be used under the AGPL license as follows:
+ *    
+ * AGPL LICENSE USAGE
+ * 
+ * This program is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Affero General Public License as published by the Free Software 
+ * Foundation, either version 3 of the License, or (at your option) any later version.
+ *  
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY 
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A 
+ * PARTICULAR PURPOSE. See the GNU Affero General Public License for more details.
+ * [Permissions of this strong copyleft license are conditioned on making available 
+ * complete source code of licensed works and modifications, which include larger 
+ * works using a licensed work, under the same license. Copyright and license notices 
+ * must be preserved. Contributors provide an express grant of patent rights.]
+ * You should have received a copy of the GNU Affero General Public License along 
+ * with this program. If not, see <https://www.gnu.org/licenses/>.
+ *******************************************************************************/
+
+#include "proof_cache.h"
+#include "eth_basic.h"
+#include "../../../core/client/stats.h"
+#include "../../../core/util/mem.h"
+#include "../../../core/util/utils.h"
+#include <string.h>
+
+typedef struct {
+  bytes32_t root;  /**< the root of the trie */
+  bytes32_t path;  /**< the hashed key */
+  bytes32_t value; /**< the hash of the value or 0x0 if it does not exist */
+  uint32_t  used;  /**< the time of the last use (as counter) or 0 if the entry is empty */
+} proof_entry_t;
+
+typedef struct {
+  uint32_t      clock;
+  proof_entry_t sets[PROOF_CACHE_SETS][PROOF_CACHE_WAYS];
+} proof_cache_t;
+
+static proof_entry_t* find_set(proof_cache_t* cache, const uint8_t* root, const uint8_t* path) {
+  // root and path are hashes, so any bytes will do as index
+  return cache->sets[(root[0] ^ path[0] ^ (path[1] << 8)) & (PROOF_CACHE_SETS - 1)];
+}
+
+static void hash_value(const bytes_t* value, bytes32_t dst) {
+  if (value)
+    sha3_to((bytes_t*) value, dst);
+  else
+    memset(dst, 0, 32);
+}
+
+bool eth_proof_cache_contains(in3_chain_t* chain, const bytes_t* root, const uint8_t* path, const bytes_t* value) {
+  eth_chain_state_t* state = chain->conf;
+  proof_cache_t*     cache = state ? state->proof_cache : NULL;
+  if (!cache || root->len != 32) return false;
+
+  bytes32_t      hash;
+  proof_entry_t* set = find_set(cache, root->data, path);
+  hash_value(value, hash);
+  for (int i = 0; i < PROOF_CACHE_WAYS; i++) {
+    if (set[i].used && !memcmp(set[i].path, path, 32) && !memcmp(set[i].root, root->data, 32) && !memcmp(set[i].value, hash, 32)) {
+      set[i].used = ++cache->clock;
+      in3_stats_add(IN3_STAT_CACHE_HIT, "proof", 1);
+      return true;
+    }
+  }
+  in3_stats_add(IN3_STAT_CACHE_MISS, "proof", 1);
+  return false;
+}
+
+void eth_proof_cache_add(in3_chain_t* chain, const bytes_t* root, const uint8_t* path, const bytes_t* value) {
+  if (root->len != 32) return;
+  eth_chain_state_t* state = eth_chain_state(chain);
+  proof_cache_t*     cache = state->proof_cache;
+  if (!cache) cache = state->proof_cache = _calloc(1, sizeof(proof_cache_t));
+
+  // replace the least recently used entry
+  proof_entry_t* set    = find_set(cache, root->data, path);
+  proof_entry_t* oldest = set;
+  for (int i = 1; i < PROOF_CACHE_WAYS; i++) {
+    if (set[i].used < oldest->used) oldest = set + i;
+  }
+  memcpy(oldest->root, root->data, 32);
+  memcpy(oldest->path, path, 32);
+  hash_value(value, oldest->value);
+  oldest->used = ++cache->clock;
+}
+
+void eth_proof_cache_free(in3_t* c, in3_chain_t* chain) {
+  UNUSED_VAR(c);
+  eth_chain_state_t* state = chain->conf;
+  if (chain->type == CHAIN_ETH && state && state->proof_cache) {
+    _free(state->proof_cache);
+    state->proof_cache = NULL;
+  }
+}
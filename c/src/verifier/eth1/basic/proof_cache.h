@@ -0,0 +1,65 @@
+/*******************************************************************************
+ * This file is part of the Incubed project.
+ * Sources: https://github.com/slockit/in3-c
+ * 
+ * Copyright (C) 2018-2020 slock.it GmbH, Blockchains LLC
+ * 
+ * 
+ * COMMERCIAL LICENSE USAGE
+ * 
+ * Licensees holding a valid commercial license may use this file in accordance 
+ * with the commercial license agreement provided with the Software or, alternatively, 
+ * in accordance with the terms contained in a written agreement between you and 
+ * slock.it GmbH/Blockchains LLC. For licensing terms and conditions or further 
+ * information please contact slock.it at in3@slock.it.
+ * 	
+ * Alternatively, this file may be used under the AGPL license as follows:
+ *    
+ * AGPL LICENSE USAGE
+ * 
+ * This program is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Affero General Public License as published by the Free Software 
+ * Foundation, either version 3 of the License, or (at your option) any later version.
+ *  
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY 
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A 
+ * PARTICULAR PURPOSE. See the GNU Affero General Public License for more details.
+ * [Permissions of this strong copyleft license are conditioned on making available 
+ * complete source code of licensed works and modifications, which include larger 
+ * works using a licensed work, under the same license. Copyright and license notices 
+ * must be preserved. Contributors provide an express grant of patent rights.]
+ * You should have received a copy of the GNU Affero General Public License along 
+ * with this program. If not, see <https://www.gnu.org/licenses/>.
+ *******************************************************************************/
+
+/** @file
+ * caches verified merkle proofs.
+ * 
+ * A value which is proven to be part of a merkle trie with a given root will always be part of it.
+ * So once a proof is verified, the root, the path and the hash of the value are remembered.
+ * If a later response proves the same account or storage value for the same root (like repeated eth_calls for the same block),
+ * the merkle proof does not need to be verified again. Since the entries can not become invalid, they never expire.
+ * 
+ * The cache is kept per chain (in the `eth_chain_state_t` of `chain->conf`) and has a fixed size. If it is full, the least recently used entry of the set is replaced.
+ * */
+
+#ifndef in3_proof_cache_h__
+#define in3_proof_cache_h__
+
+#include "../../../core/client/client.h"
+
+#define PROOF_CACHE_SETS 128 /**< number of sets, must be a power of 2 */
+#define PROOF_CACHE_WAYS 4   /**< number of entries per set */
+
+/** returns true if the proof for the value with the given root and path was already verified. */
+NONULL_FOR((1, 2, 3))
+bool eth_proof_cache_contains(in3_chain_t* chain, const bytes_t* root, const uint8_t* path, const bytes_t* value);
+
+/** remembers a verified proof. A value of NULL means the proof verified, that the path does not exist. */
+NONULL_FOR((1, 2, 3))
+void eth_proof_cache_add(in3_chain_t* chain, const bytes_t* root, const uint8_t* path, const bytes_t* value);
+
+/** frees the cache of the chain, but not the state of the chain holding it. */
+void eth_proof_cache_free(in3_t* c, in3_chain_t* chain);
+
+#endif
@@ -38,35 +38,181 @@
 #include "big.h"
 #include "gas.h"
 #ifdef EVM_GAS
-/**
- * sets a variable value to 32byte word.
- */
+#define ARENA_BLOCK_SIZE 4096
+#define HASH_MUL         0x9E3779B97F4A7C15ull
 
-account_t* evm_get_account(evm_t* evm, address_t adr, wlen_t create) {
-  if (!adr) return NULL;
-  account_t* ac = evm->accounts;
+/** the state is kept by the root evm and shared by all sub calls. */
+static inline evm_t* state_of(evm_t* evm) {
+  return evm->root ? evm->root : evm;
+}
 
-  // check if we already have the account.
-  while (ac) {
-    if (memcmp(ac->address, adr, 20) == 0) return ac;
-    ac = ac->next;
+/** allocates memory from the arena of the state, which is freed with the root evm. */
+static void* arena_alloc(evm_t* evm, uint32_t size) {
+  evm_arena_t* a = evm->index.arena;
+  size           = (size + 7) & ~7u;
+  if (!a || a->used + size > a->size) {
+    const uint32_t block = max(size, ARENA_BLOCK_SIZE);
+    a                    = _malloc(sizeof(evm_arena_t) + block);
+    a->next              = evm->index.arena;
+    a->used              = 0;
+    a->size              = block;
+    evm->index.arena     = a;
+  }
+  void* p = (uint8_t*) (a + 1) + a->used;
+  a->used += size;
+  memset(p, 0, size);
+  return p;
+}
+
+static uint32_t hash_address(const uint8_t* adr) {
+  uint64_t a, b;
+  memcpy(&a, adr, 8);
+  memcpy(&b, adr + 12, 8);
+  return (uint32_t)(((a ^ b) * HASH_MUL) >> 32);
+}
+
+static uint32_t hash_storage(const account_t* ac, const uint8_t* key) {
+  uint64_t h = hash_address(ac->address), k;
+  for (int i = 0; i < 32; i += 8) {
+    memcpy(&k, key + i, 8);
+    h = (h ^ k) * HASH_MUL;
+  }
+  return (uint32_t)(h >> 32);
+}
+
+static void put_account(account_t** table, uint32_t size, account_t* ac) {
+  uint32_t i = hash_address(ac->address) & (size - 1);
+  while (table[i]) i = (i + 1) & (size - 1);
+  table[i] = ac;
+}
+
+static void put_storage(storage_t** table, uint32_t size, storage_t* s) {
+  uint32_t i = hash_storage(s->account, s->key) & (size - 1);
+  while (table[i]) i = (i + 1) & (size - 1);
+  table[i] = s;
+}
+
+static account_t* find_account(evm_t* evm, const uint8_t* adr) {
+  const evm_index_t* ix = &evm->index;
+  if (!ix->accounts_used) return NULL;
+  for (uint32_t i = hash_address(adr) & (ix->accounts_size - 1);; i = (i + 1) & (ix->accounts_size - 1)) {
+    account_t* ac = ix->accounts[i];
+    if (!ac || memcmp(ac->address, adr, 20) == 0) return ac;
+  }
+}
+
+static storage_t* find_storage(evm_t* evm, const account_t* ac, const uint8_t* key) {
+  const evm_index_t* ix = &evm->index;
+  if (!ix->storage_used) return NULL;
+  for (uint32_t i = hash_storage(ac, key) & (ix->storage_size - 1);; i = (i + 1) & (ix->storage_size - 1)) {
+    storage_t* s = ix->storage[i];
+    if (!s || (s->account == ac && memcmp(s->key, key, 32) == 0)) return s;
+  }
+}
+
+/** adds a new empty account to the call. */
+static account_t* add_account(evm_t* evm, const uint8_t* adr) {
+  evm_index_t* ix = &evm->index;
+  if ((ix->accounts_used + 1) * 2 > ix->accounts_size) {
+    // grow the table and add all accounts again
+    _free(ix->accounts);
+    ix->accounts_size = ix->accounts_size ? ix->accounts_size * 2 : 16;
+    ix->accounts      = _calloc(ix->accounts_size, sizeof(account_t*));
+    for (account_t* a = evm->accounts; a; a = a->next) put_account(ix->accounts, ix->accounts_size, a);
   }
 
-  // if this is a internal call take it from the parent
-  if (evm->parent) {
-    ac = evm_get_account(evm->parent, adr, create);
-
-    if (ac) {
-      // clone and add account
-      account_t* a = _malloc(sizeof(account_t));
-      memcpy(a, ac, sizeof(account_t));
-      a->storage    = NULL;
-      a->next       = evm->accounts;
-      evm->accounts = a;
-      return a;
+  account_t* ac = arena_alloc(evm, sizeof(account_t));
+  memcpy(ac->address, adr, 20);
+  ac->next      = evm->accounts;
+  evm->accounts = ac;
+  put_account(ix->accounts, ix->accounts_size, ac);
+  ix->accounts_used++;
+  return ac;
+}
+
+/** adds a new storage entry with the value 0 to the account. */
+static storage_t* add_storage(evm_t* evm, account_t* ac, const uint8_t* key) {
+  evm_index_t* ix = &evm->index;
+  if ((ix->storage_used + 1) * 2 > ix->storage_size) {
+    // grow the table and add all entries again
+    _free(ix->storage);
+    ix->storage_size = ix->storage_size ? ix->storage_size * 2 : 64;
+    ix->storage      = _calloc(ix->storage_size, sizeof(storage_t*));
+    for (account_t* a = evm->accounts; a; a = a->next) {
+      for (storage_t* s = a->storage; s; s = s->next) put_storage(ix->storage, ix->storage_size, s);
     }
   }
 
+  storage_t* s = arena_alloc(evm, sizeof(storage_t));
+  memcpy(s->key, key, 32);
+  s->account  = ac;
+  s->next     = ac->storage;
+  ac->storage = s;
+  put_storage(ix->storage, ix->storage_size, s);
+  ix->storage_used++;
+  return s;
+}
+
+void evm_accounts_free(evm_t* evm) {
+  evm_index_t* ix = &evm->index;
+  while (ix->arena) {
+    evm_arena_t* a = ix->arena;
+    ix->arena      = a->next;
+    _free(a);
+  }
+  if (ix->accounts) _free(ix->accounts);
+  if (ix->storage) _free(ix->storage);
+  if (ix->journal) _free(ix->journal);
+  memset(ix, 0, sizeof(evm_index_t));
+  evm->accounts = NULL;
+}
+
+static evm_change_t* add_change(evm_t* evm) {
+  evm_index_t* ix = &state_of(evm)->index;
+  if (ix->journal_len == ix->journal_size) {
+    const uint32_t size = ix->journal_size ? ix->journal_size * 2 : 32;
+    ix->journal         = ix->journal ? _realloc(ix->journal, size * sizeof(evm_change_t), ix->journal_size * sizeof(evm_change_t)) : _malloc(size * sizeof(evm_change_t));
+    ix->journal_size    = size;
+  }
+  return ix->journal + ix->journal_len++;
+}
+
+void evm_journal_value(evm_t* evm, uint8_t* value) {
+  evm_change_t* c = add_change(evm);
+  c->value        = value;
+  memcpy(c->old, value, 32);
+}
+
+void evm_journal_code(evm_t* evm, account_t* ac) {
+  evm_change_t* c = add_change(evm);
+  c->value        = NULL;
+  c->account      = ac;
+  c->code         = ac->code;
+}
+
+uint32_t evm_checkpoint(evm_t* evm) {
+  return state_of(evm)->index.journal_len;
+}
+
+void evm_revert(evm_t* evm, uint32_t checkpoint) {
+  evm_index_t* ix = &state_of(evm)->index;
+  while (ix->journal_len > checkpoint) {
+    evm_change_t* c = ix->journal + --ix->journal_len;
+    if (c->value)
+      memcpy(c->value, c->old, 32);
+    else
+      c->account->code = c->code;
+  }
+}
+
+account_t* evm_get_account(evm_t* evm, address_t adr, wlen_t create) {
+  if (!adr) return NULL;
+  evm_t* state = state_of(evm);
+
+  // check if we already have the account.
+  account_t* ac = find_account(state, adr);
+  if (ac) return ac;
+
   // get balance, nonce and code
   uint8_t *balance = NULL, *nonce = NULL, *code_size = NULL;
   int      l_balance   = evm->env(evm, EVM_ENV_BALANCE, adr, 20, &balance, 0, 0);
@@ -79,20 +225,13 @@ account_t* evm_get_account(evm_t* evm, address_t adr, wlen_t create) {
 
   // is this a non-empty account? (or do we have to create one)
   if (create || l_balance > 1 || l_nonce > 1 || l_code_size > 1 || (l_balance == 1 && *balance) || (l_nonce == 1 && *nonce) || (l_code_size == 1 && *code_size)) {
-    ac = _calloc(1, sizeof(account_t));
-    memcpy(ac->address, adr, 20);
+    ac = add_account(state, adr);
 
     // get the code (if code_size>0)
-    ac->code.data = NULL;
-    ac->code.len  = bytes_to_int(code_size, l_code_size);
+    ac->code.len = bytes_to_int(code_size, l_code_size);
     if (ac->code.len)
       evm->env(evm, EVM_ENV_CODE_COPY, adr, 20, &ac->code.data, 0, 0);
 
-    // add to accounts
-    ac->storage   = NULL;
-    ac->next      = evm->accounts;
-    evm->accounts = ac;
-
     // set balance & nonce
     uint256_set(balance, l_balance, ac->balance);
     uint256_set(nonce, l_nonce, ac->nonce);
@@ -105,15 +244,17 @@ account_t* evm_create_account(evm_t* evm, uint8_t* data, uint32_t l_data, addres
   account_t* new_account = NULL;
   new_account            = evm_get_account(evm, code_address, 1);
   // this is a create-call
-  evm->code              = bytes(data, l_data);
-  evm->call_data.len     = 0;
-  evm->address           = code_address;
+  evm->code          = bytes(data, l_data);
+  evm->call_data.len = 0;
+  evm->address       = code_address;
+  evm_journal_value(evm, new_account->nonce);
   new_account->nonce[31] = 1;
 
   // increment the nonce of the sender
   account_t* sender_account = evm_get_account(evm, caller, 1);
   bytes32_t  new_nonce;
   uint8_t    one = 1;
+  evm_journal_value(evm, sender_account->nonce);
   uint256_set(new_nonce, big_add(sender_account->nonce, 32, &one, 1, new_nonce, 32), sender_account->nonce);
   return new_account;
 }
@@ -122,135 +263,38 @@ storage_t* evm_get_storage(evm_t* evm, address_t adr, uint8_t* s_key, wlen_t s_k
   account_t* ac = evm_get_account(evm, adr, create);
   if (!ac) return NULL;
 
-  storage_t* s = ac->storage;
-
   // create full word key
   uint8_t key_data[32], *data;
   uint256_set(s_key, s_key_len, key_data);
 
   // find existing entry
-  while (s) {
-    if (memcmp(s->key, key_data, 32) == 0) return s;
-    s = s->next;
-  }
-
-  // not found?, but if we have parents, we try to copy the entry from there first
-  if (evm->parent) {
-    storage_t* parent_s = evm_get_storage(evm->parent, adr, s_key, s_key_len, create);
-    if (parent_s) {
-      // clone and add account
-      s = _malloc(sizeof(storage_t));
-      memcpy(s, parent_s, sizeof(storage_t));
-      s->next     = ac->storage;
-      ac->storage = s;
-      return s;
-    }
-  }
+  evm_t*     state = state_of(evm);
+  storage_t* s     = find_storage(state, ac, key_data);
+  if (s) return s;
 
-  // get storage value only if this is the same account
-  if (memcmp(evm->address, adr, 20)) return NULL;
-  int l = evm->env(evm, EVM_ENV_STORAGE, s_key, s_key_len, &data, 0, 0);
+  // the enviroment only delivers the storage of the address of the evm, so we need a call running with this address.
+  evm_t* frame = evm;
+  while (frame && memcmp(frame->address, adr, 20)) frame = frame->parent;
+  if (!frame) return NULL;
+  int l = frame->env(frame, EVM_ENV_STORAGE, s_key, s_key_len, &data, 0, 0);
 
   // if it does not exist and we have a value, we set it
   if (create || l > 1 || (l == 1 && *data)) {
-    // create with key
-    s = _malloc(sizeof(storage_t));
-    memcpy(s->key, key_data, 32);
-
-    // add to account
-    s->next     = ac->storage;
-    ac->storage = s;
-
-    // set the value
+    s = add_storage(state, ac, key_data);
     uint256_set(data, l, s->value);
   }
   return s;
 }
 
-void copy_state(evm_t* dst, evm_t* src) {
-
-  // first move all logs
-  if (src->logs) {
-    logs_t* last = src->logs;
+void evm_commit(evm_t* parent, evm_t* evm) {
+  // the state is shared, so only the logs are moved to the parent.
+  if (evm->logs) {
+    logs_t* last = evm->logs;
     while (last->next) last = last->next;
 
-    last->next = dst->logs;
-    dst->logs  = src->logs;
-    src->logs  = NULL;
-  }
-
-  account_t *sa = src->accounts, *prv = NULL;
-  while (sa) {
-    // find the account in the dst-state
-    account_t *a = dst->accounts, *da = NULL;
-    while (a) {
-      if (memcmp(a->address, sa->address, 20) == 0) {
-        da = a;
-        break;
-      }
-      a = a->next;
-    }
-    if (!da) {
-      // the account does not exist yet, so we simply move it
-
-      // remove from src
-      if (prv == NULL)
-        src->accounts = sa->next;
-      else
-        prv->next = sa->next;
-
-      // add to dst
-      sa->next      = dst->accounts;
-      dst->accounts = sa;
-
-      // next item...
-      sa = prv == NULL ? src->accounts : prv->next;
-      continue;
-    } else {
-      // clone data
-      memcpy(da->balance, sa->balance, 32);
-      memcpy(da->nonce, sa->nonce, 32);
-      da->code = sa->code;
-
-      // clone storage
-      storage_t *ss = sa->storage, *ps = NULL, *ds, *s;
-      while (ss) {
-        // find the storage in the parent
-        ds = NULL;
-        s  = da->storage;
-        while (s) {
-          if (memcmp(s->key, ss->key, 32) == 0) {
-            ds = s;
-            break;
-          }
-          s = s->next;
-        }
-
-        if (ds)
-          memcpy(ds->value, ss->value, 32);
-        else {
-          // move the storage to the parent
-          // remove from src
-          if (ps == NULL)
-            sa->storage = ss->next;
-          else
-            ps->next = ss->next;
-
-          // add to dst
-          ss->next    = da->storage;
-          da->storage = ss;
-
-          // next item...
-          ss = ps == NULL ? sa->storage : ps->next;
-          continue;
-        }
-
-        ps = ss;
-        ss = ss->next;
-      }
-    }
-    prv = sa;
-    sa  = sa->next;
+    last->next   = parent->logs;
+    parent->logs = evm->logs;
+    evm->logs    = NULL;
   }
 }
 
@@ -283,10 +327,12 @@ int transfer_value(evm_t* current, address_t from_account, address_t to_account,
     if (big_cmp(ac_from->balance, 32, value, value_len) < 0) return EVM_ERROR_BALANCE_TOO_LOW;
 
     // sub balance from sender
+    evm_journal_value(current, ac_from->balance);
     uint256_set(tmp, big_sub(ac_from->balance, 32, value, value_len, tmp), ac_from->balance);
   }
 
   // add balance to receiver. (This will be executed) even if the sender is null (which means initial setup for test)
+  evm_journal_value(current, ac_to->balance);
   uint256_set(tmp, big_add(ac_to->balance, 32, value, value_len, tmp, 32), ac_to->balance);
 
   return 0;
@@ -41,8 +41,23 @@ account_t* evm_get_account(evm_t* evm, address_t adr, wlen_t create);
 /** get account storage */
 storage_t* evm_get_storage(evm_t* evm, address_t adr, uint8_t* s_key, wlen_t s_key_len, wlen_t create);
 
-/** copy state. */
-void copy_state(evm_t* dst, evm_t* src);
+/** frees all accounts and storage entries of the evm. */
+void evm_accounts_free(evm_t* evm);
+
+/** moves the logs of a successful sub call to the parent. The changes of the state are kept. */
+void evm_commit(evm_t* parent, evm_t* evm);
+
+/** returns the position in the journal, which can be used to revert all changes made afterwards. */
+uint32_t evm_checkpoint(evm_t* evm);
+
+/** reverts all changes made since the checkpoint. */
+void evm_revert(evm_t* evm, uint32_t checkpoint);
+
+/** records a balance, nonce or storage value before it is changed. */
+void evm_journal_value(evm_t* evm, uint8_t* value);
+
+/** records the code of the account before it is changed. */
+void evm_journal_code(evm_t* evm, account_t* ac);
 
 int transfer_value(evm_t* current, address_t from_account, address_t to_account, uint8_t* value, wlen_t value_len, uint32_t base_gas);
 
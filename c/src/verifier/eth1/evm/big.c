@@ -84,6 +84,20 @@ int big_signed(uint8_t* val, wlen_t len, uint8_t* dst) {
   return 1;
 }
 
+/**
+ * copies the value padded to 32 bytes to dst and returns 1 if it is negative, in which case dst holds the absolute value.
+ * The sign is the top bit of the full word, so it must not be checked on a value without its leading zeros.
+ */
+static int big_abs(uint8_t* val, wlen_t len, uint8_t* dst) {
+  if (len > 32) {
+    val += len - 32;
+    len = 32;
+  }
+  memset(dst, 0, 32 - len);
+  memcpy(dst + 32 - len, val, len);
+  return big_signed(dst, 32, dst);
+}
+
 void big_shift_left(uint8_t* a, wlen_t len, int bits) {
   wlen_t        r;
   uint_fast16_t carry = 0;
@@ -440,6 +454,16 @@ int big_divmod(uint8_t* n, wlen_t ln, uint8_t* d, wlen_t ld, uint8_t* q, wlen_t*
 int big_div(uint8_t* a, wlen_t la, uint8_t* b, wlen_t lb, wlen_t sig, uint8_t* res) {
   wlen_t l;
 
+  if (sig) {
+    uint8_t _a[32], _b[32], r[32];
+    int     sa = big_abs(a, la, _a), sb = big_abs(b, lb, _b), rl = big_div(_a, 32, _b, 32, 0, res);
+    if (rl < 0 || sa == sb) return rl;
+    memset(r, 0, 32 - rl);
+    memcpy(r + 32 - rl, res, rl);
+    big_sign(r, 32, res);
+    return 32;
+  }
+
   optimize_len(a, la);
   optimize_len(b, lb);
 
@@ -453,21 +477,6 @@ int big_div(uint8_t* a, wlen_t la, uint8_t* b, wlen_t lb, wlen_t sig, uint8_t* r
     return 1;
   }
 
-  if (sig) {
-    uint8_t _a[32], _b[32], sa, sb;
-    sa = big_signed(a, la, _a);
-    sb = big_signed(b, lb, _b);
-    big_divmod(sa ? _a : a, la, sb ? _b : b, lb, res, &l, NULL, NULL);
-
-    if (sa != sb) {
-      memcpy(_a + 32 - l, res, l);
-      if (l < 32) memset(_a, 0, 32 - l);
-      big_sign(_a, 32, res);
-      l = 32;
-    }
-    return l;
-  }
-
   TRY(big_divmod(a, la, b, lb, res, &l, NULL, 0));
   return l;
 }
@@ -476,10 +485,23 @@ int big_mod(uint8_t* a, wlen_t la, uint8_t* b, wlen_t lb, wlen_t sig, uint8_t* r
   wlen_t  l = 0, l2;
   uint8_t tmp[65];
 
+  if (sig) {
+    // the result has the sign of a
+    uint8_t _a[32], _b[32];
+    int     sa = big_abs(a, la, _a), rl;
+    big_abs(b, lb, _b);
+    rl = big_mod(_a, 32, _b, 32, 0, res);
+    if (rl < 0 || !sa) return rl;
+    memset(tmp, 0, 32 - rl);
+    memcpy(tmp + 32 - rl, res, rl);
+    big_sign(tmp, 32, res);
+    return 32;
+  }
+
   optimize_len(a, la);
   optimize_len(b, lb);
 
-  if (lb > la && !sig) {
+  if (lb > la) {
     // special case that the number is smaller than the modulo
     memcpy(res, a, la);
     return la;
@@ -490,38 +512,22 @@ int big_mod(uint8_t* a, wlen_t la, uint8_t* b, wlen_t lb, wlen_t sig, uint8_t* r
     return 1;
   }
 
-  if (!sig) {
-    l = 1;
-    // check if the mod is a power 2 value
-    if ((*b & (*b - 1)) == 0) {
-      for (wlen_t i = 1; i < lb; i++) {
-        if (b[i] != 0) {
-          // we can not do the shortcut, because it is not a power of 2 - number
-          l = 0;
-          break;
-        }
-      }
-
-      if (l) {
-        if (lb > 1) memcpy(res + 1, a + la - lb + 1, lb - 1);
-        *res = a[la - lb] & (*b - 1);
-        return lb;
+  l = 1;
+  // check if the mod is a power 2 value
+  if ((*b & (*b - 1)) == 0) {
+    for (wlen_t i = 1; i < lb; i++) {
+      if (b[i] != 0) {
+        // we can not do the shortcut, because it is not a power of 2 - number
+        l = 0;
+        break;
       }
     }
-  } else {
-    uint8_t _a[32], _b[32];
-    wlen_t  sa, sb;
-    sa = big_signed(a, la, _a);
-    sb = big_signed(b, lb, _b);
-    big_divmod(sa ? _a : a, la, sb ? _b : b, lb, tmp, &l2, res, &l);
-
-    if (sa) {
-      memcpy(_a + 32 - l, res, l);
-      if (l < 32) memset(_a, 0, 32 - l);
-      big_sign(_a, 32, res);
-      l = 32;
+
+    if (l) {
+      if (lb > 1) memcpy(res + 1, a + la - lb + 1, lb - 1);
+      *res = a[la - lb] & (*b - 1);
+      return lb;
     }
-    return l;
   }
 
   TRY(big_divmod(a, la, b, lb, tmp, &l2, res, &l));
@@ -0,0 +1,1149 @@
+/*******************************************************************************
+ * This file is part of the Incubed project.
+ * Sources: https://github.com/slockit/in3-c
+ * 
+ * Copyright (C) 2018-2020 slock.it GmbH, Blockchains LLC
+ * 
+ * 
+ * COMMERCIAL LICENSE USAGE
+ * 
+ * Licensees holding a valid commercial license may use this file in accordance 
+ * with the commercial license agreement provided with the Software or, alternatively, 
+ * in accordance with the terms contained in a written agreement between you and 
+ * slock.it GmbH/Blockchains LLC. For licensing terms and conditions or further 
+ * information please contact slock.it at in3@slock.it.
+ * 	
+ * Alternatively, this file may be used under the AGPL license as follows:
+ *    
+ * AGPL LICENSE USAGE
+ * 
+ * This program is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Affero General Public License as published by the Free Software 
+ * Foundation, either version 3 of the License, or (at your option) any later version.
+ *  
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY 
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A 
+ * PARTICULAR PURPOSE. See the GNU Affero General Public License for more details.
+ * [Permissions of this strong copyleft license are conditioned on making available 
+ * complete source code of licensed works and modifications, which include larger 
+ * works using a licensed work, under the same license. Copyright and license notices 
+ * must be preserved. Contributors provide an express grant of patent rights.]
+ * You should have received a copy of the GNU Affero General Public License along 
+ * with this program. If not, see <https://www.gnu.org/licenses/>.
+ *******************************************************************************/
+
+#include "bn128.h"
+#include "../../../core/util/mem.h"
+#include <string.h>
+
+// ----------------------------------------------------------------------------------------------
+// Fp : 4 limbs (little endian) in montgomery form with R = 2^256
+// ----------------------------------------------------------------------------------------------
+
+typedef struct {
+  uint64_t n[4];
+} fp_t;
+
+typedef struct {
+  fp_t a, b; /**< a + b * i */
+} fp2_t;
+
+typedef struct {
+  fp2_t c0, c1, c2; /**< c0 + c1 * v + c2 * v^2 */
+} fp6_t;
+
+typedef struct {
+  fp6_t c0, c1; /**< c0 + c1 * w */
+} fp12_t;
+
+typedef struct {
+  fp_t x, y, z; /**< jacobian coordinates, the point at infinity has z = 0 */
+} g1_t;
+
+typedef struct {
+  fp2_t x, y, z; /**< jacobian coordinates for the subgroup check, homogeneous projective within the miller loop */
+} g2_t;
+
+typedef struct {
+  fp2_t l0, l1, l3; /**< the line evaluated at P as the sparse element ((l0,0,0),(l1,l3,0)) */
+} line_t;
+
+static const fp_t     P_MOD = {{0x3c208c16d87cfd47, 0x97816a916871ca8d, 0xb85045b68181585d, 0x30644e72e131a029}};
+static const fp_t     R2    = {{0xf32cfc5b538afa89, 0xb5e71911d44501fb, 0x47ab1eff0a417ff6, 0x06d89f71cab8351f}};
+static const fp_t     R3    = {{0xb1cd6dafda1530df, 0x62f210e6a7283db6, 0xef7f0b0c0ada0afb, 0x20fd6e902d592544}};
+static const fp_t     ONE   = {{0xd35d438dc58f0d9d, 0x0a78eb28f5c70b3d, 0x666ea36f7879462c, 0x0e0a77c19a07df2f}};
+static const fp_t     B1    = {{0x7a17caa950ad28d7, 0x1f6ac17ae15521b9, 0x334bea4e696bd284, 0x2a1f6744ce179d8e}}; // 3
+static const uint64_t INV   = 0x87d20782e4866389;                                                                   // -p^-1 mod 2^64
+static const uint64_t U     = 0x44e992b44a6909f1;                                                                   // the bn parameter
+
+/** the order of the groups */
+static const uint64_t ORDER[4] = {0x43e1f593f0000001, 0x2833e84879b97091, 0xb85045b68181585d, 0x30644e72e131a029};
+
+/** b' = 3 / (9 + i) of the twisted curve */
+static const fp2_t B2 = {{{0x3bf938e377b802a8, 0x020b1b273633535d, 0x26b7edf049755260, 0x2514c6324384a86d}},
+                         {{0x38e7ecccd1dcff67, 0x65f0b37d93ce0d3e, 0xd749d0dd22ac00aa, 0x0141b9ce4a688d4d}}};
+
+/** (9 + i)^(j * (p - 1) / 6) for j = 1..5 used by the frobenius map */
+static const fp2_t GAMMA1[5] = {
+    {{{0xaf9ba69633144907, 0xca6b1d7387afb78a, 0x11bded5ef08a2087, 0x02f34d751a1f3a7c}}, {{0xa222ae234c492d72, 0xd00f02a4565de15b, 0xdc2ff3a253dfc926, 0x10a75716b3899551}}},
+    {{{0xb5773b104563ab30, 0x347f91c8a9aa6454, 0x7a007127242e0991, 0x1956bcd8118214ec}}, {{0x6e849f1ea0aa4757, 0xaa1c7b6d89f89141, 0xb6e713cdfae0ca3a, 0x26694fbb4e82ebc3}}},
+    {{{0xe4bbdd0c2936b629, 0xbb30f162e133bacb, 0x31a9d1b6f9645366, 0x253570bea500f8dd}}, {{0xa1d77ce45ffe77c7, 0x07affd117826d1db, 0x6d16bd27bb7edc6b, 0x2c87200285defecc}}},
+    {{{0x7361d77f843abe92, 0xa5bb2bd3273411fb, 0x9c941f314b3e2399, 0x15df9cddbb9fd3ec}}, {{0x5dddfd154bd8c949, 0x62cb29a5a4445b60, 0x37bc870a0c7dd2b9, 0x24830a9d3171f0fd}}},
+    {{{0xc970692f41690fe7, 0xe240342127694b0b, 0x32bee66b83c459e8, 0x12aabced0ab08841}}, {{0x0d485d2340aebfa9, 0x05193418ab2fcc57, 0xd3b0a40b8a4910f5, 0x2f21ebb535d2925a}}}};
+
+/** (9 + i)^(j * (p^2 - 1) / 6) for j = 1..5, which are all in Fp */
+static const fp_t GAMMA2[5] = {
+    {{0xca8d800500fa1bf2, 0xf0c5d61468b39769, 0x0e201271ad0d4418, 0x04290f65bad856e6}},
+    {{0x3350c88e13e80b9c, 0x7dce557cdb5e56b9, 0x6001b4b8b615564a, 0x2682e617020217e0}},
+    {{0x68c3488912edefaa, 0x8d087f6872aabf4f, 0x51e1a24709081231, 0x2259d6b14729c0fa}},
+    {{0x71930c11d782e155, 0xa6bb947cffbe3323, 0xaa303344d4741444, 0x2c3b3f0d26594943}},
+    {{0x08cfc388c494f1ab, 0x19b315148d1373d4, 0x584e90fdcb6c0213, 0x09e1685bdf2f8849}}};
+
+/** (9 + i)^(j * (p^3 - 1) / 6) for j = 1..5 */
+static const fp2_t GAMMA3[5] = {
+    {{{0x365316184e46d97d, 0x0af7129ed4c96d9f, 0x659da72fca1009b5, 0x08116d8983a20d23}}, {{0xb1df4af7c39c1939, 0x3d9f02878a73bf7f, 0x9b2220928caf0ae0, 0x26684515eff054a6}}},
+    {{{0xc9af22f716ad6bad, 0xb311782a4aa662b2, 0x19eeaf64e248c7f4, 0x20273e77e3439f82}}, {{0xacc02860f7ce93ac, 0x3933d5817ba76b4c, 0x69e6188b446c8467, 0x0a46036d4417cc55}}},
+    {{{0x5764af0aaf46471e, 0xdc50792e873e0fc1, 0x86a673ff881d04f6, 0x0b2eddb43c30a74c}}, {{0x9a490f32787e8580, 0x8fd16d7ff04af8b1, 0x4b39888ec6027bf2, 0x03dd2e705b52a15d}}},
+    {{{0x448a93a57b6762df, 0xbfd62df528fdeadf, 0xd858f5d00e9bd47a, 0x06b03d4d3476ec58}}, {{0x2b19daf4bcc936d1, 0xa1a54e7a56f4299f, 0xb533eee05adeaef1, 0x170c812b84dda0b2}}},
+    {{{0xe0bc4b2275cf559f, 0xc238b945c154e60f, 0x803982a5929a7d5e, 0x15ce052df7e4a37e}}, {{0x2d28efbdbf3799a7, 0x9b097e3c1ad60773, 0x982d4113af4a535b, 0x24e18991e3056063}}}};
+
+/** the NAF of 6u+2 (most significant digit first) driving the miller loop */
+static const int8_t ATE_LOOP[66] = {1, 0, -1, 0, 1, 0, 0, 0, -1, 0, -1, 0, 0, 0, -1, 0, 1, 0, -1, 0, 0, -1, 0, 0, 0, 0, 0, 1, 0, 0, -1, 0, 1,
+                                    0, 0, -1, 0, 0, 0, 0, -1, 0, 1, 0, 0, 0, -1, 0, -1, 0, 0, 1, 0, 0, 0, -1, 0, 0, -1, 0, 1, 0, 1, 0, 0, 0};
+
+#ifdef __SIZEOF_INT128__
+/** returns the low word of a * b + c + carry and stores the high word in carry */
+static inline uint64_t mac(uint64_t a, uint64_t b, uint64_t c, uint64_t* carry) {
+  const unsigned __int128 t = (unsigned __int128) a * b + c + *carry;
+  *carry                    = (uint64_t) (t >> 64);
+  return (uint64_t) t;
+}
+#else
+static inline uint64_t mac(uint64_t a, uint64_t b, uint64_t c, uint64_t* carry) {
+  const uint64_t a0 = (uint32_t) a, a1 = a >> 32, b0 = (uint32_t) b, b1 = b >> 32;
+  const uint64_t p00 = a0 * b0, p01 = a0 * b1, p10 = a1 * b0, p11 = a1 * b1;
+  const uint64_t mid = (p00 >> 32) + (uint32_t) p01 + (uint32_t) p10;
+  uint64_t       lo  = (mid << 32) | (uint32_t) p00;
+  uint64_t       hi  = p11 + (p01 >> 32) + (p10 >> 32) + (mid >> 32);
+  lo += c;
+  hi += lo < c;
+  lo += *carry;
+  hi += lo < *carry;
+  *carry = hi;
+  return lo;
+}
+#endif
+
+/** returns a + b + carry and stores the new carry */
+static inline uint64_t adc(uint64_t a, uint64_t b, uint64_t* carry) {
+  const uint64_t s = a + *carry;
+  const uint64_t c = s < a;
+  const uint64_t r = s + b;
+  *carry           = c + (r < b);
+  return r;
+}
+
+/** returns a - b - borrow and stores the new borrow */
+static inline uint64_t sbb(uint64_t a, uint64_t b, uint64_t* borrow) {
+  const uint64_t d  = a - b;
+  const uint64_t bo = (a < b) | (d < *borrow);
+  const uint64_t r  = d - *borrow;
+  *borrow           = bo;
+  return r;
+}
+
+static inline bool u256_is_one(const uint64_t* a) {
+  return a[0] == 1 && !(a[1] | a[2] | a[3]);
+}
+
+static inline bool u256_geq(const uint64_t* a, const uint64_t* b) {
+  for (int i = 3; i >= 0; i--) {
+    if (a[i] != b[i]) return a[i] > b[i];
+  }
+  return true;
+}
+
+static inline void u256_sub(uint64_t* a, const uint64_t* b) {
+  uint64_t borrow = 0;
+  for (int i = 0; i < 4; i++) a[i] = sbb(a[i], b[i], &borrow);
+}
+
+static inline void u256_shr(uint64_t* a) {
+  for (int i = 0; i < 3; i++) a[i] = (a[i] >> 1) | (a[i + 1] << 63);
+  a[3] >>= 1;
+}
+
+static inline bool fp_geq_p(const uint64_t* a) { return u256_geq(a, P_MOD.n); }
+
+static inline void fp_sub_p(uint64_t* a) { u256_sub(a, P_MOD.n); }
+
+static inline bool fp_is_zero(const fp_t* a) {
+  return !(a->n[0] | a->n[1] | a->n[2] | a->n[3]);
+}
+
+static inline bool fp_eq(const fp_t* a, const fp_t* b) {
+  return !((a->n[0] ^ b->n[0]) | (a->n[1] ^ b->n[1]) | (a->n[2] ^ b->n[2]) | (a->n[3] ^ b->n[3]));
+}
+
+static inline void fp_add(fp_t* r, const fp_t* a, const fp_t* b) {
+  uint64_t c = 0; // p < 2^254, so the sum never overflows
+  for (int i = 0; i < 4; i++) r->n[i] = adc(a->n[i], b->n[i], &c);
+  if (fp_geq_p(r->n)) fp_sub_p(r->n);
+}
+
+static inline void fp_sub(fp_t* r, const fp_t* a, const fp_t* b) {
+  uint64_t borrow = 0;
+  for (int i = 0; i < 4; i++) r->n[i] = sbb(a->n[i], b->n[i], &borrow);
+  if (borrow) {
+    uint64_t c = 0;
+    for (int i = 0; i < 4; i++) r->n[i] = adc(r->n[i], P_MOD.n[i], &c);
+  }
+}
+
+static inline void fp_neg(fp_t* r, const fp_t* a) {
+  if (fp_is_zero(a))
+    *r = *a;
+  else {
+    uint64_t borrow = 0;
+    for (int i = 0; i < 4; i++) r->n[i] = sbb(P_MOD.n[i], a->n[i], &borrow);
+  }
+}
+
+static inline void fp_dbl(fp_t* r, const fp_t* a) { fp_add(r, a, a); }
+
+/** r = a / 2 */
+static inline void fp_half(fp_t* r, const fp_t* a) {
+  uint64_t t[4], c = 0;
+  if (a->n[0] & 1)
+    for (int i = 0; i < 4; i++) t[i] = adc(a->n[i], P_MOD.n[i], &c);
+  else
+    memcpy(t, a->n, 32);
+  for (int i = 0; i < 3; i++) r->n[i] = (t[i] >> 1) | (t[i + 1] << 63);
+  r->n[3] = t[3] >> 1;
+}
+
+/**
+ * montgomery multiplication r = a * b / R.
+ * 
+ * CIOS without the extra carry words, which works since the highest limb of p is less than (2^64 - 1) / 2.
+ */
+static void fp_mul(fp_t* r, const fp_t* a, const fp_t* b) {
+  uint64_t t[4] = {0};
+  for (int i = 0; i < 4; i++) {
+    uint64_t       ca = 0, cm = 0;
+    const uint64_t bi = b->n[i];
+    t[0]              = mac(a->n[0], bi, t[0], &ca);
+    const uint64_t m  = t[0] * INV;
+    mac(m, P_MOD.n[0], t[0], &cm);
+    for (int j = 1; j < 4; j++) {
+      t[j]     = mac(a->n[j], bi, t[j], &ca);
+      t[j - 1] = mac(m, P_MOD.n[j], t[j], &cm);
+    }
+    t[3] = ca + cm;
+  }
+  if (fp_geq_p(t)) fp_sub_p(t);
+  memcpy(r->n, t, 32);
+}
+
+static inline void fp_sqr(fp_t* r, const fp_t* a) { fp_mul(r, a, a); }
+
+/**
+ * r = 1 / a using the binary extended euclidean algorithm, which does not need to run in constant time, since all values are public.
+ * 
+ * The algorithm inverts the montgomery representation aR, so the result a^-1 R^-1 is corrected by multiplying with R^3.
+ */
+static void fp_inv(fp_t* r, const fp_t* a) {
+  if (fp_is_zero(a)) {
+    *r = *a;
+    return;
+  }
+  uint64_t u[4], v[4];
+  fp_t     x1 = {{1, 0, 0, 0}}, x2 = {{0}};
+  memcpy(u, a->n, 32);
+  memcpy(v, P_MOD.n, 32);
+  while (!u256_is_one(u) && !u256_is_one(v)) {
+    while (!(u[0] & 1)) {
+      u256_shr(u);
+      fp_half(&x1, &x1);
+    }
+    while (!(v[0] & 1)) {
+      u256_shr(v);
+      fp_half(&x2, &x2);
+    }
+    if (u256_geq(u, v)) {
+      u256_sub(u, v);
+      fp_sub(&x1, &x1, &x2);
+    } else {
+      u256_sub(v, u);
+      fp_sub(&x2, &x2, &x1);
+    }
+  }
+  fp_mul(r, u256_is_one(u) ? &x1 : &x2, &R3);
+}
+
+/** reads a big endian number and converts it into montgomery form. returns false if the number is not less than p. */
+static bool fp_from_bytes(fp_t* r, const uint8_t* data) {
+  for (int i = 0; i < 4; i++) {
+    uint64_t v = 0;
+    for (int j = 0; j < 8; j++) v = (v << 8) | data[(3 - i) * 8 + j];
+    r->n[i] = v;
+  }
+  if (fp_geq_p(r->n)) return false;
+  fp_mul(r, r, &R2);
+  return true;
+}
+
+static void fp_to_bytes(uint8_t* data, const fp_t* a) {
+  static const fp_t raw_one = {{1, 0, 0, 0}};
+  fp_t              t;
+  fp_mul(&t, a, &raw_one);
+  for (int i = 0; i < 4; i++) {
+    for (int j = 0; j < 8; j++) data[(3 - i) * 8 + j] = (uint8_t) (t.n[i] >> (56 - 8 * j));
+  }
+}
+
+// ----------------------------------------------------------------------------------------------
+// Fp2
+// ----------------------------------------------------------------------------------------------
+
+static inline void fp2_add(fp2_t* r, const fp2_t* x, const fp2_t* y) {
+  fp_add(&r->a, &x->a, &y->a);
+  fp_add(&r->b, &x->b, &y->b);
+}
+
+static inline void fp2_sub(fp2_t* r, const fp2_t* x, const fp2_t* y) {
+  fp_sub(&r->a, &x->a, &y->a);
+  fp_sub(&r->b, &x->b, &y->b);
+}
+
+static inline void fp2_neg(fp2_t* r, const fp2_t* x) {
+  fp_neg(&r->a, &x->a);
+  fp_neg(&r->b, &x->b);
+}
+
+static inline void fp2_dbl(fp2_t* r, const fp2_t* x) { fp2_add(r, x, x); }
+
+static inline void fp2_half(fp2_t* r, const fp2_t* x) {
+  fp_half(&r->a, &x->a);
+  fp_half(&r->b, &x->b);
+}
+
+static inline void fp2_conj(fp2_t* r, const fp2_t* x) {
+  r->a = x->a;
+  fp_neg(&r->b, &x->b);
+}
+
+static inline bool fp2_is_zero(const fp2_t* x) { return fp_is_zero(&x->a) && fp_is_zero(&x->b); }
+
+static inline bool fp2_eq(const fp2_t* x, const fp2_t* y) { return fp_eq(&x->a, &y->a) && fp_eq(&x->b, &y->b); }
+
+static void fp2_mul(fp2_t* r, const fp2_t* x, const fp2_t* y) {
+  fp_t t0, t1, s0, s1;
+  fp_mul(&t0, &x->a, &y->a);
+  fp_mul(&t1, &x->b, &y->b);
+  fp_add(&s0, &x->a, &x->b);
+  fp_add(&s1, &y->a, &y->b);
+  fp_mul(&s0, &s0, &s1);
+  fp_sub(&r->a, &t0, &t1);
+  fp_sub(&s0, &s0, &t0);
+  fp_sub(&r->b, &s0, &t1);
+}
+
+static void fp2_sqr(fp2_t* r, const fp2_t* x) {
+  fp_t s, d, ab;
+  fp_add(&s, &x->a, &x->b);
+  fp_sub(&d, &x->a, &x->b);
+  fp_mul(&ab, &x->a, &x->b);
+  fp_mul(&r->a, &s, &d);
+  fp_dbl(&r->b, &ab);
+}
+
+static inline void fp2_mul_fp(fp2_t* r, const fp2_t* x, const fp_t* s) {
+  fp_mul(&r->a, &x->a, s);
+  fp_mul(&r->b, &x->b, s);
+}
+
+/** r = x * (9 + i) */
+static void fp2_mul_xi(fp2_t* r, const fp2_t* x) {
+  fp2_t t;
+  fp2_dbl(&t, x);
+  fp2_dbl(&t, &t);
+  fp2_dbl(&t, &t);
+  fp2_add(&t, &t, x); // 9 * x
+  fp_sub(&t.a, &t.a, &x->b);
+  fp_add(&r->b, &t.b, &x->a);
+  r->a = t.a;
+}
+
+static void fp2_inv(fp2_t* r, const fp2_t* x) {
+  fp_t t0, t1;
+  fp_sqr(&t0, &x->a);
+  fp_sqr(&t1, &x->b);
+  fp_add(&t0, &t0, &t1);
+  fp_inv(&t0, &t0);
+  fp_mul(&r->a, &x->a, &t0);
+  fp_mul(&t1, &x->b, &t0);
+  fp_neg(&r->b, &t1);
+}
+
+// ----------------------------------------------------------------------------------------------
+// Fp6
+// ----------------------------------------------------------------------------------------------
+
+static inline void fp6_add(fp6_t* r, const fp6_t* x, const fp6_t* y) {
+  fp2_add(&r->c0, &x->c0, &y->c0);
+  fp2_add(&r->c1, &x->c1, &y->c1);
+  fp2_add(&r->c2, &x->c2, &y->c2);
+}
+
+static inline void fp6_sub(fp6_t* r, const fp6_t* x, const fp6_t* y) {
+  fp2_sub(&r->c0, &x->c0, &y->c0);
+  fp2_sub(&r->c1, &x->c1, &y->c1);
+  fp2_sub(&r->c2, &x->c2, &y->c2);
+}
+
+static inline void fp6_neg(fp6_t* r, const fp6_t* x) {
+  fp2_neg(&r->c0, &x->c0);
+  fp2_neg(&r->c1, &x->c1);
+  fp2_neg(&r->c2, &x->c2);
+}
+
+/** r = x * v */
+static inline void fp6_mul_v(fp6_t* r, const fp6_t* x) {
+  fp2_t t;
+  fp2_mul_xi(&t, &x->c2);
+  r->c2 = x->c1;
+  r->c1 = x->c0;
+  r->c0 = t;
+}
+
+static void fp6_mul(fp6_t* r, const fp6_t* x, const fp6_t* y) {
+  fp2_t t0, t1, t2, s0, s1, c0, c1, c2;
+  fp2_mul(&t0, &x->c0, &y->c0);
+  fp2_mul(&t1, &x->c1, &y->c1);
+  fp2_mul(&t2, &x->c2, &y->c2);
+
+  fp2_add(&s0, &x->c1, &x->c2);
+  fp2_add(&s1, &y->c1, &y->c2);
+  fp2_mul(&c0, &s0, &s1);
+  fp2_sub(&c0, &c0, &t1);
+  fp2_sub(&c0, &c0, &t2);
+  fp2_mul_xi(&c0, &c0);
+  fp2_add(&c0, &c0, &t0);
+
+  fp2_add(&s0, &x->c0, &x->c1);
+  fp2_add(&s1, &y->c0, &y->c1);
+  fp2_mul(&c1, &s0, &s1);
+  fp2_sub(&c1, &c1, &t0);
+  fp2_sub(&c1, &c1, &t1);
+  fp2_mul_xi(&s0, &t2);
+  fp2_add(&c1, &c1, &s0);
+
+  fp2_add(&s0, &x->c0, &x->c2);
+  fp2_add(&s1, &y->c0, &y->c2);
+  fp2_mul(&c2, &s0, &s1);
+  fp2_sub(&c2, &c2, &t0);
+  fp2_sub(&c2, &c2, &t2);
+  fp2_add(&c2, &c2, &t1);
+
+  r->c0 = c0;
+  r->c1 = c1;
+  r->c2 = c2;
+}
+
+/** r = x * (b0 + b1 * v) */
+static void fp6_mul_01(fp6_t* r, const fp6_t* x, const fp2_t* b0, const fp2_t* b1) {
+  fp2_t t0, t1, s0, s1, c0, c1, c2;
+  fp2_mul(&t0, &x->c0, b0);
+  fp2_mul(&t1, &x->c1, b1);
+
+  fp2_add(&s0, &x->c1, &x->c2);
+  fp2_mul(&c0, &s0, b1);
+  fp2_sub(&c0, &c0, &t1);
+  fp2_mul_xi(&c0, &c0);
+  fp2_add(&c0, &c0, &t0);
+
+  fp2_add(&s0, &x->c0, &x->c1);
+  fp2_add(&s1, b0, b1);
+  fp2_mul(&c1, &s0, &s1);
+  fp2_sub(&c1, &c1, &t0);
+  fp2_sub(&c1, &c1, &t1);
+
+  fp2_add(&s0, &x->c0, &x->c2);
+  fp2_mul(&c2, &s0, b0);
+  fp2_sub(&c2, &c2, &t0);
+  fp2_add(&c2, &c2, &t1);
+
+  r->c0 = c0;
+  r->c1 = c1;
+  r->c2 = c2;
+}
+
+static inline void fp6_mul_fp2(fp6_t* r, const fp6_t* x, const fp2_t* s) {
+  fp2_mul(&r->c0, &x->c0, s);
+  fp2_mul(&r->c1, &x->c1, s);
+  fp2_mul(&r->c2, &x->c2, s);
+}
+
+static void fp6_inv(fp6_t* r, const fp6_t* x) {
+  fp2_t a, b, c, t, f;
+  fp2_sqr(&a, &x->c0);
+  fp2_mul(&t, &x->c1, &x->c2);
+  fp2_mul_xi(&t, &t);
+  fp2_sub(&a, &a, &t);
+
+  fp2_sqr(&b, &x->c2);
+  fp2_mul_xi(&b, &b);
+  fp2_mul(&t, &x->c0, &x->c1);
+  fp2_sub(&b, &b, &t);
+
+  fp2_sqr(&c, &x->c1);
+  fp2_mul(&t, &x->c0, &x->c2);
+  fp2_sub(&c, &c, &t);
+
+  fp2_mul(&f, &x->c2, &b);
+  fp2_mul(&t, &x->c1, &c);
+  fp2_add(&f, &f, &t);
+  fp2_mul_xi(&f, &f);
+  fp2_mul(&t, &x->c0, &a);
+  fp2_add(&f, &f, &t);
+  fp2_inv(&f, &f);
+
+  fp2_mul(&r->c0, &a, &f);
+  fp2_mul(&r->c1, &b, &f);
+  fp2_mul(&r->c2, &c, &f);
+}
+
+// ----------------------------------------------------------------------------------------------
+// Fp12
+// ----------------------------------------------------------------------------------------------
+
+static void fp12_set_one(fp12_t* r) {
+  memset(r, 0, sizeof(fp12_t));
+  r->c0.c0.a = ONE;
+}
+
+static bool fp12_is_one(const fp12_t* x) {
+  fp12_t one;
+  fp12_set_one(&one);
+  return memcmp(x, &one, sizeof(fp12_t)) == 0;
+}
+
+static void fp12_mul(fp12_t* r, const fp12_t* x, const fp12_t* y) {
+  fp6_t t0, t1, s0, s1;
+  fp6_mul(&t0, &x->c0, &y->c0);
+  fp6_mul(&t1, &x->c1, &y->c1);
+  fp6_add(&s0, &x->c0, &x->c1);
+  fp6_add(&s1, &y->c0, &y->c1);
+  fp6_mul(&s0, &s0, &s1);
+  fp6_sub(&s0, &s0, &t0);
+  fp6_sub(&r->c1, &s0, &t1);
+  fp6_mul_v(&t1, &t1);
+  fp6_add(&r->c0, &t0, &t1);
+}
+
+/** complex squaring: (a + bw)^2 = (a + b)(a + vb) - ab - vab + 2abw */
+static void fp12_sqr(fp12_t* r, const fp12_t* x) {
+  fp6_t t, s0, s1;
+  fp6_mul(&t, &x->c0, &x->c1);
+  fp6_add(&s0, &x->c0, &x->c1);
+  fp6_mul_v(&s1, &x->c1);
+  fp6_add(&s1, &s1, &x->c0);
+  fp6_mul(&s0, &s0, &s1);
+  fp6_sub(&s0, &s0, &t);
+  fp6_mul_v(&s1, &t);
+  fp6_sub(&r->c0, &s0, &s1);
+  fp6_add(&r->c1, &t, &t);
+}
+
+/** r = x^2 for elements of the cyclotomic subgroup (after the easy part of the final exponentiation), see Granger and Scott */
+static void fp12_cyclotomic_sqr(fp12_t* r, const fp12_t* x) {
+  fp2_t t[9];
+  fp2_sqr(t, &x->c1.c1);
+  fp2_sqr(t + 1, &x->c0.c0);
+  fp2_add(t + 6, &x->c1.c1, &x->c0.c0);
+  fp2_sqr(t + 6, t + 6);
+  fp2_sub(t + 6, t + 6, t);
+  fp2_sub(t + 6, t + 6, t + 1);
+  fp2_sqr(t + 2, &x->c0.c2);
+  fp2_sqr(t + 3, &x->c1.c0);
+  fp2_add(t + 7, &x->c0.c2, &x->c1.c0);
+  fp2_sqr(t + 7, t + 7);
+  fp2_sub(t + 7, t + 7, t + 2);
+  fp2_sub(t + 7, t + 7, t + 3);
+  fp2_sqr(t + 4, &x->c1.c2);
+  fp2_sqr(t + 5, &x->c0.c1);
+  fp2_add(t + 8, &x->c1.c2, &x->c0.c1);
+  fp2_sqr(t + 8, t + 8);
+  fp2_sub(t + 8, t + 8, t + 4);
+  fp2_sub(t + 8, t + 8, t + 5);
+  fp2_mul_xi(t + 8, t + 8);
+  fp2_mul_xi(t, t);
+  fp2_add(t, t, t + 1);
+  fp2_mul_xi(t + 2, t + 2);
+  fp2_add(t + 2, t + 2, t + 3);
+  fp2_mul_xi(t + 4, t + 4);
+  fp2_add(t + 4, t + 4, t + 5);
+
+  fp2_sub(&r->c0.c0, t, &x->c0.c0);
+  fp2_dbl(&r->c0.c0, &r->c0.c0);
+  fp2_add(&r->c0.c0, &r->c0.c0, t);
+  fp2_sub(&r->c0.c1, t + 2, &x->c0.c1);
+  fp2_dbl(&r->c0.c1, &r->c0.c1);
+  fp2_add(&r->c0.c1, &r->c0.c1, t + 2);
+  fp2_sub(&r->c0.c2, t + 4, &x->c0.c2);
+  fp2_dbl(&r->c0.c2, &r->c0.c2);
+  fp2_add(&r->c0.c2, &r->c0.c2, t + 4);
+  fp2_add(&r->c1.c0, t + 8, &x->c1.c0);
+  fp2_dbl(&r->c1.c0, &r->c1.c0);
+  fp2_add(&r->c1.c0, &r->c1.c0, t + 8);
+  fp2_add(&r->c1.c1, t + 6, &x->c1.c1);
+  fp2_dbl(&r->c1.c1, &r->c1.c1);
+  fp2_add(&r->c1.c1, &r->c1.c1, t + 6);
+  fp2_add(&r->c1.c2, t + 7, &x->c1.c2);
+  fp2_dbl(&r->c1.c2, &r->c1.c2);
+  fp2_add(&r->c1.c2, &r->c1.c2, t + 7);
+}
+
+/** multiplies with the sparse line ((l0,0,0),(l1,l3,0)) */
+static void fp12_mul_line(fp12_t* r, const line_t* l) {
+  fp6_t t0, t1, s;
+  fp2_t b0;
+  fp6_mul_fp2(&t0, &r->c0, &l->l0);
+  fp6_mul_01(&t1, &r->c1, &l->l1, &l->l3);
+  fp6_add(&s, &r->c0, &r->c1);
+  fp2_add(&b0, &l->l0, &l->l1);
+  fp6_mul_01(&s, &s, &b0, &l->l3);
+  fp6_sub(&s, &s, &t0);
+  fp6_sub(&r->c1, &s, &t1);
+  fp6_mul_v(&t1, &t1);
+  fp6_add(&r->c0, &t0, &t1);
+}
+
+static inline void fp12_conj(fp12_t* r, const fp12_t* x) {
+  r->c0 = x->c0;
+  fp6_neg(&r->c1, &x->c1);
+}
+
+static void fp12_inv(fp12_t* r, const fp12_t* x) {
+  fp6_t t0, t1;
+  fp6_mul(&t0, &x->c0, &x->c0);
+  fp6_mul(&t1, &x->c1, &x->c1);
+  fp6_mul_v(&t1, &t1);
+  fp6_sub(&t0, &t0, &t1);
+  fp6_inv(&t0, &t0);
+  fp6_mul(&r->c0, &x->c0, &t0);
+  fp6_mul(&t1, &x->c1, &t0);
+  fp6_neg(&r->c1, &t1);
+}
+
+/** r = x^(p^k) for k = 1,2,3 */
+static void fp12_frob(fp12_t* r, const fp12_t* x, int k) {
+  // the coefficients of w^0 .. w^5
+  const fp2_t* src[6] = {&x->c0.c0, &x->c1.c0, &x->c0.c1, &x->c1.c1, &x->c0.c2, &x->c1.c2};
+  fp2_t*       dst[6] = {&r->c0.c0, &r->c1.c0, &r->c0.c1, &r->c1.c1, &r->c0.c2, &r->c1.c2};
+  fp2_t        c[6];
+  for (int i = 0; i < 6; i++) {
+    if (k & 1)
+      fp2_conj(c + i, src[i]);
+    else
+      c[i] = *src[i];
+    if (i == 0) continue;
+    if (k == 2)
+      fp2_mul_fp(c + i, c + i, GAMMA2 + i - 1);
+    else
+      fp2_mul(c + i, c + i, (k == 1 ? GAMMA1 : GAMMA3) + i - 1);
+  }
+  for (int i = 0; i < 6; i++) *dst[i] = c[i];
+}
+
+/** r = x^u for x in the cyclotomic subgroup */
+static void fp12_pow_u(fp12_t* r, const fp12_t* x) {
+  fp12_t res = *x;
+  for (int i = 61; i >= 0; i--) {
+    fp12_cyclotomic_sqr(&res, &res);
+    if ((U >> i) & 1) fp12_mul(&res, &res, x);
+  }
+  *r = res;
+}
+
+static void final_exp(fp12_t* r, const fp12_t* f) {
+  fp12_t t0, t1, fp, fp2, fp3, fu, fu2, fu3, y0, y1, y2, y3, y4, y5, y6;
+
+  // easy part: f^((p^6 - 1)(p^2 + 1))
+  fp12_inv(&t0, f);
+  fp12_conj(&t1, f);
+  fp12_mul(&t1, &t1, &t0);
+  fp12_frob(&t0, &t1, 2);
+  fp12_mul(&t1, &t0, &t1);
+
+  // hard part: (p^4 - p^2 + 1) / r
+  fp12_frob(&fp, &t1, 1);
+  fp12_frob(&fp2, &t1, 2);
+  fp12_frob(&fp3, &fp2, 1);
+  fp12_pow_u(&fu, &t1);
+  fp12_pow_u(&fu2, &fu);
+  fp12_pow_u(&fu3, &fu2);
+
+  fp12_frob(&y3, &fu, 1);
+  fp12_frob(&y4, &fu2, 1); // fu2^p
+  fp12_frob(&y6, &fu3, 1); // fu3^p
+  fp12_frob(&y2, &fu2, 2);
+
+  fp12_mul(&y0, &fp, &fp2);
+  fp12_mul(&y0, &y0, &fp3);
+  fp12_conj(&y1, &t1);
+  fp12_conj(&y5, &fu2);
+  fp12_conj(&y3, &y3);
+  fp12_mul(&y4, &fu, &y4);
+  fp12_conj(&y4, &y4);
+  fp12_mul(&y6, &fu3, &y6);
+  fp12_conj(&y6, &y6);
+
+  fp12_cyclotomic_sqr(&t0, &y6);
+  fp12_mul(&t0, &t0, &y4);
+  fp12_mul(&t0, &t0, &y5);
+  fp12_mul(&t1, &y3, &y5);
+  fp12_mul(&t1, &t1, &t0);
+  fp12_mul(&t0, &t0, &y2);
+  fp12_cyclotomic_sqr(&t1, &t1);
+  fp12_mul(&t1, &t1, &t0);
+  fp12_cyclotomic_sqr(&t1, &t1);
+  fp12_mul(&t0, &t1, &y1);
+  fp12_mul(&t1, &t1, &y0);
+  fp12_cyclotomic_sqr(&t0, &t0);
+  fp12_mul(r, &t0, &t1);
+}
+
+// ----------------------------------------------------------------------------------------------
+// G1 : y^2 = x^3 + 3
+// ----------------------------------------------------------------------------------------------
+
+static void g1_dbl(g1_t* r, const g1_t* p) {
+  if (fp_is_zero(&p->z)) {
+    *r = *p;
+    return;
+  }
+  fp_t a, b, c, d, e, f, t;
+  fp_sqr(&a, &p->x);
+  fp_sqr(&b, &p->y);
+  fp_sqr(&c, &b);
+  fp_add(&d, &p->x, &b);
+  fp_sqr(&d, &d);
+  fp_sub(&d, &d, &a);
+  fp_sub(&d, &d, &c);
+  fp_dbl(&d, &d); // D = 2((X+B)^2 - A - C)
+  fp_dbl(&e, &a);
+  fp_add(&e, &e, &a); // E = 3A
+  fp_sqr(&f, &e);
+
+  fp_mul(&r->z, &p->y, &p->z);
+  fp_dbl(&r->z, &r->z);
+  fp_dbl(&t, &d);
+  fp_sub(&r->x, &f, &t);
+  fp_sub(&t, &d, &r->x);
+  fp_mul(&t, &e, &t);
+  fp_dbl(&c, &c);
+  fp_dbl(&c, &c);
+  fp_dbl(&c, &c);
+  fp_sub(&r->y, &t, &c);
+}
+
+static void g1_add(g1_t* r, const g1_t* p, const g1_t* q) {
+  if (fp_is_zero(&p->z)) {
+    *r = *q;
+    return;
+  }
+  if (fp_is_zero(&q->z)) {
+    *r = *p;
+    return;
+  }
+  fp_t z1z1, z2z2, u1, u2, s1, s2, h, i, j, rr, v, t;
+  fp_sqr(&z1z1, &p->z);
+  fp_sqr(&z2z2, &q->z);
+  fp_mul(&u1, &p->x, &z2z2);
+  fp_mul(&u2, &q->x, &z1z1);
+  fp_mul(&s1, &p->y, &q->z);
+  fp_mul(&s1, &s1, &z2z2);
+  fp_mul(&s2, &q->y, &p->z);
+  fp_mul(&s2, &s2, &z1z1);
+  fp_sub(&h, &u2, &u1);
+  fp_sub(&rr, &s2, &s1);
+  if (fp_is_zero(&h)) {
+    if (fp_is_zero(&rr))
+      g1_dbl(r, p);
+    else
+      memset(r, 0, sizeof(g1_t));
+    return;
+  }
+  fp_dbl(&i, &h);
+  fp_sqr(&i, &i);
+  fp_mul(&j, &h, &i);
+  fp_dbl(&rr, &rr);
+  fp_mul(&v, &u1, &i);
+
+  fp_add(&t, &p->z, &q->z);
+  fp_sqr(&t, &t);
+  fp_sub(&t, &t, &z1z1);
+  fp_sub(&t, &t, &z2z2);
+  fp_mul(&r->z, &t, &h);
+
+  fp_sqr(&t, &rr);
+  fp_sub(&t, &t, &j);
+  fp_sub(&t, &t, &v);
+  fp_sub(&r->x, &t, &v);
+
+  fp_sub(&t, &v, &r->x);
+  fp_mul(&t, &rr, &t);
+  fp_mul(&s1, &s1, &j);
+  fp_dbl(&s1, &s1);
+  fp_sub(&r->y, &t, &s1);
+}
+
+/** reads the affine point and checks that it is on the curve. (0,0) is the point at infinity. */
+static bool g1_from_bytes(g1_t* r, const uint8_t* data) {
+  if (!fp_from_bytes(&r->x, data) || !fp_from_bytes(&r->y, data + 32)) return false;
+  if (fp_is_zero(&r->x) && fp_is_zero(&r->y)) {
+    memset(r, 0, sizeof(g1_t));
+    return true;
+  }
+  r->z = ONE;
+  fp_t y2, x3;
+  fp_sqr(&y2, &r->y);
+  fp_sqr(&x3, &r->x);
+  fp_mul(&x3, &x3, &r->x);
+  fp_add(&x3, &x3, &B1);
+  return fp_eq(&y2, &x3);
+}
+
+static void g1_to_bytes(uint8_t* data, const g1_t* p) {
+  if (fp_is_zero(&p->z)) {
+    memset(data, 0, 64);
+    return;
+  }
+  fp_t zi, zi2, t;
+  fp_inv(&zi, &p->z);
+  fp_sqr(&zi2, &zi);
+  fp_mul(&t, &p->x, &zi2);
+  fp_to_bytes(data, &t);
+  fp_mul(&zi2, &zi2, &zi);
+  fp_mul(&t, &p->y, &zi2);
+  fp_to_bytes(data + 32, &t);
+}
+
+/** computes the width-5 NAF of the big endian scalar (least significant digit first) and returns the number of digits */
+static int wnaf(int8_t* digits, const uint8_t* scalar) {
+  uint64_t k[5] = {0};
+  int      len  = 0;
+  for (int i = 0; i < 32; i++) k[(31 - i) >> 3] |= ((uint64_t) scalar[i]) << (((31 - i) & 7) * 8);
+  while (k[0] | k[1] | k[2] | k[3] | k[4]) {
+    int d = 0;
+    if (k[0] & 1) {
+      d = (int) (k[0] & 31);
+      if (d >= 16) d -= 32;
+      uint64_t c = 0;
+      if (d > 0) {
+        uint64_t borrow = 0;
+        k[0]            = sbb(k[0], (uint64_t) d, &borrow);
+        for (int i = 1; i < 5; i++) k[i] = sbb(k[i], 0, &borrow);
+      } else {
+        k[0] = adc(k[0], (uint64_t) -d, &c);
+        for (int i = 1; i < 5; i++) k[i] = adc(k[i], 0, &c);
+      }
+    }
+    digits[len++] = (int8_t) d;
+    for (int i = 0; i < 4; i++) k[i] = (k[i] >> 1) | (k[i + 1] << 63);
+    k[4] >>= 1;
+  }
+  return len;
+}
+
+static void g1_mul(g1_t* r, const g1_t* p, const uint8_t* scalar) {
+  int8_t digits[258];
+  g1_t   table[8], p2, res; // P, 3P, 5P, .. 15P
+  table[0] = *p;
+  g1_dbl(&p2, p);
+  for (int i = 1; i < 8; i++) g1_add(table + i, table + i - 1, &p2);
+
+  memset(&res, 0, sizeof(g1_t));
+  for (int i = wnaf(digits, scalar) - 1; i >= 0; i--) {
+    g1_dbl(&res, &res);
+    if (digits[i] > 0)
+      g1_add(&res, &res, table + (digits[i] >> 1));
+    else if (digits[i] < 0) {
+      g1_t neg = table[(-digits[i]) >> 1];
+      fp_neg(&neg.y, &neg.y);
+      g1_add(&res, &res, &neg);
+    }
+  }
+  *r = res;
+}
+
+// ----------------------------------------------------------------------------------------------
+// G2 : y^2 = x^3 + 3/(9+i)
+// ----------------------------------------------------------------------------------------------
+
+static void g2_dbl(g2_t* r, const g2_t* p) {
+  if (fp2_is_zero(&p->z)) {
+    *r = *p;
+    return;
+  }
+  fp2_t a, b, c, d, e, f, t;
+  fp2_sqr(&a, &p->x);
+  fp2_sqr(&b, &p->y);
+  fp2_sqr(&c, &b);
+  fp2_add(&d, &p->x, &b);
+  fp2_sqr(&d, &d);
+  fp2_sub(&d, &d, &a);
+  fp2_sub(&d, &d, &c);
+  fp2_dbl(&d, &d);
+  fp2_dbl(&e, &a);
+  fp2_add(&e, &e, &a);
+  fp2_sqr(&f, &e);
+
+  fp2_mul(&r->z, &p->y, &p->z);
+  fp2_dbl(&r->z, &r->z);
+  fp2_dbl(&t, &d);
+  fp2_sub(&r->x, &f, &t);
+  fp2_sub(&t, &d, &r->x);
+  fp2_mul(&t, &e, &t);
+  fp2_dbl(&c, &c);
+  fp2_dbl(&c, &c);
+  fp2_dbl(&c, &c);
+  fp2_sub(&r->y, &t, &c);
+}
+
+static void g2_add(g2_t* r, const g2_t* p, const g2_t* q) {
+  if (fp2_is_zero(&p->z)) {
+    *r = *q;
+    return;
+  }
+  if (fp2_is_zero(&q->z)) {
+    *r = *p;
+    return;
+  }
+  fp2_t z1z1, z2z2, u1, u2, s1, s2, h, i, j, rr, v, t;
+  fp2_sqr(&z1z1, &p->z);
+  fp2_sqr(&z2z2, &q->z);
+  fp2_mul(&u1, &p->x, &z2z2);
+  fp2_mul(&u2, &q->x, &z1z1);
+  fp2_mul(&s1, &p->y, &q->z);
+  fp2_mul(&s1, &s1, &z2z2);
+  fp2_mul(&s2, &q->y, &p->z);
+  fp2_mul(&s2, &s2, &z1z1);
+  fp2_sub(&h, &u2, &u1);
+  fp2_sub(&rr, &s2, &s1);
+  if (fp2_is_zero(&h)) {
+    if (fp2_is_zero(&rr))
+      g2_dbl(r, p);
+    else
+      memset(r, 0, sizeof(g2_t));
+    return;
+  }
+  fp2_dbl(&i, &h);
+  fp2_sqr(&i, &i);
+  fp2_mul(&j, &h, &i);
+  fp2_dbl(&rr, &rr);
+  fp2_mul(&v, &u1, &i);
+
+  fp2_add(&t, &p->z, &q->z);
+  fp2_sqr(&t, &t);
+  fp2_sub(&t, &t, &z1z1);
+  fp2_sub(&t, &t, &z2z2);
+  fp2_mul(&r->z, &t, &h);
+
+  fp2_sqr(&t, &rr);
+  fp2_sub(&t, &t, &j);
+  fp2_sub(&t, &t, &v);
+  fp2_sub(&r->x, &t, &v);
+
+  fp2_sub(&t, &v, &r->x);
+  fp2_mul(&t, &rr, &t);
+  fp2_mul(&s1, &s1, &j);
+  fp2_dbl(&s1, &s1);
+  fp2_sub(&r->y, &t, &s1);
+}
+
+/** checks r * Q = O, since the twisted curve has points outside of the subgroup of order r */
+static bool g2_in_subgroup(const g2_t* q) {
+  g2_t res;
+  memset(&res, 0, sizeof(g2_t));
+  for (int i = 253; i >= 0; i--) {
+    g2_dbl(&res, &res);
+    if ((ORDER[i >> 6] >> (i & 63)) & 1) g2_add(&res, &res, q);
+  }
+  return fp2_is_zero(&res.z);
+}
+
+/** reads the affine point (x_im, x_re, y_im, y_re) and checks that it is a valid point of the subgroup. (0,0) is the point at infinity. */
+static bool g2_from_bytes(g2_t* r, const uint8_t* data) {
+  if (!fp_from_bytes(&r->x.b, data) || !fp_from_bytes(&r->x.a, data + 32) || !fp_from_bytes(&r->y.b, data + 64) || !fp_from_bytes(&r->y.a, data + 96)) return false;
+  if (fp2_is_zero(&r->x) && fp2_is_zero(&r->y)) {
+    memset(r, 0, sizeof(g2_t));
+    return true;
+  }
+  memset(&r->z, 0, sizeof(fp2_t));
+  r->z.a = ONE;
+  fp2_t y2, x3;
+  fp2_sqr(&y2, &r->y);
+  fp2_sqr(&x3, &r->x);
+  fp2_mul(&x3, &x3, &r->x);
+  fp2_add(&x3, &x3, &B2);
+  return fp2_eq(&y2, &x3) && g2_in_subgroup(r);
+}
+
+// ----------------------------------------------------------------------------------------------
+// pairing
+// ----------------------------------------------------------------------------------------------
+
+/** doubles T (homogeneous projective) and evaluates the tangent at P */
+static void line_dbl(g2_t* t, const g1_t* p, line_t* l) {
+  fp2_t a, b, c, e, f, g, h;
+  fp2_mul(&a, &t->x, &t->y);
+  fp2_half(&a, &a);
+  fp2_sqr(&b, &t->y);
+  fp2_sqr(&c, &t->z);
+  fp2_dbl(&e, &c);
+  fp2_add(&e, &e, &c);
+  fp2_mul(&e, &e, &B2);
+  fp2_dbl(&f, &e);
+  fp2_add(&f, &f, &e);
+  fp2_add(&g, &b, &f);
+  fp2_half(&g, &g);
+  fp2_add(&h, &t->y, &t->z);
+  fp2_sqr(&h, &h);
+  fp2_sub(&h, &h, &b);
+  fp2_sub(&h, &h, &c);
+
+  // the line with the old X
+  fp2_sub(&l->l3, &e, &b);
+  fp2_sqr(&l->l1, &t->x);
+  fp2_mul_fp(&l->l1, &l->l1, &p->x);
+  fp2_dbl(&c, &l->l1);
+  fp2_add(&l->l1, &l->l1, &c);
+  fp2_neg(&l->l0, &h);
+  fp2_mul_fp(&l->l0, &l->l0, &p->y);
+
+  fp2_sub(&c, &b, &f);
+  fp2_mul(&t->x, &a, &c);
+  fp2_sqr(&e, &e);
+  fp2_dbl(&c, &e);
+  fp2_add(&e, &e, &c);
+  fp2_sqr(&g, &g);
+  fp2_sub(&t->y, &g, &e);
+  fp2_mul(&t->z, &b, &h);
+}
+
+/** adds the affine point Q to T and evaluates the line through both at P */
+static void line_add(g2_t* t, const fp2_t* qx, const fp2_t* qy, const g1_t* p, line_t* l) {
+  fp2_t th, la, c, d, e, f, g, h, s;
+  fp2_mul(&th, qy, &t->z);
+  fp2_sub(&th, &t->y, &th);
+  fp2_mul(&la, qx, &t->z);
+  fp2_sub(&la, &t->x, &la);
+  fp2_sqr(&c, &th);
+  fp2_sqr(&d, &la);
+  fp2_mul(&e, &d, &la);
+  fp2_mul(&f, &t->z, &c);
+  fp2_mul(&g, &t->x, &d);
+  fp2_add(&h, &e, &f);
+  fp2_sub(&h, &h, &g);
+  fp2_sub(&h, &h, &g);
+
+  fp2_mul(&t->x, &la, &h);
+  fp2_sub(&s, &g, &h);
+  fp2_mul(&s, &th, &s);
+  fp2_mul(&t->y, &t->y, &e);
+  fp2_sub(&t->y, &s, &t->y);
+  fp2_mul(&t->z, &t->z, &e);
+
+  fp2_mul_fp(&l->l0, &la, &p->y);
+  fp2_neg(&l->l1, &th);
+  fp2_mul_fp(&l->l1, &l->l1, &p->x);
+  fp2_mul(&l->l3, &th, qx);
+  fp2_mul(&s, &la, qy);
+  fp2_sub(&l->l3, &l->l3, &s);
+}
+
+/** the miller loop for all pairs sharing the squarings of f */
+static void miller_loop(fp12_t* f, const g1_t* ps, const g2_t* qs, uint32_t n) {
+  g2_t*  ts = _malloc(n * sizeof(g2_t));
+  line_t l;
+  fp2_t  x, y;
+  memcpy(ts, qs, n * sizeof(g2_t));
+  fp12_set_one(f);
+
+  for (int i = 1; i < 66; i++) {
+    fp12_sqr(f, f);
+    for (uint32_t k = 0; k < n; k++) {
+      line_dbl(ts + k, ps + k, &l);
+      fp12_mul_line(f, &l);
+      if (!ATE_LOOP[i]) continue;
+      if (ATE_LOOP[i] > 0)
+        line_add(ts + k, &qs[k].x, &qs[k].y, ps + k, &l);
+      else {
+        fp2_neg(&y, &qs[k].y);
+        line_add(ts + k, &qs[k].x, &y, ps + k, &l);
+      }
+      fp12_mul_line(f, &l);
+    }
+  }
+
+  for (uint32_t k = 0; k < n; k++) {
+    // Q1 = pi(Q)
+    fp2_conj(&x, &qs[k].x);
+    fp2_mul(&x, &x, GAMMA1 + 1);
+    fp2_conj(&y, &qs[k].y);
+    fp2_mul(&y, &y, GAMMA1 + 2);
+    line_add(ts + k, &x, &y, ps + k, &l);
+    fp12_mul_line(f, &l);
+
+    // Q2 = -pi^2(Q), where the factor of y is -1
+    fp2_mul_fp(&x, &qs[k].x, GAMMA2 + 1);
+    line_add(ts + k, &x, &qs[k].y, ps + k, &l);
+    fp12_mul_line(f, &l);
+  }
+  _free(ts);
+}
+
+bool bn128_add(const uint8_t in[128], uint8_t out[64]) {
+  g1_t a, b;
+  if (!g1_from_bytes(&a, in) || !g1_from_bytes(&b, in + 64)) return false;
+  g1_add(&a, &a, &b);
+  g1_to_bytes(out, &a);
+  return true;
+}
+
+bool bn128_mul(const uint8_t in[96], uint8_t out[64]) {
+  g1_t a;
+  if (!g1_from_bytes(&a, in)) return false;
+  g1_mul(&a, &a, in + 64);
+  g1_to_bytes(out, &a);
+  return true;
+}
+
+bool bn128_pairing(const uint8_t* in, uint32_t len, bool* result) {
+  if (len % 192) return false;
+  uint32_t n = 0;
+  g1_t*    ps = len ? _malloc(len / 192 * sizeof(g1_t)) : NULL;
+  g2_t*    qs = len ? _malloc(len / 192 * sizeof(g2_t)) : NULL;
+  bool     ok = true;
+
+  for (uint32_t i = 0; i < len && ok; i += 192) {
+    ok = g1_from_bytes(ps + n, in + i) && g2_from_bytes(qs + n, in + i + 64);
+    // pairs with the point at infinity do not change the product
+    if (ok && !fp_is_zero(&ps[n].z) && !fp2_is_zero(&qs[n].z)) n++;
+  }
+
+  if (ok) {
+    fp12_t f;
+    if (n) {
+      miller_loop(&f, ps, qs, n);
+      final_exp(&f, &f);
+    }
+    *result = !n || fp12_is_one(&f);
+  }
+  _free(ps);
+  _free(qs);
+  return ok;
+}
@@ -0,0 +1,74 @@
+/*******************************************************************************
+ * This file is part of the Incubed project.
+ * Sources: https://github.com/slockit/in3-c
+ * 
+ * Copyright (C) 2018-2020 slock.it GmbH, Blockchains LLC
+ * 
+ * 
+ * COMMERCIAL LICENSE USAGE
+ * 
+ * Licensees holding a valid commercial license may use this file in accordance 
+ * with the commercial license agreement provided with the Software or, alternatively, 
+ * in accordance with the terms contained in a written agreement between you and 
+ * slock.it GmbH/Blockchains LLC. For licensing terms and conditions or further 
+ * information please contact slock.it at in3@slock.it.
+ * 	
+ * Alternatively, this file may be used under the AGPL license as follows:
+ *    
+ * AGPL LICENSE USAGE
+ * 
+ * This program is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Affero General Public License as published by the Free Software 
+ * Foundation, either version 3 of the License, or (at your option) any later version.
+ *  
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY 
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A 
+ * PARTICULAR PURPOSE. See the GNU Affero General Public License for more details.
+ * [Permissions of this strong copyleft license are conditioned on making available 
+ * complete source code of licensed works and modifications, which include larger 
+ * works using a licensed work, under the same license. Copyright and license notices 
+ * must be preserved. Contributors provide an express grant of patent rights.]
+ * You should have received a copy of the GNU Affero General Public License along 
+ * with this program. If not, see <https://www.gnu.org/licenses/>.
+ *******************************************************************************/
+
+/** @file
+ * arithmetic of the alt_bn128 curve used by the precompiles ECADD (0x06), ECMUL (0x07) and ECPAIRING (0x08).
+ * 
+ * The field elements are stored as 4 64-bit limbs in Montgomery form, points are kept in Jacobian (G1) or
+ * homogeneous projective coordinates (G2 in the Miller loop), so only the final result needs an inversion.
+ * Scalar multiplication uses a wNAF of width 5 and the pairing is the optimal ate pairing with the extension
+ * tower Fp2 = Fp[i]/(i^2+1), Fp6 = Fp2[v]/(v^3-(9+i)) and Fp12 = Fp6[w]/(w^2-v).
+ * 
+ * All points are passed as big-endian bytes as defined in EIP-196 and EIP-197.
+ * */
+
+#ifndef evm_bn128_h__
+#define evm_bn128_h__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * adds the two G1 points (x1,y1,x2,y2) and writes the result as (x,y).
+ * 
+ * returns false if one of the points is not on the curve.
+ */
+bool bn128_add(const uint8_t in[128], uint8_t out[64]);
+
+/**
+ * multiplies the G1 point (x,y) with the scalar s of the input (x,y,s) and writes the result as (x,y).
+ * 
+ * returns false if the point is not on the curve.
+ */
+bool bn128_mul(const uint8_t in[96], uint8_t out[64]);
+
+/**
+ * checks if the product of the pairings of the pairs (G1,G2) equals 1.
+ * 
+ * Each pair has 192 bytes. The G2 point is encoded with the imaginary parts first.
+ * returns false if the length is not a multiple of 192 or if a point is not on the curve or not in the subgroup.
+ */
+bool bn128_pairing(const uint8_t* in, uint32_t len, bool* result);
+
+#endif
@@ -34,7 +34,9 @@
 
 #include "../../../core/client/verifier.h"
 #include "../../../core/util/mem.h"
+#include "../basic/eth_basic.h"
 #include "big.h"
+#include "env.h"
 #include "evm.h"
 #include "evm_mem.h"
 #include "gas.h"
@@ -46,9 +48,8 @@
 void evm_free(evm_t* evm) {
   if (evm->last_returned.data) _free(evm->last_returned.data);
   if (evm->return_data.data) _free(evm->return_data.data);
-  if (evm->stack.b.data) _free(evm->stack.b.data);
+  if (evm->stack) _free(evm->stack);
   if (evm->memory.b.data) _free(evm->memory.b.data);
-  if (evm->invalid_jumpdest) _free(evm->invalid_jumpdest);
 
 #ifdef EVM_GAS
   logs_t* l = NULL;
@@ -60,20 +61,7 @@ void evm_free(evm_t* evm) {
     _free(l);
   }
 
-  account_t* ac = NULL;
-  storage_t* s  = NULL;
-
-  while (evm->accounts) {
-    ac = evm->accounts;
-    s  = NULL;
-    while (ac->storage) {
-      s           = ac->storage;
-      ac->storage = s->next;
-      _free(s);
-    }
-    evm->accounts = ac->next;
-    _free(ac);
-  }
+  evm_accounts_free(evm);
 #endif
 }
 
@@ -88,17 +76,16 @@ int evm_prepare_evm(evm_t*      evm,
                     evm_get_env env,
                     void*       env_ptr,
                     wlen_t      mode) {
-  evm->stack.b.data = _malloc(64);
-  evm->stack.b.len  = 0;
-  evm->stack.bsize  = 64;
+  evm->stack = _malloc(EVM_STACK_LIMIT * sizeof(evm_word_t));
 
   evm->memory.b.data = _calloc(32, 1);
   evm->memory.b.len  = 0;
   evm->memory.bsize  = 32;
   memset(evm->memory.b.data, 0, 32);
 
-  evm->stack_size       = 0;
-  evm->invalid_jumpdest = NULL;
+  evm->stack_size = 0;
+  evm->program    = NULL;
+  evm->programs   = NULL;
 
   evm->pos   = 0;
   evm->state = EVM_STATE_INIT;
@@ -131,9 +118,11 @@ int evm_prepare_evm(evm_t*      evm,
 
 #ifdef EVM_GAS
   evm->accounts = NULL;
+  memset(&evm->index, 0, sizeof(evm_index_t));
   evm->gas      = 0;
   evm->logs     = NULL;
   evm->parent   = NULL;
+  evm->root     = NULL;
   evm->refund   = 0;
   evm->init_gas = 0;
 #endif
@@ -178,6 +167,7 @@ int evm_sub_call(evm_t*    parent,
 
   evm.properties      = parent->properties;
   evm.chain_id        = parent->chain_id;
+  evm.programs        = parent->programs;
   evm.call_data.data  = data;
   evm.call_data.len   = l_data;
   evm.call_value.data = value;
@@ -222,9 +212,11 @@ int evm_sub_call(evm_t*    parent,
 }
 
 /**
- * run a evm-call
+ * run a evm-call with a in3_env_t as env.
+ * 
+ * If the gas is 0, the call is executed without metering the gas.
  */
-int evm_call(void*     vc,
+int evm_call(void*     env,
              address_t address,
              uint8_t* value, wlen_t l_value,
              uint8_t* data, uint32_t l_data,
@@ -233,9 +225,16 @@ int evm_call(void*     vc,
              uint64_t  chain_id,
              bytes_t** result) {
 
-  evm_t evm;
-  int   res    = evm_prepare_evm(&evm, address, address, caller, caller, in3_get_env, vc, 0);
-  evm.chain_id = chain_id;
+  evm_t       evm;
+  in3_vctx_t* vc  = ((in3_env_t*) env)->vc;
+  int         res = evm_prepare_evm(&evm, address, address, caller, caller, in3_get_env, env, 0);
+  evm.chain_id    = chain_id;
+
+  // the decoded code is kept with the chain, so contracts called again are not decoded again.
+  eth_chain_state_t* state = eth_chain_state(vc->chain);
+  if (!state->evm_programs) state->evm_programs = _calloc(1, sizeof(evm_programs_t));
+  evm.programs            = state->evm_programs;
+  evm.programs->max_bytes = vc->client->max_code_cache ? vc->client->max_code_cache : EVM_PROGRAM_CACHE_BYTES;
 
   // check if the caller is empty
   uint8_t* ccaller = caller;
@@ -253,6 +252,11 @@ int evm_call(void*     vc,
 
 //  evm.properties     = EVM_PROP_DEBUG;
 #ifdef EVM_GAS
+  // without a gas limit there is nothing to check, so we don't meter the gas, but still have plenty of it left for GAS and the sub calls.
+  if (!gas) {
+    evm.properties |= EVM_PROP_NO_GAS;
+    gas = 0xFFFFFFFFFFFFFF;
+  }
   evm.gas = gas;
 #endif
   evm.call_data.data = data;
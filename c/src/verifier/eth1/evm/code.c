@@ -33,6 +33,7 @@
  *******************************************************************************/
 
 #include "../../../core/client/keys.h"
+#include "../../../core/client/stats.h"
 #include "../../../core/client/verifier.h"
 #include "../../../core/util/log.h"
 #include "../../../core/util/mem.h"
@@ -150,8 +151,10 @@ in3_ret_t in3_get_code(in3_vctx_t* vc, address_t address, cache_entry_t** target
   in3_ret_t res;
 
   // not cached yet
-  if (vc->ctx->client->cache)
+  if (vc->ctx->client->cache) {
     code = vc->ctx->client->cache->get_item(vc->ctx->client->cache->cptr, key_str);
+    in3_stats_add(code ? IN3_STAT_CACHE_HIT : IN3_STAT_CACHE_MISS, "code", 1);
+  }
 
   in3_log_debug("try to get the code for %s from cache: %p\n", key_str, code);
 
@@ -32,26 +32,84 @@
  * with this program. If not, see <https://www.gnu.org/licenses/>.
  *******************************************************************************/
 
+#include "env.h"
 #include "../../../core/client/keys.h"
-#include "../../../core/client/verifier.h"
+#include "../../../core/util/mem.h"
 #include "big.h"
 #include "code.h"
 #include "evm.h"
+#include <stdlib.h>
+#include <string.h>
 
-static d_token_t* get_account(in3_vctx_t* vc, d_token_t* accounts, uint8_t* address) {
-  int        i;
-  d_token_t* t = NULL;
+static int cmp_account(const void* a, const void* b) {
+  return memcmp(((const in3_env_account_t*) a)->address, ((const in3_env_account_t*) b)->address, 20);
+}
 
-  if (!accounts) {
-    vc_err(vc, "no accounts");
-    return NULL;
+static int cmp_slot(const void* a, const void* b) {
+  return memcmp(((const in3_env_slot_t*) a)->key, ((const in3_env_slot_t*) b)->key, 32);
+}
+
+void in3_env_init(in3_env_t* env, in3_vctx_t* vc) {
+  memset(env, 0, sizeof(in3_env_t));
+  env->vc             = vc;
+  d_token_t* accounts = d_get(vc->proof, K_ACCOUNTS);
+  if (!accounts) return;
+
+  // count first, so we only need one allocation for all slots
+  uint32_t n_accounts = 0, n_slots = 0;
+  for (d_iterator_t iter = d_iter(accounts); iter.left; d_iter_next(&iter)) {
+    if (!d_get_byteskl(iter.token, K_ADDRESS, 20)) continue;
+    n_accounts++;
+    n_slots += d_len(d_get(iter.token, K_STORAGE_PROOF));
+  }
+  if (!n_accounts) return;
+  env->accounts = _calloc(n_accounts, sizeof(in3_env_account_t));
+  env->slots    = n_slots ? _calloc(n_slots, sizeof(in3_env_slot_t)) : NULL;
+
+  in3_env_slot_t* slot = env->slots;
+  for (d_iterator_t iter = d_iter(accounts); iter.left; d_iter_next(&iter)) {
+    bytes_t* address = d_get_byteskl(iter.token, K_ADDRESS, 20);
+    if (!address) continue;
+    in3_env_account_t* ac = env->accounts + env->accounts_len++;
+    ac->address           = address->data;
+    ac->token             = iter.token;
+    ac->slots             = slot;
+
+    for (d_iterator_t s = d_iter(d_get(iter.token, K_STORAGE_PROOF)); s.left; d_iter_next(&s)) {
+      bytes_t k = d_to_bytes(d_get(s.token, K_KEY));
+      if (!k.data || k.len > 32) continue; // can never match a key
+      memcpy(slot->key + 32 - k.len, k.data, k.len);
+      slot->value = d_to_bytes(d_get(s.token, K_VALUE));
+      slot++;
+    }
+    ac->slots_len = slot - ac->slots;
+    qsort(ac->slots, ac->slots_len, sizeof(in3_env_slot_t), cmp_slot);
   }
-  for (i = 0, t = accounts + 1; i < d_len(accounts); i++, t = d_next(t)) {
-    if (memcmp(d_get_byteskl(t, K_ADDRESS, 20)->data, address, 20) == 0)
-      return t;
+  qsort(env->accounts, env->accounts_len, sizeof(in3_env_account_t), cmp_account);
+}
+
+void in3_env_free(in3_env_t* env) {
+  if (env->accounts) _free(env->accounts);
+  if (env->slots) _free(env->slots);
+}
+
+static in3_env_account_t* get_account(in3_env_t* env, uint8_t* address) {
+  if (!env->accounts) {
+    vc_err(env->vc, "no accounts");
+    return NULL;
   }
-  vc_err(vc, "The account could not be found!");
-  return NULL;
+  in3_env_account_t key = {.address = address};
+  in3_env_account_t* ac = bsearch(&key, env->accounts, env->accounts_len, sizeof(in3_env_account_t), cmp_account);
+  if (!ac) vc_err(env->vc, "The account could not be found!");
+  return ac;
+}
+
+static in3_env_slot_t* get_slot(in3_env_account_t* ac, uint8_t* key, int len) {
+  in3_env_slot_t k;
+  if (len > 32) return NULL;
+  memset(k.key, 0, 32 - len);
+  memcpy(k.key + 32 - len, key, len);
+  return bsearch(&k, ac->slots, ac->slots_len, sizeof(in3_env_slot_t), cmp_slot);
 }
 #ifdef LOGGING
 #define INVALID(msg)              \
@@ -71,13 +129,15 @@ int in3_get_env(void* evm_ptr, uint16_t evm_key, uint8_t* in_data, int in_len, u
   bytes_t*  res = NULL;
   in3_ret_t ret = IN3_OK;
 
-  d_token_t *t, *t2;
-  int        i;
+  d_token_t*         t;
+  in3_env_account_t* ac;
+  in3_env_slot_t*    slot;
 
   evm_t* evm = evm_ptr;
   if (!evm) return EVM_ERROR_INVALID_ENV;
-  in3_vctx_t* vc = evm->env_ptr;
-  if (!vc) return EVM_ERROR_INVALID_ENV;
+  in3_env_t* env = evm->env_ptr;
+  if (!env || !env->vc) return EVM_ERROR_INVALID_ENV;
+  in3_vctx_t* vc = env->vc;
 
   switch (evm_key) {
     case EVM_ENV_BLOCKHEADER:
@@ -87,35 +147,27 @@ int in3_get_env(void* evm_ptr, uint16_t evm_key, uint8_t* in_data, int in_len, u
       return res->len;
 
     case EVM_ENV_BALANCE:
-      if (!(t = get_account(vc, d_get(vc->proof, K_ACCOUNTS), in_data)) || !(t = d_get(t, K_BALANCE)))
+      if (!(ac = get_account(env, in_data)) || !(t = d_get(ac->token, K_BALANCE)))
         INVALID("account not found in proof")
       bytes_t b1 = d_to_bytes(t);
       *out_data  = b1.data;
       return b1.len;
 
     case EVM_ENV_NONCE:
-      if (!(t = get_account(vc, d_get(vc->proof, K_ACCOUNTS), in_data)) || !(t = d_get(t, K_NONCE)))
+      if (!(ac = get_account(env, in_data)) || !(t = d_get(ac->token, K_NONCE)))
         INVALID("account not found in proof")
       bytes_t b2 = d_to_bytes(t);
       *out_data  = b2.data;
       return b2.len;
 
     case EVM_ENV_STORAGE:
-      if (!(t = get_account(vc, d_get(vc->proof, K_ACCOUNTS), evm->address)) || !(t = d_get(t, K_STORAGE_PROOF)))
+      if (!(ac = get_account(env, evm->address)) || !d_get(ac->token, K_STORAGE_PROOF))
         INVALID("account not found in proof")
-
-      for (i = 0, t2 = t + 1; i < d_len(t); i++, t2 = d_next(t2)) {
-        bytes_t k = d_to_bytes(d_get(t2, K_KEY));
-        if (!k.data) INVALID("no data on storage")
-
-        if (big_cmp(in_data, in_len, k.data, k.len) == 0) {
-          k = d_to_bytes(d_get(t2, K_VALUE));
-          if (!k.data) INVALID("no data on storage")
-          *out_data = k.data;
-          return k.len;
-        }
-      }
-      INVALID("storage not found in proof");
+      if (!(slot = get_slot(ac, in_data, in_len)))
+        INVALID("storage not found in proof")
+      if (!slot->value.data) INVALID("no data on storage")
+      *out_data = slot->value.data;
+      return slot->value.len;
 
     case EVM_ENV_BLOCKHASH:
       return EVM_ERROR_UNSUPPORTED_CALL_OPCODE;
@@ -131,7 +183,7 @@ int in3_get_env(void* evm_ptr, uint16_t evm_key, uint8_t* in_data, int in_len, u
     }
     case EVM_ENV_CODE_HASH: {
       if (in_len != 20) return EVM_ERROR_INVALID_ENV;
-      if (!(t = get_account(vc, d_get(vc->proof, K_ACCOUNTS), evm->address)) || !(t = d_get(t, K_STORAGE_PROOF)))
+      if (!(ac = get_account(env, evm->address)) || !(t = d_get(ac->token, K_STORAGE_PROOF)))
         return EVM_ERROR_INVALID_ENV;
       t = d_getl(t, K_CODE_HASH, 32);
       if (!t) return EVM_ERROR_INVALID_ENV;
@@ -0,0 +1,76 @@
+/*******************************************************************************
+ * This file is part of the Incubed project.
+ * Sources: https://github.com/slockit/in3-c
+ * 
+ * Copyright (C) 2018-2020 slock.it GmbH, Blockchains LLC
+ * 
+ * 
+ * COMMERCIAL LICENSE USAGE
+ * 
+ * Licensees holding a valid commercial license may use this file in accordance 
+ * with the commercial license agreement provided with the Software or, alternatively, 
+ * in accordance with the terms contained in a written agreement between you and 
+ * slock.it GmbH/Blockchains LLC. For licensing terms and conditions or further 
+ * information please contact slock.it at in3@slock.it.
+ * 	
+ * Alternatively, this file may be used under the AGPL license as follows:
+ *    
+ * AGPL LICENSE USAGE
+ * 
+ * This program is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Affero General Public License as published by the Free Software 
+ * Foundation, either version 3 of the License, or (at your option) any later version.
+ *  
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY 
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A 
+ * PARTICULAR PURPOSE. See the GNU Affero General Public License for more details.
+ * [Permissions of this strong copyleft license are conditioned on making available 
+ * complete source code of licensed works and modifications, which include larger 
+ * works using a licensed work, under the same license. Copyright and license notices 
+ * must be preserved. Contributors provide an express grant of patent rights.]
+ * You should have received a copy of the GNU Affero General Public License along 
+ * with this program. If not, see <https://www.gnu.org/licenses/>.
+ *******************************************************************************/
+
+/** @file 
+ * the enviroment of the evm when verifying a eth_call.
+ * */
+
+#ifndef in3_evm_env_h__
+#define in3_evm_env_h__
+
+#include "../../../core/client/verifier.h"
+
+/** a verified storage value of the proof */
+typedef struct {
+  bytes32_t key;   /**< the storage key as 32 bytes */
+  bytes_t   value; /**< the value as found in the proof or NULL if it is missing */
+} in3_env_slot_t;
+
+/** an account of the proof */
+typedef struct {
+  uint8_t*        address;   /**< the address of the account */
+  d_token_t*      token;     /**< the account as found in the proof */
+  in3_env_slot_t* slots;     /**< the storage values sorted by key */
+  uint32_t        slots_len; /**< number of storage values */
+} in3_env_account_t;
+
+/** 
+ * the enviroment passed to the evm as env_ptr.
+ * 
+ * It indexes the accounts and storage values of the proof, so the evm can find them without walking through the tokens.
+ */
+typedef struct {
+  in3_vctx_t*        vc;           /**< the verification context */
+  in3_env_account_t* accounts;     /**< the accounts sorted by address */
+  uint32_t           accounts_len; /**< number of accounts */
+  in3_env_slot_t*    slots;        /**< the storage values of all accounts */
+} in3_env_t;
+
+/** indexes the accounts of the proof of the verification context. */
+void in3_env_init(in3_env_t* env, in3_vctx_t* vc);
+
+/** frees the index, but not the verification context */
+void in3_env_free(in3_env_t* env);
+
+#endif
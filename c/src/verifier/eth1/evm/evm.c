@@ -49,113 +49,75 @@
 int exit_zero(void) { return 0; }
 int evm_stack_push(evm_t* evm, uint8_t* data, uint8_t len) {
   if (evm->stack_size == EVM_STACK_LIMIT || len > 32) return EVM_ERROR_STACK_LIMIT;
-  // we need to make sure the data ref is not part of the stack and would be ionvalidated now
-  uint32_t tmp[32];
-  memcpy(tmp, data, len);
-  if (bb_check_size(&evm->stack, len + 1)) return EVM_ERROR_EMPTY_STACK;
-  memcpy(evm->stack.b.data + evm->stack.b.len, tmp, len);
-  evm->stack.b.len += len + 1;
-  evm->stack.b.data[evm->stack.b.len - 1] = len;
-  evm->stack_size++;
+  // data may point to a popped entry, so we read it before writing the new one.
+  evm_word_t w;
+  evm_word_from_bytes(&w, data, len);
+  evm->stack[evm->stack_size++] = w;
   return 0;
 }
 
-int evm_stack_push_ref(evm_t* evm, uint8_t** dst, uint8_t len) {
+int evm_stack_push_word(evm_t* evm, const evm_word_t* val) {
   if (evm->stack_size == EVM_STACK_LIMIT) return EVM_ERROR_STACK_LIMIT;
-  if (bb_check_size(&evm->stack, len + 1)) return EVM_ERROR_EMPTY_STACK;
-  *dst = evm->stack.b.data + evm->stack.b.len;
-  evm->stack.b.len += len + 1;
-  evm->stack.b.data[evm->stack.b.len - 1] = len;
-  evm->stack_size++;
+  evm->stack[evm->stack_size++] = *val;
   return 0;
 }
+
 int evm_stack_push_int(evm_t* evm, uint32_t val) {
-  uint8_t bytes[4];
-  bytes[3] = val & 0xFF;
-  bytes[2] = (val >> 8) & 0xFF;
-  bytes[1] = (val >> 16) & 0xFF;
-  bytes[0] = (val >> 24) & 0xFF;
-  if (bytes[0]) return evm_stack_push(evm, bytes, 4);
-  if (bytes[1]) return evm_stack_push(evm, bytes + 1, 3);
-  if (bytes[2]) return evm_stack_push(evm, bytes + 2, 2);
-  return evm_stack_push(evm, bytes + 3, 1);
+  return evm_stack_push_long(evm, val);
 }
 
 int evm_stack_push_long(evm_t* evm, uint64_t val) {
-  uint8_t bytes[8];
-  bytes[7] = val & 0xFF;
-  bytes[6] = (val >> 8) & 0xFF;
-  bytes[5] = (val >> 16) & 0xFF;
-  bytes[4] = (val >> 24) & 0xFF;
-  bytes[3] = (val >> 32) & 0xFF;
-  bytes[2] = (val >> 40) & 0xFF;
-  bytes[1] = (val >> 48) & 0xFF;
-  bytes[0] = (val >> 56) & 0xFF;
-  for (uint8_t i = 0; i < 7; i++) {
-    if (bytes[i] == 0) return evm_stack_push(evm, bytes + i, 8 - i);
-  }
-  return evm_stack_push(evm, bytes + 7, 1);
+  if (evm->stack_size == EVM_STACK_LIMIT) return EVM_ERROR_STACK_LIMIT;
+  evm_word_set_u64(evm->stack + evm->stack_size++, val);
+  return 0;
+}
+
+int evm_stack_pop_word(evm_t* evm, evm_word_t* dst) {
+  if (evm->stack_size == 0) return EVM_ERROR_EMPTY_STACK; // stack empty
+  *dst = evm->stack[--evm->stack_size];
+  return 0;
 }
 
 int evm_stack_pop(evm_t* evm, uint8_t* dst, uint8_t len) {
   if (evm->stack_size == 0) return EVM_ERROR_EMPTY_STACK; // stack empty
-  uint8_t l = evm->stack.b.data[evm->stack.b.len - 1];
-  evm->stack.b.len -= l + 1;
-  evm->stack_size--;
+  evm_word_t* w = evm->stack + --evm->stack_size;
+  int         l = evm_word_len(w);
   if (!dst) return l;
-  if (l == len)
-    memcpy(dst, evm->stack.b.data + evm->stack.b.len, l);
-  else if (l < len) {
-    memset(dst, 0, len - l);
-    memcpy(dst + len - l, evm->stack.b.data + evm->stack.b.len, l);
+  uint8_t tmp[32];
+  evm_word_to_bytes(w, tmp);
+  if (len > 32) {
+    memset(dst, 0, len - 32);
+    memcpy(dst + len - 32, tmp, 32);
   } else
-    memcpy(dst, evm->stack.b.data + evm->stack.b.len + l - len, len);
+    memcpy(dst, tmp + 32 - len, len);
   return l;
 }
 
 int evm_stack_pop_ref(evm_t* evm, uint8_t** dst) {
   if (evm->stack_size == 0) return EVM_ERROR_EMPTY_STACK; // stack empty
-  uint8_t l = evm->stack.b.data[evm->stack.b.len - 1];
-  evm->stack.b.len -= l + 1;
-  evm->stack_size--;
-  *dst = evm->stack.b.data + evm->stack.b.len;
-  return l;
-}
-
-int evm_stack_get_ref(evm_t* evm, uint8_t pos, uint8_t** dst) {
-  if (evm->stack_size - pos < 0 || pos < 1) return EVM_ERROR_EMPTY_STACK; // stack empty
-  uint32_t p = evm->stack.b.len;
-  uint8_t  i, l = 0;
-  for (i = 0; i < pos; i++) {
-    l = evm->stack.b.data[p - 1];
-    p -= l + 1;
-  }
-  *dst = evm->stack.b.data + p;
+  // the popped slot is free now, so we convert it in place. The data stays valid until the next push.
+  evm_word_t* w   = evm->stack + --evm->stack_size;
+  uint8_t*    p   = (uint8_t*) w;
+  int         l   = 32;
+  evm_word_t  tmp = *w;
+  evm_word_to_bytes(&tmp, p);
+  optimize_len(p, l);
+  *dst = p;
   return l;
 }
 
 int evm_stack_pop_byte(evm_t* evm, uint8_t* dst) {
   if (evm->stack_size == 0) return EVM_ERROR_EMPTY_STACK; // stack empty
-  uint8_t l = evm->stack.b.data[evm->stack.b.len - 1];
-  evm->stack.b.len -= l + 1;
-  evm->stack_size--;
-  if (l > 1) {
-    for (uint32_t i = evm->stack.b.len; i < evm->stack.b.len + l - 1; i++) {
-      if (evm->stack.b.data[i]) return -3;
-    }
-  } else if (l == 0)
-    return -3;
-  *dst = evm->stack.b.data[evm->stack.b.len + l - 1];
-  return l;
+  evm_word_t* w = evm->stack + --evm->stack_size;
+  if (!evm_word_is_u64(w) || w->n[0] > 0xFF) return -3;
+  *dst = (uint8_t) w->n[0];
+  return 1;
 }
 
 int32_t evm_stack_pop_int(evm_t* evm) {
   if (evm->stack_size == 0) return EVM_ERROR_EMPTY_STACK; // stack empty
-  uint8_t l = evm->stack.b.data[evm->stack.b.len - 1], *p = evm->stack.b.data + evm->stack.b.len - l - 1;
-  evm->stack.b.len -= l + 1;
-  evm->stack_size--;
-  optimize_len(p, l);
-  return (l > 4 || (l == 4 && *p & 0xF0)) ? 0xFFFFFFF : bytes_to_int(p, l);
+  evm_word_t* w = evm->stack + --evm->stack_size;
+  return (!evm_word_is_u64(w) || w->n[0] >= 0x10000000) ? 0xFFFFFFF : (int32_t) w->n[0];
 }
 
 #define __code(n)                     \
@@ -280,8 +242,9 @@ void evm_print_stack(evm_t* evm, uint64_t last_gas, uint32_t pos) {
   evm_print_op(evm, last_gas, pos);
   in3_log_trace(" [ ");
   for (int i = 0; i < evm->stack_size; i++) {
-    uint8_t* dst = NULL;
-    int      l   = evm_stack_get_ref(evm, i + 1, &dst);
+    uint8_t tmp[32], *dst = tmp;
+    int     l = 32;
+    evm_word_to_bytes(evm_stack_peek(evm, i + 1), tmp);
     optimize_len(dst, l);
     for (int j = 0; j < l; j++) {
       if (j == 0 && dst[j] < 16) {
@@ -465,6 +428,62 @@ int evm_execute(evm_t* evm) {
   }
 }
 
+#if defined(__GNUC__) && !defined(EVM_NO_COMPUTED_GOTO)
+#define EVM_COMPUTED_GOTO
+#endif
+
+#ifdef EVM_COMPUTED_GOTO
+#define HANDLER(h) L_##h:
+#define DISPATCH() goto* handlers[ip->handler]
+#else
+#define HANDLER(h) case h:
+#define DISPATCH() continue
+#endif
+
+#if defined(DEBUG) && defined(EVM_GAS)
+#define TRACE_OP() EVM_DEBUG_BLOCK({ evm_print_stack(evm, last_gas, last); })
+#define TRACE_NEXT()                       \
+  EVM_DEBUG_BLOCK({                        \
+    last     = ip - program->instr;        \
+    last_gas = KEEP_TRACK_GAS(evm);        \
+  })
+#else
+#define TRACE_OP()
+#define TRACE_NEXT()
+#endif
+
+/** ends the current instruction and jumps to the handler of the next one. */
+#define NEXT()                                                   \
+  {                                                              \
+    TRACE_OP();                                                  \
+    if (res < 0 || evm->state != EVM_STATE_RUNNING) return res;  \
+    if ((timeout--) == 0) return EVM_ERROR_TIMEOUT;              \
+    TRACE_NEXT();                                                \
+    DISPATCH();                                                  \
+  }
+
+/** like NEXT, but the next instruction starts a new block. */
+#define NEXT_BLOCK()                                             \
+  {                                                              \
+    TRACE_OP();                                                  \
+    if (res < 0 || evm->state != EVM_STATE_RUNNING) return res;  \
+    if ((timeout--) == 0) return EVM_ERROR_TIMEOUT;              \
+    TRACE_NEXT();                                                \
+    ENTER_BLOCK();                                               \
+    DISPATCH();                                                  \
+  }
+
+#ifdef EVM_GAS
+// the metered loop, used unless EVM_PROP_NO_GAS is set
+#define EVM_LOOP_NAME run_program_gas
+#define EVM_LOOP_GAS
+#include "evm_loop.h"
+#endif
+
+// the loop without any gas metering
+#define EVM_LOOP_NAME run_program
+#include "evm_loop.h"
+
 int evm_run(evm_t* evm, address_t code_address) {
 
   INIT_GAS(evm);
@@ -472,34 +491,21 @@ int evm_run(evm_t* evm, address_t code_address) {
   // for precompiled we simply execute it there
   if (evm_is_precompiled(evm, code_address))
     return evm_run_precompiled(evm, code_address);
-  // timeout is simply used in case we don't use gas to make sure we don't run a infite loop.
-  uint32_t timeout = 0xFFFFFFFF;
-  int      res     = 0;
-#ifdef DEBUG
-  uint32_t last     = 0;
-  uint64_t last_gas = 0;
-#endif
+
   // inital state
   evm->state = EVM_STATE_RUNNING;
 
-  // loop opcodes
-  while (res >= 0 && evm->state == EVM_STATE_RUNNING && evm->pos < evm->code.len) {
-    EVM_DEBUG_BLOCK({
-      last     = evm->pos;
-      last_gas = KEEP_TRACK_GAS(evm);
-    });
-
-    // execute the opcode
-    res = evm_execute(evm);
-    // display the result of the opcode (only if the debug flag is set)
+  // decode the code or take it from the cache
+  evm->program = evm_program_get(evm->programs, evm->code);
 #ifdef EVM_GAS
-    // debug gas output
-    EVM_DEBUG_BLOCK({ evm_print_stack(evm, last_gas, last); });
+  int res = (evm->properties & EVM_PROP_NO_GAS) ? run_program(evm, evm->program) : run_program_gas(evm, evm->program);
+#else
+  int res = run_program(evm, evm->program);
 #endif
-    if ((timeout--) == 0) return EVM_ERROR_TIMEOUT;
-  }
-  // done...
+  evm_program_release(evm->program);
+  evm->program = NULL;
 
+  // done...
 #ifdef EVM_GAS
   // debug gas output
   EVM_DEBUG_BLOCK({
@@ -37,6 +37,8 @@
  * */
 
 #include "../../../core/util/bytes.h"
+#include "program.h"
+#include "word.h"
 #ifndef evm_h__
 #define evm_h__
 int exit_zero(void);
@@ -50,13 +52,16 @@ typedef enum evm_state {
 } evm_state_t;
 
 #ifdef EVM_GAS
-#define gas_options       \
-  struct {                \
-    account_t*  accounts; \
-    struct evm* parent;   \
-    logs_t*     logs;     \
-    uint64_t    refund;   \
-    uint64_t    init_gas; \
+#define gas_options         \
+  struct {                  \
+    account_t*  accounts;   \
+    evm_index_t index;      \
+    struct evm* parent;     \
+    struct evm* root;       \
+    uint32_t    checkpoint; \
+    logs_t*     logs;       \
+    uint64_t    refund;     \
+    uint64_t    init_gas;   \
   }
 #else
 #define gas_options
@@ -83,6 +88,7 @@ typedef enum evm_state {
 #define EVM_PROP_ISTANBUL 32
 #define EVM_PROP_NO_FINALIZE 32768
 #define EVM_PROP_STATIC 256
+#define EVM_PROP_NO_GAS 512 /**< the gas is not metered. Without EVM_GAS the gas is never metered. */
 
 #define EVM_ENV_BALANCE 1
 #define EVM_ENV_CODE_SIZE 2
@@ -207,6 +213,7 @@ typedef int (*evm_get_env)(void* evm, uint16_t evm_key, uint8_t* in_data, int in
 typedef struct account_storage {
   bytes32_t               key;
   bytes32_t               value;
+  struct account*         account; /**< the account the entry belongs to */
   struct account_storage* next;
 } storage_t;
 typedef struct logs {
@@ -224,10 +231,44 @@ typedef struct account {
   struct account* next;
 } account_t;
 
+/** a block of memory the accounts and storage entries of a call are allocated from. The data follows the header. */
+typedef struct evm_arena {
+  struct evm_arena* next; /**< the block allocated before */
+  uint32_t          used; /**< number of bytes already used */
+  uint32_t          size; /**< number of bytes of the data */
+} evm_arena_t;
+
+/** a change of the state, which is recorded in the journal so it can be reverted. */
+typedef struct {
+  uint8_t*   value;   /**< the changed balance, nonce or storage value or NULL if the code was changed */
+  account_t* account; /**< the account whose code was changed */
+  bytes32_t  old;     /**< the previous value */
+  bytes_t    code;    /**< the previous code */
+} evm_change_t;
+
+/**
+ * the hash tables to find the accounts and storage entries and the journal of all changes.
+ * 
+ * The state is kept by the root evm and shared by all sub calls (see evm_t.root).
+ * Both tables are open addressing tables with linear probing, which are never more than half full.
+ * The entries are allocated from the arena and also linked in the lists of the evm and the accounts.
+ */
+typedef struct {
+  account_t**   accounts;      /**< the accounts indexed by the hash of the address */
+  storage_t**   storage;       /**< the storage entries indexed by the hash of address and key */
+  uint32_t      accounts_size; /**< the size of the accounts-table (a power of 2) */
+  uint32_t      accounts_used; /**< number of accounts in the table */
+  uint32_t      storage_size;  /**< the size of the storage-table (a power of 2) */
+  uint32_t      storage_used;  /**< number of storage entries in the table */
+  evm_arena_t*  arena;         /**< the last allocated block of the arena */
+  evm_change_t* journal;       /**< the changes in the order they were made */
+  uint32_t      journal_len;   /**< number of changes in the journal */
+  uint32_t      journal_size;  /**< number of changes the journal has room for */
+} evm_index_t;
+
 typedef struct evm {
   // internal data
-  bytes_builder_t stack;
-  //  bytes_builder_t memory;
+  evm_word_t*     stack; /**< the stack with room for EVM_STACK_LIMIT words, stack[stack_size - 1] is the top */
   bytes_builder_t memory;
   int             stack_size;
   bytes_t         code;
@@ -235,7 +276,8 @@ typedef struct evm {
   evm_state_t     state;
   bytes_t         last_returned;
   bytes_t         return_data;
-  uint32_t*       invalid_jumpdest;
+  evm_program_t*  program;  /**< the decoded code, which is executed right now */
+  evm_programs_t* programs; /**< the cache of decoded code used for this call and all sub calls (may be NULL) */
 
   // set properties as to which EIPs to use.
   uint32_t properties;
@@ -258,13 +300,18 @@ typedef struct evm {
 
 } evm_t;
 
+/** returns the word at the given position (1 = top of the stack) or NULL if the stack does not have that many entries */
+static inline evm_word_t* evm_stack_peek(evm_t* evm, int pos) {
+  return pos > evm->stack_size ? NULL : evm->stack + evm->stack_size - pos;
+}
+
 int evm_stack_push(evm_t* evm, uint8_t* data, uint8_t len);
-int evm_stack_push_ref(evm_t* evm, uint8_t** dst, uint8_t len);
+int evm_stack_push_word(evm_t* evm, const evm_word_t* val);
 int evm_stack_push_int(evm_t* evm, uint32_t val);
 int evm_stack_push_long(evm_t* evm, uint64_t val);
 
-int     evm_stack_get_ref(evm_t* evm, uint8_t pos, uint8_t** dst);
 int     evm_stack_pop(evm_t* evm, uint8_t* dst, uint8_t len);
+int     evm_stack_pop_word(evm_t* evm, evm_word_t* dst);
 int     evm_stack_pop_ref(evm_t* evm, uint8_t** dst);
 int     evm_stack_pop_byte(evm_t* evm, uint8_t* dst);
 int32_t evm_stack_pop_int(evm_t* evm);
@@ -288,7 +335,7 @@ int evm_sub_call(evm_t*   parent,
 
 int  evm_ensure_memory(evm_t* evm, uint32_t max_pos);
 int  in3_get_env(void* evm_ptr, uint16_t evm_key, uint8_t* in_data, int in_len, uint8_t** out_data, int offset, int len);
-int  evm_call(void*    vc,
+int  evm_call(void*    env,
               uint8_t  address[20],
               uint8_t* value, wlen_t l_value,
               uint8_t* data, uint32_t l_data,
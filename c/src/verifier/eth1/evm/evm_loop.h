@@ -0,0 +1,215 @@
+/*******************************************************************************
+ * This file is part of the Incubed project.
+ * Sources: https://github.com/slockit/in3-c
+ * 
+ * Copyright (C) 2018-2020 slock.it GmbH, Blockchains LLC
+ * 
+ * 
+ * COMMERCIAL LICENSE USAGE
+ * 
+ * Licensees holding a valid commercial license may use this file in accordance 
+ * with the commercial license agreement provided with the Software or, alternatively, 
+ * in accordance with the terms contained in a written agreement between you and 
+ * slock.it GmbH/Blockchains LLC. For licensing terms and conditions or further 
+ * information please contact slock.it at in3@slock.it.
+ * 	
+ * Alternatively, this file may be used under the AGPL license as follows:
+ *    
+ * AGPL LICENSE USAGE
+ * 
+ * This program is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Affero General Public License as published by the Free Software 
+ * Foundation, either version 3 of the License, or (at your option) any later version.
+ *  
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY 
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A 
+ * PARTICULAR PURPOSE. See the GNU Affero General Public License for more details.
+ * [Permissions of this strong copyleft license are conditioned on making available 
+ * complete source code of licensed works and modifications, which include larger 
+ * works using a licensed work, under the same license. Copyright and license notices 
+ * must be preserved. Contributors provide an express grant of patent rights.]
+ * You should have received a copy of the GNU Affero General Public License along 
+ * with this program. If not, see <https://www.gnu.org/licenses/>.
+ *******************************************************************************/
+
+/** @file
+ * the interpreter loop executing a decoded program.
+ * 
+ * This file is included by evm.c once for each variant of the loop. Before including it, `EVM_LOOP_NAME` must be defined
+ * as the name of the function and `EVM_LOOP_GAS` if the loop should meter the gas of the blocks.
+ * This way the loop for calls without metering does not even check the gas, while the metered loop stays exact.
+ * */
+
+#ifdef EVM_LOOP_GAS
+/** charges the static gas of the block starting at the current instruction. */
+#define CHARGE_BLOCK() charge_gas(ip->block_gas)
+/** charges the block entered by a jump or after a generic instruction. A JUMPDEST charges its block itself, since it may also be reached by simply continuing. */
+#define ENTER_BLOCK() \
+  if (ip->handler != EVM_H_JUMPDEST) CHARGE_BLOCK()
+#else
+#define CHARGE_BLOCK()
+#define ENTER_BLOCK()
+#endif
+
+/**
+ * executes the decoded program starting at evm->pos.
+ * 
+ * The frequently used opcodes are executed directly, all others are passed to `evm_execute`.
+ * Since the gas is charged by returning directly, this function must not own any resources.
+ */
+static int EVM_LOOP_NAME(evm_t* evm, const evm_program_t* program) {
+  const evm_instr_t* ip      = program->instr + evm->pos;
+  uint32_t           timeout = 0xFFFFFFFF; // timeout is simply used in case we don't use gas to make sure we don't run a infite loop.
+  int                res     = 0;
+#if defined(DEBUG) && defined(EVM_GAS)
+  uint32_t last     = evm->pos;
+  uint64_t last_gas = KEEP_TRACK_GAS(evm);
+#endif
+
+  // the first instruction starts a block
+  ENTER_BLOCK();
+
+#ifdef EVM_COMPUTED_GOTO
+  // must be in the same order as evm_handler_t
+  static const void* const handlers[] = {
+      &&L_EVM_H_GENERIC, &&L_EVM_H_STOP, &&L_EVM_H_PUSH, &&L_EVM_H_DUP, &&L_EVM_H_SWAP, &&L_EVM_H_POP,
+      &&L_EVM_H_MATH, &&L_EVM_H_MATH_MOD, &&L_EVM_H_SIGNEXTEND, &&L_EVM_H_CMP, &&L_EVM_H_ISZERO, &&L_EVM_H_BIT,
+      &&L_EVM_H_NOT, &&L_EVM_H_BYTE, &&L_EVM_H_SHIFT, &&L_EVM_H_MLOAD, &&L_EVM_H_MSTORE, &&L_EVM_H_JUMP,
+      &&L_EVM_H_JUMPDEST, &&L_EVM_H_PC};
+  DISPATCH();
+#else
+  for (;;) {
+    switch ((evm_handler_t) ip->handler) {
+#endif
+
+  HANDLER(EVM_H_GENERIC) {
+    evm->pos = ip - program->instr;
+    res      = evm_execute(evm);
+    ip++;
+    NEXT_BLOCK();
+  }
+  HANDLER(EVM_H_STOP) {
+    evm->state = EVM_STATE_STOPPED;
+    return 0;
+  }
+  HANDLER(EVM_H_PUSH) {
+    res = evm_stack_push_word(evm, program->words + ip->word);
+    ip += ip->size;
+    NEXT();
+  }
+  // DUP, SWAP and POP only move words on the stack, so they are done here instead of calling op_dup, op_swap or evm_stack_pop.
+  HANDLER(EVM_H_DUP) {
+    if (evm->stack_size < ip->arg)
+      res = EVM_ERROR_EMPTY_STACK;
+    else if (evm->stack_size == EVM_STACK_LIMIT)
+      res = EVM_ERROR_STACK_LIMIT;
+    else {
+      evm->stack[evm->stack_size] = evm->stack[evm->stack_size - ip->arg];
+      evm->stack_size++;
+    }
+    ip++;
+    NEXT();
+  }
+  HANDLER(EVM_H_SWAP) {
+    if (evm->stack_size < ip->arg)
+      res = EVM_ERROR_EMPTY_STACK;
+    else {
+      evm_word_t* a = evm->stack + evm->stack_size - 1;
+      evm_word_t* b = evm->stack + evm->stack_size - ip->arg;
+      evm_word_t  t = *a;
+      *a            = *b;
+      *b            = t;
+    }
+    ip++;
+    NEXT();
+  }
+  HANDLER(EVM_H_POP) {
+    if (evm->stack_size == 0)
+      res = EVM_ERROR_EMPTY_STACK;
+    else
+      evm->stack_size--;
+    ip++;
+    NEXT();
+  }
+  HANDLER(EVM_H_MATH) {
+    res = op_math(evm, ip->arg, 0);
+    ip++;
+    NEXT();
+  }
+  HANDLER(EVM_H_MATH_MOD) {
+    res = op_math(evm, ip->arg, 1);
+    ip++;
+    NEXT();
+  }
+  HANDLER(EVM_H_SIGNEXTEND) {
+    res = op_signextend(evm);
+    ip++;
+    NEXT();
+  }
+  HANDLER(EVM_H_CMP) {
+    res = op_cmp(evm, (int8_t)(ip->arg & 3) - 1, ip->arg >> 2);
+    ip++;
+    NEXT();
+  }
+  HANDLER(EVM_H_ISZERO) {
+    res = op_is_zero(evm);
+    ip++;
+    NEXT();
+  }
+  HANDLER(EVM_H_BIT) {
+    res = op_bit(evm, ip->arg);
+    ip++;
+    NEXT();
+  }
+  HANDLER(EVM_H_NOT) {
+    res = op_not(evm);
+    ip++;
+    NEXT();
+  }
+  HANDLER(EVM_H_BYTE) {
+    res = op_byte(evm);
+    ip++;
+    NEXT();
+  }
+  HANDLER(EVM_H_SHIFT) {
+    res = op_shift(evm, ip->arg);
+    ip++;
+    NEXT();
+  }
+  HANDLER(EVM_H_MLOAD) {
+    res = op_mload(evm);
+    ip++;
+    NEXT();
+  }
+  HANDLER(EVM_H_MSTORE) {
+    res = op_mstore(evm, ip->arg);
+    ip++;
+    NEXT();
+  }
+  HANDLER(EVM_H_JUMP) {
+    evm->pos = ip - program->instr + 1;
+    res      = op_jump(evm, ip->arg);
+    ip       = program->instr + evm->pos;
+    NEXT_BLOCK();
+  }
+  HANDLER(EVM_H_JUMPDEST) {
+    CHARGE_BLOCK();
+    ip++;
+    NEXT();
+  }
+  HANDLER(EVM_H_PC) {
+    res = evm_stack_push_int(evm, ip - program->instr);
+    ip++;
+    NEXT();
+  }
+
+#ifndef EVM_COMPUTED_GOTO
+    }
+  }
+#endif
+}
+
+#undef CHARGE_BLOCK
+#undef ENTER_BLOCK
+#undef EVM_LOOP_NAME
+#undef EVM_LOOP_GAS
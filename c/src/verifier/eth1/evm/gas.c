@@ -43,15 +43,19 @@ void init_gas(evm_t* evm) {
 
 void update_account_code(evm_t* evm, account_t* new_account) {
   // prepare evm gas
-  if (new_account)
+  if (new_account) {
+    evm_journal_code(evm, new_account);
     new_account->code = evm->return_data;
+  }
 }
 
 void evm_init(evm_t* evm) {
   evm->accounts = NULL;
+  memset(&evm->index, 0, sizeof(evm_index_t));
   evm->gas      = 0;
   evm->logs     = NULL;
   evm->parent   = NULL;
+  evm->root     = NULL;
   evm->refund   = 0;
   evm->init_gas = 0;
 }
@@ -70,9 +74,11 @@ void finalize_and_refund_gas(evm_t* evm) {
 }
 
 void finalize_subcall_gas(evm_t* evm, int success, evm_t* parent) {
-  // if it was successfull we copy the new state to the parent
+  // if it was successfull we keep the changes of the state, otherwise they are reverted
   if ((success == 0 || success == EVM_ERROR_SUCCESS_CONSUME_GAS) && evm->state != EVM_STATE_REVERTED)
-    copy_state(parent, evm);
+    evm_commit(parent, evm);
+  else
+    evm_revert(parent, evm->checkpoint);
   // if we have gas left and it was successfull we returen it to the parent process.
   if (success == 0 || success == EVM_ERROR_SUCCESS_CONSUME_GAS) parent->gas += evm->gas;
 }
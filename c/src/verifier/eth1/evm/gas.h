@@ -43,7 +43,8 @@
 #include "evm.h"
 
 #ifdef EVM_GAS
-#define subgas(g)                  \
+/** charges the gas or returns EVM_ERROR_OUT_OF_GAS, even if EVM_PROP_NO_GAS is set */
+#define charge_gas(g)              \
   {                                \
     uint64_t gas = (g);            \
     if (evm->gas < gas)            \
@@ -51,6 +52,12 @@
     else                           \
       evm->gas -= gas;             \
   }
+/** charges the gas unless the gas is not metered for this call */
+#define subgas(g)                                 \
+  {                                               \
+    if ((evm->properties & EVM_PROP_NO_GAS) == 0) \
+      charge_gas(g)                               \
+  }
 #define op_exec(m, gc)   \
   {                      \
     subgas(gc) return m; \
@@ -145,6 +152,8 @@ void update_account_code(evm_t* evm, account_t* new_account);
 #define UPDATE_SUBCALL_GAS(evm, parent, address, code_address, caller, gas, mode, value, l_value)          \
   do {                                                                                                     \
     evm.parent                = parent;                                                                    \
+    evm.root                  = parent->root ? parent->root : parent;                                      \
+    evm.checkpoint            = evm_checkpoint(parent);                                                    \
     uint64_t max_gas_provided = parent->gas - (parent->gas >> 6);                                          \
     if (!address) {                                                                                        \
       new_account = evm_create_account(&evm, evm.call_data.data, evm.call_data.len, code_address, caller); \
@@ -49,7 +49,61 @@
 #include <stdio.h>
 #include <string.h>
 
+#ifdef EVM_FAST_MATH
 int op_math(evm_t* evm, uint8_t op, uint8_t mod) {
+  evm_word_t *a = evm_stack_peek(evm, 1), *b = evm_stack_peek(evm, 2), *m = mod ? evm_stack_peek(evm, 3) : b;
+  if (!b || !m) return EVM_ERROR_EMPTY_STACK;
+  switch (op) {
+    case MATH_ADD:
+      if (mod)
+        evm_word_addmod(m, a, b, m);
+      else
+        evm_word_add(b, a, b);
+      break;
+    case MATH_SUB:
+      evm_word_sub(b, a, b);
+      break;
+    case MATH_MUL:
+      if (mod)
+        evm_word_mulmod(m, a, b, m);
+      else
+        evm_word_mul(b, a, b);
+      break;
+    case MATH_DIV:
+      evm_word_divmod(b, NULL, a, b);
+      break;
+    case MATH_SDIV:
+      evm_word_sdivmod(b, NULL, a, b);
+      break;
+    case MATH_MOD:
+      evm_word_divmod(NULL, b, a, b);
+      break;
+    case MATH_SMOD:
+      evm_word_sdivmod(NULL, b, a, b);
+      break;
+    case MATH_EXP:
+      subgas((evm->properties & EVM_PROP_FRONTIER ? FRONTIER_G_EXPBYTE : G_EXPBYTE) * (evm_word_is_zero(b) ? 0 : evm_word_len(b)));
+      evm_word_exp(b, a, b);
+      break;
+    default:
+      return EVM_ERROR_INVALID_OPCODE;
+  }
+  evm->stack_size -= mod ? 2 : 1;
+  return 0;
+}
+#else
+int op_math(evm_t* evm, uint8_t op, uint8_t mod) {
+  if (!mod && (op == MATH_ADD || op == MATH_SUB)) {
+    evm_word_t *a = evm_stack_peek(evm, 1), *b = evm_stack_peek(evm, 2);
+    if (!b) return EVM_ERROR_EMPTY_STACK;
+    if (op == MATH_ADD)
+      evm_word_add(b, a, b);
+    else
+      evm_word_sub(b, a, b);
+    evm->stack_size--;
+    return 0;
+  }
+
   uint8_t *a, *b, res[65], *r = res;
   int      la = evm_stack_pop_ref(evm, &a), lb = evm_stack_pop_ref(evm, &b), l;
   if (la < 0 || lb < 0) return EVM_ERROR_EMPTY_STACK;
@@ -77,7 +131,7 @@ int op_math(evm_t* evm, uint8_t op, uint8_t mod) {
       break;
     case MATH_EXP:
       l = big_exp(a, la, b, lb, res);
-      subgas((evm->properties & EVM_PROP_FRONTIER ? FRONTIER_G_EXPBYTE : G_EXPBYTE) * big_log256(b, lb));
+      subgas((evm->properties & EVM_PROP_FRONTIER ? FRONTIER_G_EXPBYTE : G_EXPBYTE) * (lb == 1 && !*b ? 0 : lb));
       break;
     default:
       return EVM_ERROR_INVALID_OPCODE;
@@ -102,177 +156,89 @@ int op_math(evm_t* evm, uint8_t op, uint8_t mod) {
 
   return evm_stack_push(evm, r, l);
 }
+#endif
 
 int op_signextend(evm_t* evm) {
-  uint8_t* val = NULL;
-  int32_t  k   = evm_stack_pop_int(evm), l;
-
+  int32_t k = evm_stack_pop_int(evm);
   if (k < 0) return k;
-  if (k > 31) return 0;
-  if ((l = evm_stack_pop_ref(evm, &val)) < 0) return l;
-
-  //  uint8_t bit_set = l>k ? val[l-k-1] & 128 :0
-  bool    bitset = l > k && val[l - k - 1] & 128;
-  uint8_t tmp[32], tmp2[32];
-  memset(tmp2, 0, 32);
-  memcpy(tmp2, val, l);
-  val = tmp2;
-  if (k < 31)
-    memset(tmp, bitset ? 0xFF : 0, 31 - k);
-  memcpy(tmp + 31 - k, val + l - k - 1, k + 1);
-  val = tmp;
-  l   = 32;
-  optimize_len(val, l);
-  return evm_stack_push(evm, val, l);
+  if (k > 30) return 0; // the value already uses all 32 bytes
+
+  evm_word_t* val = evm_stack_peek(evm, 1);
+  if (!val) return EVM_ERROR_EMPTY_STACK;
+  const unsigned int bit  = k * 8 + 7, limb = bit >> 6, shift = bit & 63;
+  const uint64_t     mask = shift == 63 ? 0 : (~(uint64_t) 0) << (shift + 1); // the bits above the sign bit within its limb
+  const bool         neg  = (val->n[limb] >> shift) & 1;
+  val->n[limb]            = neg ? val->n[limb] | mask : val->n[limb] & ~mask;
+  for (unsigned int i = limb + 1; i < 4; i++) val->n[i] = neg ? ~(uint64_t) 0 : 0;
+  return 0;
 }
 
 int op_is_zero(evm_t* evm) {
-  uint8_t res = 1, *a;
-  int     l   = evm_stack_pop_ref(evm, &a), i;
-  if (l < 0) return l;
-  for (i = 0; i < l; i++) {
-    if (a[i]) {
-      res = 0;
-      break;
-    }
-  }
-  // push result to stack
-  return evm_stack_push(evm, &res, 1);
+  evm_word_t* a = evm_stack_peek(evm, 1);
+  if (!a) return EVM_ERROR_EMPTY_STACK;
+  evm_word_set_u64(a, evm_word_is_zero(a));
+  return 0;
 }
 
 int op_not(evm_t* evm) {
-  uint8_t res[32], *a;
-  int     l = evm_stack_pop_ref(evm, &a), i;
-  if (l < 0) return l;
-  if (l < 32) memset(res, 0, 32 - l);
-  memcpy(res + 32 - l, a, l);
-
-  for (i = 0; i < 32; i++) res[i] ^= 0xFF;
-
-  a = res;
-  l = 32;
-  optimize_len(a, l);
-
-  // push result to stack
-  return evm_stack_push(evm, a, l);
+  evm_word_t* a = evm_stack_peek(evm, 1);
+  if (!a) return EVM_ERROR_EMPTY_STACK;
+  for (int i = 0; i < 4; i++) a->n[i] = ~a->n[i];
+  return 0;
 }
 
 int op_bit(evm_t* evm, uint8_t op) {
-  uint8_t result[32], *res = result, *a;
-  int     l, l1            = evm_stack_pop_ref(evm, &a), i, j;
-  if (l1 < 0) return l1;
-  memcpy(res + 32 - l1, a, l1);
-  if (l1 < 32) memset(res, 0, 32 - l1);
-  if ((l = evm_stack_pop_ref(evm, &a)) < 0) return EVM_ERROR_EMPTY_STACK;
-  l1 = l1 > l ? l1 : l;
-  res += 32 - l1;
-
+  evm_word_t *a = evm_stack_peek(evm, 1), *b = evm_stack_peek(evm, 2);
+  if (!b) return EVM_ERROR_EMPTY_STACK;
   switch (op) {
     case OP_AND:
-      for (i = 0, j = l1 - l; i < l; i++) res[j++] &= a[i];
-      if (l < l1) memset(res, 0, l1 - l);
+      for (int i = 0; i < 4; i++) b->n[i] &= a->n[i];
       break;
     case OP_OR:
-      for (i = 0, j = l1 - l; i < l; i++) res[j++] |= a[i];
+      for (int i = 0; i < 4; i++) b->n[i] |= a->n[i];
       break;
     case OP_XOR:
-      for (i = 0, j = l1 - l; i < l; i++) res[j++] ^= a[i];
+      for (int i = 0; i < 4; i++) b->n[i] ^= a->n[i];
       break;
     default:
       return -1;
   }
-
-  optimize_len(res, l1);
-
-  // push result to stack
-  return evm_stack_push(evm, res, l1);
+  evm->stack_size--;
+  return 0;
 }
 
 int op_byte(evm_t* evm) {
-  uint8_t pos, *b, res = 0xFF;
-  int     l = evm_stack_pop_byte(evm, &pos);
-  if (l == EVM_ERROR_EMPTY_STACK) return l;
-  if (l < 0 || (pos & 0xE0)) res = 0;
-  if ((l = evm_stack_pop_ref(evm, &b)) < 0) return EVM_ERROR_EMPTY_STACK;
-  if (res) res = pos >= (32 - l) ? b[pos + l - 32] : 0;
-  return evm_stack_push(evm, &res, 1);
+  evm_word_t *pos = evm_stack_peek(evm, 1), *val = evm_stack_peek(evm, 2);
+  if (!val) return EVM_ERROR_EMPTY_STACK;
+  uint64_t res = 0;
+  // pos counts the bytes from the most significant one
+  if (evm_word_is_u64(pos) && pos->n[0] < 32) res = (val->n[3 - (pos->n[0] >> 3)] >> ((7 - (pos->n[0] & 7)) << 3)) & 0xFF;
+  evm_word_set_u64(val, res);
+  evm->stack_size--;
+  return 0;
 }
 
 int op_cmp(evm_t* evm, int8_t eq, uint8_t sig) {
-  uint8_t *a, *b, res = 0, sig_a = 0, sig_b = 0;
-  int      len_a, len_b;
-  // try fetch the 2 values from the stack
-  if ((len_a = evm_stack_pop_ref(evm, &a)) < 0 || (len_b = evm_stack_pop_ref(evm, &b)) < 0) return EVM_ERROR_EMPTY_STACK;
-
-  // if it is signed,. we store the sign and convert it to unsigned.
-  if (sig) {
-    sig_a = big_signed(a, len_a, a);
-    sig_b = big_signed(b, len_b, b);
-  }
-
-  // compare the value
-  switch (eq) {
-    case -1:
-      res = big_cmp(a, len_a, b, len_b) < 0;
-      break;
-    case 0:
-      res = big_cmp(a, len_a, b, len_b) == 0;
-      break;
-    case 1:
-      res = big_cmp(a, len_a, b, len_b) > 0;
-      break;
-  }
-
-  // if it is signed we check check the sign and change the result if the sign changes.
-  if (sig && eq) {
-    if (sig_a && sig_b)
-      res ^= 1;
-    else if (sig_a || sig_b)
-      res = eq < 0 ? sig_a : sig_b;
-  }
-
-  // push result to stack
-  return evm_stack_push(evm, &res, 1);
+  evm_word_t *a = evm_stack_peek(evm, 1), *b = evm_stack_peek(evm, 2);
+  if (!b) return EVM_ERROR_EMPTY_STACK;
+  evm_word_set_u64(b, (sig ? evm_word_scmp(a, b) : evm_word_cmp(a, b)) == eq);
+  evm->stack_size--;
+  return 0;
 }
 
 int op_shift(evm_t* evm, uint8_t left) {
-  uint8_t pos, *b, res[32];
-  int     l;
   if ((evm->properties & EVM_PROP_CONSTANTINOPL) == 0) return EVM_ERROR_INVALID_OPCODE;
-  l = evm_stack_pop_byte(evm, &pos);
-  if (l == EVM_ERROR_EMPTY_STACK) return l;
-  if (l < 0) { // the number is out of range
-    if ((l = evm_stack_pop_ref(evm, &b)) < 0) return EVM_ERROR_EMPTY_STACK;
-    if (left == 2 && l == 32 && (*b & 128)) { //signed number return max NUMBER as fault
-      memset(res, 0xFF, 32);
-      return evm_stack_push(evm, res, 32);
-    } else {
-      res[0] = 0;
-      return evm_stack_push(evm, res, 1);
-    }
-  }
-
-  if ((l = evm_stack_pop_ref(evm, &b)) < 0) return EVM_ERROR_EMPTY_STACK;
-  memmove(res + 32 - l, b, l);
-  if (l < 32) memset(res, 0, 32 - l);
-  if (left == 1)
-    big_shift_left(res, 32, pos);
-  else if (left == 0)
-    big_shift_right(res, 32, pos);
-  else if (left == 2) { // signed shift right
-    big_shift_right(res, 32, pos);
-    if (l == 32 && (*b & 128)) { // the original number was signed
-      for (l = 0; l < (pos >> 3); l++) res[l] = 0xFF;
-      l = 8 - (pos % 8);
-      res[pos >> 3] |= (0XFF >> l) << l;
-      return evm_stack_push(evm, res, 32);
-    }
-  }
-
-  b   = res;
-  pos = 32;
-  optimize_len(b, pos);
-  return evm_stack_push(evm, b, pos);
+  evm_word_t *shift = evm_stack_peek(evm, 1), *val = evm_stack_peek(evm, 2);
+  if (!val) return EVM_ERROR_EMPTY_STACK;
+  const bool fill = left == 2 && evm_word_is_negative(val); // signed shift right of a negative number
+  if (!evm_word_is_u64(shift) || shift->n[0] > 255)
+    memset(val, fill ? 0xFF : 0, sizeof(evm_word_t));
+  else if (left == 1)
+    evm_word_shl(val, val, shift->n[0]);
+  else
+    evm_word_shr(val, val, shift->n[0], fill);
+  evm->stack_size--;
+  return 0;
 }
 
 int op_sha3(evm_t* evm) {
@@ -313,11 +279,12 @@ int op_sha3(evm_t* evm) {
 
 int op_account(evm_t* evm, uint8_t key) {
   if ((evm->properties & EVM_PROP_CONSTANTINOPL) == 0 && key == EVM_ENV_CODE_HASH) return EVM_ERROR_UNSUPPORTED_CALL_OPCODE;
-  uint8_t *address, *data;
-  int      l = evm_stack_pop_ref(evm, &address);
+  address_t address;
+  uint8_t*  data;
+  int       l = evm_stack_pop(evm, address, 20);
   if (l < 0) return EVM_ERROR_EMPTY_STACK;
   OP_ACCOUNT_GAS(evm, key, address, data, l);
-  l = evm->env(evm, key, address, l, &data, 0, 0);
+  l = evm->env(evm, key, address, 20, &data, 0, 0);
   return l < 0 ? l : evm_stack_push(evm, data, l);
 }
 int op_dataload(evm_t* evm) {
@@ -382,31 +349,22 @@ int op_header(evm_t* evm, uint8_t index) {
 }
 
 int op_mload(evm_t* evm) {
-  uint8_t *off, *dst;
+  uint8_t *off, data[32];
   int      off_len = evm_stack_pop_ref(evm, &off);
   if (off_len < 0) return off_len;
 
   uint8_t tmp[32] = {0};
   memcpy(tmp + 32 - off_len, off, off_len);
-  if (evm_stack_push_ref(evm, &dst, 32)) return EVM_ERROR_ILLEGAL_MEMORY_ACCESS;
-  return evm_mem_read(evm, bytes(tmp, 32), dst, 32);
+  int res = evm_mem_read(evm, bytes(tmp, 32), data, 32);
+  return res < 0 ? res : evm_stack_push(evm, data, 32);
 }
 
 int op_mstore(evm_t* evm, uint8_t len) {
   int offset = evm_stack_pop_int(evm);
   if (offset < 0) return offset;
-  uint8_t* data     = NULL;
-  int      data_len = evm_stack_pop_ref(evm, &data);
-
-  if (data_len < 0) return data_len;
-
-  if (len == 32) {
-    uint8_t tmp[32];
-    memset(tmp, 0, 32);
-    memcpy(tmp + 32 - data_len, data, data_len);
-    return evm_mem_write(evm, offset, bytes(tmp, 32), len);
-  }
-  return evm_mem_write(evm, offset, bytes(data, data_len), len);
+  uint8_t data[32];
+  if (evm_stack_pop(evm, data, 32) < 0) return EVM_ERROR_EMPTY_STACK;
+  return evm_mem_write(evm, offset, bytes(data + 32 - len, len), len);
 }
 
 int op_sload(evm_t* evm) {
@@ -427,36 +385,7 @@ int op_jump(evm_t* evm, uint8_t cond) {
     if (ret == EVM_ERROR_EMPTY_STACK) return EVM_ERROR_EMPTY_STACK;
     if (!c && ret >= 0) return 0; // the condition was false
   }
-  if ((uint32_t) pos > evm->code.len || evm->code.data[pos] != 0x5B) return EVM_ERROR_INVALID_JUMPDEST;
-
-  // check if this is a invalid jumpdest
-  if (evm->invalid_jumpdest == NULL) {
-    uint32_t size = 8, p = 0, *list = _malloc(8 * sizeof(uint32_t)), i, cl = evm->code.len;
-    uint8_t  op, jumpl = 0;
-    for (i = 0; i < cl; i++) {
-      op = evm->code.data[i];
-      if (jumpl) {
-        if (op == 0x5B) {
-          // add it
-          if (p == size - 2) {
-            list = _realloc(list, (size + 8) * sizeof(uint32_t), size * sizeof(uint32_t));
-            size = size + 8;
-          }
-          list[p++] = i;
-        }
-        jumpl--;
-      } else if (op >= 0x60 && op <= 0x7F) // PUSH
-        jumpl = op - 0x5F;
-    }
-    list[p]               = 0xFFFFFFFF;
-    evm->invalid_jumpdest = list;
-  }
-
-  // check if our dest contains the pos as invalid
-  for (int i = 0;; i++) {
-    if (evm->invalid_jumpdest[i] == 0xFFFFFFFF) break;
-    if (evm->invalid_jumpdest[i] == (uint32_t) pos) return EVM_ERROR_INVALID_JUMPDEST;
-  }
+  if (!evm_program_is_jumpdest(evm->program, pos)) return EVM_ERROR_INVALID_JUMPDEST;
 
   evm->pos = pos;
   return 0;
@@ -477,33 +406,17 @@ int op_push(evm_t* evm, wlen_t len) {
 }
 
 int op_dup(evm_t* evm, uint8_t pos) {
-  uint8_t* data = NULL;
-  int      l    = evm_stack_get_ref(evm, pos, &data);
-  if (l < 0) return l;
-  return evm_stack_push(evm, data, l);
+  evm_word_t* w = evm_stack_peek(evm, pos);
+  if (!w) return EVM_ERROR_EMPTY_STACK;
+  return evm_stack_push_word(evm, w);
 }
 
 int op_swap(evm_t* evm, uint8_t pos) {
-  uint8_t data[33], *a, *b;
-  int     l1 = evm_stack_get_ref(evm, 1, &a);
-  if (l1 < 0) return l1;
-  int l2 = evm_stack_get_ref(evm, pos, &b);
-  if (l2 < 0) return l2;
-  if (l1 == l2) {
-    memcpy(data, a, l1);
-    memcpy(a, b, l1);
-    memcpy(b, data, l1);
-  } else if (l2 > l1) {
-    memcpy(data, b, l2 + 1); // keep old b + len
-    memcpy(b, a, l1 + 1);
-    if (pos > 2) memmove(b + l1 + 1, b + l2 + 1, a - b - l2 - 1);
-    memcpy(a + l1 - l2, data, l2 + 1);
-  } else {
-    memcpy(data, a, l1 + 1); // keep old b + len
-    memcpy(a + l1 - l2, b, l2 + 1);
-    if (pos > 2) memmove(b + l1 + 1, b + l2 + 1, a - b - l2 - 1);
-    memcpy(b, data, l1 + 1);
-  }
+  evm_word_t *a = evm_stack_peek(evm, 1), *b = evm_stack_peek(evm, pos);
+  if (!b) return EVM_ERROR_EMPTY_STACK;
+  evm_word_t tmp = *a;
+  *a             = *b;
+  *b             = tmp;
   return 0;
 }
 
@@ -535,7 +448,8 @@ int op_call(evm_t* evm, uint8_t mode) {
   if ((out_len = evm_stack_pop_int(evm)) < 0) return out_len;
   uint64_t gas = bytes_to_long(gas_limit, l_gas);
 
-  if ((out_len > 0 && mem_check(evm, out_offset + out_len, true) < 0) || (in_len && mem_check(evm, in_offset + in_len, true) < 0)) return EVM_ERROR_ILLEGAL_MEMORY_ACCESS;
+  // the input is passed as pointer into the memory, so it must be allocated and not only be counted.
+  if ((out_len > 0 && mem_check(evm, out_offset + out_len, true) < 0) || (in_len && mem_check(evm, in_offset + in_len, false) < 0)) return EVM_ERROR_ILLEGAL_MEMORY_ACCESS;
 
   switch (mode) {
     case CALL_CALL:
@@ -637,14 +551,15 @@ int op_selfdestruct(evm_t* evm) {
     }
     if (transfer_value(evm, evm->address, adr, self_account->balance, 32, 0) < 0) return EVM_ERROR_OUT_OF_GAS;
   }
+  evm_journal_value(evm, self_account->balance);
+  evm_journal_value(evm, self_account->nonce);
+  evm_journal_code(evm, self_account);
   memset(self_account->balance, 0, 32);
   memset(self_account->nonce, 0, 32);
   self_account->code.len = 0;
-  storage_t* s           = NULL;
-  while (self_account->storage) {
-    s                     = self_account->storage;
-    self_account->storage = s->next;
-    _free(s);
+  for (storage_t* s = self_account->storage; s; s = s->next) {
+    evm_journal_value(evm, s->value);
+    memset(s->value, 0, 32);
   }
   evm->state = EVM_STATE_STOPPED;
   return 0;
@@ -749,6 +664,7 @@ int op_sstore(evm_t* evm) {
     }
   }
 
+  evm_journal_value(evm, s->value);
   uint256_set(value, l_val, s->value);
   return 0;
 }
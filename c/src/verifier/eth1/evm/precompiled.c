@@ -196,6 +196,8 @@ int evm_run_precompiled(evm_t* evm, const address_t address) {
       return pre_ec_add(evm);
     case 7:
       return pre_ec_mul(evm);
+    case 8:
+      return pre_ec_pairing(evm);
     case 9:
       return pre_blake2(evm);
     default:
@@ -42,6 +42,7 @@ uint8_t evm_is_precompiled(evm_t* evm, uint8_t address[20]);
 
 int pre_ec_add(evm_t* evm);
 int pre_ec_mul(evm_t* evm);
+int pre_ec_pairing(evm_t* evm);
 int pre_blake2(evm_t* evm);
 
 #endif
\ No newline at end of file
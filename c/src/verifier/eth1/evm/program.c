@@ -0,0 +1,226 @@
+/*******************************************************************************
+ * This file is part of the Incubed project.
+ * Sources: https://github.com/slockit/in3-c
+ * 
+ * Copyright (C) 2018-2020 slock.it GmbH, Blockchains LLC
+ * 
+ * 
+ * COMMERCIAL LICENSE USAGE
+ * 
+ * Licensees holding a valid commercial license may use this file in accordance 
+ * with the commercial license agreement provided with the Software or, alternatively, 
+ * in accordance with the terms contained in a written agreement between you and 
+ * slock.it GmbH/Blockchains LLC. For licensing terms and conditions or further 
+ * information please contact slock.it at in3@slock.it.
+ * 	
+ * Alternatively, this file may be used under the AGPL license as follows:
+ *    
+ * AGPL LICENSE USAGE
+ * 
+ * This program is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Affero General Public License as published by the Free Software 
+ * Foundation, either version 3 of the License, or (at your option) any later version.
+ *  
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY 
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A 
+ * PARTICULAR PURPOSE. See the GNU Affero General Public License for more details.
+ * [Permissions of this strong copyleft license are conditioned on making available 
+ * complete source code of licensed works and modifications, which include larger 
+ * works using a licensed work, under the same license. Copyright and license notices 
+ * must be preserved. Contributors provide an express grant of patent rights.]
+ * You should have received a copy of the GNU Affero General Public License along 
+ * with this program. If not, see <https://www.gnu.org/licenses/>.
+ *******************************************************************************/
+
+#include "program.h"
+#include "../../../core/util/mem.h"
+#include "../../../core/util/utils.h"
+#include "evm.h"
+#include "gas.h"
+#include <string.h>
+
+/** FNV-1a of the code, which is only used to find the candidates in the cache. */
+static uint64_t code_hash(bytes_t code) {
+  uint64_t h = 14695981039346656037ull;
+  for (uint32_t i = 0; i < code.len; i++) h = (h ^ code.data[i]) * 1099511628211ull;
+  return h;
+}
+
+static void set_instr(evm_instr_t* in, evm_handler_t handler, uint8_t arg, uint8_t gas) {
+  in->handler = handler;
+  in->arg     = arg;
+  in->gas     = gas;
+}
+
+/** maps the opcode to its handler. Opcodes without a handler of their own stay EVM_H_GENERIC. */
+static void decode_op(evm_instr_t* in, uint8_t op) {
+  if (op >= 0x80 && op <= 0x8F)
+    set_instr(in, EVM_H_DUP, op - 0x7F, G_VERY_LOW);
+  else if (op >= 0x90 && op <= 0x9F)
+    set_instr(in, EVM_H_SWAP, op - 0x8E, G_VERY_LOW);
+  else
+    switch (op) {
+      case 0x00: set_instr(in, EVM_H_STOP, 0, 0); break;
+      case 0x01: set_instr(in, EVM_H_MATH, MATH_ADD, G_VERY_LOW); break;
+      case 0x02: set_instr(in, EVM_H_MATH, MATH_MUL, G_LOW); break;
+      case 0x03: set_instr(in, EVM_H_MATH, MATH_SUB, G_VERY_LOW); break;
+      case 0x04: set_instr(in, EVM_H_MATH, MATH_DIV, G_LOW); break;
+      case 0x05: set_instr(in, EVM_H_MATH, MATH_SDIV, G_LOW); break;
+      case 0x06: set_instr(in, EVM_H_MATH, MATH_MOD, G_LOW); break;
+      case 0x07: set_instr(in, EVM_H_MATH, MATH_SMOD, G_LOW); break;
+      case 0x08: set_instr(in, EVM_H_MATH_MOD, MATH_ADD, G_MID); break;
+      case 0x09: set_instr(in, EVM_H_MATH_MOD, MATH_MUL, G_MID); break;
+      case 0x0A: set_instr(in, EVM_H_MATH, MATH_EXP, G_EXP); break;
+      case 0x0B: set_instr(in, EVM_H_SIGNEXTEND, 0, G_LOW); break;
+      case 0x10: set_instr(in, EVM_H_CMP, 0, G_VERY_LOW); break;     // LT  (eq=-1)
+      case 0x11: set_instr(in, EVM_H_CMP, 2, G_VERY_LOW); break;     // GT  (eq=1)
+      case 0x12: set_instr(in, EVM_H_CMP, 0 | 4, G_VERY_LOW); break; // SLT (eq=-1, signed)
+      case 0x13: set_instr(in, EVM_H_CMP, 2 | 4, G_VERY_LOW); break; // SGT (eq=1, signed)
+      case 0x14: set_instr(in, EVM_H_CMP, 1, G_VERY_LOW); break;     // EQ  (eq=0)
+      case 0x15: set_instr(in, EVM_H_ISZERO, 0, G_VERY_LOW); break;
+      case 0x16: set_instr(in, EVM_H_BIT, OP_AND, G_VERY_LOW); break;
+      case 0x17: set_instr(in, EVM_H_BIT, OP_OR, G_VERY_LOW); break;
+      case 0x18: set_instr(in, EVM_H_BIT, OP_XOR, G_VERY_LOW); break;
+      case 0x19: set_instr(in, EVM_H_NOT, 0, G_VERY_LOW); break;
+      case 0x1a: set_instr(in, EVM_H_BYTE, 0, G_VERY_LOW); break;
+      case 0x1b: set_instr(in, EVM_H_SHIFT, 1, G_VERY_LOW); break;
+      case 0x1c: set_instr(in, EVM_H_SHIFT, 0, G_VERY_LOW); break;
+      case 0x1d: set_instr(in, EVM_H_SHIFT, 2, G_VERY_LOW); break;
+      case 0x50: set_instr(in, EVM_H_POP, 0, G_BASE); break;
+      case 0x51: set_instr(in, EVM_H_MLOAD, 0, G_VERY_LOW); break;
+      case 0x52: set_instr(in, EVM_H_MSTORE, 32, G_VERY_LOW); break;
+      case 0x53: set_instr(in, EVM_H_MSTORE, 1, G_VERY_LOW); break;
+      case 0x56: set_instr(in, EVM_H_JUMP, 0, G_MID); break;
+      case 0x57: set_instr(in, EVM_H_JUMP, 1, G_HIGH); break;
+      case 0x58: set_instr(in, EVM_H_PC, 0, G_BASE); break;
+      case 0x5b: set_instr(in, EVM_H_JUMPDEST, 0, G_JUMPDEST); break;
+      default: break;
+    }
+}
+
+static evm_program_t* decode(bytes_t code) {
+  uint32_t pushes = 0;
+  for (uint32_t i = 0; i < code.len; i++) {
+    if (code.data[i] >= 0x60 && code.data[i] <= 0x7F) {
+      pushes++;
+      i += code.data[i] - 0x5F;
+    }
+  }
+
+  evm_program_t* p = _calloc(1, sizeof(evm_program_t));
+  p->code          = bytes(_malloc(code.len ? code.len : 1), code.len);
+  p->instr         = _calloc(code.len + 1, sizeof(evm_instr_t));
+  p->words         = pushes ? _malloc(pushes * sizeof(evm_word_t)) : NULL;
+  p->jumpdests     = _calloc(code.len / 8 + 1, 1);
+  p->size          = sizeof(evm_program_t) + code.len + (code.len + 1) * sizeof(evm_instr_t) + pushes * sizeof(evm_word_t) + code.len / 8 + 1;
+  memcpy(p->code.data, code.data, code.len);
+
+  uint32_t words = 0;
+  for (uint32_t i = 0; i < code.len;) {
+    evm_instr_t*  in = p->instr + i;
+    const uint8_t op = code.data[i];
+    in->size         = 1;
+    if (op >= 0x60 && op <= 0x7F) {
+      // the push data may be cut off at the end of the code, which pushes the available bytes padded with zeros.
+      uint8_t  data[32] = {0};
+      uint32_t len      = op - 0x5F;
+      memcpy(data, code.data + i + 1, min(len, code.len - i - 1));
+      evm_word_from_bytes(p->words + words, data, len);
+      set_instr(in, EVM_H_PUSH, len, G_VERY_LOW);
+      in->size = 1 + min(len, code.len - i - 1);
+      in->word = words++;
+    }
+    else {
+      decode_op(in, op);
+      if (op == 0x5B) p->jumpdests[i >> 3] |= 1 << (i & 7);
+    }
+    i += in->size;
+  }
+
+  // running off the end of the code stops the execution
+  set_instr(p->instr + code.len, EVM_H_STOP, 0, 0);
+  p->instr[code.len].size = 1;
+
+  // sum up the static gas of the blocks
+  evm_instr_t* block = NULL;
+  for (uint32_t i = 0; i < code.len; i += p->instr[i].size) {
+    evm_instr_t* in = p->instr + i;
+    if (in->handler == EVM_H_GENERIC) {
+      block = NULL;
+      continue;
+    }
+    if (!block || in->handler == EVM_H_JUMPDEST) block = in;
+    block->block_gas += in->gas;
+    if (in->handler == EVM_H_JUMP || in->handler == EVM_H_STOP) block = NULL;
+  }
+  return p;
+}
+
+static void program_free(evm_program_t* p) {
+  _free(p->code.data);
+  _free(p->instr);
+  _free(p->jumpdests);
+  if (p->words) _free(p->words);
+  _free(p);
+}
+
+/** returns the index of the least recently used program of the cache or -1 if it is empty */
+static int least_recently_used(evm_programs_t* cache) {
+  int lru = -1;
+  for (int i = 0; i < EVM_PROGRAM_CACHE_SIZE; i++) {
+    if (cache->entries[i] && (lru < 0 || cache->entries[i]->used < cache->entries[lru]->used)) lru = i;
+  }
+  return lru;
+}
+
+static void remove_program(evm_programs_t* cache, int i) {
+  cache->bytes -= cache->entries[i]->size;
+  evm_program_release(cache->entries[i]);
+  cache->entries[i] = NULL;
+}
+
+evm_program_t* evm_program_get(evm_programs_t* cache, bytes_t code) {
+  if (!cache) {
+    evm_program_t* p = decode(code);
+    p->refs          = 1;
+    return p;
+  }
+
+  const uint64_t hash = code_hash(code);
+  int            free = -1;
+  for (int i = 0; i < EVM_PROGRAM_CACHE_SIZE; i++) {
+    evm_program_t* p = cache->entries[i];
+    if (p && p->hash == hash && b_cmp(&p->code, &code)) {
+      p->used = ++cache->clock;
+      p->refs++;
+      return p;
+    }
+    if (!p && free < 0) free = i;
+  }
+
+  evm_program_t* p = decode(code);
+  p->hash          = hash;
+  p->refs          = 1;
+  if (p->size > cache->max_bytes) return p; // too big to be cached
+
+  // make room by removing the least recently used programs
+  while (free < 0 || cache->bytes + p->size > cache->max_bytes) {
+    free = least_recently_used(cache);
+    remove_program(cache, free);
+  }
+  p->used              = ++cache->clock;
+  p->refs              = 2; // the cache and the caller
+  cache->entries[free] = p;
+  cache->bytes += p->size;
+  return p;
+}
+
+void evm_program_release(evm_program_t* program) {
+  if (program && --program->refs == 0) program_free(program);
+}
+
+void evm_programs_free(evm_programs_t* cache) {
+  if (!cache) return;
+  for (int i = 0; i < EVM_PROGRAM_CACHE_SIZE; i++) evm_program_release(cache->entries[i]);
+  _free(cache);
+}
@@ -0,0 +1,140 @@
+/*******************************************************************************
+ * This file is part of the Incubed project.
+ * Sources: https://github.com/slockit/in3-c
+ * 
+ * Copyright (C) 2018-2020 slock.it GmbH, Blockchains LLC
+ * 
+ * 
+ * COMMERCIAL LICENSE USAGE
+ * 
+ * Licensees holding a valid commercial license may use this file in accordance 
+ * with the commercial license agreement provided with the Software or, alternatively, 
+ * in accordance with the terms contained in a written agreement between you and 
+ * slock.it GmbH/Blockchains LLC. For licensing terms and conditions or further 
+ * information please contact slock.it at in3@slock.it.
+ * 	
+ * Alternatively, this file may be used under the AGPL license as follows:
+ *    
+ * AGPL LICENSE USAGE
+ * 
+ * This program is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Affero General Public License as published by the Free Software 
+ * Foundation, either version 3 of the License, or (at your option) any later version.
+ *  
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY 
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A 
+ * PARTICULAR PURPOSE. See the GNU Affero General Public License for more details.
+ * [Permissions of this strong copyleft license are conditioned on making available 
+ * complete source code of licensed works and modifications, which include larger 
+ * works using a licensed work, under the same license. Copyright and license notices 
+ * must be preserved. Contributors provide an express grant of patent rights.]
+ * You should have received a copy of the GNU Affero General Public License along 
+ * with this program. If not, see <https://www.gnu.org/licenses/>.
+ *******************************************************************************/
+
+/** @file
+ * pre-decoded evm code.
+ * 
+ * Before the code is executed, it is decoded once into an array of instructions with one entry for each byte of the code.
+ * This way the position in the code is also the index of the instruction, so jumps need no lookup.
+ * The values of all PUSH instructions are converted to words and the frequently used opcodes are mapped to handlers,
+ * which are executed directly by the interpreter loop in evm.c. All other opcodes are executed by `evm_execute`.
+ * 
+ * Decoding also marks all valid jump destinations in a bitmap, so checking a jump is a single bit test.
+ * 
+ * The instructions executed by the loop are grouped into basic blocks. A block starts at a JUMPDEST, after a JUMP or JUMPI
+ * or after an instruction executed by `evm_execute` and ends with a JUMP, JUMPI or STOP or before the next JUMPDEST or
+ * generic instruction. The static gas of all instructions of a block is summed up and charged once when entering the block,
+ * while dynamic costs (like memory expansion or the bytes of EXP) are still charged by the instructions.
+ * Generic instructions are never part of a block and charge their own gas, so instructions like GAS or CALL always see the exact gas left.
+ * 
+ * Since decoding the same contract again and again would be a waste, programs are kept in a small cache (per chain),
+ * which is identified by the content of the code. Because each byte of code takes a full instruction, the cache is limited
+ * by the number of programs and by the memory they use (`maxCodeCache` of the client).
+ * */
+
+#ifndef evm_program_h__
+#define evm_program_h__
+
+#include "../../../core/util/bytes.h"
+#include "word.h"
+
+#define EVM_PROGRAM_CACHE_SIZE 16         /**< max number of decoded programs kept in the cache */
+#define EVM_PROGRAM_CACHE_BYTES 0x100000 /**< max memory used by the cached programs, if the client does not set `maxCodeCache` */
+
+/** the handler of an instruction. The order must match the dispatch table in evm.c */
+typedef enum {
+  EVM_H_GENERIC = 0, /**< executed by evm_execute */
+  EVM_H_STOP,        /**< STOP or the end of the code */
+  EVM_H_PUSH,        /**< PUSH1-32, arg is the number of bytes */
+  EVM_H_DUP,         /**< DUP1-16, arg is the position to copy */
+  EVM_H_SWAP,        /**< SWAP1-16, arg is the position to swap with the top */
+  EVM_H_POP,         /**< POP */
+  EVM_H_MATH,        /**< arithmetic, arg is the MATH_* operation */
+  EVM_H_MATH_MOD,    /**< ADDMOD and MULMOD, arg is the MATH_* operation */
+  EVM_H_SIGNEXTEND,  /**< SIGNEXTEND */
+  EVM_H_CMP,         /**< LT, GT, SLT, SGT, EQ with arg = (eq + 1) | (signed << 2) */
+  EVM_H_ISZERO,      /**< ISZERO */
+  EVM_H_BIT,         /**< AND, OR, XOR, arg is the OP_* operation */
+  EVM_H_NOT,         /**< NOT */
+  EVM_H_BYTE,        /**< BYTE */
+  EVM_H_SHIFT,       /**< SHL (1), SHR (0), SAR (2) */
+  EVM_H_MLOAD,       /**< MLOAD */
+  EVM_H_MSTORE,      /**< MSTORE and MSTORE8, arg is the number of bytes */
+  EVM_H_JUMP,        /**< JUMP and JUMPI, arg is set for JUMPI */
+  EVM_H_JUMPDEST,    /**< JUMPDEST */
+  EVM_H_PC           /**< PC */
+} evm_handler_t;
+
+/** a decoded instruction */
+typedef struct {
+  uint8_t  handler; /**< the evm_handler_t */
+  uint8_t  arg;     /**< the argument for the handler */
+  uint8_t  size;    /**< number of bytes of the instruction including the push data */
+  uint8_t  gas;       /**< the static gas costs of the instruction */
+  uint32_t word;      /**< for PUSH, the index of the value in the words */
+  uint32_t block_gas; /**< if the instruction starts a block, the sum of the static gas of the block, otherwise 0 */
+} evm_instr_t;
+
+/** the decoded code */
+typedef struct evm_program {
+  bytes_t      code;      /**< a copy of the code, which identifies the program */
+  uint64_t     hash;      /**< a fast hash of the code to find it in the cache */
+  evm_instr_t* instr;     /**< one instruction for each byte of the code plus a final STOP. Entries within push data are not used. */
+  evm_word_t*  words;     /**< the values of all PUSH instructions */
+  uint8_t*     jumpdests; /**< one bit for each byte of the code, which is set for valid jump destinations */
+  uint32_t     size;      /**< the memory allocated for the program */
+  uint32_t     refs;      /**< number of references, the cache holds one as long as the program is cached */
+  uint32_t     used;      /**< the clock of the cache when the program was used last */
+} evm_program_t;
+
+/** the cache of decoded programs */
+typedef struct {
+  evm_program_t* entries[EVM_PROGRAM_CACHE_SIZE]; /**< the cached programs, empty entries are NULL */
+  uint32_t       clock;                           /**< counter used to find the least recently used program */
+  uint32_t       bytes;                           /**< the memory used by all cached programs */
+  uint32_t       max_bytes;                       /**< the max memory used by all cached programs. Bigger programs are not cached at all. */
+} evm_programs_t;
+
+/** returns true if the position is a JUMPDEST, which is not part of push data */
+static inline bool evm_program_is_jumpdest(const evm_program_t* program, uint32_t pos) {
+  return pos < program->code.len && (program->jumpdests[pos >> 3] & (1 << (pos & 7)));
+}
+
+/**
+ * returns the decoded program for the code.
+ * 
+ * If the cache contains the code, the cached program is returned, otherwise the code is decoded and added to the cache,
+ * replacing the least recently used ones until there is a free entry and the memory used stays within `max_bytes`.
+ * The cache may be NULL, in which case the program only lives until it is released.
+ * The program must be released with `evm_program_release`.
+ */
+evm_program_t* evm_program_get(evm_programs_t* cache, bytes_t code);
+
+/** releases a program returned by `evm_program_get` */
+void evm_program_release(evm_program_t* program);
+
+/** frees the cache and all programs, which are not used anymore. */
+void evm_programs_free(evm_programs_t* cache);
+
+#endif
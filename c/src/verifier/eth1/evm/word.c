@@ -0,0 +1,205 @@
+/*******************************************************************************
+ * This file is part of the Incubed project.
+ * Sources: https://github.com/slockit/in3-c
+ * 
+ * Copyright (C) 2018-2020 slock.it GmbH, Blockchains LLC
+ * 
+ * 
+ * COMMERCIAL LICENSE USAGE
+ * 
+ * Licensees holding a valid commercial license may use this file in accordance 
+ * with the commercial license agreement provided with the Software or, alternatively, 
+ * in accordance with the terms contained in a written agreement between you and 
+ * slock.it GmbH/Blockchains LLC. For licensing terms and conditions or further 
+ * information please contact slock.it at in3@slock.it.
+ * 	
+ * Alternatively, this file may be used under the AGPL license as follows:
+ *    
+ * AGPL LICENSE USAGE
+ * 
+ * This program is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Affero General Public License as published by the Free Software 
+ * Foundation, either version 3 of the License, or (at your option) any later version.
+ *  
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY 
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A 
+ * PARTICULAR PURPOSE. See the GNU Affero General Public License for more details.
+ * [Permissions of this strong copyleft license are conditioned on making available 
+ * complete source code of licensed works and modifications, which include larger 
+ * works using a licensed work, under the same license. Copyright and license notices 
+ * must be preserved. Contributors provide an express grant of patent rights.]
+ * You should have received a copy of the GNU Affero General Public License along 
+ * with this program. If not, see <https://www.gnu.org/licenses/>.
+ *******************************************************************************/
+
+#include "word.h"
+
+#ifdef EVM_FAST_MATH
+
+typedef unsigned __int128 uint128_t;
+
+/** returns the number of used limbs */
+static int used_limbs(const uint64_t* a, int n) {
+  while (n && !a[n - 1]) n--;
+  return n;
+}
+
+/** r = a * b with r having la + lb limbs */
+static void mul_limbs(uint64_t* r, const uint64_t* a, int la, const uint64_t* b, int lb, int lr) {
+  memset(r, 0, lr * sizeof(uint64_t));
+  for (int i = 0; i < la && i < lr; i++) {
+    if (!a[i]) continue;
+    uint64_t carry = 0;
+    for (int j = 0; j < lb && i + j < lr; j++) {
+      const uint128_t p = (uint128_t) a[i] * b[j] + r[i + j] + carry;
+      r[i + j]          = (uint64_t) p;
+      carry             = p >> 64;
+    }
+    if (i + lb < lr) r[i + lb] = carry;
+  }
+}
+
+/**
+ * divides u (m limbs) by v (n limbs, v[n - 1] != 0, m >= n) using Knuth's algorithm D.
+ * q receives m - n + 1 limbs and r n limbs. Both may be NULL.
+ */
+static void divmod_limbs(uint64_t* q, uint64_t* r, const uint64_t* u, int m, const uint64_t* v, int n) {
+  if (n == 1) {
+    uint64_t rem = 0;
+    for (int j = m - 1; j >= 0; j--) {
+      const uint128_t cur = ((uint128_t) rem << 64) | u[j];
+      if (q) q[j] = (uint64_t)(cur / v[0]);
+      rem = (uint64_t)(cur % v[0]);
+    }
+    if (r) r[0] = rem;
+    return;
+  }
+
+  // normalize, so the highest bit of the divisor is set
+  const int s = __builtin_clzll(v[n - 1]);
+  uint64_t  vn[4], un[9];
+  for (int i = n - 1; i > 0; i--) vn[i] = (v[i] << s) | (s ? v[i - 1] >> (64 - s) : 0);
+  vn[0] = v[0] << s;
+  un[m] = s ? u[m - 1] >> (64 - s) : 0;
+  for (int i = m - 1; i > 0; i--) un[i] = (u[i] << s) | (s ? u[i - 1] >> (64 - s) : 0);
+  un[0] = u[0] << s;
+
+  for (int j = m - n; j >= 0; j--) {
+    // estimate the quotient digit, which may be 1 too large afterwards
+    const uint128_t num  = ((uint128_t) un[j + n] << 64) | un[j + n - 1];
+    uint128_t       qhat = num / vn[n - 1], rhat = num % vn[n - 1];
+    while ((qhat >> 64) || qhat * vn[n - 2] > ((rhat << 64) | un[j + n - 2])) {
+      qhat--;
+      rhat += vn[n - 1];
+      if (rhat >> 64) break;
+    }
+
+    // multiply and subtract
+    uint64_t borrow = 0, carry = 0;
+    for (int i = 0; i < n; i++) {
+      const uint128_t p  = qhat * vn[i] + carry;
+      const uint64_t  pl = (uint64_t) p, t = un[i + j] - pl - borrow;
+      carry              = p >> 64;
+      borrow             = un[i + j] < pl || un[i + j] - pl < borrow;
+      un[i + j]          = t;
+    }
+    const uint64_t t = un[j + n] - carry - borrow;
+    borrow           = un[j + n] < carry || un[j + n] - carry < borrow;
+    un[j + n]        = t;
+
+    if (borrow) { // the estimate was too large, so we add the divisor back
+      qhat--;
+      uint64_t c = 0;
+      for (int i = 0; i < n; i++) {
+        const uint128_t sum = (uint128_t) un[i + j] + vn[i] + c;
+        un[i + j]           = (uint64_t) sum;
+        c                   = sum >> 64;
+      }
+      un[j + n] += c;
+    }
+    if (q) q[j] = (uint64_t) qhat;
+  }
+
+  if (r) {
+    for (int i = 0; i < n - 1; i++) r[i] = (un[i] >> s) | (s ? un[i + 1] << (64 - s) : 0);
+    r[n - 1] = un[n - 1] >> s;
+  }
+}
+
+/** r = u mod m for u with up to 8 limbs */
+static void mod_limbs(evm_word_t* r, const uint64_t* u, int lu, const evm_word_t* m) {
+  const int n = used_limbs(m->n, 4);
+  lu          = used_limbs(u, lu);
+  evm_word_t res = {{0, 0, 0, 0}};
+  if (!n)
+    ; // x mod 0 = 0
+  else if (lu < n)
+    memcpy(res.n, u, lu * sizeof(uint64_t));
+  else
+    divmod_limbs(NULL, res.n, u, lu, m->n, n);
+  *r = res;
+}
+
+void evm_word_mul(evm_word_t* r, const evm_word_t* a, const evm_word_t* b) {
+  evm_word_t res;
+  mul_limbs(res.n, a->n, used_limbs(a->n, 4), b->n, 4, 4);
+  *r = res;
+}
+
+void evm_word_divmod(evm_word_t* q, evm_word_t* r, const evm_word_t* a, const evm_word_t* b) {
+  const int  m = used_limbs(a->n, 4), n = used_limbs(b->n, 4);
+  evm_word_t rq = {{0, 0, 0, 0}}, rr = {{0, 0, 0, 0}};
+  if (!n)
+    ; // x / 0 = 0 and x mod 0 = 0
+  else if (m < n || evm_word_cmp(a, b) < 0)
+    rr = *a;
+  else
+    divmod_limbs(rq.n, rr.n, a->n, m, b->n, n);
+  if (q) *q = rq;
+  if (r) *r = rr;
+}
+
+void evm_word_sdivmod(evm_word_t* q, evm_word_t* r, const evm_word_t* a, const evm_word_t* b) {
+  const bool neg_a = evm_word_is_negative(a), neg_b = evm_word_is_negative(b);
+  evm_word_t abs_a, abs_b, rq, rr;
+  if (neg_a)
+    evm_word_neg(&abs_a, a);
+  else
+    abs_a = *a;
+  if (neg_b)
+    evm_word_neg(&abs_b, b);
+  else
+    abs_b = *b;
+  evm_word_divmod(&rq, &rr, &abs_a, &abs_b);
+  // the quotient is negative if the signs differ, the remainder has the sign of the dividend
+  if (neg_a != neg_b) evm_word_neg(&rq, &rq);
+  if (neg_a) evm_word_neg(&rr, &rr);
+  if (q) *q = rq;
+  if (r) *r = rr;
+}
+
+void evm_word_addmod(evm_word_t* r, const evm_word_t* a, const evm_word_t* b, const evm_word_t* m) {
+  evm_word_t s;
+  evm_word_add(&s, a, b);
+  // the sum overflowed if it is smaller than one of the summands
+  const uint64_t sum[5] = {s.n[0], s.n[1], s.n[2], s.n[3], evm_word_cmp(&s, a) < 0};
+  mod_limbs(r, sum, 5, m);
+}
+
+void evm_word_mulmod(evm_word_t* r, const evm_word_t* a, const evm_word_t* b, const evm_word_t* m) {
+  uint64_t product[8];
+  mul_limbs(product, a->n, 4, b->n, 4, 8);
+  mod_limbs(r, product, 8, m);
+}
+
+void evm_word_exp(evm_word_t* r, const evm_word_t* base, const evm_word_t* exp) {
+  evm_word_t res = {{1, 0, 0, 0}}, b = *base;
+  const int  bits = evm_word_is_zero(exp) ? 0 : evm_word_len(exp) * 8;
+  for (int i = 0; i < bits; i++) {
+    if ((exp->n[i >> 6] >> (i & 63)) & 1) evm_word_mul(&res, &res, &b);
+    if (i + 1 < bits) evm_word_mul(&b, &b, &b);
+  }
+  *r = res;
+}
+
+#endif
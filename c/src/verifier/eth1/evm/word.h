@@ -0,0 +1,178 @@
+/*******************************************************************************
+ * This file is part of the Incubed project.
+ * Sources: https://github.com/slockit/in3-c
+ * 
+ * Copyright (C) 2018-2020 slock.it GmbH, Blockchains LLC
+ * 
+ * 
+ * COMMERCIAL LICENSE USAGE
+ * 
+ * Licensees holding a valid commercial license may use this file in accordance 
+ * with the commercial license agreement provided with the Software or, alternatively, 
+ * in accordance with the terms contained in a written agreement between you and 
+ * slock.it GmbH/Blockchains LLC. For licensing terms and conditions or further 
+ * information please contact slock.it at in3@slock.it.
+ * 	
+ * Alternatively, this file may be used under the AGPL license as follows:
+ *    
+ * AGPL LICENSE USAGE
+ * 
+ * This program is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Affero General Public License as published by the Free Software 
+ * Foundation, either version 3 of the License, or (at your option) any later version.
+ *  
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY 
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A 
+ * PARTICULAR PURPOSE. See the GNU Affero General Public License for more details.
+ * [Permissions of this strong copyleft license are conditioned on making available 
+ * complete source code of licensed works and modifications, which include larger 
+ * works using a licensed work, under the same license. Copyright and license notices 
+ * must be preserved. Contributors provide an express grant of patent rights.]
+ * You should have received a copy of the GNU Affero General Public License along 
+ * with this program. If not, see <https://www.gnu.org/licenses/>.
+ *******************************************************************************/
+
+/** @file
+ * fixed-width 256-bit words as used by the stack of the evm.
+ *
+ * A word is stored as 4 native 64-bit limbs with the least significant limb first,
+ * so the arithmetic does not need to deal with different lengths.
+ * Conversion to big-endian bytes only happens when a value leaves the stack (memory, storage, env).
+ * */
+
+#ifndef evm_word_h__
+#define evm_word_h__
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#if defined(IN3_MATH_FAST) && defined(__SIZEOF_INT128__)
+#define EVM_FAST_MATH /**< the arithmetic of the evm uses the native kernels of word.c instead of big.c */
+#endif
+
+/** a 256-bit word */
+typedef struct {
+  uint64_t n[4]; /**< the limbs, n[0] is the least significant one */
+} evm_word_t;
+
+/** sets the word to the value of a uint64 */
+static inline void evm_word_set_u64(evm_word_t* w, uint64_t val) {
+  w->n[0] = val;
+  w->n[1] = w->n[2] = w->n[3] = 0;
+}
+
+/** reads up to 32 big-endian bytes into the word */
+static inline void evm_word_from_bytes(evm_word_t* w, const uint8_t* data, int len) {
+  w->n[0] = w->n[1] = w->n[2] = w->n[3] = 0;
+  for (int i = 0; i < len; i++) w->n[i >> 3] |= ((uint64_t) data[len - 1 - i]) << ((i & 7) << 3);
+}
+
+/** writes the word as 32 big-endian bytes */
+static inline void evm_word_to_bytes(const evm_word_t* w, uint8_t* dst) {
+  for (int i = 0; i < 4; i++) {
+    const uint64_t v = w->n[3 - i];
+    for (int j = 0; j < 8; j++) dst[i * 8 + j] = (uint8_t)(v >> (56 - j * 8));
+  }
+}
+
+/** returns the number of bytes needed to represent the value (at least 1) */
+static inline int evm_word_len(const evm_word_t* w) {
+  for (int i = 3; i >= 0; i--) {
+    if (!w->n[i]) continue;
+    int l = i * 8 + 8;
+    for (uint64_t v = w->n[i]; !(v >> 56); v <<= 8) l--;
+    return l;
+  }
+  return 1;
+}
+
+/** returns true if the value fits into 64 bits */
+static inline bool evm_word_is_u64(const evm_word_t* w) {
+  return !(w->n[1] | w->n[2] | w->n[3]);
+}
+
+static inline bool evm_word_is_zero(const evm_word_t* w) {
+  return !(w->n[0] | w->n[1] | w->n[2] | w->n[3]);
+}
+
+static inline bool evm_word_is_negative(const evm_word_t* w) {
+  return w->n[3] >> 63;
+}
+
+/** compares the unsigned values and returns -1, 0 or 1 */
+static inline int evm_word_cmp(const evm_word_t* a, const evm_word_t* b) {
+  for (int i = 3; i >= 0; i--) {
+    if (a->n[i] != b->n[i]) return a->n[i] < b->n[i] ? -1 : 1;
+  }
+  return 0;
+}
+
+/** compares the values as two's complement and returns -1, 0 or 1 */
+static inline int evm_word_scmp(const evm_word_t* a, const evm_word_t* b) {
+  const bool neg_a = evm_word_is_negative(a);
+  if (neg_a != evm_word_is_negative(b)) return neg_a ? -1 : 1;
+  return evm_word_cmp(a, b);
+}
+
+/** r = a + b (mod 2^256), r may be a or b */
+static inline void evm_word_add(evm_word_t* r, const evm_word_t* a, const evm_word_t* b) {
+  uint64_t carry = 0;
+  for (int i = 0; i < 4; i++) {
+    const uint64_t s = a->n[i] + carry;
+    carry            = s < carry;
+    r->n[i]          = s + b->n[i];
+    carry += r->n[i] < s;
+  }
+}
+
+/** r = a - b (mod 2^256), r may be a or b */
+static inline void evm_word_sub(evm_word_t* r, const evm_word_t* a, const evm_word_t* b) {
+  uint64_t borrow = 0;
+  for (int i = 0; i < 4; i++) {
+    const uint64_t d = a->n[i] - borrow;
+    borrow           = d > a->n[i];
+    borrow += d < b->n[i];
+    r->n[i] = d - b->n[i];
+  }
+}
+
+/** r = 0 - a */
+static inline void evm_word_neg(evm_word_t* r, const evm_word_t* a) {
+  const evm_word_t zero = {{0, 0, 0, 0}};
+  evm_word_sub(r, &zero, a);
+}
+
+/** r = a << bits, with bits < 256 */
+static inline void evm_word_shl(evm_word_t* r, const evm_word_t* a, unsigned int bits) {
+  const unsigned int limbs = bits >> 6, s = bits & 63;
+  for (int i = 3; i >= 0; i--) {
+    const int src = i - (int) limbs;
+    uint64_t  v   = src >= 0 ? a->n[src] << s : 0;
+    if (s && src > 0) v |= a->n[src - 1] >> (64 - s);
+    r->n[i] = v;
+  }
+}
+
+/** r = a >> bits, with bits < 256. If fill is set, the free bits are set to 1. */
+static inline void evm_word_shr(evm_word_t* r, const evm_word_t* a, unsigned int bits, bool fill) {
+  const unsigned int limbs = bits >> 6, s = bits & 63;
+  const uint64_t     f     = fill ? ~(uint64_t) 0 : 0;
+  for (int i = 0; i < 4; i++) {
+    const int src = i + (int) limbs;
+    uint64_t  v   = src < 4 ? a->n[src] >> s : f;
+    if (s) v |= (src + 1 < 4 ? a->n[src + 1] : f) << (64 - s);
+    r->n[i] = v;
+  }
+}
+
+#ifdef EVM_FAST_MATH
+void evm_word_mul(evm_word_t* r, const evm_word_t* a, const evm_word_t* b);                          /**< r = a * b (mod 2^256) */
+void evm_word_divmod(evm_word_t* q, evm_word_t* r, const evm_word_t* a, const evm_word_t* b);        /**< q = a / b, r = a % b, both 0 if b is 0. q or r may be NULL */
+void evm_word_sdivmod(evm_word_t* q, evm_word_t* r, const evm_word_t* a, const evm_word_t* b);       /**< same as evm_word_divmod, but for two's complement values */
+void evm_word_addmod(evm_word_t* r, const evm_word_t* a, const evm_word_t* b, const evm_word_t* m);  /**< r = (a + b) % m without overflow, 0 if m is 0 */
+void evm_word_mulmod(evm_word_t* r, const evm_word_t* a, const evm_word_t* b, const evm_word_t* m);  /**< r = (a * b) % m without overflow, 0 if m is 0 */
+void evm_word_exp(evm_word_t* r, const evm_word_t* base, const evm_word_t* exp);                     /**< r = base ^ exp (mod 2^256) */
+#endif
+
+#endif
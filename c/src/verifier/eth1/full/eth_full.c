@@ -42,7 +42,9 @@
 #include "../../../verifier/eth1/basic/eth_basic.h"
 #include "../../../verifier/eth1/nano/merkle.h"
 #include "../../../verifier/eth1/nano/serialize.h"
+#include "../evm/env.h"
 #include "../evm/evm.h"
+#include "../evm/program.h"
 #include <string.h>
 
 int in3_verify_eth_full(in3_vctx_t* vc) {
@@ -69,15 +71,18 @@ int in3_verify_eth_full(in3_vctx_t* vc) {
     bytes_t* data      = d_get_bytesk(tx, K_DATA);
     bytes_t  gas       = d_to_bytes(d_get(tx, K_GAS_LIMIT));
     bytes_t* result    = NULL;
-    uint64_t gas_limit = bytes_to_long(gas.data, gas.len);
-    if (!gas_limit) gas_limit = 0xFFFFFFFFFFFFFF;
+    uint64_t gas_limit = bytes_to_long(gas.data, gas.len); // without a gas limit the evm does not meter the gas
 #if defined(DEBUG) && defined(LOGGING)
     in3_log_level_t old = in3_log_get_level();
     in3_log_disable_prefix();
     in3_log_set_level(LOG_ERROR);
 #endif
 
-    int ret = evm_call(vc, address ? address->data : zeros, value ? value->data : zeros, value ? value->len : 1, data ? data->data : zeros, data ? data->len : 0, from ? from->data : zeros, gas_limit, vc->chain->chain_id, &result);
+    // index the accounts and storage of the proof once, so the evm finds them without scanning the proof
+    in3_env_t env;
+    in3_env_init(&env, vc);
+    int ret = evm_call(&env, address ? address->data : zeros, value ? value->data : zeros, value ? value->len : 1, data ? data->data : zeros, data ? data->len : 0, from ? from->data : zeros, gas_limit, vc->chain->chain_id, &result);
+    in3_env_free(&env);
 #if defined(DEBUG) && defined(LOGGING)
     in3_log_set_level(old);
     in3_log_enable_prefix();
@@ -125,10 +130,20 @@ int in3_verify_eth_full(in3_vctx_t* vc) {
     return in3_verify_eth_basic(vc);
 }
 
+static void eth_full_free_chain(in3_t* c, in3_chain_t* chain) {
+  eth_chain_state_t* state = chain->conf;
+  if (chain->type == CHAIN_ETH && state) {
+    evm_programs_free(state->evm_programs);
+    state->evm_programs = NULL;
+  }
+  eth_free_chain_state(c, chain);
+}
+
 void in3_register_eth_full() {
   in3_verifier_t* v = _calloc(1, sizeof(in3_verifier_t));
   v->type           = CHAIN_ETH;
   v->pre_handle     = eth_handle_intern;
   v->verify         = (in3_verify) in3_verify_eth_full;
+  v->free_chain     = eth_full_free_chain;
   in3_register_verifier(v);
 }
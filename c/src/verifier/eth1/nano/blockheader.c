@@ -34,6 +34,8 @@
 
 #include "../../../core/client/context.h"
 #include "../../../core/client/keys.h"
+#include "../../../core/client/shared_stats.h"
+#include "../../../core/client/verified_hashes.h"
 #include "../../../core/util/mem.h"
 #include "../../../third-party/crypto/ecdsa.h"
 #include "../../../third-party/crypto/secp256k1.h"
@@ -334,19 +336,7 @@ in3_ret_t eth_verify_authority(in3_vctx_t* vc, bytes_t** blocks, uint16_t needed
 #endif
 
 NONULL static void add_verified(int max, in3_chain_t* chain, uint64_t number, bytes32_t hash) {
-  if (!max) return;
-  if (!chain->verified_hashes) chain->verified_hashes = _calloc(max, sizeof(in3_verified_hash_t));
-  int      oldest_index  = 0;
-  uint64_t oldest_number = 0xFFFFFFFFFFFFFFFFLL;
-  for (int i = 0; i < max; i++) {
-    if (chain->verified_hashes[i].block_number < oldest_number) {
-      oldest_index  = i;
-      oldest_number = chain->verified_hashes[i].block_number;
-      if (oldest_number == 0) break;
-    }
-  }
-  chain->verified_hashes[oldest_index].block_number = number;
-  memcpy(chain->verified_hashes[oldest_index].hash, hash, 32);
+  if (in3_verified_hashes_add(chain, max, number, hash)) in3_shared_add_verified(chain, number, hash);
 }
 
 /** verify the header */
@@ -375,15 +365,12 @@ in3_ret_t eth_verify_blockheader(in3_vctx_t* vc, bytes_t* header, bytes_t* expec
     return vc_err(vc, "wrong blockhash");
 
   // already verified?
-  if (vc->chain->verified_hashes) {
-    for (i = 0; i < vc->ctx->client->max_verified_hashes; i++) {
-      if (vc->chain->verified_hashes[i].block_number == header_number) {
-        if (memcmp(vc->chain->verified_hashes[i].hash, block_hash, 32))
-          return vc_err(vc, "invalid blockhash");
-        else
-          return IN3_OK;
-      }
-    }
+  in3_verified_hash_t* verified = in3_verified_hashes_find(vc->chain, vc->ctx->client->max_verified_hashes, header_number);
+  if (verified) {
+    if (memcmp(verified->hash, block_hash, 32))
+      return vc_err(vc, "invalid blockhash");
+    else
+      return IN3_OK;
   }
 
   // if we expect no signatures ...
@@ -34,6 +34,7 @@
 #ifdef POA
 #include "vhist.h"
 #include "../../../core/client/keys.h"
+#include "../../../core/client/stats.h"
 #include "../../../core/util/log.h"
 #include "../../../core/util/mem.h"
 #include "../../../core/util/utils.h"
@@ -221,6 +222,7 @@ vhist_t* vh_cache_retrieve(in3_t* c) {
   if (c->cache) {
     sprintf(k, VALIDATOR_LIST_KEY, c->chain_id);
     v_ = c->cache->get_item(c->cache->cptr, k);
+    in3_stats_add(v_ ? IN3_STAT_CACHE_HIT : IN3_STAT_CACHE_MISS, "validators", 1);
     if (v_) {
       rlp_decode(v_, 0, &b_);
       uint8_t vers;
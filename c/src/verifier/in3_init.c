@@ -3,6 +3,7 @@
 #include "../pay/eth/pay_eth.h"
 #include "../transport/curl/in3_curl.h"
 #include "../transport/http/in3_http.h"
+#include "../transport/ipc/in3_ipc.h"
 #include "../verifier/btc/btc.h"
 #include "../verifier/eth1/basic/eth_basic.h"
 #include "../verifier/eth1/full/eth_full.h"
@@ -39,8 +40,14 @@ static void init_transport() {
 #ifdef TRANSPORTS
 #ifdef USE_CURL
   in3_register_curl();
+#ifdef USE_IPC
+  in3_register_ipc(send_curl);
+#endif /* USE_IPC */
 #else
   in3_register_http();
+#ifdef USE_IPC
+  in3_register_ipc(send_http);
+#endif /* USE_IPC */
 #endif /* USE_CURL */
 #endif /* TRANSPORTS */
 }
@@ -0,0 +1,103 @@
+/*******************************************************************************
+ * This file is part of the Incubed project.
+ * Sources: https://github.com/slockit/in3-c
+ * 
+ * Copyright (C) 2018-2020 slock.it GmbH, Blockchains LLC
+ * 
+ * 
+ * COMMERCIAL LICENSE USAGE
+ * 
+ * Licensees holding a valid commercial license may use this file in accordance 
+ * with the commercial license agreement provided with the Software or, alternatively, 
+ * in accordance with the terms contained in a written agreement between you and 
+ * slock.it GmbH/Blockchains LLC. For licensing terms and conditions or further 
+ * information please contact slock.it at in3@slock.it.
+ * 	
+ * Alternatively, this file may be used under the AGPL license as follows:
+ *    
+ * AGPL LICENSE USAGE
+ * 
+ * This program is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Affero General Public License as published by the Free Software 
+ * Foundation, either version 3 of the License, or (at your option) any later version.
+ *  
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY 
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A 
+ * PARTICULAR PURPOSE. See the GNU Affero General Public License for more details.
+ * [Permissions of this strong copyleft license are conditioned on making available 
+ * complete source code of licensed works and modifications, which include larger 
+ * works using a licensed work, under the same license. Copyright and license notices 
+ * must be preserved. Contributors provide an express grant of patent rights.]
+ * You should have received a copy of the GNU Affero General Public License along 
+ * with this program. If not, see <https://www.gnu.org/licenses/>.
+ *******************************************************************************/
+
+/** @file 
+ * measures the alt_bn128 precompiles ECADD (0x06), ECMUL (0x07) and ECPAIRING (0x08) without the evm.
+ * 
+ * The pairing check uses e(G1, G2) * e(-G1, G2) = 1 with the number of pairs as the precompile would get them.
+ * 
+ * usage: bench_ec [number of runs] [number of pairs]
+ * */
+
+#include "../../src/core/util/mem.h"
+#include "../../src/core/util/utils.h"
+#include "../../src/verifier/eth1/evm/bn128.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+#define G1     "00000000000000000000000000000000000000000000000000000000000000010000000000000000000000000000000000000000000000000000000000000002"
+#define G1_NEG "000000000000000000000000000000000000000000000000000000000000000130644e72e131a029b85045b68181585d97816a916871ca8d3c208c16d87cfd45"
+#define G2     "198e9393920d483a7260bfb731fb5d25f1aa493335a9e71297e485b7aef312c21800deef121f1e76426a00665e5c4479674322d4f75edadd46debd5cd992f6ed" \
+               "090689d0585ff075ec9e99ad690c3395bc4b313370b38ef355acdadcd122975b12c85ea5db8c6deb4aab71808dcb408fe3d1e7690c43d37b4ce6cc0166fa7daa"
+#define SCALAR "30644e72e1319f29b85045b68181585d97816a916871ca8d3c208c16d87cfd46" // a full-size scalar
+
+static uint64_t now_us() {
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec * 1000000L + tv.tv_usec;
+}
+
+static void check(bool ok, const char* msg) {
+  if (ok) return;
+  printf("%s\n", msg);
+  exit(EXIT_FAILURE);
+}
+
+static void report(const char* name, uint64_t start, int count) {
+  printf("%-10s: %9.1f us\n", name, (double) (now_us() - start) / count);
+}
+
+int main(int argc, char* argv[]) {
+  int      count = argc > 1 ? atoi(argv[1]) : 100;
+  int      pairs = argc > 2 ? atoi(argv[2]) : 2;
+  uint8_t  in[128], out[64];
+  uint8_t* pairing = _malloc(pairs * 192);
+  bool     result  = false;
+  check(pairs > 0 && pairs % 2 == 0, "the number of pairs must be even");
+
+  hex_to_bytes(G1, -1, in, 64);
+  hex_to_bytes(G1, -1, in + 64, 64);
+  uint64_t start = now_us();
+  for (int i = 0; i < count * 100; i++) check(bn128_add(in, out), "ecadd failed");
+  report("ecadd", start, count * 100);
+
+  hex_to_bytes(SCALAR, -1, in + 64, 32);
+  start = now_us();
+  for (int i = 0; i < count; i++) check(bn128_mul(in, out), "ecmul failed");
+  report("ecmul", start, count);
+
+  for (int i = 0; i < pairs; i++) {
+    hex_to_bytes(i % 2 ? G1_NEG : G1, -1, pairing + i * 192, 64);
+    hex_to_bytes(G2, -1, pairing + i * 192 + 64, 128);
+  }
+  start = now_us();
+  for (int i = 0; i < count; i++) check(bn128_pairing(pairing, pairs * 192, &result) && result, "ecpairing failed");
+  printf("%d pairs ", pairs);
+  report("ecpairing", start, count);
+
+  _free(pairing);
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,270 @@
+/*******************************************************************************
+ * This file is part of the Incubed project.
+ * Sources: https://github.com/slockit/in3-c
+ * 
+ * Copyright (C) 2018-2020 slock.it GmbH, Blockchains LLC
+ * 
+ * 
+ * COMMERCIAL LICENSE USAGE
+ * 
+ * Licensees holding a valid commercial license may use this file in accordance 
+ * with the commercial license agreement provided with the Software or, alternatively, 
+ * in accordance with the terms contained in a written agreement between you and 
+ * slock.it GmbH/Blockchains LLC. For licensing terms and conditions or further 
+ * information please contact slock.it at in3@slock.it.
+ * 	
+ * Alternatively, this file may be used under the AGPL license as follows:
+ *    
+ * AGPL LICENSE USAGE
+ * 
+ * This program is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Affero General Public License as published by the Free Software 
+ * Foundation, either version 3 of the License, or (at your option) any later version.
+ *  
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY 
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A 
+ * PARTICULAR PURPOSE. See the GNU Affero General Public License for more details.
+ * [Permissions of this strong copyleft license are conditioned on making available 
+ * complete source code of licensed works and modifications, which include larger 
+ * works using a licensed work, under the same license. Copyright and license notices 
+ * must be preserved. Contributors provide an express grant of patent rights.]
+ * You should have received a copy of the GNU Affero General Public License along 
+ * with this program. If not, see <https://www.gnu.org/licenses/>.
+ *******************************************************************************/
+/** @file 
+ * measures the throughput and latency of the http-server (`in3 -port`).
+ * 
+ * Each thread uses its own connection and sends the next request as soon as the response arrived.
+ * Using `-k 0` a new connection is opened for each request, which is how the server was used before keep-alive was supported.
+ * With `-P` the requests are pipelined and with `-b` each request is sent as batch, so the latency is the time for all of them.
+ * 
+ * usage: bench_http_server [options]
+ * 
+ * | option | description | default |
+ * |--------|-------------|---------|
+ * | -h HOST | the host of the server | 127.0.0.1 |
+ * | -p PORT | the port of the server | 8545 |
+ * | -c THREADS | number of concurrent connections | 16 |
+ * | -t SECONDS | duration of the test | 10 |
+ * | -k 0/1 | use keep-alive | 1 |
+ * | -P DEPTH | number of requests sent at once on each connection | 1 |
+ * | -b SIZE | number of rpc-requests in each request, which are sent as batch if more than 1 | 1 |
+ * | -r REQUEST | the json-rpc request to send | eth_blockNumber |
+ * */
+
+#include "../../src/core/util/mem.h"
+#include "../../src/core/util/utils.h"
+#include <inttypes.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#define BUFFER_SIZE 65536
+
+typedef struct {
+  struct addrinfo* addr;
+  const char*      request;
+  size_t           request_len;
+  bool             keep_alive;
+  int              depth;
+  uint64_t         end;
+  uint64_t*        latencies; /**< the latency in us for each request */
+  int              len;
+  int              allocated;
+  uint64_t         errors;
+  uint64_t         connects;
+} worker_t;
+
+static uint64_t now_us() {
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec * 1000000L + tv.tv_usec;
+}
+
+static int connect_to(struct addrinfo* addr) {
+  int fd = socket(addr->ai_family, addr->ai_socktype, addr->ai_protocol);
+  if (fd < 0) return -1;
+  int            option  = 1;
+  struct timeval timeout = {.tv_sec = 10}; // a server which does not respond counts as error
+  setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &option, sizeof(option));
+  setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+  if (connect(fd, addr->ai_addr, addr->ai_addrlen) == 0) return fd;
+  close(fd);
+  return -1;
+}
+
+static bool send_all(int fd, const char* data, size_t len) {
+  while (len) {
+    ssize_t n = send(fd, data, len, MSG_NOSIGNAL);
+    if (n <= 0) return false;
+    data += n;
+    len -= n;
+  }
+  return true;
+}
+
+/** reads one response and returns the status code or 0 if the connection failed. data of the next response are kept in the buffer. */
+static int read_response(int fd, char* buf, size_t* buffered, bool* keep_alive) {
+  size_t len    = *buffered, header = 0, content_length = 0;
+  int    status = 0;
+  while (!header || len < header + content_length) {
+    buf[len]  = 0;
+    char* end = header ? NULL : strstr(buf, "\r\n\r\n");
+    if (end) {
+      header   = end + 4 - buf;
+      *end     = 0;
+      char* cl = strcasestr(buf, "\r\nContent-Length:");
+      if (cl) content_length = strtoul(cl + 17, NULL, 10);
+      if (strcasestr(buf, "\r\nConnection: close")) *keep_alive = false;
+      *end   = '\r';
+      status = atoi(buf + 9);
+      if (header + content_length >= BUFFER_SIZE) return 0;
+      if (!cl && !*keep_alive) content_length = BUFFER_SIZE - 1 - header;
+      continue;
+    }
+    ssize_t n = recv(fd, buf + len, BUFFER_SIZE - 1 - len, 0);
+    if (n <= 0) {
+      *buffered = 0;
+      return header && !*keep_alive ? status : 0; // without keep-alive the end of the body may be the end of the connection
+    }
+    len += n;
+  }
+  *buffered = len - header - content_length;
+  memmove(buf, buf + header + content_length, *buffered);
+  return status;
+}
+
+static void* run_worker(void* arg) {
+  worker_t* w        = arg;
+  char*     buf      = _malloc(BUFFER_SIZE);
+  size_t    buffered = 0;
+  int       fd       = -1;
+  while (now_us() < w->end) {
+    uint64_t start = now_us();
+    if (fd < 0 && (fd = connect_to(w->addr)) >= 0) w->connects++;
+    bool keep_alive = w->keep_alive;
+    int  status     = 0;
+    for (int i = 0; i < w->depth && fd >= 0; i++) {
+      if (!send_all(fd, w->request, w->request_len)) break;
+      status = 200;
+    }
+    for (int i = 0; i < w->depth && status == 200; i++) status = read_response(fd, buf, &buffered, &keep_alive);
+    if (status != 200) w->errors++;
+    if (status == 0 || !keep_alive) {
+      if (fd >= 0) close(fd);
+      fd       = -1;
+      buffered = 0;
+    }
+    if (w->len == w->allocated) {
+      w->latencies = _realloc(w->latencies, sizeof(uint64_t) * (w->allocated * 2 + 1024), sizeof(uint64_t) * w->allocated);
+      w->allocated = w->allocated * 2 + 1024;
+    }
+    w->latencies[w->len++] = now_us() - start;
+  }
+  if (fd >= 0) close(fd);
+  _free(buf);
+  return NULL;
+}
+
+static int cmp_u64(const void* a, const void* b) {
+  uint64_t x = *(const uint64_t*) a, y = *(const uint64_t*) b;
+  return x < y ? -1 : (x > y);
+}
+
+static void usage(const char* name) {
+  fprintf(stderr, "usage: %s [-h host] [-p port] [-c threads] [-t seconds] [-k 0|1] [-P depth] [-b size] [-r request]\n", name);
+  exit(EXIT_FAILURE);
+}
+
+int main(int argc, char* argv[]) {
+  const char *host = "127.0.0.1", *port = "8545", *rpc = "{\"jsonrpc\":\"2.0\",\"id\":1,\"method\":\"eth_blockNumber\",\"params\":[]}";
+  int         threads = 16, depth = 1, batch = 1;
+  bool        keep_alive = true;
+  double      duration   = 10;
+
+  for (int i = 1; i < argc; i++) {
+    if (i + 1 >= argc) usage(argv[0]);
+    char* arg = argv[i];
+    char* val = argv[++i];
+    if (!strcmp(arg, "-h"))
+      host = val;
+    else if (!strcmp(arg, "-p"))
+      port = val;
+    else if (!strcmp(arg, "-c"))
+      threads = atoi(val);
+    else if (!strcmp(arg, "-t"))
+      duration = atof(val);
+    else if (!strcmp(arg, "-k"))
+      keep_alive = atoi(val) != 0;
+    else if (!strcmp(arg, "-P"))
+      depth = atoi(val);
+    else if (!strcmp(arg, "-b"))
+      batch = atoi(val);
+    else if (!strcmp(arg, "-r"))
+      rpc = val;
+    else
+      usage(argv[0]);
+  }
+  if (threads < 1 || duration <= 0 || depth < 1 || batch < 1 || (depth > 1 && !keep_alive)) usage(argv[0]);
+
+  struct addrinfo hints = {.ai_family = AF_INET, .ai_socktype = SOCK_STREAM}, *addr = NULL;
+  if (getaddrinfo(host, port, &hints, &addr) != 0) {
+    fprintf(stderr, "could not resolve %s\n", host);
+    return EXIT_FAILURE;
+  }
+
+  size_t body_len = batch * (strlen(rpc) + 1) + 1;
+  char*  body     = _malloc(body_len + 1);
+  *body           = 0;
+  for (int i = 0; i < batch && batch > 1; i++) strcat(strcat(body, i ? "," : "["), rpc);
+  strcat(body, batch > 1 ? "]" : rpc);
+  char* request = _malloc(strlen(body) + 200);
+  sprintf(request, "POST / HTTP/1.1\r\nHost: %s\r\nContent-Type: application/json\r\nContent-Length: %u\r\nConnection: %s\r\n\r\n%s",
+          host, (unsigned int) strlen(body), keep_alive ? "keep-alive" : "close", body);
+  _free(body);
+
+  printf("sending requests for %.0fs with %d connections to %s:%s (%s, %d pipelined, %d per batch)\n", duration, threads, host, port, keep_alive ? "keep-alive" : "new connection per request", depth, batch);
+  worker_t*  w   = _calloc(threads, sizeof(worker_t));
+  pthread_t* ids = _malloc(sizeof(pthread_t) * threads);
+  uint64_t   start = now_us();
+  for (int i = 0; i < threads; i++) {
+    w[i] = (worker_t){.addr = addr, .request = request, .request_len = strlen(request), .keep_alive = keep_alive, .depth = depth, .end = start + (uint64_t)(duration * 1000000)};
+    pthread_create(ids + i, NULL, run_worker, w + i);
+  }
+
+  // collect the results
+  uint64_t  errors = 0, connects = 0;
+  int       len    = 0;
+  uint64_t* all    = NULL;
+  for (int i = 0; i < threads; i++) {
+    pthread_join(ids[i], NULL);
+    all = _realloc(all, sizeof(uint64_t) * (len + w[i].len + 1), sizeof(uint64_t) * len);
+    if (w[i].len) memcpy(all + len, w[i].latencies, sizeof(uint64_t) * w[i].len);
+    len += w[i].len;
+    errors += w[i].errors;
+    connects += w[i].connects;
+    if (w[i].latencies) _free(w[i].latencies);
+  }
+  double elapsed = (now_us() - start) / 1000000.0;
+
+  qsort(all, len, sizeof(uint64_t), cmp_u64);
+  printf("\nrequests   : %d in %.2fs (%.1f/s), %" PRIu64 " failed, %" PRIu64 " connections\n", len * depth, elapsed, len * depth / elapsed, errors, connects);
+  printf("rpc calls  : %d (%.1f/s)\n", len * depth * batch, len * depth * batch / elapsed);
+  if (len)
+    printf("latency    : p50 %.2fms  p90 %.2fms  p99 %.2fms  p99.9 %.2fms  max %.2fms\n",
+           all[len / 2] / 1000.0, all[len * 90 / 100] / 1000.0, all[len * 99 / 100] / 1000.0, all[len * 999 / 1000] / 1000.0, all[len - 1] / 1000.0);
+
+  freeaddrinfo(addr);
+  _free(all);
+  _free(w);
+  _free(ids);
+  _free(request);
+  return errors ? EXIT_FAILURE : EXIT_SUCCESS;
+}
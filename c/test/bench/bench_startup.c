@@ -0,0 +1,180 @@
+/*******************************************************************************
+ * This file is part of the Incubed project.
+ * Sources: https://github.com/slockit/in3-c
+ * 
+ * Copyright (C) 2018-2020 slock.it GmbH, Blockchains LLC
+ * 
+ * 
+ * COMMERCIAL LICENSE USAGE
+ * 
+ * Licensees holding a valid commercial license may use this file in accordance 
+ * with the commercial license agreement provided with the Software or, alternatively, 
+ * in accordance with the terms contained in a written agreement between you and 
+ * slock.it GmbH/Blockchains LLC. For licensing terms and conditions or further 
+ * information please contact slock.it at in3@slock.it.
+ * 	
+ * Alternatively, this file may be used under the AGPL license as follows:
+ *    
+ * AGPL LICENSE USAGE
+ * 
+ * This program is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Affero General Public License as published by the Free Software 
+ * Foundation, either version 3 of the License, or (at your option) any later version.
+ *  
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY 
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A 
+ * PARTICULAR PURPOSE. See the GNU Affero General Public License for more details.
+ * [Permissions of this strong copyleft license are conditioned on making available 
+ * complete source code of licensed works and modifications, which include larger 
+ * works using a licensed work, under the same license. Copyright and license notices 
+ * must be preserved. Contributors provide an express grant of patent rights.]
+ * You should have received a copy of the GNU Affero General Public License along 
+ * with this program. If not, see <https://www.gnu.org/licenses/>.
+ *******************************************************************************/
+
+/** @file 
+ * compares the time a new process needs to start a client and send the first request.
+ * 
+ * - config   : the nodelist is part of the configuration, which is parsed with in3_configure
+ * - cache    : the nodelist is read from the storage handler with in3_cache_init
+ * - snapshot : the client is restored from a snapshot file with in3_snapshot_load
+ * 
+ * All clients are created for mainnet only. The request is answered by a local transport, so only the time spent in the client is measured.
+ * The cache is kept in memory, so reading the nodelist from a file is not included.
+ * 
+ * usage: bench_startup [number of starts] [number of nodes]
+ * */
+
+#include "../../src/core/client/cache.h"
+#include "../../src/core/client/client.h"
+#include "../../src/core/client/snapshot.h"
+#include "../../src/core/util/mem.h"
+#include "../../src/core/util/stringbuilder.h"
+#include "../../src/verifier/eth1/nano/eth_nano.h"
+#include <fcntl.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#define BASE_CONFIG "{\"chainId\":\"0x1\",\"proof\":\"none\",\"requestCount\":1,\"maxAttempts\":1"
+
+typedef enum {
+  START_CONFIG,
+  START_CACHE,
+  START_SNAPSHOT
+} start_t;
+
+static char*    config_with_nodes = NULL;
+static char*    snapshot_file     = "/tmp/in3_bench_startup.snapshot";
+static char*    cached_key        = NULL;
+static bytes_t* cached_value      = NULL;
+
+static uint64_t now_us() {
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec * 1000000L + tv.tv_usec;
+}
+
+static in3_ret_t local_transport(in3_request_t* req) {
+  for (unsigned int i = 0; i < req->urls_len; i++) in3_req_add_response(req, i, false, "[{\"id\":1,\"jsonrpc\":\"2.0\",\"result\":\"0xa3f1b2\"}]", -1);
+  return IN3_OK;
+}
+
+static bytes_t* mem_get_item(void* cptr, const char* key) {
+  UNUSED_VAR(cptr);
+  return cached_key && !strcmp(key, cached_key) ? b_dup(cached_value) : NULL;
+}
+
+static void mem_set_item(void* cptr, const char* key, bytes_t* value) {
+  UNUSED_VAR(cptr);
+  if (cached_key) _free(cached_key);
+  if (cached_value) b_free(cached_value);
+  cached_key   = _strdupn(key, -1);
+  cached_value = b_dup(value);
+}
+
+static void check(bool ok, const char* msg) {
+  if (ok) return;
+  printf("%s\n", msg);
+  exit(EXIT_FAILURE);
+}
+
+static in3_t* start(start_t type) {
+  in3_t* c = in3_for_chain(CHAIN_ID_MAINNET);
+  if (type == START_SNAPSHOT) {
+    // this is what a new process would do. For a snapshot of a few kB reading it is cheaper than mapping it.
+    struct stat st;
+    int         fd = open(snapshot_file, O_RDONLY);
+    check(fd >= 0 && !fstat(fd, &st), "could not open the snapshot");
+    bytes_t b = bytes(_malloc(st.st_size), st.st_size);
+    check(read(fd, b.data, b.len) == (ssize_t) b.len, "could not read the snapshot");
+    check(in3_snapshot_load(c, &b) == IN3_OK, "invalid snapshot");
+    _free(b.data);
+    close(fd);
+  } else {
+    char* error = in3_configure(c, type == START_CONFIG ? config_with_nodes : BASE_CONFIG "}");
+    check(!error, error);
+    if (type == START_CACHE) in3_set_storage_handler(c, mem_get_item, mem_set_item, NULL, NULL);
+  }
+  c->transport = local_transport;
+  return c;
+}
+
+static void bench(const char* name, start_t type, int count) {
+  uint64_t init = 0, total = 0;
+  for (int i = -10; i < count; i++) {
+    char *   result = NULL, *error = NULL;
+    uint64_t t0 = now_us();
+    in3_t*   c  = start(type);
+    uint64_t t1 = now_us();
+    check(in3_client_rpc(c, "eth_blockNumber", "[]", &result, &error) == IN3_OK, error ? error : "request failed");
+    uint64_t t2 = now_us();
+    if (i >= 0) {
+      init += t1 - t0;
+      total += t2 - t0;
+    }
+    _free(result);
+    in3_free(c);
+  }
+  printf("%-9s: start %7.1f us   start + first request %7.1f us\n", name, (double) init / count, (double) total / count);
+}
+
+int main(int argc, char* argv[]) {
+  int count = argc > 1 ? atoi(argv[1]) : 1000;
+  int nodes = argc > 2 ? atoi(argv[2]) : 40;
+  in3_register_eth_nano();
+
+  // a configuration with a complete nodelist
+  sb_t* sb = sb_new(BASE_CONFIG ",\"nodes\":{\"0x1\":{\"needsUpdate\":false,\"nodeList\":[");
+  for (int i = 0; i < nodes; i++) {
+    char node[200];
+    sprintf(node, "%s{\"url\":\"https://in3-node-%d.example.com\",\"address\":\"0x%040x\",\"props\":\"0x1dd\"}", i ? "," : "", i, i + 1);
+    sb_add_chars(sb, node);
+  }
+  sb_add_chars(sb, "]}}}");
+  config_with_nodes = sb->data;
+
+  // fill the cache and write the snapshot
+  in3_t* c = start(START_CONFIG);
+  in3_set_storage_handler(c, mem_get_item, mem_set_item, NULL, NULL);
+  in3_cache_store_nodelist(c, c->chains);
+  bytes_t* snapshot = in3_snapshot_save(c);
+  FILE*    f        = fopen(snapshot_file, "wb");
+  check(f && fwrite(snapshot->data, 1, snapshot->len, f) == snapshot->len, "could not write the snapshot");
+  fclose(f);
+  printf("%d starts with %d nodes (config %u bytes, snapshot %u bytes)\n", count, nodes, (uint32_t) strlen(config_with_nodes), snapshot->len);
+  b_free(snapshot);
+  in3_free(c);
+
+  bench("config", START_CONFIG, count);
+  bench("cache", START_CACHE, count);
+  bench("snapshot", START_SNAPSHOT, count);
+
+  unlink(snapshot_file);
+  sb_free(sb);
+  return EXIT_SUCCESS;
+}
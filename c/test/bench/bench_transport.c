@@ -0,0 +1,213 @@
+/*******************************************************************************
+ * This file is part of the Incubed project.
+ * Sources: https://github.com/slockit/in3-c
+ * 
+ * Copyright (C) 2018-2020 slock.it GmbH, Blockchains LLC
+ * 
+ * 
+ * COMMERCIAL LICENSE USAGE
+ * 
+ * Licensees holding a valid commercial license may use this file in accordance 
+ * with the commercial license agreement provided with the Software or, alternatively, 
+ * in accordance with the terms contained in a written agreement between you and 
+ * slock.it GmbH/Blockchains LLC. For licensing terms and conditions or further 
+ * information please contact slock.it at in3@slock.it.
+ * 	
+ * Alternatively, this file may be used under the AGPL license as follows:
+ *    
+ * AGPL LICENSE USAGE
+ * 
+ * This program is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Affero General Public License as published by the Free Software 
+ * Foundation, either version 3 of the License, or (at your option) any later version.
+ *  
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY 
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A 
+ * PARTICULAR PURPOSE. See the GNU Affero General Public License for more details.
+ * [Permissions of this strong copyleft license are conditioned on making available 
+ * complete source code of licensed works and modifications, which include larger 
+ * works using a licensed work, under the same license. Copyright and license notices 
+ * must be preserved. Contributors provide an express grant of patent rights.]
+ * You should have received a copy of the GNU Affero General Public License along 
+ * with this program. If not, see <https://www.gnu.org/licenses/>.
+ *******************************************************************************/
+
+/** @file 
+ * compares the latency of the ipc-transport with the http-transport for a node on the same host.
+ * 
+ * A child process serves `eth_blockNumber` over a unix domain socket and http on loopback.
+ * 
+ * usage: bench_transport [number of requests]
+ * */
+
+#include "../../src/core/client/client.h"
+#include "../../src/core/util/mem.h"
+#include "../../src/core/util/utils.h"
+#include "../../src/transport/ipc/in3_ipc.h"
+#include "../../src/verifier/eth1/nano/eth_nano.h"
+#ifdef USE_CURL
+#include "../../src/transport/curl/in3_curl.h"
+#define send_loopback send_curl
+#else
+#include "../../src/transport/http/in3_http.h"
+#define send_loopback send_http
+#endif
+#include <inttypes.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#define MAX_CLIENTS 16
+
+typedef struct {
+  int  fd;
+  bool http;
+  char buf[8192];
+  int  len;
+} client_t;
+
+static uint64_t now_us() {
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec * 1000000L + tv.tv_usec;
+}
+
+static int create_response(char* dst, const char* req) {
+  const char* id = strstr(req, "\"id\":");
+  return sprintf(dst, "[{\"id\":%d,\"jsonrpc\":\"2.0\",\"result\":\"0xa3f1b2\"}]", id ? atoi(id + 5) : 1);
+}
+
+/** handles the buffered request and returns the number of bytes consumed */
+static int handle(client_t* cl) {
+  char body[256], out[512];
+  cl->buf[cl->len] = 0;
+  if (cl->http) {
+    char* end = strstr(cl->buf, "\r\n\r\n");
+    if (!end) return 0;
+    char* cl_header = strstr(cl->buf, "Content-Length:");
+    int   body_len  = cl_header ? atoi(cl_header + 15) : 0;
+    int   total     = end + 4 - cl->buf + body_len;
+    if (cl->len < total) return 0;
+    int l = create_response(body, end + 4);
+    l     = sprintf(out, "HTTP/1.1 200 OK\r\nContent-Type: application/json\r\nContent-Length: %d\r\n\r\n%s", l, body);
+    if (write(cl->fd, out, l) != l) return -1;
+    return total;
+  }
+  char* end = strchr(cl->buf, '\n');
+  if (!end) return 0;
+  int l = create_response(out, cl->buf);
+  if (write(cl->fd, out, l) != l) return -1;
+  return end + 1 - cl->buf;
+}
+
+static void serve(int http_fd, int ipc_fd) {
+  client_t      clients[MAX_CLIENTS];
+  struct pollfd fds[MAX_CLIENTS + 2];
+  int           n = 0, polled;
+  while (true) {
+    fds[0] = (struct pollfd){.fd = http_fd, .events = POLLIN};
+    fds[1] = (struct pollfd){.fd = ipc_fd, .events = POLLIN};
+    for (int i = 0; i < n; i++) fds[i + 2] = (struct pollfd){.fd = clients[i].fd, .events = POLLIN};
+    if (poll(fds, n + 2, -1) < 0) continue;
+    polled = n;
+    for (int i = 0; i < 2; i++) {
+      if (fds[i].revents & POLLIN && n < MAX_CLIENTS) {
+        clients[n++] = (client_t){.fd = accept(fds[i].fd, NULL, NULL), .http = i == 0, .len = 0};
+      }
+    }
+    for (int i = polled - 1; i >= 0; i--) {
+      if (!fds[i + 2].revents) continue;
+      client_t* cl = clients + i;
+      int       r  = read(cl->fd, cl->buf + cl->len, sizeof(cl->buf) - 1 - cl->len);
+      if (r <= 0) {
+        close(cl->fd);
+        clients[i] = clients[--n];
+        continue;
+      }
+      cl->len += r;
+      while ((r = handle(cl)) > 0) {
+        memmove(cl->buf, cl->buf + r, cl->len - r);
+        cl->len -= r;
+      }
+    }
+  }
+}
+
+static int cmp_u64(const void* a, const void* b) {
+  uint64_t x = *(const uint64_t*) a, y = *(const uint64_t*) b;
+  return x < y ? -1 : (x > y);
+}
+
+static void bench(const char* name, const char* url, in3_transport_send transport, int count) {
+  in3_t*    c      = in3_for_chain_default(CHAIN_ID_LOCAL);
+  uint64_t* times  = _malloc(sizeof(uint64_t) * count);
+  char      config[300];
+  sprintf(config, "{\"rpc\":\"%s\",\"proof\":\"none\",\"requestCount\":1,\"maxAttempts\":1}", url);
+  char* error = in3_configure(c, config);
+  if (error) {
+    printf("invalid config: %s\n", error);
+    exit(EXIT_FAILURE);
+  }
+  c->transport = transport;
+
+  for (int i = -10; i < count; i++) {
+    char *   result = NULL, *err = NULL;
+    uint64_t start  = now_us();
+    if (in3_client_rpc(c, "eth_blockNumber", "[]", &result, &err) != IN3_OK) {
+      printf("%s failed: %s\n", name, err ? err : "unknown error");
+      exit(EXIT_FAILURE);
+    }
+    if (i >= 0) times[i] = now_us() - start;
+    _free(result);
+  }
+
+  uint64_t total = 0;
+  for (int i = 0; i < count; i++) total += times[i];
+  qsort(times, count, sizeof(uint64_t), cmp_u64);
+  printf("%-6s: avg %6.1f us   p50 %6" PRIu64 " us   p99 %6" PRIu64 " us\n", name, (double) total / count, times[count / 2], times[count * 99 / 100]);
+  _free(times);
+  in3_free(c);
+}
+
+int main(int argc, char* argv[]) {
+  int                count = argc > 1 ? atoi(argv[1]) : 10000;
+  char               ipc_url[128], http_url[128];
+  struct sockaddr_un ipc_addr  = {.sun_family = AF_UNIX};
+  struct sockaddr_in http_addr = {.sin_family = AF_INET, .sin_addr.s_addr = htonl(INADDR_LOOPBACK)};
+  socklen_t          len       = sizeof(http_addr);
+
+  sprintf(ipc_addr.sun_path, "/tmp/in3_bench_%d.ipc", (int) getpid());
+  int ipc_fd  = socket(AF_UNIX, SOCK_STREAM, 0);
+  int http_fd = socket(AF_INET, SOCK_STREAM, 0);
+  if (bind(ipc_fd, (struct sockaddr*) &ipc_addr, sizeof(ipc_addr)) || listen(ipc_fd, 16) ||
+      bind(http_fd, (struct sockaddr*) &http_addr, sizeof(http_addr)) || listen(http_fd, 16) ||
+      getsockname(http_fd, (struct sockaddr*) &http_addr, &len)) {
+    perror("could not create the sockets");
+    return EXIT_FAILURE;
+  }
+  sprintf(ipc_url, "ipc://%s", ipc_addr.sun_path);
+  sprintf(http_url, "http://127.0.0.1:%d", ntohs(http_addr.sin_port));
+
+  pid_t pid = fork();
+  if (pid == 0) serve(http_fd, ipc_fd);
+  close(ipc_fd);
+  close(http_fd);
+
+  in3_register_eth_nano();
+  printf("%d requests of eth_blockNumber\n", count);
+  bench("ipc", ipc_url, send_ipc, count);
+  bench("http", http_url, send_loopback, count);
+
+  kill(pid, SIGTERM);
+  waitpid(pid, NULL, 0);
+  unlink(ipc_addr.sun_path);
+  return EXIT_SUCCESS;
+}
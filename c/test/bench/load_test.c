@@ -0,0 +1,316 @@
+/*******************************************************************************
+ * This file is part of the Incubed project.
+ * Sources: https://github.com/slockit/in3-c
+ * 
+ * Copyright (C) 2018-2020 slock.it GmbH, Blockchains LLC
+ * 
+ * 
+ * COMMERCIAL LICENSE USAGE
+ * 
+ * Licensees holding a valid commercial license may use this file in accordance 
+ * with the commercial license agreement provided with the Software or, alternatively, 
+ * in accordance with the terms contained in a written agreement between you and 
+ * slock.it GmbH/Blockchains LLC. For licensing terms and conditions or further 
+ * information please contact slock.it at in3@slock.it.
+ * 	
+ * Alternatively, this file may be used under the AGPL license as follows:
+ *    
+ * AGPL LICENSE USAGE
+ * 
+ * This program is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Affero General Public License as published by the Free Software 
+ * Foundation, either version 3 of the License, or (at your option) any later version.
+ *  
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY 
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A 
+ * PARTICULAR PURPOSE. See the GNU Affero General Public License for more details.
+ * [Permissions of this strong copyleft license are conditioned on making available 
+ * complete source code of licensed works and modifications, which include larger 
+ * works using a licensed work, under the same license. Copyright and license notices 
+ * must be preserved. Contributors provide an express grant of patent rights.]
+ * You should have received a copy of the GNU Affero General Public License along 
+ * with this program. If not, see <https://www.gnu.org/licenses/>.
+ *******************************************************************************/
+
+/** @file 
+ * drives incubed clients with a constant rate of requests against a node (usually the mock_server) and reports the latencies.
+ * 
+ * The requests are taken from the same recorded testdata the mock_server uses. Each thread uses its own client.
+ * Requests are scheduled at a fixed rate and the latency is measured from the scheduled time,
+ * so a slow client can not hide its latency by sending less requests.
+ * 
+ * usage: load_test [options]
+ * 
+ * | option | description | default |
+ * |--------|-------------|---------|
+ * | -u URL | the base url of the server. the nodes use `URL/nd-<index>` | http://127.0.0.1:8545 |
+ * | -n NODES | number of nodes in the nodelist | 10 |
+ * | -q QPS | requests per second | 100 |
+ * | -t SECONDS | duration of the test | 10 |
+ * | -c THREADS | number of threads | 8 |
+ * | -m METHOD | only send requests with this method, may be used more than once | all eth_-methods |
+ * | -d DIR | directory with recorded requests, may be used more than once | testdata/requests and testdata/mock |
+ * | -C CONFIG | additional client configuration as json | |
+ * */
+
+#include "../../src/core/client/client.h"
+#include "../../src/core/client/context.h"
+#include "../../src/core/util/mem.h"
+#include "../../src/core/util/stringbuilder.h"
+#include "../../src/core/util/utils.h"
+#include "../../src/verifier/eth1/nano/eth_nano.h"
+#include "recorded.h"
+#ifdef USE_CURL
+#include "../../src/transport/curl/in3_curl.h"
+#define send_transport send_curl
+#else
+#include "../../src/transport/http/in3_http.h"
+#define send_transport send_http
+#endif
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/time.h>
+#include <time.h>
+#include <unistd.h>
+
+#ifndef TESTDATA_DIR
+#define TESTDATA_DIR "../c/test/testdata"
+#endif
+#define MAX_ARGS 16
+#define MAX_ERRORS 32 // number of different error codes we count
+
+typedef struct {
+  int          index;
+  in3_t*       client;
+  recorded_t** requests;
+  int          requests_len;
+  int          threads;
+  double       qps;
+  uint64_t     start;
+  uint64_t     end;
+  uint64_t*    latencies; /**< the latency in us for each request */
+  int          len;
+  int          allocated;
+  uint64_t     errors[MAX_ERRORS];
+} worker_t;
+
+static uint64_t now_us() {
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec * 1000000L + tv.tv_usec;
+}
+
+static void sleep_until(uint64_t t) {
+  uint64_t now = now_us();
+  if (t <= now) return;
+  struct timespec ts = {.tv_sec = (t - now) / 1000000, .tv_nsec = ((t - now) % 1000000) * 1000};
+  nanosleep(&ts, NULL);
+}
+
+static uint64_t cpu_us() {
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000000L + usage.ru_utime.tv_usec + usage.ru_stime.tv_usec;
+}
+
+static long rss_kb() {
+  long  pages = 0, rss = 0;
+  FILE* f     = fopen("/proc/self/statm", "r");
+  if (!f) return 0;
+  if (fscanf(f, "%ld %ld", &pages, &rss) != 2) rss = 0;
+  fclose(f);
+  return rss * (sysconf(_SC_PAGESIZE) / 1024);
+}
+
+static void* run_worker(void* arg) {
+  worker_t* w = arg;
+  in3_t*    c = w->client;
+
+  // the requests are distributed over all threads
+  for (uint64_t n = w->index;; n += w->threads) {
+    uint64_t scheduled = w->start + (uint64_t)(n * 1000000 / w->qps);
+    if (scheduled >= w->end) break;
+    sleep_until(scheduled);
+
+    recorded_t* r      = w->requests[n % w->requests_len];
+    char *      result = NULL, *error = NULL;
+    in3_ret_t   res    = in3_client_rpc(c, r->method, r->params, &result, &error);
+    if (w->len == w->allocated) {
+      w->latencies = _realloc(w->latencies, sizeof(uint64_t) * (w->allocated * 2 + 1024), sizeof(uint64_t) * w->allocated);
+      w->allocated = w->allocated * 2 + 1024;
+    }
+    w->latencies[w->len++] = now_us() - scheduled;
+    if (res) w->errors[min(-res, MAX_ERRORS - 1)]++;
+    if (result) _free(result);
+    if (error) _free(error);
+  }
+  return NULL;
+}
+
+static int cmp_u64(const void* a, const void* b) {
+  uint64_t x = *(const uint64_t*) a, y = *(const uint64_t*) b;
+  return x < y ? -1 : (x > y);
+}
+
+static void print_histogram(uint64_t* latencies, int len) {
+  int buckets[40] = {0}, max_bucket = 0, max_count = 0;
+  for (int i = 0; i < len; i++) {
+    int b = 0;
+    for (uint64_t v = latencies[i]; v > 1 && b < 39; v >>= 1) b++;
+    buckets[b]++;
+    max_bucket = max(max_bucket, b);
+    max_count  = max(max_count, buckets[b]);
+  }
+  printf("\nlatency histogram:\n");
+  for (int b = 0; b <= max_bucket; b++) {
+    if (!buckets[b] && b < max_bucket && !buckets[b + 1]) continue;
+    printf("  < %9" PRIu64 " us %8d ", (uint64_t) 2 << b, buckets[b]);
+    for (int i = 0; i < buckets[b] * 50 / max(max_count, 1); i++) putchar('#');
+    putchar('\n');
+  }
+}
+
+static char* create_config(const char* url, int nodes, const char* extra) {
+  sb_t sb = {0};
+  char tmp[300];
+  sb_add_chars(&sb, "{\"proof\":\"none\",\"autoUpdateList\":false,\"nodes\":{\"0x1\":{\"needsUpdate\":false,\"nodeList\":[");
+  for (int i = 0; i < nodes; i++) {
+    sprintf(tmp, "%s{\"url\":\"%s/nd-%d\",\"address\":\"0x%040x\",\"props\":\"0xffff\"}", i ? "," : "", url, i, i + 1);
+    sb_add_chars(&sb, tmp);
+  }
+  sb_add_chars(&sb, "]}}}");
+  if (!extra) return sb.data;
+
+  // we merge the extra config
+  sb.data[sb.len - 1] = ',';
+  sb_add_chars(&sb, strchr(extra, '{') + 1);
+  return sb.data;
+}
+
+static void usage(const char* name) {
+  fprintf(stderr, "usage: %s [-u url] [-n nodes] [-q qps] [-t seconds] [-c threads] [-m method]... [-d dir]... [-C config]\n", name);
+  exit(EXIT_FAILURE);
+}
+
+int main(int argc, char* argv[]) {
+  const char *    url = "http://127.0.0.1:8545", *extra = NULL, *methods[MAX_ARGS], *dirs[MAX_ARGS];
+  int             nodes = 10, threads = 8, methods_len = 0, dirs_len = 0;
+  double          qps = 100, duration = 10;
+  recorded_list_t recorded = {0};
+
+  for (int i = 1; i < argc; i++) {
+    if (i + 1 >= argc) usage(argv[0]);
+    char* arg = argv[i];
+    char* val = argv[++i];
+    if (!strcmp(arg, "-u"))
+      url = val;
+    else if (!strcmp(arg, "-n"))
+      nodes = atoi(val);
+    else if (!strcmp(arg, "-q"))
+      qps = atof(val);
+    else if (!strcmp(arg, "-t"))
+      duration = atof(val);
+    else if (!strcmp(arg, "-c"))
+      threads = atoi(val);
+    else if (!strcmp(arg, "-m") && methods_len < MAX_ARGS)
+      methods[methods_len++] = val;
+    else if (!strcmp(arg, "-d") && dirs_len < MAX_ARGS)
+      dirs[dirs_len++] = val;
+    else if (!strcmp(arg, "-C"))
+      extra = val;
+    else
+      usage(argv[0]);
+  }
+  if (nodes < 1 || threads < 1 || qps <= 0 || duration <= 0) usage(argv[0]);
+  if (!dirs_len) {
+    dirs[dirs_len++] = TESTDATA_DIR "/requests";
+    dirs[dirs_len++] = TESTDATA_DIR "/mock";
+  }
+  for (int i = 0; i < dirs_len; i++) recorded_load_dir(&recorded, dirs[i]);
+
+  // select the requests to send
+  recorded_t** requests     = _malloc(sizeof(recorded_t*) * (recorded.len + 1));
+  int          requests_len = 0;
+  for (int i = 0; i < recorded.len; i++) {
+    bool match = !methods_len && !strncmp(recorded.entries[i].method, "eth_", 4);
+    for (int m = 0; m < methods_len && !match; m++) match = !strcmp(methods[m], recorded.entries[i].method);
+    if (match) requests[requests_len++] = recorded.entries + i;
+  }
+  if (!requests_len) {
+    fprintf(stderr, "no recorded requests found\n");
+    return EXIT_FAILURE;
+  }
+
+  // each thread gets its own client, which are configured before we start, since the json-parser uses a global key-cache.
+  in3_register_eth_nano();
+  char*      config = create_config(url, nodes, extra);
+  worker_t*  w      = _calloc(threads, sizeof(worker_t));
+  pthread_t* ids    = _malloc(sizeof(pthread_t) * threads);
+  long       rss    = rss_kb();
+  for (int i = 0; i < threads; i++) {
+    in3_t* c   = in3_for_chain_default(CHAIN_ID_MAINNET);
+    char*  err = in3_configure(c, config);
+    if (err) {
+      fprintf(stderr, "invalid config: %s\n", err);
+      return EXIT_FAILURE;
+    }
+    c->transport = send_transport;
+    w[i]         = (worker_t){.index = i, .client = c, .requests = requests, .requests_len = requests_len, .threads = threads, .qps = qps};
+  }
+
+  printf("sending %.0f requests/s for %.0fs with %d threads to %d nodes using %d different requests\n", qps, duration, threads, nodes, requests_len);
+  uint64_t cpu   = cpu_us();
+  uint64_t start = now_us() + 100000; // give the threads time to start
+  for (int i = 0; i < threads; i++) {
+    w[i].start = start;
+    w[i].end   = start + (uint64_t)(duration * 1000000);
+    pthread_create(ids + i, NULL, run_worker, w + i);
+  }
+
+  // collect the results
+  uint64_t  errors[MAX_ERRORS] = {0}, total_errors = 0;
+  int       len                = 0;
+  uint64_t* all                = NULL;
+  for (int i = 0; i < threads; i++) {
+    pthread_join(ids[i], NULL);
+    all = _realloc(all, sizeof(uint64_t) * (len + w[i].len + 1), sizeof(uint64_t) * len);
+    if (w[i].len) memcpy(all + len, w[i].latencies, sizeof(uint64_t) * w[i].len);
+    len += w[i].len;
+    for (int e = 0; e < MAX_ERRORS; e++) errors[e] += w[i].errors[e];
+    if (w[i].latencies) _free(w[i].latencies);
+  }
+  cpu            = cpu_us() - cpu;
+  double elapsed = (now_us() - start) / 1000000.0;
+
+  // report
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  qsort(all, len, sizeof(uint64_t), cmp_u64);
+  for (int e = 0; e < MAX_ERRORS; e++) total_errors += errors[e];
+  in3_transport_stats_t stats = in3_get_transport_stats();
+
+  printf("\nrequests   : %d in %.2fs (%.1f/s), %" PRIu64 " failed\n", len, elapsed, len / elapsed, total_errors);
+  if (len)
+    printf("latency    : p50 %.2fms  p90 %.2fms  p99 %.2fms  p99.9 %.2fms  max %.2fms\n",
+           all[len / 2] / 1000.0, all[len * 90 / 100] / 1000.0, all[len * 99 / 100] / 1000.0, all[len * 999 / 1000] / 1000.0, all[len - 1] / 1000.0);
+  printf("cpu        : %.1f us per request (%.1f%% of one core)\n", len ? (double) cpu / len : 0.0, cpu / elapsed / 10000.0);
+  printf("memory     : %ld kB rss (+%ld kB), %ld kB max rss\n", rss_kb(), rss_kb() - rss, usage.ru_maxrss);
+  printf("transferred: %" PRIu64 " bytes sent, %" PRIu64 " bytes received (%" PRIu64 " on the wire)\n", stats.bytes_sent, stats.bytes_received, stats.bytes_received_wire);
+  for (int e = 1; e < MAX_ERRORS; e++) {
+    if (errors[e]) printf("  %8" PRIu64 " x %s\n", errors[e], in3_errmsg(-e) ? in3_errmsg(-e) : "unknown error");
+  }
+  if (len) print_histogram(all, len);
+
+  for (int i = 0; i < threads; i++) in3_free(w[i].client);
+  _free(all);
+  _free(w);
+  _free(ids);
+  _free(config);
+  _free(requests);
+  recorded_free(&recorded);
+  return total_errors ? EXIT_FAILURE : EXIT_SUCCESS;
+}
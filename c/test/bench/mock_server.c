@@ -0,0 +1,445 @@
+/*******************************************************************************
+ * This file is part of the Incubed project.
+ * Sources: https://github.com/slockit/in3-c
+ * 
+ * Copyright (C) 2018-2020 slock.it GmbH, Blockchains LLC
+ * 
+ * 
+ * COMMERCIAL LICENSE USAGE
+ * 
+ * Licensees holding a valid commercial license may use this file in accordance 
+ * with the commercial license agreement provided with the Software or, alternatively, 
+ * in accordance with the terms contained in a written agreement between you and 
+ * slock.it GmbH/Blockchains LLC. For licensing terms and conditions or further 
+ * information please contact slock.it at in3@slock.it.
+ * 	
+ * Alternatively, this file may be used under the AGPL license as follows:
+ *    
+ * AGPL LICENSE USAGE
+ * 
+ * This program is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Affero General Public License as published by the Free Software 
+ * Foundation, either version 3 of the License, or (at your option) any later version.
+ *  
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY 
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A 
+ * PARTICULAR PURPOSE. See the GNU Affero General Public License for more details.
+ * [Permissions of this strong copyleft license are conditioned on making available 
+ * complete source code of licensed works and modifications, which include larger 
+ * works using a licensed work, under the same license. Copyright and license notices 
+ * must be preserved. Contributors provide an express grant of patent rights.]
+ * You should have received a copy of the GNU Affero General Public License along 
+ * with this program. If not, see <https://www.gnu.org/licenses/>.
+ *******************************************************************************/
+
+/** @file 
+ * a mock in3-server serving the recorded responses from the testdata for any number of node-urls.
+ * 
+ * All requests to `http://127.0.0.1:<port>/<anything>` are answered. If the path contains a number (like `/nd-12`),
+ * it is used as index of the node, which allows to simulate slow nodes.
+ * 
+ * usage: mock_server [options]
+ * 
+ * | option | description | default |
+ * |--------|-------------|---------|
+ * | -p PORT | the port to listen on | 8545 |
+ * | -d DIR | directory with recorded requests, may be used more than once | testdata/requests and testdata/mock |
+ * | -l DIST | latency distribution in ms : `fixed:MS`, `uniform:MIN:MAX`, `normal:MEAN:STDDEV` or `exp:MEAN` | fixed:0 |
+ * | -s SHARE:FACTOR | the share (0..1) of nodes which are slower by the given factor | 0:1 |
+ * | -e RATE | share of the requests answered with a http-error 500 | 0 |
+ * | -g RATE | share of the requests answered with invalid json | 0 |
+ * | -b BYTES | bandwidth limit per connection in bytes per second | 0 (no limit) |
+ * | -r SEED | seed for the random generator | 1 |
+ * 
+ * The server stops on SIGINT or SIGTERM and prints the number of handled requests.
+ * */
+
+#include "../../src/core/util/data.h"
+#include "../../src/core/util/mem.h"
+#include "../../src/core/util/stringbuilder.h"
+#include "../../src/core/util/utils.h"
+#include "recorded.h"
+#include <errno.h>
+#include <inttypes.h>
+#include <math.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#ifndef TESTDATA_DIR
+#define TESTDATA_DIR "../c/test/testdata"
+#endif
+#define MAX_DIRS 8
+#define MIN_CHUNK 1024 // min number of bytes to write when the bandwidth is limited
+
+typedef enum {
+  DIST_FIXED,
+  DIST_UNIFORM,
+  DIST_NORMAL,
+  DIST_EXP
+} dist_type_t;
+
+typedef struct {
+  dist_type_t type;
+  double      a;
+  double      b;
+} dist_t;
+
+typedef struct {
+  int      fd;
+  int      node;        /**< index of the node taken from the url */
+  sb_t     in;          /**< received, but not handled data */
+  char*    out;         /**< the response to send */
+  size_t   out_len;     /**< length of the response */
+  size_t   out_sent;    /**< bytes already sent */
+  uint64_t ready_at;    /**< time in us, when we may start to send the response */
+  bool     close_after; /**< close the connection after sending the response */
+} con_t;
+
+typedef struct {
+  recorded_list_t recorded;
+  dist_t          latency;
+  double          slow_share;
+  double          slow_factor;
+  double          error_rate;
+  double          garbage_rate;
+  uint64_t        bandwidth;
+  uint64_t        rnd;
+  con_t*          cons;
+  int             len;
+  uint64_t        requests, errors, garbage, missing, bytes;
+} server_t;
+
+static volatile sig_atomic_t running = 1;
+
+static void stop(int sig) {
+  UNUSED_VAR(sig);
+  running = 0;
+}
+
+static uint64_t now_us() {
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec * 1000000L + tv.tv_usec;
+}
+
+/** xorshift64* , which is good enough to simulate the network */
+static double rnd(server_t* s) {
+  s->rnd ^= s->rnd >> 12;
+  s->rnd ^= s->rnd << 25;
+  s->rnd ^= s->rnd >> 27;
+  return (double) ((s->rnd * 0x2545F4914F6CDD1DULL) >> 11) / (double) (1ULL << 53);
+}
+
+static double sample(server_t* s, const dist_t* d) {
+  double v = 0;
+  switch (d->type) {
+    case DIST_FIXED: v = d->a; break;
+    case DIST_UNIFORM: v = d->a + (d->b - d->a) * rnd(s); break;
+    case DIST_NORMAL: v = d->a + d->b * sqrt(-2 * log(1 - rnd(s))) * cos(2 * M_PI * rnd(s)); break;
+    case DIST_EXP: v = -d->a * log(1 - rnd(s)); break;
+  }
+  return v < 0 ? 0 : v;
+}
+
+static bool parse_dist(const char* spec, dist_t* d) {
+  *d = (dist_t){0};
+  if (sscanf(spec, "fixed:%lf", &d->a) == 1)
+    d->type = DIST_FIXED;
+  else if (sscanf(spec, "uniform:%lf:%lf", &d->a, &d->b) == 2)
+    d->type = DIST_UNIFORM;
+  else if (sscanf(spec, "normal:%lf:%lf", &d->a, &d->b) == 2)
+    d->type = DIST_NORMAL;
+  else if (sscanf(spec, "exp:%lf", &d->a) == 1)
+    d->type = DIST_EXP;
+  else
+    return false;
+  return true;
+}
+
+static bool is_slow_node(server_t* s, int node) {
+  // a simple hash, so the slow nodes are spread over the indexes
+  uint32_t h = (uint32_t) node * 2654435761U;
+  return s->slow_share > 0 && (h % 10000) < s->slow_share * 10000;
+}
+
+static void add_response(server_t* s, sb_t* sb, d_token_t* request) {
+  char*       method = d_get_string(request, "method");
+  d_token_t*  params = d_get(request, key("params"));
+  char*       p      = NULL;
+  recorded_t* found  = NULL;
+  if (method) {
+    if (params) {
+      str_range_t r = d_to_json(params);
+      p             = _strdupn(r.data, r.len);
+    }
+    char* k = recorded_key(method, p);
+    found   = recorded_find(&s->recorded, method, k);
+    _free(k);
+    _free(p);
+  }
+  if (found)
+    sb_add_chars(sb, found->response);
+  else {
+    s->missing++;
+    sb_add_chars(sb, "{\"id\":1,\"jsonrpc\":\"2.0\",\"error\":{\"code\":-32601,\"message\":\"no recorded response for ");
+    sb_add_chars(sb, method ? method : "invalid request");
+    sb_add_chars(sb, "\"}}");
+  }
+}
+
+static void create_response(server_t* s, con_t* con, const char* body) {
+  sb_t        res = {0}, out = {0};
+  int         status;
+  json_ctx_t* json = parse_json(body);
+  s->requests++;
+
+  if (rnd(s) < s->error_rate) {
+    s->errors++;
+    status = 500;
+    sb_add_chars(&res, "{\"jsonrpc\":\"2.0\",\"id\":1,\"error\":{\"code\":-32603,\"message\":\"simulated server error\"}}");
+  } else if (!json) {
+    status = 400;
+    sb_add_chars(&res, "{\"jsonrpc\":\"2.0\",\"id\":1,\"error\":{\"code\":-32700,\"message\":\"invalid json\"}}");
+  } else {
+    status = 200;
+    if (d_type(json->result) == T_ARRAY) {
+      sb_add_char(&res, '[');
+      for (d_iterator_t iter = d_iter(json->result); iter.left; d_iter_next(&iter)) {
+        if (res.len > 1) sb_add_char(&res, ',');
+        add_response(s, &res, iter.token);
+      }
+      sb_add_char(&res, ']');
+    } else
+      add_response(s, &res, json->result);
+
+    // garbage is a truncated response with some random bytes
+    if (rnd(s) < s->garbage_rate) {
+      s->garbage++;
+      res.len = (size_t)(rnd(s) * res.len);
+      for (int i = 0; i < 16; i++) sb_add_char(&res, (char) (33 + rnd(s) * 90));
+    }
+  }
+  if (json) json_free(json);
+
+  char header[200];
+  sprintf(header, "HTTP/1.1 %d %s\r\nContent-Type: application/json\r\nContent-Length: %u\r\nConnection: %s\r\n\r\n",
+          status, status == 200 ? "OK" : (status == 500 ? "Internal Server Error" : "Bad Request"), (unsigned int) res.len, con->close_after ? "close" : "keep-alive");
+  sb_add_chars(&out, header);
+  if (res.len) sb_add_range(&out, res.data, 0, res.len);
+  if (res.data) _free(res.data);
+
+  double latency = sample(s, &s->latency) * (is_slow_node(s, con->node) ? s->slow_factor : 1);
+  con->out       = out.data;
+  con->out_len   = out.len;
+  con->out_sent  = 0;
+  con->ready_at  = now_us() + (uint64_t)(latency * 1000);
+}
+
+/** checks if the buffer contains a complete request and prepares the response */
+static void handle_request(server_t* s, con_t* con) {
+  if (con->out || !con->in.len) return;
+  char* end = strstr(con->in.data, "\r\n\r\n");
+  if (!end) return;
+  *end                = 0;
+  char*  cl           = strstr(con->in.data, "Content-Length:");
+  char*  path         = strchr(con->in.data, ' ');
+  size_t header_len   = end + 4 - con->in.data;
+  size_t body_len     = cl ? (size_t) atol(cl + 15) : 0;
+  bool   close_header = strstr(con->in.data, "Connection: close") != NULL;
+  *end                = '\r';
+  if (con->in.len < header_len + body_len) return;
+
+  // take the node index from the path
+  con->node = 0;
+  if (path) {
+    for (char* c = path + 1; *c && *c != ' '; c++) {
+      if (*c >= '0' && *c <= '9') con->node = con->node * 10 + (*c - '0');
+    }
+  }
+
+  char* body = _strdupn(con->in.data + header_len, body_len);
+  con->close_after = close_header;
+  create_response(s, con, body);
+  _free(body);
+
+  // keep what belongs to the next request
+  memmove(con->in.data, con->in.data + header_len + body_len, con->in.len - header_len - body_len);
+  con->in.len -= header_len + body_len;
+  con->in.data[con->in.len] = 0;
+}
+
+static void con_close(server_t* s, int i) {
+  con_t* con = s->cons + i;
+  close(con->fd);
+  if (con->in.data) _free(con->in.data);
+  if (con->out) _free(con->out);
+  s->cons[i] = s->cons[--s->len];
+}
+
+/** returns the number of bytes we may send now or the time to wait in us as negative value */
+static int64_t allowed_bytes(server_t* s, con_t* con, uint64_t now) {
+  if (now < con->ready_at) return -(int64_t)(con->ready_at - now);
+  size_t left = con->out_len - con->out_sent;
+  if (!s->bandwidth) return left;
+  uint64_t budget = (now - con->ready_at) * s->bandwidth / 1000000;
+  size_t   chunk  = left < MIN_CHUNK ? left : MIN_CHUNK;
+  if (budget >= con->out_sent + chunk) return min(budget - con->out_sent, left);
+  return -(int64_t)((con->out_sent + chunk) * 1000000 / s->bandwidth + con->ready_at - now);
+}
+
+/** returns false if the connection was closed */
+static bool con_write(server_t* s, int i, uint64_t now) {
+  con_t*  con = s->cons + i;
+  int64_t n   = allowed_bytes(s, con, now);
+  if (n <= 0) return true;
+  ssize_t w = send(con->fd, con->out + con->out_sent, n, MSG_NOSIGNAL);
+  if (w < 0) {
+    if (errno == EAGAIN || errno == EINTR) return true;
+    con_close(s, i);
+    return false;
+  }
+  s->bytes += w;
+  con->out_sent += w;
+  if (con->out_sent < con->out_len) return true;
+  _free(con->out);
+  con->out = NULL;
+  if (con->close_after) {
+    con_close(s, i);
+    return false;
+  }
+  handle_request(s, con); // a pipelined request may be waiting
+  return true;
+}
+
+static bool con_read(server_t* s, int i) {
+  con_t* con = s->cons + i;
+  char   buf[16384];
+  ssize_t r = recv(con->fd, buf, sizeof(buf), 0);
+  if (r <= 0) {
+    if (r < 0 && (errno == EAGAIN || errno == EINTR)) return true;
+    con_close(s, i);
+    return false;
+  }
+  sb_add_range(&con->in, buf, 0, r);
+  handle_request(s, con);
+  return true;
+}
+
+static void serve(server_t* s, int server_fd) {
+  struct pollfd* fds       = NULL;
+  int            allocated = 0;
+  while (running) {
+    if (allocated < s->len + 1) {
+      fds       = _realloc(fds, sizeof(struct pollfd) * (s->len + 16), sizeof(struct pollfd) * allocated);
+      allocated = s->len + 16;
+    }
+
+    // find the next timer
+    uint64_t now     = now_us();
+    int64_t  timeout = -1;
+    fds[0]           = (struct pollfd){.fd = server_fd, .events = POLLIN};
+    for (int i = 0; i < s->len; i++) {
+      con_t* con = s->cons + i;
+      fds[i + 1] = (struct pollfd){.fd = con->fd, .events = POLLIN};
+      if (!con->out) continue;
+      int64_t n = allowed_bytes(s, con, now);
+      if (n > 0)
+        fds[i + 1].events |= POLLOUT;
+      else if (timeout < 0 || -n < timeout)
+        timeout = -n;
+    }
+
+    int polled = s->len;
+    if (poll(fds, polled + 1, timeout < 0 ? -1 : (int) ((timeout + 999) / 1000)) < 0) continue;
+    now = now_us();
+
+    for (int i = polled - 1; i >= 0; i--) {
+      if (i >= s->len) continue;
+      if ((fds[i + 1].revents & (POLLIN | POLLHUP | POLLERR)) && !con_read(s, i)) continue;
+      if (s->cons[i].out) con_write(s, i, now);
+    }
+
+    if (fds[0].revents & POLLIN) {
+      int fd = accept(server_fd, NULL, NULL);
+      if (fd >= 0) {
+        s->cons          = _realloc(s->cons, sizeof(con_t) * (s->len + 1), sizeof(con_t) * s->len);
+        s->cons[s->len++] = (con_t){.fd = fd};
+      }
+    }
+  }
+  _free(fds);
+}
+
+static void usage(const char* name) {
+  fprintf(stderr, "usage: %s [-p port] [-d dir]... [-l fixed:MS|uniform:MIN:MAX|normal:MEAN:STDDEV|exp:MEAN] [-s SHARE:FACTOR] [-e RATE] [-g RATE] [-b BYTES_PER_SEC] [-r SEED]\n", name);
+  exit(EXIT_FAILURE);
+}
+
+int main(int argc, char* argv[]) {
+  server_t    s        = {.latency = {.type = DIST_FIXED}, .slow_factor = 1, .rnd = 1};
+  const char* dirs[MAX_DIRS];
+  int         dirs_len = 0, port = 8545;
+
+  for (int i = 1; i < argc; i++) {
+    if (i + 1 >= argc) usage(argv[0]);
+    char* arg = argv[i];
+    char* val = argv[++i];
+    if (!strcmp(arg, "-p"))
+      port = atoi(val);
+    else if (!strcmp(arg, "-d") && dirs_len < MAX_DIRS)
+      dirs[dirs_len++] = val;
+    else if (!strcmp(arg, "-l")) {
+      if (!parse_dist(val, &s.latency)) usage(argv[0]);
+    } else if (!strcmp(arg, "-s")) {
+      if (sscanf(val, "%lf:%lf", &s.slow_share, &s.slow_factor) != 2) usage(argv[0]);
+    } else if (!strcmp(arg, "-e"))
+      s.error_rate = atof(val);
+    else if (!strcmp(arg, "-g"))
+      s.garbage_rate = atof(val);
+    else if (!strcmp(arg, "-b"))
+      s.bandwidth = atoll(val);
+    else if (!strcmp(arg, "-r"))
+      s.rnd = atoll(val) | 1;
+    else
+      usage(argv[0]);
+  }
+  if (!dirs_len) {
+    dirs[dirs_len++] = TESTDATA_DIR "/requests";
+    dirs[dirs_len++] = TESTDATA_DIR "/mock";
+  }
+  for (int i = 0; i < dirs_len; i++) {
+    if (recorded_load_dir(&s.recorded, dirs[i]) < 0) fprintf(stderr, "could not read %s\n", dirs[i]);
+  }
+
+  struct sockaddr_in addr = {.sin_family = AF_INET, .sin_addr.s_addr = htonl(INADDR_LOOPBACK), .sin_port = htons(port)};
+  int                fd   = socket(AF_INET, SOCK_STREAM, 0);
+  int                on   = 1;
+  setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+  if (bind(fd, (struct sockaddr*) &addr, sizeof(addr)) || listen(fd, 1024)) {
+    perror("could not listen");
+    return EXIT_FAILURE;
+  }
+
+  signal(SIGINT, stop);
+  signal(SIGTERM, stop);
+  signal(SIGPIPE, SIG_IGN);
+  printf("mock server listening on http://127.0.0.1:%d with %d recorded responses\n", port, s.recorded.len);
+  fflush(stdout);
+
+  serve(&s, fd);
+
+  printf("requests: %" PRIu64 "  errors: %" PRIu64 "  garbage: %" PRIu64 "  not recorded: %" PRIu64 "  bytes sent: %" PRIu64 "\n",
+         s.requests, s.errors, s.garbage, s.missing, s.bytes);
+  while (s.len) con_close(&s, 0);
+  if (s.cons) _free(s.cons);
+  close(fd);
+  recorded_free(&s.recorded);
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,158 @@
+/*******************************************************************************
+ * This file is part of the Incubed project.
+ * Sources: https://github.com/slockit/in3-c
+ * 
+ * Copyright (C) 2018-2020 slock.it GmbH, Blockchains LLC
+ * 
+ * 
+ * COMMERCIAL LICENSE USAGE
+ * 
+ * Licensees holding a valid commercial license may use this file in accordance 
+ * with the commercial license agreement provided with the Software or, alternatively, 
+ * in accordance with the terms contained in a written agreement between you and 
+ * slock.it GmbH/Blockchains LLC. For licensing terms and conditions or further 
+ * information please contact slock.it at in3@slock.it.
+ * 	
+ * Alternatively, this file may be used under the AGPL license as follows:
+ *    
+ * AGPL LICENSE USAGE
+ * 
+ * This program is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Affero General Public License as published by the Free Software 
+ * Foundation, either version 3 of the License, or (at your option) any later version.
+ *  
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY 
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A 
+ * PARTICULAR PURPOSE. See the GNU Affero General Public License for more details.
+ * [Permissions of this strong copyleft license are conditioned on making available 
+ * complete source code of licensed works and modifications, which include larger 
+ * works using a licensed work, under the same license. Copyright and license notices 
+ * must be preserved. Contributors provide an express grant of patent rights.]
+ * You should have received a copy of the GNU Affero General Public License along 
+ * with this program. If not, see <https://www.gnu.org/licenses/>.
+ *******************************************************************************/
+
+#include "recorded.h"
+#include "../../src/core/util/data.h"
+#include "../../src/core/util/mem.h"
+#include "../../src/core/util/stringbuilder.h"
+#include "../../src/core/util/utils.h"
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static char* read_file(const char* path) {
+  FILE* f = fopen(path, "r");
+  if (!f) return NULL;
+  fseek(f, 0, SEEK_END);
+  long len = ftell(f);
+  fseek(f, 0, SEEK_SET);
+  char* data = _malloc(len + 1);
+  len        = fread(data, 1, len, f);
+  data[len]  = 0;
+  fclose(f);
+  return data;
+}
+
+static char* range_dup(d_token_t* t) {
+  str_range_t r = d_to_json(t);
+  return _strdupn(r.data, r.len);
+}
+
+char* recorded_key(const char* method, const char* params) {
+  sb_t sb = {0};
+  sb_add_chars(&sb, method);
+  sb_add_char(&sb, ':');
+  d_track_keynames(1);
+  json_ctx_t* json = params ? parse_json(params) : NULL;
+  d_track_keynames(0);
+  if (json) {
+    char* p = d_create_json(json->result);
+    sb_add_chars(&sb, p);
+    _free(p);
+    json_free(json);
+  }
+  return sb.data;
+}
+
+static void add_entry(recorded_list_t* list, d_token_t* request, d_token_t* response) {
+  char*      method = d_get_string(request, "method");
+  d_token_t* params = d_get(request, key("params"));
+  if (!method || !response) return;
+
+  list->entries = _realloc(list->entries, sizeof(recorded_t) * (list->len + 1), sizeof(recorded_t) * list->len);
+  recorded_t* e = list->entries + list->len++;
+  e->method     = _strdupn(method, -1);
+  e->params     = params ? range_dup(params) : _strdupn("[]", -1);
+  e->key        = recorded_key(e->method, e->params);
+  e->response   = range_dup(response);
+}
+
+static void add_test(recorded_list_t* list, d_token_t* test) {
+  d_token_t* request  = d_get(test, key("request"));
+  d_token_t* response = d_get(test, key("response"));
+  if (d_type(request) == T_ARRAY && d_type(response) == T_ARRAY && d_len(request) == d_len(response)) {
+    // mock-format : the responses match the requests
+    for (int i = 0; i < d_len(request); i++) add_entry(list, d_get_at(request, i), d_get_at(response, i));
+  } else if (d_type(request) == T_OBJECT && d_type(response) == T_ARRAY && d_len(response) == 1)
+    // requests-format : only if there was no other request needed to get the response
+    add_entry(list, request, d_get_at(response, 0));
+}
+
+static int cmp_entry(const void* a, const void* b) {
+  return strcmp(((const recorded_t*) a)->key, ((const recorded_t*) b)->key);
+}
+
+int recorded_load_dir(recorded_list_t* list, const char* dir) {
+  DIR* d = opendir(dir);
+  if (!d) return -1;
+  int            start = list->len;
+  struct dirent* ent;
+  while ((ent = readdir(d))) {
+    size_t l = strlen(ent->d_name);
+    if (l < 6 || strcmp(ent->d_name + l - 5, ".json")) continue;
+
+    char path[1024];
+    snprintf(path, sizeof(path), "%s/%s", dir, ent->d_name);
+    char* content = read_file(path);
+    if (!content) continue;
+    d_track_keynames(1);
+    json_ctx_t* json = parse_json(content);
+    d_track_keynames(0);
+    if (json) {
+      if (d_type(json->result) == T_ARRAY) {
+        for (d_iterator_t iter = d_iter(json->result); iter.left; d_iter_next(&iter)) add_test(list, iter.token);
+      } else if (d_type(json->result) == T_OBJECT)
+        add_test(list, json->result);
+      json_free(json);
+    }
+    _free(content);
+  }
+  closedir(d);
+
+  // sort them, so we can find the responses with a binary search
+  qsort(list->entries, list->len, sizeof(recorded_t), cmp_entry);
+  return list->len - start;
+}
+
+recorded_t* recorded_find(recorded_list_t* list, const char* method, const char* key) {
+  recorded_t  search = {.key = (char*) key};
+  recorded_t* found  = key ? bsearch(&search, list->entries, list->len, sizeof(recorded_t), cmp_entry) : NULL;
+  for (int i = 0; !found && i < list->len; i++) {
+    if (strcmp(list->entries[i].method, method) == 0) found = list->entries + i;
+  }
+  return found;
+}
+
+void recorded_free(recorded_list_t* list) {
+  for (int i = 0; i < list->len; i++) {
+    _free(list->entries[i].method);
+    _free(list->entries[i].params);
+    _free(list->entries[i].key);
+    _free(list->entries[i].response);
+  }
+  if (list->entries) _free(list->entries);
+  list->entries = NULL;
+  list->len     = 0;
+}
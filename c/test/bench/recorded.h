@@ -0,0 +1,86 @@
+/*******************************************************************************
+ * This file is part of the Incubed project.
+ * Sources: https://github.com/slockit/in3-c
+ * 
+ * Copyright (C) 2018-2020 slock.it GmbH, Blockchains LLC
+ * 
+ * 
+ * COMMERCIAL LICENSE USAGE
+ * 
+ * Licensees holding a valid commercial license may use this file in accordance 
+ * with the commercial license agreement provided with the Software or, alternatively, 
+ * in accordance with the terms contained in a written agreement between you and 
+ * slock.it GmbH/Blockchains LLC. For licensing terms and conditions or further 
+ * information please contact slock.it at in3@slock.it.
+ * 	
+ * Alternatively, this file may be used under the AGPL license as follows:
+ *    
+ * AGPL LICENSE USAGE
+ * 
+ * This program is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Affero General Public License as published by the Free Software 
+ * Foundation, either version 3 of the License, or (at your option) any later version.
+ *  
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY 
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A 
+ * PARTICULAR PURPOSE. See the GNU Affero General Public License for more details.
+ * [Permissions of this strong copyleft license are conditioned on making available 
+ * complete source code of licensed works and modifications, which include larger 
+ * works using a licensed work, under the same license. Copyright and license notices 
+ * must be preserved. Contributors provide an express grant of patent rights.]
+ * You should have received a copy of the GNU Affero General Public License along 
+ * with this program. If not, see <https://www.gnu.org/licenses/>.
+ *******************************************************************************/
+
+/** @file 
+ * loads the recorded requests and responses from the testdata, which are used by the mock server and the load test.
+ * */
+
+#ifndef IN3_BENCH_RECORDED_H
+#define IN3_BENCH_RECORDED_H
+
+#include <stdint.h>
+
+/** a recorded request with its response. */
+typedef struct recorded {
+  char* method;   /**< the rpc-method */
+  char* params;   /**< the params as found in the file */
+  char* key;      /**< method and normalized params used to find the response */
+  char* response; /**< the json-response for this request */
+} recorded_t;
+
+/** all recorded requests */
+typedef struct recorded_list {
+  recorded_t* entries; /**< the entries */
+  int         len;     /**< number of entries */
+} recorded_list_t;
+
+/**
+ * reads all json-files within the directory and adds the requests with exactly one response.
+ * 
+ * Two formats are supported:
+ * - `testdata/requests`: `[{ "request": {...}, "response": [ {...} ] }]`
+ * - `testdata/mock`: `{ "request": [ {...} ], "response": [ {...} ] }`
+ * 
+ * returns the number of added entries or -1 if the directory could not be read.
+ */
+int recorded_load_dir(recorded_list_t* list, const char* dir);
+
+/**
+ * creates the key used to find the response for the request.
+ * 
+ * The result must be freed.
+ */
+char* recorded_key(const char* method, const char* params);
+
+/**
+ * finds the response for a request-key.
+ * 
+ * if there is no exact match, the first entry with the same method is returned.
+ */
+recorded_t* recorded_find(recorded_list_t* list, const char* method, const char* key);
+
+/** frees all entries */
+void recorded_free(recorded_list_t* list);
+
+#endif
@@ -434,15 +434,14 @@ int run_evm(d_token_t* test, uint32_t props, uint64_t* ms, char* fork_name, int
 
   // create vm
   evm_t evm;
-  evm.stack.b.data = _malloc(64);
-  evm.stack.b.len  = 0;
-  evm.stack.bsize  = 64;
+  evm.stack = _malloc(EVM_STACK_LIMIT * sizeof(evm_word_t));
 
   evm.memory.b.data = _calloc(32, 1);
   evm.memory.b.len  = 0;
   evm.memory.bsize  = 32;
 
-  evm.invalid_jumpdest = NULL;
+  evm.program  = NULL;
+  evm.programs = _calloc(1, sizeof(evm_programs_t));
 
   evm.stack_size = 0;
 
@@ -474,9 +473,11 @@ int run_evm(d_token_t* test, uint32_t props, uint64_t* ms, char* fork_name, int
 
 #ifdef EVM_GAS
     evm.accounts = NULL;
+    evm.index    = (evm_index_t){0};
     evm.gas      = d_get_long(exec, "gas");
     evm.code     = d_to_bytes(d_get(exec, K_CODE));
     evm.parent   = NULL;
+    evm.root     = NULL;
     evm.logs     = NULL;
     evm.init_gas = 0;
 #endif
@@ -512,8 +513,10 @@ int run_evm(d_token_t* test, uint32_t props, uint64_t* ms, char* fork_name, int
 
 #ifdef EVM_GAS
     evm.accounts = NULL;
+    evm.index    = (evm_index_t){0};
     evm.gas      = d_long(get_test_val(transaction, "gasLimit", indexes));
     evm.parent   = NULL;
+    evm.root     = NULL;
     evm.logs     = NULL;
     evm.refund   = 0;
     evm.init_gas = evm.gas;
@@ -558,6 +561,7 @@ int run_evm(d_token_t* test, uint32_t props, uint64_t* ms, char* fork_name, int
     l = big_add(txval, l, evm.call_value.data, evm.call_value.len, tmp, 32);
     if (big_cmp(tmp, l, c_adr->balance, 32) > 0) {
       print_error("not enough value to pay for the gas");
+      evm_programs_free(evm.programs);
       evm_free(&evm);
       return 1;
     }
@@ -603,21 +607,8 @@ int run_evm(d_token_t* test, uint32_t props, uint64_t* ms, char* fork_name, int
       evm.gas   = 0;
       fail      = 0;
       uint8_t    gas_tmp[32], gas_tmp2[32];
-      account_t* ac = NULL;
-      storage_t* s  = NULL;
       // reset all accounts except the sender
-      while (evm.accounts) {
-        ac = evm.accounts;
-        //    if (ac->code.data) _free(ac->code.data);
-        s = NULL;
-        while (ac->storage) {
-          s           = ac->storage;
-          ac->storage = s->next;
-          _free(s);
-        }
-        evm.accounts = ac->next;
-        _free(ac);
-      }
+      evm_accounts_free(&evm);
 
       // read the accounts from pre-state
       read_accounts(&evm, d_get(test, key("pre")));
@@ -731,6 +722,7 @@ int run_evm(d_token_t* test, uint32_t props, uint64_t* ms, char* fork_name, int
         break;
     }
   }
+  evm_programs_free(evm.programs);
   evm_free(&evm);
   return fail;
 }
@@ -133,6 +133,7 @@ static void test_cache() {
   in3_t* c           = in3_for_chain(CHAIN_ID_GOERLI);
   c->transport       = test_transport;
   c->signature_count = 0;
+  c->flags |= FLAGS_NODE_LIST_NO_SIG; // the recorded response is only signed by one of the nodes
   setup_test_cache(c);
 
   in3_chain_t* chain = in3_find_chain(c, CHAIN_ID_GOERLI);
@@ -248,6 +249,80 @@ static void test_newchain() {
   in3_free(c2);
 }
 
+static bytes_t* find_cache_entry(const char* suffix) {
+  for (int i = 0; i < MAX_ENTRIES && cache.keys[i]; i++) {
+    if (strlen(cache.keys[i]) >= strlen(suffix) && !strcmp(cache.keys[i] + strlen(cache.keys[i]) - strlen(suffix), suffix)) return cache.values + i;
+  }
+  return NULL;
+}
+
+static void test_cache_weights() {
+  in3_t* c           = in3_for_chain(CHAIN_ID_GOERLI);
+  c->transport       = test_transport;
+  c->signature_count = 0;
+  c->flags |= FLAGS_NODE_LIST_NO_SIG; // the recorded response is only signed by one of the nodes
+  setup_test_cache(c);
+  in3_chain_t* chain = in3_find_chain(c, CHAIN_ID_GOERLI);
+  TEST_ASSERT_EQUAL(0, update_nodes(c, chain));
+  TEST_ASSERT_EQUAL_INT32(7, chain->nodelist_length);
+  bytes_t* stored = b_dup(find_cache_entry("c8"));
+  TEST_ASSERT_NOT_NULL(stored);
+
+  // a changed weight is only written as delta
+  in3_node_add_response_time(chain->weights + 2, 120);
+  chain->weights[3].blacklisted_until = 1234;
+  TEST_ASSERT_EQUAL(IN3_OK, in3_cache_store_weights(c, chain));
+  TEST_ASSERT_TRUE(b_cmp(stored, find_cache_entry("c8")));
+  TEST_ASSERT_NOT_NULL(find_cache_entry("_delta"));
+  TEST_ASSERT_TRUE(find_cache_entry("_delta")->len < stored->len / 2);
+
+  // a second client reads both
+  in3_t* c2 = in3_for_chain(CHAIN_ID_GOERLI);
+  c2->cache = c->cache;
+  in3_cache_init(c2);
+  in3_chain_t* chain2 = in3_find_chain(c2, CHAIN_ID_GOERLI);
+  TEST_ASSERT_EQUAL_INT32(7, chain2->nodelist_length);
+  TEST_ASSERT_EQUAL_MEMORY(chain->weights, chain2->weights, 7 * sizeof(in3_node_weight_t));
+  for (int i = 0; i < 7; i++) {
+    TEST_ASSERT_EQUAL_STRING(chain->nodelist[i].url, chain2->nodelist[i].url);
+    TEST_ASSERT_TRUE(b_cmp(chain->nodelist[i].address, chain2->nodelist[i].address));
+    TEST_ASSERT_EQUAL(chain->nodelist[i].deposit, chain2->nodelist[i].deposit);
+    TEST_ASSERT_EQUAL(chain->nodelist[i].props, chain2->nodelist[i].props);
+  }
+
+  // if most weights change, the whole list is written and the old delta is ignored
+  for (int i = 0; i < 7; i++) in3_node_add_response_time(chain->weights + i, 50);
+  TEST_ASSERT_EQUAL(IN3_OK, in3_cache_store_weights(c, chain));
+  TEST_ASSERT_FALSE(b_cmp(stored, find_cache_entry("c8")));
+  c2->cache = NULL;
+  in3_free(c2);
+  c2        = in3_for_chain(CHAIN_ID_GOERLI);
+  c2->cache = c->cache;
+  in3_cache_init(c2);
+  TEST_ASSERT_EQUAL_MEMORY(chain->weights, in3_find_chain(c2, CHAIN_ID_GOERLI)->weights, 7 * sizeof(in3_node_weight_t));
+
+  // a truncated nodelist is rejected
+  bytes_t* entry = find_cache_entry("c8");
+  entry->len -= 3;
+  TEST_ASSERT_EQUAL(IN3_EINVALDT, in3_cache_update_nodelist(c2, in3_find_chain(c2, CHAIN_ID_GOERLI)));
+  entry->len += 3;
+
+  // a header claiming more strings than the entry holds is rejected before reading them
+  bytes_t* full = b_dup(entry);
+  entry->len    = 41;
+  memset(entry->data + 33, 0, 4);
+  int_to_bytes(0x40000000, entry->data + 37);
+  TEST_ASSERT_EQUAL(IN3_EINVALDT, in3_cache_update_nodelist(c2, in3_find_chain(c2, CHAIN_ID_GOERLI)));
+  memcpy(entry->data, full->data, full->len);
+  entry->len = full->len;
+  b_free(full);
+
+  b_free(stored);
+  c2->cache = NULL;
+  in3_free(c2);
+  in3_free(c);
+}
+
 static void test_scache() {
   char*          key   = "123";
   char*          value = "45678";
@@ -331,6 +406,7 @@ int main() {
   RUN_TEST(test_scache);
   RUN_TEST(test_cache);
   RUN_TEST(test_newchain);
+  RUN_TEST(test_cache_weights);
   RUN_TEST(test_whitelist_cache);
   return TESTS_END();
 }
@@ -0,0 +1,135 @@
+/*******************************************************************************
+ * This file is part of the Incubed project.
+ * Sources: https://github.com/slockit/in3-c
+ * 
+ * Copyright (C) 2018-2020 slock.it GmbH, Blockchains LLC
+ * 
+ * 
+ * COMMERCIAL LICENSE USAGE
+ * 
+ * Licensees holding a valid commercial license may use this file in accordance 
+ * with the commercial license agreement provided with the Software or, alternatively, 
+ * in accordance with the terms contained in a written agreement between you and 
+ * slock.it GmbH/Blockchains LLC. For licensing terms and conditions or further 
+ * information please contact slock.it at in3@slock.it.
+ * 	
+ * Alternatively, this file may be used under the AGPL license as follows:
+ *    
+ * AGPL LICENSE USAGE
+ * 
+ * This program is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Affero General Public License as published by the Free Software 
+ * Foundation, either version 3 of the License, or (at your option) any later version.
+ *  
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY 
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A 
+ * PARTICULAR PURPOSE. See the GNU Affero General Public License for more details.
+ * [Permissions of this strong copyleft license are conditioned on making available 
+ * complete source code of licensed works and modifications, which include larger 
+ * works using a licensed work, under the same license. Copyright and license notices 
+ * must be preserved. Contributors provide an express grant of patent rights.]
+ * You should have received a copy of the GNU Affero General Public License along 
+ * with this program. If not, see <https://www.gnu.org/licenses/>.
+ *******************************************************************************/
+#ifndef TEST
+#define TEST
+#endif
+#ifndef TEST
+#define DEBUG
+#endif
+
+#include "../../src/core/util/bytes.h"
+#include "../../src/core/util/log.h"
+#include "../../src/core/util/mem.h"
+#include "../../src/transport/compression/compression.h"
+#include "../test_utils.h"
+#include <stdio.h>
+#include <string.h>
+#include <zlib.h>
+
+#define GZIP 31     /**< window bits for a gzip-header */
+#define ZLIB 15     /**< window bits for a zlib-header */
+#define RAW_DEFLATE -15 /**< window bits for raw deflate without header */
+
+static char text[4096];
+
+/** encodes the data with the given window bits */
+static bytes_t* encode(const char* data, size_t len, int window_bits) {
+  z_stream z;
+  memset(&z, 0, sizeof(z));
+  TEST_ASSERT_EQUAL(Z_OK, deflateInit2(&z, Z_DEFAULT_COMPRESSION, Z_DEFLATED, window_bits, 8, Z_DEFAULT_STRATEGY));
+  bytes_t* res = b_new(NULL, deflateBound(&z, len));
+  z.next_in    = (Bytef*) data;
+  z.avail_in   = len;
+  z.next_out   = res->data;
+  z.avail_out  = res->len;
+  TEST_ASSERT_EQUAL(Z_STREAM_END, deflate(&z, Z_FINISH));
+  res->len -= z.avail_out;
+  deflateEnd(&z);
+  return res;
+}
+
+/** decodes the data in parts of the given size and returns the result of the last part */
+static int decode(bytes_t* data, uint32_t part, sb_t* dst) {
+  in3_inflate_t* z   = in3_inflate_new();
+  int            res = 0;
+  for (uint32_t pos = 0; pos < data->len && res == 0; pos += part)
+    res = in3_inflate(z, (char*) data->data + pos, pos + part > data->len ? data->len - pos : part, dst);
+  in3_inflate_free(z);
+  return res;
+}
+
+static void check_decode(bytes_t* data, uint32_t part) {
+  sb_t dst = {0};
+  TEST_ASSERT_EQUAL(1, decode(data, part, &dst));
+  TEST_ASSERT_EQUAL(strlen(text), dst.len);
+  TEST_ASSERT_EQUAL_STRING(text, dst.data);
+  _free(dst.data);
+}
+
+static void test_decode() {
+  int bits[] = {GZIP, ZLIB, RAW_DEFLATE};
+  for (int i = 0; i < 3; i++) {
+    bytes_t* data = encode(text, strlen(text), bits[i]);
+    check_decode(data, data->len);
+
+    // the data may be split at any byte, even within the header
+    check_decode(data, 1);
+    check_decode(data, 7);
+    b_free(data);
+  }
+}
+
+static void test_gzip() {
+  bytes_t* data = in3_gzip(text, strlen(text));
+  TEST_ASSERT_NOT_NULL(data);
+  TEST_ASSERT_TRUE(data->len < strlen(text));
+  TEST_ASSERT_EQUAL_HEX8(0x1f, data->data[0]);
+  TEST_ASSERT_EQUAL_HEX8(0x8b, data->data[1]);
+  check_decode(data, data->len);
+  b_free(data);
+}
+
+static void test_invalid() {
+  sb_t     dst     = {0};
+  uint8_t  junk[]  = {0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff};
+  bytes_t  invalid = bytes(junk, sizeof(junk));
+  TEST_ASSERT_TRUE(decode(&invalid, invalid.len, &dst) < 0);
+
+  // a stream cut off is not complete
+  bytes_t* data = encode(text, strlen(text), GZIP);
+  data->len /= 2;
+  TEST_ASSERT_EQUAL(0, decode(data, data->len, &dst));
+  b_free(data);
+  _free(dst.data);
+}
+
+int main() {
+  in3_log_set_quiet(true);
+  for (size_t i = 0; i < sizeof(text) - 1; i++) text[i] = "{\"jsonrpc\":\"2.0\",\"result\":\"0x1234abcd\"}"[i % 39];
+  TESTS_BEGIN();
+  RUN_TEST(test_decode);
+  RUN_TEST(test_gzip);
+  RUN_TEST(test_invalid);
+  return TESTS_END();
+}
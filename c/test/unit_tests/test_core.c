@@ -103,6 +103,7 @@ void test_debug() {
   TEST_ASSERT_NOT_NULL(in3_errmsg(IN3_WAITING));
   TEST_ASSERT_NOT_NULL(in3_errmsg(IN3_EPAYMENT_REQUIRED));
   TEST_ASSERT_NOT_NULL(in3_errmsg(IN3_EIGNORE));
+  TEST_ASSERT_NOT_NULL(in3_errmsg(IN3_ETIMEOUT));
   TEST_ASSERT_NULL(in3_errmsg(IN3_OK));
   TEST_ASSERT_NULL(in3_errmsg(100));
 }
@@ -0,0 +1,178 @@
+/*******************************************************************************
+ * This file is part of the Incubed project.
+ * Sources: https://github.com/slockit/in3-c
+ * 
+ * Copyright (C) 2018-2020 slock.it GmbH, Blockchains LLC
+ * 
+ * 
+ * COMMERCIAL LICENSE USAGE
+ * 
+ * Licensees holding a valid commercial license may use this file in accordance 
+ * with the commercial license agreement provided with the Software or, alternatively, 
+ * in accordance with the terms contained in a written agreement between you and 
+ * slock.it GmbH/Blockchains LLC. For licensing terms and conditions or further 
+ * information please contact slock.it at in3@slock.it.
+ * 	
+ * Alternatively, this file may be used under the AGPL license as follows:
+ *    
+ * AGPL LICENSE USAGE
+ * 
+ * This program is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Affero General Public License as published by the Free Software 
+ * Foundation, either version 3 of the License, or (at your option) any later version.
+ *  
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY 
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A 
+ * PARTICULAR PURPOSE. See the GNU Affero General Public License for more details.
+ * [Permissions of this strong copyleft license are conditioned on making available 
+ * complete source code of licensed works and modifications, which include larger 
+ * works using a licensed work, under the same license. Copyright and license notices 
+ * must be preserved. Contributors provide an express grant of patent rights.]
+ * You should have received a copy of the GNU Affero General Public License along 
+ * with this program. If not, see <https://www.gnu.org/licenses/>.
+ *******************************************************************************/
+#ifndef TEST
+#define TEST
+#endif
+#ifndef TEST
+#define DEBUG
+#endif
+
+#include "../../src/core/client/context.h"
+#include "../../src/core/util/bytes.h"
+#include "../../src/core/util/data.h"
+#include "../../src/core/util/log.h"
+#include "../../src/core/util/mem.h"
+#include "../../src/core/util/utils.h"
+#include "../../src/verifier/eth1/evm/env.h"
+#include "../../src/verifier/eth1/basic/eth_basic.h"
+#include "../../src/verifier/eth1/evm/evm.h"
+#include "../../src/verifier/eth1/evm/program.h"
+#include "../../src/verifier/eth1/full/eth_full.h"
+#include "../test_utils.h"
+#include <stdio.h>
+#include <string.h>
+
+// sums up 1..10 and returns the sum and the gas left after the loop as 2 words:
+// PUSH1 0 PUSH1 10 JUMPDEST DUP1 SWAP2 ADD SWAP1 PUSH1 1 SWAP1 SUB DUP1 PUSH1 4 JUMPI POP
+// PUSH1 0 MSTORE GAS PUSH1 32 MSTORE PUSH1 64 PUSH1 0 RETURN
+#define CODE "6000600a5b809101906001900380600457506000525a60205260406000f3"
+
+// divides and reduces 0x80 as a 32 byte word, which is positive even though its first byte is 0x80:
+// PUSH1 2 PUSH32 0x80 SDIV PUSH1 0 MSTORE PUSH1 3 PUSH32 0x80 SMOD PUSH1 32 MSTORE PUSH1 64 PUSH1 0 RETURN
+#define SIGNED_CODE "60027f000000000000000000000000000000000000000000000000000000000000008005600052" \
+                    "60037f000000000000000000000000000000000000000000000000000000000000008007602052" \
+                    "60406000f3"
+
+/** runs the contract as eth_call with the given gas and returns the result. */
+static bytes_t* call_contract(const char* code_hex, uint64_t gas) {
+  bytes32_t code_hash;
+  uint8_t   code[128];
+  char      proof[700], hash_hex[65];
+  address_t address = {0}, caller = {0};
+  address[19]       = 0x42;
+
+  bytes_t b = bytes(code, hex_to_bytes(code_hex, -1, code, sizeof(code)));
+  sha3_to(&b, code_hash);
+  bytes_to_hex(code_hash, 32, hash_hex);
+  sprintf(proof, "{\"accounts\":[{\"address\":\"0x0000000000000000000000000000000000000042\",\"balance\":\"0x0\",\"nonce\":\"0x0\","
+                 "\"code\":\"0x%s\",\"codeHash\":\"0x%s\",\"storageProof\":[]}]}",
+          code_hex, hash_hex);
+
+  in3_t*      c   = in3_for_chain(CHAIN_ID_MAINNET);
+  c->cache        = NULL;
+  in3_ctx_t*  ctx = ctx_new(c, "{\"method\":\"eth_call\",\"params\":[]}");
+  json_ctx_t* p   = parse_json(proof);
+  in3_vctx_t  vc  = {.ctx = ctx, .chain = in3_find_chain(c, c->chain_id), .proof = p->result, .client = c};
+  in3_env_t   env;
+  in3_env_init(&env, &vc);
+
+  bytes_t* result = NULL;
+  uint8_t  value  = 0;
+  int      res    = evm_call(&env, address, &value, 1, NULL, 0, caller, gas, c->chain_id, &result);
+  TEST_ASSERT_EQUAL_INT(0, res);
+  TEST_ASSERT_NOT_NULL(result);
+  TEST_ASSERT_EQUAL_UINT32(64, result->len);
+
+  // the decoded code is kept with the state of the chain
+  eth_chain_state_t* state = vc.chain->conf;
+  TEST_ASSERT_NOT_NULL(state->evm_programs);
+  TEST_ASSERT_EQUAL_UINT32(EVM_PROGRAM_CACHE_BYTES, ((evm_programs_t*) state->evm_programs)->max_bytes);
+  TEST_ASSERT_TRUE(((evm_programs_t*) state->evm_programs)->bytes > 0);
+
+  in3_env_free(&env);
+  json_free(p);
+  ctx_free(ctx);
+  in3_free(c);
+  return result;
+}
+
+static void test_evm_call_unmetered() {
+  bytes_t* metered   = call_contract(CODE, 100000);
+  bytes_t* unmetered = call_contract(CODE, 0);
+
+  // the result does not depend on the gas metering
+  TEST_ASSERT_EQUAL_UINT64(55, bytes_to_long(metered->data + 24, 8));
+  TEST_ASSERT_EQUAL_MEMORY(metered->data, unmetered->data, 32);
+
+#ifdef EVM_GAS
+  // with a limit, the loop was charged
+  uint64_t gas_left = bytes_to_long(metered->data + 56, 8);
+  TEST_ASSERT_TRUE(gas_left > 0 && gas_left < 100000);
+
+  // without a limit, subgas was skipped, so nothing was charged at all
+  TEST_ASSERT_EQUAL_UINT64(0xFFFFFFFFFFFFFF, bytes_to_long(unmetered->data + 56, 8));
+#endif
+
+  b_free(metered);
+  b_free(unmetered);
+}
+
+static void test_signed_math() {
+  bytes_t* result = call_contract(SIGNED_CODE, 100000);
+
+  // 0x80 / 2 and 0x80 % 3, the sign is the top bit of the full word
+  TEST_ASSERT_EQUAL_UINT64(64, bytes_to_long(result->data + 24, 8));
+  TEST_ASSERT_EQUAL_UINT64(2, bytes_to_long(result->data + 56, 8));
+  TEST_ASSERT_TRUE(memiszero(result->data, 24) && memiszero(result->data + 32, 24));
+  b_free(result);
+}
+
+static void test_program_cache() {
+  uint8_t         a[] = {0x60, 0x01, 0x00}, b[] = {0x60, 0x02, 0x00}, big[100] = {0};
+  evm_programs_t* cache = _calloc(1, sizeof(evm_programs_t));
+  cache->max_bytes      = 0xFFFF;
+
+  // the same code is decoded only once
+  evm_program_t* p = evm_program_get(cache, bytes(a, sizeof(a)));
+  evm_program_release(p);
+  TEST_ASSERT_EQUAL_PTR(p, evm_program_get(cache, bytes(a, sizeof(a))));
+  evm_program_release(p);
+  TEST_ASSERT_EQUAL_UINT32(p->size, cache->bytes);
+
+  // if the memory is used up, the least recently used programs are removed
+  cache->max_bytes  = p->size;
+  evm_program_t* p2 = evm_program_get(cache, bytes(b, sizeof(b)));
+  evm_program_release(p2);
+  TEST_ASSERT_EQUAL_UINT32(p2->size, cache->bytes);
+  TEST_ASSERT_NULL(cache->entries[1]);
+  TEST_ASSERT_EQUAL_PTR(p2, cache->entries[0]);
+
+  // programs which don't fit at all are not cached
+  evm_program_t* p3 = evm_program_get(cache, bytes(big, sizeof(big)));
+  TEST_ASSERT_EQUAL_UINT32(1, p3->refs);
+  TEST_ASSERT_EQUAL_PTR(p2, cache->entries[0]);
+  evm_program_release(p3);
+
+  evm_programs_free(cache);
+}
+
+int main() {
+  in3_log_set_quiet(true);
+  in3_register_eth_full();
+  TESTS_BEGIN();
+  RUN_TEST(test_evm_call_unmetered);
+  RUN_TEST(test_signed_math);
+  RUN_TEST(test_program_cache);
+  return TESTS_END();
+}
@@ -0,0 +1,352 @@
+/*******************************************************************************
+ * This file is part of the Incubed project.
+ * Sources: https://github.com/slockit/in3-c
+ * 
+ * Copyright (C) 2018-2020 slock.it GmbH, Blockchains LLC
+ * 
+ * 
+ * COMMERCIAL LICENSE USAGE
+ * 
+ * Licensees holding a valid commercial license may use this file in accordance 
+ * with the commercial license agreement provided with the Software or, alternatively, 
+ * in accordance with the terms contained in a written agreement between you and 
+ * slock.it GmbH/Blockchains LLC. For licensing terms and conditions or further 
+ * information please contact slock.it at in3@slock.it.
+ * 	
+ * Alternatively, this file may be used under the AGPL license as follows:
+ *    
+ * AGPL LICENSE USAGE
+ * 
+ * This program is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Affero General Public License as published by the Free Software 
+ * Foundation, either version 3 of the License, or (at your option) any later version.
+ *  
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY 
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A 
+ * PARTICULAR PURPOSE. See the GNU Affero General Public License for more details.
+ * [Permissions of this strong copyleft license are conditioned on making available 
+ * complete source code of licensed works and modifications, which include larger 
+ * works using a licensed work, under the same license. Copyright and license notices 
+ * must be preserved. Contributors provide an express grant of patent rights.]
+ * You should have received a copy of the GNU Affero General Public License along 
+ * with this program. If not, see <https://www.gnu.org/licenses/>.
+ *******************************************************************************/
+#ifndef TEST
+#define TEST
+#endif
+#ifndef TEST
+#define DEBUG
+#endif
+
+#include "../../src/core/client/context.h"
+#include "../../src/core/util/log.h"
+#include "../../src/core/util/mem.h"
+#include "../../src/transport/http/in3_http.h"
+#ifdef USE_ZLIB
+#include "../../src/transport/compression/compression.h"
+#endif
+#include "../test_utils.h"
+#include <netinet/in.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#define MAX_RESPONSES 8
+#define MAX_CONS 4
+
+/** a local http server answering each request with the next of the given responses */
+typedef struct {
+  int       fd;                       /**< the listening socket */
+  uint16_t  port;                     /**< the port it listens on */
+  bytes_t   responses[MAX_RESPONSES]; /**< the raw responses to send */
+  int       len;                      /**< number of responses */
+  int       split;                    /**< if set, the responses are written in parts of this size */
+  int       served;                   /**< number of requests answered */
+  int       connections;              /**< number of accepted connections */
+  char      request[4096];            /**< the last request received */
+  int       request_len;              /**< length of the last request */
+  pthread_t thread;                   /**< the thread serving the requests */
+} server_t;
+
+static in3_t* client = NULL;
+
+static void respond(server_t* s, int fd) {
+  bytes_t r = s->responses[s->served++];
+  for (uint32_t sent = 0; sent < r.len;) {
+    uint32_t n = s->split && s->split < (int) (r.len - sent) ? (uint32_t) s->split : r.len - sent;
+    if (write(fd, r.data + sent, n) != (int) n) return;
+    sent += n;
+    if (s->split) usleep(2000);
+  }
+}
+
+static void* serve(void* arg) {
+  server_t*     s = arg;
+  struct pollfd fds[MAX_CONS + 1];
+  int           cons[MAX_CONS], lens[MAX_CONS], n = 0;
+  char          buf[MAX_CONS][4096];
+
+  while (s->served < s->len) {
+    fds[0] = (struct pollfd){.fd = s->fd, .events = POLLIN};
+    for (int i = 0; i < n; i++) fds[i + 1] = (struct pollfd){.fd = cons[i], .events = POLLIN};
+    if (poll(fds, n + 1, 5000) <= 0) break;
+
+    for (int i = n - 1; i >= 0; i--) {
+      if (!fds[i + 1].revents) continue;
+      int r = read(cons[i], buf[i] + lens[i], sizeof(buf[i]) - 1 - lens[i]);
+      if (r <= 0) {
+        close(cons[i]);
+        cons[i] = cons[--n];
+        lens[i] = lens[n];
+        memcpy(buf[i], buf[n], sizeof(buf[i]));
+        continue;
+      }
+      lens[i] += r;
+      buf[i][lens[i]] = 0;
+
+      // wait for the header and the body
+      char* end = strstr(buf[i], "\r\n\r\n");
+      if (!end) continue;
+      char* cl    = strstr(buf[i], "Content-Length: ");
+      int   total = end + 4 - buf[i] + (cl && cl < end ? atoi(cl + 16) : 0);
+      if (lens[i] < total) continue;
+      memcpy(s->request, buf[i], total);
+      s->request[total] = 0;
+      s->request_len = total;
+      lens[i]        = 0;
+
+      bytes_t response = s->responses[s->served];
+      respond(s, cons[i]);
+      if (!strncmp((char*) response.data, "HTTP/1.0", 8) || strstr((char*) response.data, "Connection: close")) {
+        close(cons[i]);
+        cons[i] = cons[--n];
+        lens[i] = lens[n];
+        memcpy(buf[i], buf[n], sizeof(buf[i]));
+      }
+    }
+
+    if ((fds[0].revents & POLLIN) && n < MAX_CONS) {
+      cons[n]   = accept(s->fd, NULL, NULL);
+      lens[n++] = 0;
+      s->connections++;
+    }
+  }
+  for (int i = 0; i < n; i++) close(cons[i]);
+  return NULL;
+}
+
+static void server_add(server_t* s, const char* data, int len) {
+  s->responses[s->len++] = bytes((uint8_t*) data, len < 0 ? strlen(data) : (uint32_t) len);
+}
+
+/** starts the server after the responses have been added */
+static void server_start(server_t* s) {
+  struct sockaddr_in addr = {.sin_family = AF_INET, .sin_port = 0, .sin_addr.s_addr = htonl(INADDR_LOOPBACK)};
+  socklen_t          len  = sizeof(addr);
+  s->fd                   = socket(AF_INET, SOCK_STREAM, 0);
+  TEST_ASSERT_EQUAL(0, bind(s->fd, (struct sockaddr*) &addr, len));
+  TEST_ASSERT_EQUAL(0, listen(s->fd, MAX_CONS));
+  getsockname(s->fd, (struct sockaddr*) &addr, &len);
+  s->port = ntohs(addr.sin_port);
+  pthread_create(&s->thread, NULL, serve, s);
+}
+
+static void server_stop(server_t* s) {
+  pthread_join(s->thread, NULL);
+  close(s->fd);
+}
+
+/** sends the payload to the server and returns the state of the response, which must be freed. */
+static in3_ret_t send_request(server_t* s, const char* payload, in3_response_t* response) {
+  char url[64];
+  sprintf(url, "http://127.0.0.1:%u/", (unsigned) s->port);
+  char*         urls[] = {url};
+  in3_ctx_t     ctx    = {.client = client, .raw_response = response};
+  in3_request_t req    = {.payload = (char*) payload, .urls = urls, .urls_len = 1, .action = REQ_ACTION_SEND, .ctx = &ctx};
+  memset(response, 0, sizeof(in3_response_t));
+  return send_http(&req);
+}
+
+/** sends a request and checks the result */
+static void expect_response(server_t* s, in3_ret_t state, const char* data) {
+  in3_response_t response;
+  TEST_ASSERT_EQUAL(state, send_request(s, "{\"method\":\"eth_blockNumber\"}", &response));
+  TEST_ASSERT_EQUAL(state, response.state);
+  TEST_ASSERT_EQUAL_STRING(data, response.data.data ? response.data.data : "");
+  _free(response.data.data);
+}
+
+static void test_header() {
+  server_t s = {0};
+  server_add(&s, "HTTP/1.1 200 OK\r\ncontent-length: 2\r\nX-Custom: content-length: 5\r\n\r\nok", -1);
+  server_add(&s, "HTTP/1.1 500 Internal Server Error\r\nContent-Length: 4\r\n\r\nfail", -1);
+  server_add(&s, "HTTP/1.1 200 OK\r\nContent-Encoding: br\r\nContent-Length: 2\r\n\r\nok", -1);
+  server_add(&s, "HTTP/1.0 200 OK\r\n\r\nuntil the end", -1);
+  server_add(&s, "HTTP/2.0 200 OK\r\nContent-Length: 2\r\n\r\nok", -1);
+  server_start(&s);
+
+  expect_response(&s, IN3_OK, "ok");
+  expect_response(&s, IN3_ERPC, "fail");
+  expect_response(&s, IN3_ERPC, "ERROR unsupported Content-Encoding");
+  expect_response(&s, IN3_OK, "until the end");
+  expect_response(&s, IN3_ERPC, "ERROR invalid HTTP Version");
+
+  // the request is sent with its length
+  TEST_ASSERT_NOT_NULL(strstr(s.request, "POST / HTTP/1.1\r\n"));
+  TEST_ASSERT_NOT_NULL(strstr(s.request, "Content-Length: 28\r\n"));
+  server_stop(&s);
+}
+
+static void test_chunked() {
+  const char* chunked = "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n4\r\nWiki\r\n5;ext=1\r\npedia\r\n0\r\nTrailer: x\r\n\r\n";
+  server_t    s       = {0};
+  server_add(&s, chunked, -1);
+  server_add(&s, chunked, -1);
+  server_add(&s, "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\nzz\r\nWiki\r\n0\r\n\r\n", -1);
+  server_start(&s);
+
+  expect_response(&s, IN3_OK, "Wikipedia");
+
+  // the framing may be split at any byte
+  s.split = 1;
+  expect_response(&s, IN3_OK, "Wikipedia");
+  s.split = 0;
+
+  expect_response(&s, IN3_ERPC, "ERROR invalid chunked encoding");
+  server_stop(&s);
+}
+
+static void test_keep_alive() {
+  server_t s = {0};
+  server_add(&s, "HTTP/1.1 200 OK\r\nContent-Length: 1\r\n\r\n1", -1);
+  server_add(&s, "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n1\r\n2\r\n0\r\n\r\n", -1);
+  server_add(&s, "HTTP/1.1 200 OK\r\nContent-Length: 1\r\nConnection: close\r\n\r\n3", -1);
+  server_add(&s, "HTTP/1.1 200 OK\r\nContent-Length: 1\r\n\r\n4", -1);
+  server_start(&s);
+
+  // the connection is reused as long as the server keeps it open
+  expect_response(&s, IN3_OK, "1");
+  expect_response(&s, IN3_OK, "2");
+  expect_response(&s, IN3_OK, "3");
+  TEST_ASSERT_EQUAL(1, s.connections);
+
+  // after closing, a new connection is opened
+  expect_response(&s, IN3_OK, "4");
+  TEST_ASSERT_EQUAL(2, s.connections);
+  server_stop(&s);
+}
+
+#ifdef USE_ZLIB
+/** creates a response with the gzipped body, which is chunked in parts of the given size if chunk_size > 0 */
+static char* gzip_response(const char* body, int chunk_size, int* len) {
+  bytes_t* data = in3_gzip(body, strlen(body));
+  sb_t     sb   = {0};
+  char     tmp[64];
+  sb_add_chars(&sb, "HTTP/1.1 200 OK\r\nContent-Encoding: gzip\r\n");
+  if (chunk_size) {
+    sb_add_chars(&sb, "Transfer-Encoding: chunked\r\n\r\n");
+    for (uint32_t pos = 0; pos < data->len; pos += chunk_size) {
+      int n = pos + chunk_size > data->len ? (int) (data->len - pos) : chunk_size;
+      sb_add_range(&sb, tmp, 0, sprintf(tmp, "%x\r\n", n));
+      sb_add_range(&sb, (char*) data->data, pos, n);
+      sb_add_chars(&sb, "\r\n");
+    }
+    sb_add_chars(&sb, "0\r\n\r\n");
+  } else {
+    sb_add_range(&sb, tmp, 0, sprintf(tmp, "Content-Length: %u\r\n\r\n", data->len));
+    sb_add_range(&sb, (char*) data->data, 0, data->len);
+  }
+  b_free(data);
+  *len = sb.len;
+  return sb.data;
+}
+
+static void test_gzip_response() {
+  const char* body = "{\"jsonrpc\":\"2.0\",\"id\":1,\"result\":\"0x0000000000000000000000000000000000000000000000000000000000000000\"}";
+  int         len[3];
+  char*       responses[3] = {gzip_response(body, 0, len), gzip_response(body, 5, len + 1), gzip_response(body, 5, len + 2)};
+  server_t    s            = {0};
+  for (int i = 0; i < 3; i++) server_add(&s, responses[i], len[i]);
+  server_start(&s);
+
+  // the bytes are counted before and after decoding
+  in3_transport_stats_t stats = in3_get_transport_stats();
+  expect_response(&s, IN3_OK, body);
+  in3_transport_stats_t now = in3_get_transport_stats();
+  TEST_ASSERT_EQUAL(28, now.bytes_sent - stats.bytes_sent);
+  TEST_ASSERT_EQUAL(28, now.bytes_sent_wire - stats.bytes_sent_wire);
+  TEST_ASSERT_EQUAL(strlen(body), now.bytes_received - stats.bytes_received);
+  TEST_ASSERT_EQUAL(len[0] - (strstr(responses[0], "\r\n\r\n") + 4 - responses[0]), now.bytes_received_wire - stats.bytes_received_wire);
+  TEST_ASSERT_TRUE(now.bytes_received_wire - stats.bytes_received_wire < strlen(body));
+
+  // a chunked gzip body, which is also split across the reads
+  expect_response(&s, IN3_OK, body);
+  s.split = 3;
+  expect_response(&s, IN3_OK, body);
+  server_stop(&s);
+  for (int i = 0; i < 3; i++) _free(responses[i]);
+}
+
+static void test_compress_requests() {
+  char payload[200];
+  memset(payload, ' ', sizeof(payload) - 1);
+  memcpy(payload, "{\"method\":\"eth_blockNumber\"}", 28);
+  payload[sizeof(payload) - 1] = 0;
+
+  server_t s = {0};
+  server_add(&s, "HTTP/1.1 200 OK\r\nContent-Length: 2\r\n\r\nok", -1);
+  server_add(&s, "HTTP/1.1 200 OK\r\nContent-Length: 2\r\n\r\nok", -1);
+  server_start(&s);
+  in3_http_compress_requests(199);
+
+  // smaller payloads are sent as they are
+  in3_response_t        response;
+  in3_transport_stats_t stats = in3_get_transport_stats();
+  payload[198]                = 0;
+  TEST_ASSERT_EQUAL(IN3_OK, send_request(&s, payload, &response));
+  _free(response.data.data);
+  TEST_ASSERT_NULL(strstr(s.request, "Content-Encoding"));
+  TEST_ASSERT_NOT_NULL(strstr(s.request, "Content-Length: 198\r\n"));
+  TEST_ASSERT_EQUAL(198, in3_get_transport_stats().bytes_sent_wire - stats.bytes_sent_wire);
+
+  // from the threshold on, they are gzipped
+  stats        = in3_get_transport_stats();
+  payload[198] = ' ';
+  TEST_ASSERT_EQUAL(IN3_OK, send_request(&s, payload, &response));
+  _free(response.data.data);
+  TEST_ASSERT_NOT_NULL(strstr(s.request, "Content-Encoding: gzip\r\n"));
+  char*          body  = strstr(s.request, "\r\n\r\n") + 4;
+  int            l     = s.request_len - (body - s.request);
+  sb_t           sb    = {0};
+  in3_inflate_t* z     = in3_inflate_new();
+  TEST_ASSERT_EQUAL(1, in3_inflate(z, body, l, &sb));
+  TEST_ASSERT_EQUAL_STRING(payload, sb.data);
+  in3_inflate_free(z);
+  _free(sb.data);
+  in3_transport_stats_t now = in3_get_transport_stats();
+  TEST_ASSERT_EQUAL(199, now.bytes_sent - stats.bytes_sent);
+  TEST_ASSERT_EQUAL(l, now.bytes_sent_wire - stats.bytes_sent_wire);
+
+  in3_http_compress_requests(0);
+  server_stop(&s);
+}
+#endif
+
+int main() {
+  in3_log_set_quiet(true);
+  client          = in3_for_chain(CHAIN_ID_MAINNET);
+  client->timeout = 5000;
+  TESTS_BEGIN();
+  RUN_TEST(test_header);
+  RUN_TEST(test_chunked);
+  RUN_TEST(test_keep_alive);
+#ifdef USE_ZLIB
+  RUN_TEST(test_gzip_response);
+  RUN_TEST(test_compress_requests);
+#endif
+  in3_free(client);
+  return TESTS_END();
+}
@@ -695,6 +695,37 @@ static void test_nodelist_update_8() {
   in3_free(c);
 }
 
+static void test_node_timeout() {
+  in3_node_weight_t w = {0};
+
+  // without enough response times we use the configured timeout
+  TEST_ASSERT_EQUAL(10000, in3_node_calculate_timeout(&w, 10000));
+  TEST_ASSERT_EQUAL(10000, in3_node_calculate_timeout(NULL, 10000));
+  for (int i = 0; i < 3; i++) in3_node_add_response_time(&w, 100);
+  TEST_ASSERT_EQUAL(10000, in3_node_calculate_timeout(&w, 10000));
+
+  // fast nodes get the min timeout
+  in3_node_add_response_time(&w, 100);
+  TEST_ASSERT_EQUAL(4, w.response_count);
+  TEST_ASSERT_EQUAL(400, w.total_response_time);
+  TEST_ASSERT_EQUAL(1000, in3_node_calculate_timeout(&w, 10000));
+  TEST_ASSERT_EQUAL(500, in3_node_calculate_timeout(&w, 500));
+  TEST_ASSERT_EQUAL(0, in3_node_calculate_timeout(&w, 0));
+
+  // the 90th percentile of 10 x 400ms and 6 x 100ms, is 400ms
+  for (int i = 0; i < IN3_NODE_LATENCY_SAMPLES; i++) in3_node_add_response_time(&w, i < 10 ? 400 : 100);
+  TEST_ASSERT_EQUAL(IN3_NODE_LATENCY_SAMPLES, w.latency_len);
+  TEST_ASSERT_EQUAL(1200, in3_node_calculate_timeout(&w, 10000));
+
+  // a single slow response does not change the timeout
+  in3_node_add_response_time(&w, 5000);
+  TEST_ASSERT_EQUAL(1200, in3_node_calculate_timeout(&w, 10000));
+
+  // but if the node gets slower the timeout grows, until it reaches the max
+  for (int i = 0; i < 2; i++) in3_node_add_response_time(&w, 5000);
+  TEST_ASSERT_EQUAL(10000, in3_node_calculate_timeout(&w, 10000));
+}
+
 /*
  * Main
  */
@@ -713,5 +744,6 @@ int main() {
   RUN_TEST(test_nodelist_update_6);
   RUN_TEST(test_nodelist_update_7);
   RUN_TEST(test_nodelist_update_8);
+  RUN_TEST(test_node_timeout);
   return TESTS_END();
 }
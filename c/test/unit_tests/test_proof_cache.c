@@ -0,0 +1,186 @@
+/*******************************************************************************
+ * This file is part of the Incubed project.
+ * Sources: https://github.com/slockit/in3-c
+ * 
+ * Copyright (C) 2018-2020 slock.it GmbH, Blockchains LLC
+ * 
+ * 
+ * COMMERCIAL LICENSE USAGE
+ * 
+ * Licensees holding a valid commercial license may use this file in accordance 
+ * with the commercial license agreement provided with the Software or, alternatively, 
+ * in accordance with the terms contained in a written agreement between you and 
+ * slock.it GmbH/Blockchains LLC. For licensing terms and conditions or further 
+ * information please contact slock.it at in3@slock.it.
+ * 	
+ * Alternatively, this file may be used under the AGPL license as follows:
+ *    
+ * AGPL LICENSE USAGE
+ * 
+ * This program is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Affero General Public License as published by the Free Software 
+ * Foundation, either version 3 of the License, or (at your option) any later version.
+ *  
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY 
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A 
+ * PARTICULAR PURPOSE. See the GNU Affero General Public License for more details.
+ * [Permissions of this strong copyleft license are conditioned on making available 
+ * complete source code of licensed works and modifications, which include larger 
+ * works using a licensed work, under the same license. Copyright and license notices 
+ * must be preserved. Contributors provide an express grant of patent rights.]
+ * You should have received a copy of the GNU Affero General Public License along 
+ * with this program. If not, see <https://www.gnu.org/licenses/>.
+ *******************************************************************************/
+#ifndef TEST
+#define TEST
+#endif
+#ifndef TEST
+#define DEBUG
+#endif
+
+#include "../../src/core/client/context.h"
+#include "../../src/core/client/keys.h"
+#include "../../src/core/util/data.h"
+#include "../../src/core/util/log.h"
+#include "../../src/core/util/mem.h"
+#include "../../src/verifier/eth1/basic/eth_basic.h"
+#include "../../src/verifier/eth1/basic/proof_cache.h"
+#include "../test_utils.h"
+#include <stdio.h>
+#include <string.h>
+
+static char* response = NULL;
+
+static in3_ret_t test_transport(in3_request_t* req) {
+  in3_ctx_add_response(req->ctx, 0, false, response, -1);
+  return IN3_OK;
+}
+
+/** reads the response of the testdata */
+static char* read_response(const char* name) {
+  char path[200];
+  sprintf(path, "../c/test/testdata/requests/%s.json", name);
+  FILE* f = fopen(path, "r");
+  TEST_ASSERT_NOT_NULL_MESSAGE(f, "testdata not found");
+  fseek(f, 0, SEEK_END);
+  long  len    = ftell(f);
+  char* buffer = _malloc(len + 1);
+  fseek(f, 0, SEEK_SET);
+  buffer[fread(buffer, 1, len, f)] = 0;
+  fclose(f);
+
+  json_ctx_t* test = parse_json(buffer);
+  str_range_t res  = d_to_json(d_get(d_get_at(test->result, 0), key("response")));
+  char*       r    = _strdupn(res.data, res.len);
+  json_free(test);
+  _free(buffer);
+  return r;
+}
+
+/** replaces all elements of the arrays with the given property with spaces, so the response has no merkle proofs */
+static void remove_proofs(char* json, const char* prop) {
+  for (char* p = strstr(json, prop); p; p = strstr(p, prop)) {
+    p += strlen(prop);
+    while (*p != ']') *(p++) = ' ';
+  }
+}
+
+/** replaces the last digit of all occurrences of the value */
+static void replace_value(char* json, const char* value, char digit) {
+  for (char* p = strstr(json, value); p; p = strstr(p, value)) {
+    p += strlen(value);
+    p[-2] = digit;
+  }
+}
+
+static in3_t* create_client() {
+  in3_t* c        = in3_for_chain(0x2a);
+  c->transport    = test_transport;
+  c->cache        = NULL;
+  c->max_attempts = 1;
+  c->proof        = PROOF_STANDARD;
+  c->flags        = FLAGS_STATS;
+  for (int i = 0; i < c->chains_length; i++) {
+    _free(c->chains[i].nodelist_upd8_params);
+    c->chains[i].nodelist_upd8_params = NULL;
+  }
+  return c;
+}
+
+static in3_ret_t get_storage(in3_t* c) {
+  char *    result = NULL, *error = NULL;
+  in3_ret_t res    = in3_client_rpc(c, "eth_getStorageAt", "[\"0x27a37a1210Df14f7E058393d026e2fB53B7cf8c1\",\"0x0\",\"latest\"]", &result, &error);
+  _free(result);
+  _free(error);
+  return res;
+}
+
+static void test_proof_cache_lru() {
+  in3_chain_t chain = {.type = CHAIN_ETH};
+  bytes32_t   root = {1}, path = {2};
+  bytes_t     r = bytes(root, 32), value = bytes(path, 3);
+
+  TEST_ASSERT_FALSE(eth_proof_cache_contains(&chain, &r, path, NULL));
+  eth_proof_cache_add(&chain, &r, path, NULL);
+  TEST_ASSERT_TRUE(eth_proof_cache_contains(&chain, &r, path, NULL));
+  TEST_ASSERT_FALSE(eth_proof_cache_contains(&chain, &r, path, &value));
+
+  // fill the set with the same index
+  for (int i = 1; i < PROOF_CACHE_WAYS; i++) {
+    path[31] = i;
+    eth_proof_cache_add(&chain, &r, path, &value);
+  }
+  path[31] = 0;
+  TEST_ASSERT_TRUE(eth_proof_cache_contains(&chain, &r, path, NULL));
+
+  // now the entry 1 is the least recently used and will be replaced
+  path[31] = PROOF_CACHE_WAYS;
+  eth_proof_cache_add(&chain, &r, path, &value);
+  for (int i = 0; i <= PROOF_CACHE_WAYS; i++) {
+    path[31] = i;
+    TEST_ASSERT_EQUAL(i != 1, eth_proof_cache_contains(&chain, &r, path, i ? &value : NULL));
+  }
+  eth_free_chain_state(NULL, &chain);
+  TEST_ASSERT_NULL(chain.conf);
+}
+
+static void test_proof_cache_request() {
+  char*  full     = read_response("eth_getStorageAt");
+  char*  stripped = _strdupn(full, -1);
+  in3_t* c        = create_client();
+  remove_proofs(stripped, "\"accountProof\": [");
+  remove_proofs(stripped, "\"proof\": [");
+
+  // without verifying the proofs first, a response without merkle proofs fails
+  response = stripped;
+  TEST_ASSERT_NOT_EQUAL(IN3_OK, get_storage(c));
+
+  // once verified, the same values for the same state root need no proof
+  response = full;
+  TEST_ASSERT_EQUAL(IN3_OK, get_storage(c));
+  response = stripped;
+  TEST_ASSERT_EQUAL(IN3_OK, get_storage(c));
+
+  // but a different value still needs a proof
+  replace_value(stripped, "\"0x5\"", '6');
+  TEST_ASSERT_NOT_EQUAL(IN3_OK, get_storage(c));
+  replace_value(stripped, "\"0x6\"", '5');
+
+  // the cache belongs to the client
+  in3_free(c);
+  c        = create_client();
+  response = stripped;
+  TEST_ASSERT_NOT_EQUAL(IN3_OK, get_storage(c));
+  in3_free(c);
+  _free(full);
+  _free(stripped);
+}
+
+int main() {
+  in3_log_set_quiet(true);
+  in3_register_eth_basic();
+  TESTS_BEGIN();
+  RUN_TEST(test_proof_cache_lru);
+  RUN_TEST(test_proof_cache_request);
+  return TESTS_END();
+}
@@ -208,6 +208,96 @@ static void test_retry_response() {
   ctx_free(ctx);
   in3_free(c);
 }
+static void test_deadline() {
+  in3_t* c         = in3_for_chain(CHAIN_ID_MAINNET);
+  c->request_count = 1;
+  c->flags         = 0;
+  c->timeout       = 5000;
+  c->deadline      = 3000;
+  _free(c->chains->nodelist_upd8_params);
+  c->chains->nodelist_upd8_params = NULL;
+
+  in3_ctx_t* ctx = ctx_new(c, "{\"method\":\"eth_blockNumber\",\"params\":[]}");
+  TEST_ASSERT_NOT_EQUAL(0, ctx->deadline);
+  TEST_ASSERT_EQUAL(IN3_WAITING, in3_ctx_execute(ctx));
+  in3_request_t* req = in3_create_request(ctx);
+
+  // the timeout is limited by the deadline
+  TEST_ASSERT_NOT_NULL(req->timeouts);
+  TEST_ASSERT_TRUE(req->timeouts[0] <= 3000 && req->timeouts[0] > 0);
+  TEST_ASSERT_EQUAL(req->timeouts[0], in3_get_request_timeout(req));
+
+  // an error before the deadline means we try again
+  in3_ctx_add_response(req->ctx, 0, true, "500 from server", -1);
+  TEST_ASSERT_EQUAL(IN3_WAITING, in3_ctx_execute(ctx));
+  request_free(req);
+
+  // but if the deadline is exceeded, we don't create a new request
+  ctx->deadline = current_ms() - 1;
+  TEST_ASSERT_NULL(in3_create_request(ctx));
+  TEST_ASSERT_EQUAL(IN3_ETIMEOUT, ctx->verification_state);
+  ctx_free(ctx);
+
+  // and a failed attempt after the deadline will not be retried
+  ctx = ctx_new(c, "{\"method\":\"eth_blockNumber\",\"params\":[]}");
+  TEST_ASSERT_EQUAL(IN3_WAITING, in3_ctx_execute(ctx));
+  req           = in3_create_request(ctx);
+  ctx->deadline = current_ms() - 1;
+  in3_ctx_add_response(req->ctx, 0, true, "500 from server", -1);
+  TEST_ASSERT_EQUAL(IN3_ETIMEOUT, in3_ctx_execute(ctx));
+  TEST_ASSERT_EQUAL(CTX_ERROR, in3_ctx_state(ctx));
+
+  request_free(req);
+  ctx_free(ctx);
+  in3_free(c);
+}
+
+/** answers like a node which needs `latency` ms, so the response only arrives if the timeout is long enough */
+static void add_slow_response(in3_request_t* req, uint32_t latency) {
+  if (req->timeouts[0] >= latency)
+    in3_ctx_add_response(req->ctx, 0, false, "{\"result\":\"0x100\"}", -1);
+  else
+    in3_ctx_add_response(req->ctx, 0, true, "timeout", -1);
+}
+
+static void test_adaptive_timeout() {
+  in3_t* c         = in3_for_chain(CHAIN_ID_MAINNET);
+  c->request_count = 1;
+  c->max_attempts  = 1;
+  c->flags         = 0;
+  c->proof         = PROOF_NONE;
+  c->timeout       = 10000;
+  _free(c->chains->nodelist_upd8_params);
+  c->chains->nodelist_upd8_params = NULL;
+
+  // all nodes answered cheap requests within 200ms
+  for (unsigned int i = 0; i < c->chains->nodelist_length; i++) {
+    for (int n = 0; n < IN3_NODE_LATENCY_SAMPLES; n++) in3_node_add_response_time(c->chains->weights + i, 200);
+  }
+
+  // by default a slow request still gets the configured timeout
+  in3_ctx_t* ctx = ctx_new(c, "{\"method\":\"eth_getLogs\",\"params\":[{}]}");
+  TEST_ASSERT_EQUAL(IN3_WAITING, in3_ctx_execute(ctx));
+  in3_request_t* req = in3_create_request(ctx);
+  TEST_ASSERT_EQUAL(10000, req->timeouts[0]);
+  add_slow_response(req, 3000);
+  TEST_ASSERT_EQUAL(IN3_OK, in3_ctx_execute(ctx));
+  request_free(req);
+  ctx_free(ctx);
+
+  // with adaptiveTimeout the timeout follows the response times of the node
+  TEST_ASSERT_NULL(in3_configure(c, "{\"adaptiveTimeout\":true}"));
+  ctx = ctx_new(c, "{\"method\":\"eth_getLogs\",\"params\":[{}]}");
+  TEST_ASSERT_EQUAL(IN3_WAITING, in3_ctx_execute(ctx));
+  req = in3_create_request(ctx);
+  TEST_ASSERT_EQUAL(1000, req->timeouts[0]);
+  add_slow_response(req, 3000);
+  TEST_ASSERT_NOT_EQUAL(IN3_OK, in3_ctx_execute(ctx));
+  request_free(req);
+  ctx_free(ctx);
+  in3_free(c);
+}
+
 static void test_configure() {
   in3_t* c   = in3_for_chain(CHAIN_ID_MULTICHAIN);
   char*  tmp = NULL;
@@ -376,6 +466,12 @@ static void test_configure_validation() {
   TEST_ASSERT_CONFIGURE_FAIL("mismatched type: timeout", c, "{\"timeout\":\"0\"}", "expected uint32");
   TEST_ASSERT_CONFIGURE_FAIL("mismatched type: timeout", c, "{\"timeout\":false}", "expected uint32");
   TEST_ASSERT_CONFIGURE_FAIL("mismatched type: timeout", c, "{\"timeout\":\"0x1203030230\"}", "expected uint32");
+  TEST_ASSERT_CONFIGURE_FAIL("mismatched type: deadline", c, "{\"deadline\":\"-1\"}", "expected uint32");
+  TEST_ASSERT_CONFIGURE_FAIL("mismatched type: deadline", c, "{\"deadline\":false}", "expected uint32");
+  TEST_ASSERT_CONFIGURE_PASS(c, "{\"deadline\":30000}");
+  TEST_ASSERT_EQUAL(c->deadline, 30000);
+  TEST_ASSERT_CONFIGURE_PASS(c, "{\"deadline\":0}");
+  TEST_ASSERT_EQUAL(c->deadline, 0);
   TEST_ASSERT_CONFIGURE_PASS(c, "{\"timeout\":1}");
   TEST_ASSERT_EQUAL(c->timeout, 1);
   TEST_ASSERT_CONFIGURE_PASS(c, "{\"timeout\":0}");
@@ -559,13 +655,14 @@ static void test_configure_validation() {
   hex_to_bytes(NODE_ADDRS, -1, addr, 20);
   TEST_ASSERT_EQUAL_MEMORY(chain->nodelist[0].address->data, addr, 20);
 
-  TEST_ASSERT_EQUAL(0x234ad3, chain->verified_hashes[0].block_number);
+  // the verified hashes are sorted by blocknumber
+  TEST_ASSERT_EQUAL(0x234ad3, chain->verified_hashes[1].block_number);
   hex_to_bytes("0x1230980495039470913820938019274231230980495039470913820938019274", -1, b256, 32);
-  TEST_ASSERT_EQUAL_MEMORY(chain->verified_hashes[0].hash, b256, 32);
+  TEST_ASSERT_EQUAL_MEMORY(chain->verified_hashes[1].hash, b256, 32);
 
-  TEST_ASSERT_EQUAL(0x234a99, chain->verified_hashes[1].block_number);
+  TEST_ASSERT_EQUAL(0x234a99, chain->verified_hashes[0].block_number);
   hex_to_bytes("0xda879213bf9834ff2eade0921348dda879213bf9834ff2eade0921348d238130", -1, b256, 32);
-  TEST_ASSERT_EQUAL_MEMORY(chain->verified_hashes[1].hash, b256, 32);
+  TEST_ASSERT_EQUAL_MEMORY(chain->verified_hashes[0].hash, b256, 32);
 
   TEST_ASSERT_EQUAL(7, chain->avg_block_time);
 
@@ -589,6 +686,8 @@ int main() {
   TESTS_BEGIN();
   RUN_TEST(test_partial_response);
   RUN_TEST(test_retry_response);
+  RUN_TEST(test_deadline);
+  RUN_TEST(test_adaptive_timeout);
   RUN_TEST(test_configure_request);
   RUN_TEST(test_exec_req);
   RUN_TEST(test_configure);
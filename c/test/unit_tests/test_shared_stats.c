@@ -0,0 +1,166 @@
+/*******************************************************************************
+ * This file is part of the Incubed project.
+ * Sources: https://github.com/slockit/in3-c
+ * 
+ * Copyright (C) 2018-2020 slock.it GmbH, Blockchains LLC
+ * 
+ * 
+ * COMMERCIAL LICENSE USAGE
+ * 
+ * Licensees holding a valid commercial license may use this file in accordance 
+ * with the commercial license agreement provided with the Software or, alternatively, 
+ * in accordance with the terms contained in a written agreement between you and 
+ * slock.it GmbH/Blockchains LLC. For licensing terms and conditions or further 
+ * information please contact slock.it at in3@slock.it.
+ * 	
+ * Alternatively, this file may be used under the AGPL license as follows:
+ *    
+ * AGPL LICENSE USAGE
+ * 
+ * This program is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Affero General Public License as published by the Free Software 
+ * Foundation, either version 3 of the License, or (at your option) any later version.
+ *  
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY 
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A 
+ * PARTICULAR PURPOSE. See the GNU Affero General Public License for more details.
+ * [Permissions of this strong copyleft license are conditioned on making available 
+ * complete source code of licensed works and modifications, which include larger 
+ * works using a licensed work, under the same license. Copyright and license notices 
+ * must be preserved. Contributors provide an express grant of patent rights.]
+ * You should have received a copy of the GNU Affero General Public License along 
+ * with this program. If not, see <https://www.gnu.org/licenses/>.
+ *******************************************************************************/
+#ifndef TEST
+#define TEST
+#endif
+#ifndef TEST
+#define DEBUG
+#endif
+
+#include "../../src/core/client/shared_stats.h"
+#include "../../src/core/client/client.h"
+#include "../../src/core/client/nodelist.h"
+#include "../../src/core/util/log.h"
+#include "../../src/core/util/mem.h"
+#include "../test_utils.h"
+#include <stdio.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#ifdef SHARED_STATS
+
+static char name[32];
+
+static in3_t* create_client() {
+  in3_t* c   = in3_for_chain(CHAIN_ID_GOERLI);
+  char*  err = in3_configure(c, "{\"chainId\":\"0x5\",\"maxVerifiedHashes\":4,"
+                               "\"nodes\":{\"0x5\":{\"needsUpdate\":false,\"nodeList\":["
+                               "{\"url\":\"https://node1.test\",\"address\":\"0x1234567890123456789012345678901234567890\",\"props\":\"0xffff\"},"
+                               "{\"url\":\"https://node2.test\",\"address\":\"0x2234567890123456789012345678901234567890\",\"props\":\"0xffff\"}]}}}");
+  TEST_ASSERT_NULL_MESSAGE(err, err);
+  return c;
+}
+
+static in3_chain_t* attach(in3_t* c) {
+  TEST_ASSERT_EQUAL(IN3_OK, in3_shared_stats_attach(c, CHAIN_ID_GOERLI, name));
+  return in3_find_chain(c, CHAIN_ID_GOERLI);
+}
+
+static void test_shared_weights() {
+  in3_t *      c1 = create_client(), *c2 = create_client();
+  in3_chain_t* chain1                    = in3_find_chain(c1, CHAIN_ID_GOERLI);
+  chain1->weights[1].response_count      = 7;
+  chain1->weights[1].total_response_time = 700;
+  in3_node_add_response_time(chain1->weights + 1, 100);
+
+  // the first process seeds the segment with its weights
+  chain1              = attach(c1);
+  in3_chain_t* chain2 = attach(c2);
+  TEST_ASSERT_EQUAL(8, chain2->weights[1].response_count);
+  TEST_ASSERT_EQUAL(800, chain2->weights[1].total_response_time);
+  TEST_ASSERT_EQUAL(1, chain2->weights[1].latency_len);
+
+  // updates are seen by the other client after the next sync
+  for (uint32_t i = 1; i <= IN3_NODE_LATENCY_SAMPLES + 2; i++) in3_shared_add_response_time(chain1, chain1->nodelist, i * 10);
+  in3_shared_blacklist(chain1, chain1->nodelist[0].address->data, 5000);
+  in3_shared_sync(chain2, c2->max_verified_hashes);
+  TEST_ASSERT_EQUAL(IN3_NODE_LATENCY_SAMPLES + 2, chain2->weights[0].response_count);
+  TEST_ASSERT_EQUAL(IN3_NODE_LATENCY_SAMPLES, chain2->weights[0].latency_len);
+  TEST_ASSERT_EQUAL(2, chain2->weights[0].latency_pos);
+  TEST_ASSERT_EQUAL((IN3_NODE_LATENCY_SAMPLES + 1) * 10, chain2->weights[0].latency[0]);
+  TEST_ASSERT_EQUAL(5000, chain2->weights[0].blacklisted_until);
+  in3_shared_sync(chain1, c1->max_verified_hashes);
+  TEST_ASSERT_EQUAL(in3_node_calculate_timeout(chain1->weights, 10000), in3_node_calculate_timeout(chain2->weights, 10000));
+
+  in3_free(c1);
+  in3_free(c2);
+  TEST_ASSERT_EQUAL(IN3_OK, in3_shared_stats_unlink(name, CHAIN_ID_GOERLI));
+}
+
+static void test_shared_hashes() {
+  in3_t *      c1 = create_client(), *c2 = create_client();
+  in3_chain_t* chain2                     = in3_find_chain(c2, CHAIN_ID_GOERLI);
+  chain2->verified_hashes                 = _calloc(c2->max_verified_hashes, sizeof(in3_verified_hash_t));
+  chain2->verified_hashes[0].block_number = 42;
+  memset(chain2->verified_hashes[0].hash, 42, 32);
+
+  in3_chain_t* chain1 = attach(c1);
+  chain2              = attach(c2);
+  bytes32_t hash;
+  for (int i = 1; i <= 6; i++) {
+    memset(hash, i, 32);
+    in3_shared_add_verified(chain2, 100 + i, hash);
+  }
+  in3_shared_sync(chain1, c1->max_verified_hashes);
+
+  // we only keep the newest 4 hashes
+  uint64_t sum = 0;
+  for (int i = 0; i < 4; i++) {
+    sum += chain1->verified_hashes[i].block_number;
+    TEST_ASSERT_EQUAL(chain1->verified_hashes[i].block_number - 100, chain1->verified_hashes[i].hash[31]);
+  }
+  TEST_ASSERT_EQUAL(103 + 104 + 105 + 106, sum);
+
+  in3_free(c1);
+  in3_free(c2);
+  TEST_ASSERT_EQUAL(IN3_OK, in3_shared_stats_unlink(name, CHAIN_ID_GOERLI));
+}
+
+static void test_shared_processes() {
+  in3_t*       c     = create_client();
+  in3_chain_t* chain = attach(c);
+
+  pid_t pid = fork();
+  if (pid == 0) {
+    in3_t*       child       = create_client();
+    in3_chain_t* child_chain = attach(child);
+    in3_shared_add_response_time(child_chain, child_chain->nodelist + 1, 250);
+    in3_shared_blacklist(child_chain, child_chain->nodelist[1].address->data, 1234);
+    _exit(0);
+  }
+  TEST_ASSERT_EQUAL(pid, waitpid(pid, NULL, 0));
+
+  in3_shared_sync(chain, c->max_verified_hashes);
+  TEST_ASSERT_EQUAL(1, chain->weights[1].response_count);
+  TEST_ASSERT_EQUAL(250, chain->weights[1].latency[0]);
+  TEST_ASSERT_EQUAL(1234, chain->weights[1].blacklisted_until);
+
+  in3_free(c);
+  TEST_ASSERT_EQUAL(IN3_OK, in3_shared_stats_unlink(name, CHAIN_ID_GOERLI));
+  TEST_ASSERT_EQUAL(IN3_EFIND, in3_shared_stats_unlink(name, CHAIN_ID_GOERLI));
+}
+#endif
+
+int main() {
+  in3_log_set_quiet(true);
+  TESTS_BEGIN();
+#ifdef SHARED_STATS
+  sprintf(name, "test%d", (int) getpid());
+  RUN_TEST(test_shared_weights);
+  RUN_TEST(test_shared_hashes);
+  RUN_TEST(test_shared_processes);
+#endif
+  return TESTS_END();
+}
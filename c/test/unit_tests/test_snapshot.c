@@ -0,0 +1,163 @@
+/*******************************************************************************
+ * This file is part of the Incubed project.
+ * Sources: https://github.com/slockit/in3-c
+ * 
+ * Copyright (C) 2018-2020 slock.it GmbH, Blockchains LLC
+ * 
+ * 
+ * COMMERCIAL LICENSE USAGE
+ * 
+ * Licensees holding a valid commercial license may use this file in accordance 
+ * with the commercial license agreement provided with the Software or, alternatively, 
+ * in accordance with the terms contained in a written agreement between you and 
+ * slock.it GmbH/Blockchains LLC. For licensing terms and conditions or further 
+ * information please contact slock.it at in3@slock.it.
+ * 	
+ * Alternatively, this file may be used under the AGPL license as follows:
+ *    
+ * AGPL LICENSE USAGE
+ * 
+ * This program is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Affero General Public License as published by the Free Software 
+ * Foundation, either version 3 of the License, or (at your option) any later version.
+ *  
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY 
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A 
+ * PARTICULAR PURPOSE. See the GNU Affero General Public License for more details.
+ * [Permissions of this strong copyleft license are conditioned on making available 
+ * complete source code of licensed works and modifications, which include larger 
+ * works using a licensed work, under the same license. Copyright and license notices 
+ * must be preserved. Contributors provide an express grant of patent rights.]
+ * You should have received a copy of the GNU Affero General Public License along 
+ * with this program. If not, see <https://www.gnu.org/licenses/>.
+ *******************************************************************************/
+
+#ifndef TEST
+#define TEST
+#endif
+#ifndef TEST
+#define DEBUG
+#endif
+
+#include "../../src/core/client/snapshot.h"
+#include "../../src/core/client/client.h"
+#include "../../src/core/client/nodelist.h"
+#include "../../src/core/client/verified_hashes.h"
+#include "../../src/core/util/log.h"
+#include "../../src/core/util/mem.h"
+#include "../test_utils.h"
+#include <stdio.h>
+#include <string.h>
+
+static in3_t* create_client() {
+  in3_t* c   = in3_for_chain(0);
+  char*  err = in3_configure(c, "{\"chainId\":\"0x5\",\"requestCount\":2,\"maxVerifiedHashes\":8,\"timeout\":3000,\"deadline\":9000,"
+                               "\"nodes\":{\"0x5\":{\"needsUpdate\":false,\"nodeList\":["
+                               "{\"url\":\"https://node1.test\",\"address\":\"0x1234567890123456789012345678901234567890\",\"props\":\"0xffff\"},"
+                               "{\"url\":\"https://node2.test\",\"address\":\"0x2234567890123456789012345678901234567890\",\"props\":\"0x1dd\"}]}}}");
+  TEST_ASSERT_NULL_MESSAGE(err, err);
+
+  bytes32_t hash;
+  memset(hash, 0xab, 32);
+  in3_chain_t* chain                  = in3_find_chain(c, 0x5);
+  chain->last_block                   = 0x1234;
+  chain->weights[1].response_count    = 7;
+  chain->weights[1].blacklisted_until = 1000;
+  in3_verified_hashes_add(chain, c->max_verified_hashes, 42, hash);
+
+  // a custom chain with a whitelist
+  address_t contract = {1}, wl_contract = {2};
+  bytes32_t registry = {3};
+  TEST_ASSERT_EQUAL(IN3_OK, in3_client_register_chain(c, 0x100, CHAIN_ETH, contract, registry, 2, wl_contract));
+  chain                          = in3_find_chain(c, 0x100);
+  chain->whitelist->addresses    = bytes(_calloc(40, 1), 40);
+  chain->whitelist->last_block   = 99;
+  chain->whitelist->needs_update = false;
+  return c;
+}
+
+static void test_snapshot_roundtrip() {
+  in3_t*   c        = create_client();
+  bytes_t* snapshot = in3_snapshot_save(c);
+  in3_free(c);
+
+  c = in3_for_chain(CHAIN_ID_MAINNET);
+  TEST_ASSERT_EQUAL(IN3_OK, in3_snapshot_load(c, snapshot));
+  TEST_ASSERT_EQUAL(0x5, c->chain_id);
+  TEST_ASSERT_EQUAL(2, c->request_count);
+  TEST_ASSERT_EQUAL(8, c->max_verified_hashes);
+  TEST_ASSERT_EQUAL(3000, c->timeout);
+  TEST_ASSERT_EQUAL(9000, c->deadline);
+  TEST_ASSERT_EQUAL(8, c->chains_length);
+
+  in3_chain_t* chain = in3_find_chain(c, 0x5);
+  TEST_ASSERT_NOT_NULL(chain);
+  TEST_ASSERT_EQUAL(2, chain->nodelist_length);
+  TEST_ASSERT_EQUAL(0x1234, chain->last_block);
+  TEST_ASSERT_EQUAL_STRING("https://node2.test", chain->nodelist[1].url);
+  TEST_ASSERT_EQUAL(0x1dd, chain->nodelist[1].props);
+  TEST_ASSERT_EQUAL(0x22, chain->nodelist[1].address->data[0]);
+  TEST_ASSERT_EQUAL(7, chain->weights[1].response_count);
+  TEST_ASSERT_EQUAL(1000, chain->weights[1].blacklisted_until);
+  TEST_ASSERT_EQUAL(42, chain->verified_hashes[0].block_number);
+  TEST_ASSERT_EQUAL(0xab, chain->verified_hashes[0].hash[31]);
+  TEST_ASSERT_NULL(chain->nodelist_upd8_params);
+
+  chain = in3_find_chain(c, 0x100);
+  TEST_ASSERT_NOT_NULL(chain);
+  TEST_ASSERT_EQUAL(2, chain->version);
+  TEST_ASSERT_EQUAL(3, chain->registry_id[0]);
+  TEST_ASSERT_NOT_NULL(chain->whitelist);
+  TEST_ASSERT_EQUAL(2, chain->whitelist->contract[0]);
+  TEST_ASSERT_EQUAL(40, chain->whitelist->addresses.len);
+  TEST_ASSERT_EQUAL(99, chain->whitelist->last_block);
+  TEST_ASSERT_FALSE(chain->whitelist->needs_update);
+
+  // saving again results in the same snapshot
+  bytes_t* again = in3_snapshot_save(c);
+  TEST_ASSERT_TRUE(b_cmp(snapshot, again));
+  b_free(again);
+  b_free(snapshot);
+  in3_free(c);
+}
+
+static void test_snapshot_invalid() {
+  in3_t*   c        = create_client();
+  bytes_t* snapshot = in3_snapshot_save(c);
+  in3_free(c);
+
+  c               = in3_for_chain(CHAIN_ID_MAINNET);
+  bytes_t* before = in3_snapshot_save(c);
+
+  // every incomplete snapshot is rejected without changing the client
+  for (uint32_t len = 0; len < snapshot->len; len++) {
+    bytes_t part = bytes(snapshot->data, len);
+    TEST_ASSERT_NOT_EQUAL(IN3_OK, in3_snapshot_load(c, &part));
+  }
+
+  // a different version
+  snapshot->data[4]++;
+  TEST_ASSERT_EQUAL(IN3_EVERS, in3_snapshot_load(c, snapshot));
+  snapshot->data[4]--;
+
+  // additional bytes
+  bytes_t* longer = b_new(NULL, snapshot->len + 1);
+  memcpy(longer->data, snapshot->data, snapshot->len);
+  TEST_ASSERT_EQUAL(IN3_EINVALDT, in3_snapshot_load(c, longer));
+  b_free(longer);
+
+  bytes_t* after = in3_snapshot_save(c);
+  TEST_ASSERT_TRUE(b_cmp(before, after));
+  b_free(before);
+  b_free(after);
+  b_free(snapshot);
+  in3_free(c);
+}
+
+int main() {
+  in3_log_set_quiet(true);
+  TESTS_BEGIN();
+  RUN_TEST(test_snapshot_roundtrip);
+  RUN_TEST(test_snapshot_invalid);
+  return TESTS_END();
+}
@@ -0,0 +1,177 @@
+/*******************************************************************************
+ * This file is part of the Incubed project.
+ * Sources: https://github.com/slockit/in3-c
+ * 
+ * Copyright (C) 2018-2020 slock.it GmbH, Blockchains LLC
+ * 
+ * 
+ * COMMERCIAL LICENSE USAGE
+ * 
+ * Licensees holding a valid commercial license may use this file in accordance 
+ * with the commercial license agreement provided with the Software or, alternatively, 
+ * in accordance with the terms contained in a written agreement between you and 
+ * slock.it GmbH/Blockchains LLC. For licensing terms and conditions or further 
+ * information please contact slock.it at in3@slock.it.
+ * 	
+ * Alternatively, this file may be used under the AGPL license as follows:
+ *    
+ * AGPL LICENSE USAGE
+ * 
+ * This program is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Affero General Public License as published by the Free Software 
+ * Foundation, either version 3 of the License, or (at your option) any later version.
+ *  
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY 
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A 
+ * PARTICULAR PURPOSE. See the GNU Affero General Public License for more details.
+ * [Permissions of this strong copyleft license are conditioned on making available 
+ * complete source code of licensed works and modifications, which include larger 
+ * works using a licensed work, under the same license. Copyright and license notices 
+ * must be preserved. Contributors provide an express grant of patent rights.]
+ * You should have received a copy of the GNU Affero General Public License along 
+ * with this program. If not, see <https://www.gnu.org/licenses/>.
+ *******************************************************************************/
+
+#ifndef TEST
+#define TEST
+#endif
+#ifndef TEST
+#define DEBUG
+#endif
+
+#include "../../src/core/client/context_internal.h"
+#include "../../src/core/client/stats.h"
+#include "../../src/core/util/log.h"
+#include "../../src/verifier/eth1/basic/eth_basic.h"
+#include "../test_utils.h"
+#include <stdio.h>
+#include <string.h>
+
+static in3_stat_t* find_stat(in3_stats_t* stats, in3_stat_type_t type, const char* label) {
+  for (uint32_t i = 0; i < stats->len; i++) {
+    if (stats->entries[i].type == type && !strcmp(stats->entries[i].label, label)) return stats->entries + i;
+  }
+  return NULL;
+}
+
+static void test_stats_counter() {
+  in3_stats_reset();
+  in3_stats_add(IN3_STAT_REQUESTS, "eth_call", 1);
+  in3_stats_add(IN3_STAT_REQUESTS, "eth_blockNumber", 1);
+  in3_stats_add(IN3_STAT_REQUESTS, "eth_call", 2);
+  in3_stats_add(IN3_STAT_CACHE_HIT, "eth_call", 5);
+
+  in3_stats_t* stats = in3_get_stats();
+  TEST_ASSERT_EQUAL(3, stats->len);
+  TEST_ASSERT_EQUAL(3, find_stat(stats, IN3_STAT_REQUESTS, "eth_call")->count);
+  TEST_ASSERT_EQUAL(1, find_stat(stats, IN3_STAT_REQUESTS, "eth_blockNumber")->count);
+  TEST_ASSERT_EQUAL(5, find_stat(stats, IN3_STAT_CACHE_HIT, "eth_call")->count);
+
+  // sorted by type and label
+  TEST_ASSERT_EQUAL_STRING("eth_blockNumber", stats->entries[0].label);
+  TEST_ASSERT_EQUAL(IN3_STAT_CACHE_HIT, stats->entries[2].type);
+  in3_stats_free(stats);
+
+  in3_stats_reset();
+  stats = in3_get_stats();
+  TEST_ASSERT_EQUAL(0, stats->len);
+  in3_stats_free(stats);
+}
+
+static void test_stats_histogram() {
+  in3_stats_reset();
+  in3_stats_observe(IN3_STAT_VERIFICATION, "eth", 50);
+  in3_stats_observe(IN3_STAT_VERIFICATION, "eth", 100);
+  in3_stats_observe(IN3_STAT_VERIFICATION, "eth", 3000);
+  in3_stats_observe(IN3_STAT_VERIFICATION, "eth", 20000000);
+
+  in3_stats_t* stats = in3_get_stats();
+  in3_stat_t*  stat  = find_stat(stats, IN3_STAT_VERIFICATION, "eth");
+  TEST_ASSERT_NOT_NULL(stat);
+  TEST_ASSERT_TRUE(in3_stats_is_histogram(stat->type));
+  TEST_ASSERT_EQUAL(4, stat->count);
+  TEST_ASSERT_EQUAL(20003150, stat->sum);
+  TEST_ASSERT_EQUAL(2, stat->buckets[0]); // <= 100us
+  TEST_ASSERT_EQUAL(1, stat->buckets[5]); // <= 5ms
+  uint64_t in_buckets = 0;
+  for (int i = 0; i < IN3_STATS_BUCKETS; i++) in_buckets += stat->buckets[i];
+  TEST_ASSERT_EQUAL(3, in_buckets); // 20s is only counted as +Inf
+  in3_stats_free(stats);
+}
+
+static void test_stats_labels() {
+  char label[100];
+  in3_stats_reset();
+
+  // long labels are cut
+  memset(label, 'a', 99);
+  label[99] = 0;
+  in3_stats_add(IN3_STAT_BLACKLISTED, label, 1);
+  label[60] = 'b';
+  in3_stats_add(IN3_STAT_BLACKLISTED, label, 1);
+  in3_stats_add(IN3_STAT_BLACKLISTED, NULL, 1);
+  in3_stats_t* stats = in3_get_stats();
+  TEST_ASSERT_EQUAL(2, stats->len);
+  TEST_ASSERT_EQUAL(IN3_STATS_LABEL_LEN - 1, strlen(stats->entries[1].label));
+  TEST_ASSERT_EQUAL(2, stats->entries[1].count);
+  TEST_ASSERT_EQUAL(1, find_stat(stats, IN3_STAT_BLACKLISTED, "")->count);
+  in3_stats_free(stats);
+
+  // if the registry is full, we count them as other
+  in3_stats_reset();
+  for (int i = 0; i < IN3_STATS_MAX_ENTRIES + 10; i++) {
+    sprintf(label, "method_%d", i);
+    in3_stats_add(IN3_STAT_REQUESTS, label, 1);
+  }
+  stats = in3_get_stats();
+  TEST_ASSERT_EQUAL(IN3_STATS_MAX_ENTRIES + 1, stats->len);
+  TEST_ASSERT_EQUAL(10, find_stat(stats, IN3_STAT_REQUESTS, "other")->count);
+  TEST_ASSERT_EQUAL(1, find_stat(stats, IN3_STAT_REQUESTS, "method_0")->count);
+  in3_stats_free(stats);
+  in3_stats_reset();
+}
+
+static void test_stats_request() {
+  in3_stats_reset();
+  in3_t* c         = in3_for_chain(CHAIN_ID_MAINNET);
+  c->request_count = 2;
+  c->flags         = 0;
+  c->proof         = PROOF_NONE;
+  _free(c->chains->nodelist_upd8_params);
+  c->chains->nodelist_upd8_params = NULL;
+
+  in3_ctx_t* ctx = ctx_new(c, "{\"method\":\"eth_blockNumber\",\"params\":[]}");
+  TEST_ASSERT_EQUAL(IN3_WAITING, in3_ctx_execute(ctx));
+  in3_request_t* req = in3_create_request(ctx);
+  char*          url = _strdupn(req->urls[0], -1);
+
+  // the first node fails and will be blacklisted
+  in3_ctx_add_response(req->ctx, 0, true, "500 from server", -1);
+  in3_ctx_add_response(req->ctx, 1, false, "{\"result\":\"0x100\"}", -1);
+  req->ctx->raw_response[1].time = 12;
+  TEST_ASSERT_EQUAL(IN3_OK, in3_ctx_execute(ctx));
+
+  in3_stats_t* stats = in3_get_stats();
+  TEST_ASSERT_EQUAL(1, find_stat(stats, IN3_STAT_REQUESTS, "eth_blockNumber")->count);
+  TEST_ASSERT_EQUAL(1, find_stat(stats, IN3_STAT_BLACKLISTED, url)->count);
+  TEST_ASSERT_EQUAL(1, find_stat(stats, IN3_STAT_VERIFICATION, "eth")->count);
+  TEST_ASSERT_EQUAL(12000, find_stat(stats, IN3_STAT_TRANSPORT_LATENCY, req->urls[1])->sum);
+  in3_stats_free(stats);
+
+  _free(url);
+  request_free(req);
+  ctx_free(ctx);
+  in3_free(c);
+}
+
+int main() {
+  in3_log_set_quiet(true);
+  in3_register_eth_basic();
+
+  TESTS_BEGIN();
+  RUN_TEST(test_stats_counter);
+  RUN_TEST(test_stats_histogram);
+  RUN_TEST(test_stats_labels);
+  RUN_TEST(test_stats_request);
+  return TESTS_END();
+}
@@ -0,0 +1,329 @@
+/*******************************************************************************
+ * This file is part of the Incubed project.
+ * Sources: https://github.com/slockit/in3-c
+ * 
+ * Copyright (C) 2018-2020 slock.it GmbH, Blockchains LLC
+ * 
+ * 
+ * COMMERCIAL LICENSE USAGE
+ * 
+ * Licensees holding a valid commercial license may use this file in accordance 
+ * with the commercial license agreement provided with the Software or, alternatively, 
+ * in accordance with the terms contained in a written agreement between you and 
+ * slock.it GmbH/Blockchains LLC. For licensing terms and conditions or further 
+ * information please contact slock.it at in3@slock.it.
+ * 	
+ * Alternatively, this file may be used under the AGPL license as follows:
+ *    
+ * AGPL LICENSE USAGE
+ * 
+ * This program is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Affero General Public License as published by the Free Software 
+ * Foundation, either version 3 of the License, or (at your option) any later version.
+ *  
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY 
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A 
+ * PARTICULAR PURPOSE. See the GNU Affero General Public License for more details.
+ * [Permissions of this strong copyleft license are conditioned on making available 
+ * complete source code of licensed works and modifications, which include larger 
+ * works using a licensed work, under the same license. Copyright and license notices 
+ * must be preserved. Contributors provide an express grant of patent rights.]
+ * You should have received a copy of the GNU Affero General Public License along 
+ * with this program. If not, see <https://www.gnu.org/licenses/>.
+ *******************************************************************************/
+
+#ifndef TEST
+#define TEST
+#endif
+#ifndef TEST
+#define DEBUG
+#endif
+
+#include "../../src/cmd/in3/async_storage.h"
+#include "../../src/cmd/in3/in3_storage.h"
+#include "../../src/cmd/in3/recorder.h"
+#include "../../src/core/util/bytes.h"
+#include "../../src/core/util/log.h"
+#include "../../src/core/util/mem.h"
+#include "../test_utils.h"
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define STORE_PATH "test_storage.db"
+
+static long file_size(const char* path) {
+  struct stat st;
+  return stat(path, &st) ? -1 : (long) st.st_size;
+}
+
+static void set_value(in3_storage_handler_t* h, const char* key, const char* val) {
+  bytes_t b = bytes((uint8_t*) val, strlen(val));
+  h->set_item(h->cptr, key, &b);
+}
+
+static void assert_item(in3_storage_handler_t* h, const char* key, const char* val) {
+  bytes_t* b = h->get_item(h->cptr, key);
+  if (!val) {
+    TEST_ASSERT_NULL(b);
+    return;
+  }
+  TEST_ASSERT_NOT_NULL(b);
+  TEST_ASSERT_EQUAL(strlen(val), b->len);
+  if (b->len) TEST_ASSERT_EQUAL_MEMORY(val, b->data, b->len);
+  b_free(b);
+}
+
+static void set_string(in3_store_t* s, const char* key, const char* val) {
+  in3_storage_handler_t h = {.get_item = storage_get_item, .set_item = storage_set_item, .cptr = s};
+  set_value(&h, key, val);
+}
+
+static void assert_value(in3_store_t* s, const char* key, const char* val) {
+  in3_storage_handler_t h = {.get_item = storage_get_item, .set_item = storage_set_item, .cptr = s};
+  assert_item(&h, key, val);
+}
+
+static in3_store_t* open_empty() {
+  remove(STORE_PATH);
+  in3_store_t* s = store_open(STORE_PATH);
+  TEST_ASSERT_NOT_NULL(s);
+  return s;
+}
+
+static void test_storage_set_get() {
+  in3_store_t* s = open_empty();
+  assert_value(s, "nodelist_1", NULL);
+  set_string(s, "nodelist_1", "first");
+  set_string(s, "code_0x1234", "");
+  assert_value(s, "nodelist_1", "first");
+  assert_value(s, "code_0x1234", "");
+  set_string(s, "nodelist_1", "second");
+  assert_value(s, "nodelist_1", "second");
+
+  // writing the same value again does not append anything
+  long size = file_size(STORE_PATH);
+  set_string(s, "nodelist_1", "second");
+  TEST_ASSERT_EQUAL(size, file_size(STORE_PATH));
+  store_close(s);
+
+  // reopen
+  s = store_open(STORE_PATH);
+  assert_value(s, "nodelist_1", "second");
+  assert_value(s, "code_0x1234", "");
+  assert_value(s, "nodelist_", NULL);
+
+  storage_clear(s);
+  assert_value(s, "nodelist_1", NULL);
+  set_string(s, "nodelist_1", "third");
+  assert_value(s, "nodelist_1", "third");
+  store_close(s);
+  remove(STORE_PATH);
+}
+
+static void test_storage_interrupted_write() {
+  in3_store_t* s = open_empty();
+  set_string(s, "a", "1");
+  set_string(s, "b", "2");
+  store_close(s);
+
+  // simulate a crash while writing a record
+  long  size = file_size(STORE_PATH);
+  FILE* f    = fopen(STORE_PATH, "ab");
+  fwrite("\x12\x34\x56\x78\x01\x00\x00\x00\x10\x00\x00\x00" "cpartial", 1, 20, f);
+  fclose(f);
+
+  s = store_open(STORE_PATH);
+  assert_value(s, "a", "1");
+  assert_value(s, "b", "2");
+  assert_value(s, "c", NULL);
+
+  // the next write replaces the incomplete record
+  set_string(s, "c", "3");
+  assert_value(s, "c", "3");
+  TEST_ASSERT_EQUAL(size + 14, file_size(STORE_PATH));
+  store_close(s);
+
+  s = store_open(STORE_PATH);
+  assert_value(s, "a", "1");
+  assert_value(s, "c", "3");
+  store_close(s);
+  remove(STORE_PATH);
+}
+
+static void test_storage_compaction() {
+  char         key[32], val[1000];
+  in3_store_t* s = open_empty();
+  memset(val, 'x', sizeof(val) - 1);
+  val[sizeof(val) - 1] = 0;
+
+  for (int i = 0; i < 500; i++) {
+    sprintf(key, "key_%d", i % 10);
+    sprintf(val, "%04d", i);
+    val[4] = 'x';
+    set_string(s, key, val);
+  }
+  // 10 values of about 1kB are left
+  TEST_ASSERT_TRUE(file_size(STORE_PATH) < 0x10000 * 2);
+  for (int i = 490; i < 500; i++) {
+    sprintf(key, "key_%d", i % 10);
+    sprintf(val, "%04d", i);
+    val[4] = 'x';
+    assert_value(s, key, val);
+  }
+  store_close(s);
+  remove(STORE_PATH);
+}
+
+static void test_storage_shared() {
+  in3_store_t* a = open_empty();
+  in3_store_t* b = store_open(STORE_PATH);
+  set_string(a, "k", "from a");
+  assert_value(b, "k", "from a");
+  set_string(b, "k", "from b");
+  assert_value(a, "k", "from b");
+
+  // a compaction replaces the file, which must be detected by the other handle
+  char val[2000];
+  memset(val, 'y', sizeof(val) - 1);
+  val[sizeof(val) - 1] = 0;
+  for (int i = 0; i < 100; i++) set_string(a, "big", val + (i & 1));
+  assert_value(b, "big", val + 1);
+  assert_value(b, "k", "from b");
+
+  storage_clear(b);
+  assert_value(a, "k", NULL);
+  set_string(a, "k", "again");
+  assert_value(b, "k", "again");
+
+  store_close(a);
+  store_close(b);
+  remove(STORE_PATH);
+}
+
+#define MOCK_SIZE 4
+
+/** a slow storage handler keeping the values in memory */
+typedef struct {
+  char*    keys[MOCK_SIZE];
+  bytes_t* values[MOCK_SIZE];
+  int      writes;
+} mock_storage_t;
+
+static bytes_t* mock_get_item(void* cptr, const char* key) {
+  mock_storage_t* m = cptr;
+  for (int i = 0; i < MOCK_SIZE; i++) {
+    if (m->keys[i] && !strcmp(m->keys[i], key)) return b_dup(m->values[i]);
+  }
+  return NULL;
+}
+
+static void mock_set_item(void* cptr, const char* key, bytes_t* value) {
+  mock_storage_t* m = cptr;
+  usleep(2000);
+  m->writes++;
+  for (int i = 0; i < MOCK_SIZE; i++) {
+    if (!m->keys[i] || !strcmp(m->keys[i], key)) {
+      if (!m->keys[i]) m->keys[i] = _strdupn(key, -1);
+      if (m->values[i]) b_free(m->values[i]);
+      m->values[i] = b_dup(value);
+      return;
+    }
+  }
+}
+
+static void mock_clear(void* cptr) {
+  mock_storage_t* m = cptr;
+  for (int i = 0; i < MOCK_SIZE; i++) {
+    if (m->keys[i]) _free(m->keys[i]);
+    if (m->values[i]) b_free(m->values[i]);
+    m->keys[i]   = NULL;
+    m->values[i] = NULL;
+  }
+}
+
+static void test_storage_async() {
+  mock_storage_t        mock         = {0};
+  in3_storage_handler_t mock_handler = {.get_item = mock_get_item, .set_item = mock_set_item, .cptr = &mock};
+  char                  val[10];
+  in3_t*                c = in3_for_chain(CHAIN_ID_MAINNET);
+  in3_set_storage_handler(c, mock_get_item, mock_set_item, mock_clear, &mock);
+  in3_storage_handler_t* cache = storage_async(c);
+  TEST_ASSERT_TRUE(cache == c->cache);
+
+  // pending values are returned before they are written
+  for (int i = 0; i < 100; i++) {
+    sprintf(val, "v%d", i);
+    set_value(cache, "k", val);
+    assert_item(cache, "k", val);
+  }
+  storage_async_flush(cache);
+  TEST_ASSERT_TRUE(mock.writes < 100);
+  assert_item(&mock_handler, "k", "v99");
+
+  // clear removes pending values too
+  set_value(cache, "a", "1");
+  set_value(cache, "b", "2");
+  cache->clear(cache->cptr);
+  assert_item(cache, "a", NULL);
+  assert_item(cache, "b", NULL);
+  storage_async_flush(cache);
+  assert_item(&mock_handler, "k", NULL);
+
+  // a write already running when clear is called must not land afterwards
+  set_value(cache, "c", "1");
+  usleep(500);
+  cache->clear(cache->cptr);
+  storage_async_flush(cache);
+  assert_item(&mock_handler, "c", NULL);
+
+  // in3_free writes all pending values
+  mock.writes = 0;
+  set_value(cache, "a", "x");
+  set_value(cache, "b", "y");
+  in3_free(c);
+  TEST_ASSERT_EQUAL(2, mock.writes);
+  assert_item(&mock_handler, "a", "x");
+  assert_item(&mock_handler, "b", "y");
+  mock_clear(&mock);
+}
+
+static void test_storage_recorder() {
+  char*        argv[] = {"in3", "-fo", "test_recorder.txt", "eth_blockNumber"};
+  in3_store_t* store  = store_open(STORE_PATH);
+  in3_t*       c      = in3_for_chain(CHAIN_ID_MAINNET);
+  in3_set_storage_handler(c, storage_get_item, storage_set_item, storage_clear, store);
+  TEST_ASSERT_NOT_NULL(storage_async(c));
+
+  // the recorder must pass the store to the wrapped handler, not itself
+  recorder_write_start(c, "test_recorder.txt", 4, argv);
+  set_value(c->cache, "k", "v");
+  assert_item(c->cache, "k", "v");
+  in3_free(c);
+  assert_value(store, "k", "v");
+  store_close(store);
+
+  char  buffer[1024] = {0};
+  FILE* f            = fopen("test_recorder.txt", "r");
+  TEST_ASSERT_NOT_NULL(f);
+  fread(buffer, 1, sizeof(buffer) - 1, f);
+  fclose(f);
+  TEST_ASSERT_NOT_NULL(strstr(buffer, ":: cache k 1\n76\n"));
+  remove("test_recorder.txt");
+  remove(STORE_PATH);
+}
+
+int main() {
+  in3_log_set_quiet(true);
+  TESTS_BEGIN();
+  RUN_TEST(test_storage_set_get);
+  RUN_TEST(test_storage_interrupted_write);
+  RUN_TEST(test_storage_compaction);
+  RUN_TEST(test_storage_shared);
+  RUN_TEST(test_storage_async);
+  RUN_TEST(test_storage_recorder);
+  int res = TESTS_END();
+  remove(STORE_PATH ".lock");
+  return res;
+}
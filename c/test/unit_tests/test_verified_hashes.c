@@ -0,0 +1,293 @@
+/*******************************************************************************
+ * This file is part of the Incubed project.
+ * Sources: https://github.com/slockit/in3-c
+ * 
+ * Copyright (C) 2018-2020 slock.it GmbH, Blockchains LLC
+ * 
+ * 
+ * COMMERCIAL LICENSE USAGE
+ * 
+ * Licensees holding a valid commercial license may use this file in accordance 
+ * with the commercial license agreement provided with the Software or, alternatively, 
+ * in accordance with the terms contained in a written agreement between you and 
+ * slock.it GmbH/Blockchains LLC. For licensing terms and conditions or further 
+ * information please contact slock.it at in3@slock.it.
+ * 	
+ * Alternatively, this file may be used under the AGPL license as follows:
+ *    
+ * AGPL LICENSE USAGE
+ * 
+ * This program is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Affero General Public License as published by the Free Software 
+ * Foundation, either version 3 of the License, or (at your option) any later version.
+ *  
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY 
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A 
+ * PARTICULAR PURPOSE. See the GNU Affero General Public License for more details.
+ * [Permissions of this strong copyleft license are conditioned on making available 
+ * complete source code of licensed works and modifications, which include larger 
+ * works using a licensed work, under the same license. Copyright and license notices 
+ * must be preserved. Contributors provide an express grant of patent rights.]
+ * You should have received a copy of the GNU Affero General Public License along 
+ * with this program. If not, see <https://www.gnu.org/licenses/>.
+ *******************************************************************************/
+#ifndef TEST
+#define TEST
+#endif
+#ifndef TEST
+#define DEBUG
+#endif
+
+#include "../../src/core/client/cache.h"
+#include "../../src/core/client/context.h"
+#include "../../src/core/client/keys.h"
+#include "../../src/core/client/verified_hashes.h"
+#include "../../src/core/util/log.h"
+#include "../../src/core/util/mem.h"
+#include "../../src/verifier/eth1/basic/eth_basic.h"
+#include "../test_utils.h"
+#include <stdio.h>
+#include <string.h>
+
+#define MAX_ENTRIES 8
+
+static bytes_t values[MAX_ENTRIES];
+static char*   keys[MAX_ENTRIES];
+static int     writes = 0;
+
+static bytes_t* cache_get_item(void* cptr, const char* key) {
+  UNUSED_VAR(cptr);
+  for (int i = 0; i < MAX_ENTRIES && keys[i]; i++) {
+    if (strcmp(keys[i], key) == 0) return b_dup(values + i);
+  }
+  return NULL;
+}
+
+static void cache_set_item(void* cptr, const char* key, bytes_t* value) {
+  UNUSED_VAR(cptr);
+  int i = 0;
+  while (i < MAX_ENTRIES - 1 && keys[i] && strcmp(keys[i], key)) i++;
+  if (keys[i]) {
+    _free(keys[i]);
+    _free(values[i].data);
+  }
+  if (strncmp(key, "verified_", 9) == 0) writes++;
+  keys[i]   = _strdupn(key, -1);
+  values[i] = bytes(_malloc(value->len), value->len);
+  memcpy(values[i].data, value->data, value->len);
+}
+
+static void hash_of(uint64_t block_number, bytes32_t hash) {
+  memset(hash, 0, 32);
+  long_to_bytes(block_number, hash);
+}
+
+static void add_blocks(in3_chain_t* chain, uint_fast16_t max, uint64_t first, uint64_t last, uint64_t step) {
+  bytes32_t hash;
+  for (uint64_t n = first; n <= last; n += step) {
+    hash_of(n, hash);
+    in3_verified_hashes_add(chain, max, n, hash);
+  }
+}
+
+static void test_add_find() {
+  in3_chain_t chain;
+  bytes32_t   hash;
+
+  // add in any order, but the blocks are sorted
+  memset(&chain, 0, sizeof(chain));
+  uint64_t blocks[] = {50, 10, 30, 20, 40};
+  for (int i = 0; i < 5; i++) {
+    hash_of(blocks[i], hash);
+    TEST_ASSERT_TRUE(in3_verified_hashes_add(&chain, 8, blocks[i], hash));
+  }
+  TEST_ASSERT_EQUAL(5, in3_verified_hashes_len(&chain, 8));
+  for (int i = 0; i < 5; i++) TEST_ASSERT_EQUAL((i + 1) * 10, chain.verified_hashes[i].block_number);
+
+  TEST_ASSERT_NULL(in3_verified_hashes_find(&chain, 8, 35));
+  in3_verified_hash_t* vh = in3_verified_hashes_find(&chain, 8, 30);
+  TEST_ASSERT_NOT_NULL(vh);
+  hash_of(30, hash);
+  TEST_ASSERT_EQUAL_MEMORY(hash, vh->hash, 32);
+
+  // replacing a hash does not add a block
+  memset(hash, 0xff, 32);
+  TEST_ASSERT_TRUE(in3_verified_hashes_add(&chain, 8, 30, hash));
+  TEST_ASSERT_EQUAL(5, in3_verified_hashes_len(&chain, 8));
+  TEST_ASSERT_EQUAL(0xff, in3_verified_hashes_find(&chain, 8, 30)->hash[0]);
+  _free(chain.verified_hashes);
+}
+
+static void test_eviction() {
+  in3_chain_t chain = {0};
+  bytes32_t   hash;
+  add_blocks(&chain, 4, 10, 40, 10);
+  TEST_ASSERT_EQUAL(4, in3_verified_hashes_len(&chain, 4));
+
+  // an older block than all does not fit into the full store
+  hash_of(5, hash);
+  TEST_ASSERT_FALSE(in3_verified_hashes_add(&chain, 4, 5, hash));
+
+  // a block in the middle replaces the oldest
+  hash_of(25, hash);
+  TEST_ASSERT_TRUE(in3_verified_hashes_add(&chain, 4, 25, hash));
+  TEST_ASSERT_NULL(in3_verified_hashes_find(&chain, 4, 10));
+  TEST_ASSERT_EQUAL(20, chain.verified_hashes[0].block_number);
+  TEST_ASSERT_EQUAL(25, chain.verified_hashes[1].block_number);
+  TEST_ASSERT_EQUAL(40, chain.verified_hashes[3].block_number);
+
+  // shrinking keeps the newest blocks
+  in3_verified_hashes_resize(&chain, 4, 2);
+  TEST_ASSERT_EQUAL(2, in3_verified_hashes_len(&chain, 2));
+  TEST_ASSERT_EQUAL(30, chain.verified_hashes[0].block_number);
+  TEST_ASSERT_EQUAL(40, chain.verified_hashes[1].block_number);
+
+  // growing adds empty entries
+  in3_verified_hashes_resize(&chain, 2, 16);
+  TEST_ASSERT_EQUAL(2, in3_verified_hashes_len(&chain, 16));
+  _free(chain.verified_hashes);
+}
+
+static void test_range() {
+  in3_chain_t   chain = {0};
+  uint_fast16_t len;
+  add_blocks(&chain, 2000, 1000, 2998, 2);
+  TEST_ASSERT_EQUAL(1000, in3_verified_hashes_len(&chain, 2000));
+
+  in3_verified_hash_t* range = in3_verified_hashes_range(&chain, 2000, 1501, 1510, &len);
+  TEST_ASSERT_EQUAL(5, len);
+  TEST_ASSERT_EQUAL(1502, range[0].block_number);
+  TEST_ASSERT_EQUAL(1510, range[4].block_number);
+
+  TEST_ASSERT_NULL(in3_verified_hashes_range(&chain, 2000, 3000, 4000, &len));
+  TEST_ASSERT_EQUAL(0, len);
+  TEST_ASSERT_NOT_NULL(in3_verified_hashes_range(&chain, 2000, 0, UINT64_MAX, &len));
+  TEST_ASSERT_EQUAL(1000, len);
+  _free(chain.verified_hashes);
+}
+
+static void test_select() {
+  in3_chain_t chain = {0};
+  bytes_t     hashes[IN3_ADVERTISED_HASHES];
+  add_blocks(&chain, 100, 1, 100, 1);
+
+  // without a block, the newest are sent
+  TEST_ASSERT_EQUAL(4, in3_verified_hashes_select(&chain, 100, 0, 0, hashes, 4));
+  TEST_ASSERT_EQUAL(100, bytes_to_long(hashes[0].data, 8));
+  TEST_ASSERT_EQUAL(97, bytes_to_long(hashes[3].data, 8));
+
+  // the requested block and its finality blocks come first
+  TEST_ASSERT_EQUAL(IN3_ADVERTISED_HASHES, in3_verified_hashes_select(&chain, 100, 20, 2, hashes, IN3_ADVERTISED_HASHES));
+  TEST_ASSERT_EQUAL(20, bytes_to_long(hashes[0].data, 8));
+  TEST_ASSERT_EQUAL(22, bytes_to_long(hashes[2].data, 8));
+  TEST_ASSERT_EQUAL(100, bytes_to_long(hashes[3].data, 8));
+
+  // the newest blocks are not repeated
+  TEST_ASSERT_EQUAL(5, in3_verified_hashes_select(&chain, 100, 99, 5, hashes, 5));
+  TEST_ASSERT_EQUAL(99, bytes_to_long(hashes[0].data, 8));
+  TEST_ASSERT_EQUAL(100, bytes_to_long(hashes[1].data, 8));
+  TEST_ASSERT_EQUAL(98, bytes_to_long(hashes[2].data, 8));
+  _free(chain.verified_hashes);
+}
+
+static char* last_payload = NULL;
+
+static in3_ret_t payload_transport(in3_request_t* req) {
+  _free(last_payload);
+  last_payload = _strdupn(req->payload, -1);
+  in3_ctx_add_response(req->ctx, 0, true, "not sent", -1);
+  return IN3_OK;
+}
+
+/** sends the request and returns the blocknumber of the first verified hash advertised with it */
+static uint64_t first_hash_sent(in3_t* c, char* method, char* params) {
+  char *result = NULL, *error = NULL;
+  in3_client_rpc(c, method, params, &result, &error);
+  _free(result);
+  _free(error);
+  TEST_ASSERT_NOT_NULL(last_payload);
+  json_ctx_t* json   = parse_json(last_payload);
+  bytes_t*    hash   = d_get_bytes_at(d_get(d_get(d_get_at(json->result, 0), key("in3")), key("verifiedHashes")), 0);
+  uint64_t    number = hash ? bytes_to_long(hash->data, 8) : 0;
+  json_free(json);
+  return number;
+}
+
+static void test_request_block() {
+  in3_t* c               = in3_for_chain(0x5);
+  c->transport           = payload_transport;
+  c->cache               = NULL;
+  c->max_attempts        = 1;
+  c->request_count       = 1;
+  c->finality            = 0;
+  c->max_verified_hashes = 100;
+  in3_chain_t* chain     = in3_find_chain(c, 0x5);
+  _free(chain->nodelist_upd8_params);
+  chain->nodelist_upd8_params = NULL;
+  add_blocks(chain, c->max_verified_hashes, 1, 100, 1);
+
+  // the hash of the requested block comes first
+  TEST_ASSERT_EQUAL(20, first_hash_sent(c, "eth_getBalance", "[\"0x0000000000000000000000000000000000000001\",\"0x14\"]"));
+  TEST_ASSERT_EQUAL(20, first_hash_sent(c, "eth_getStorageAt", "[\"0x0000000000000000000000000000000000000001\",\"0x0\",\"0x14\"]"));
+  TEST_ASSERT_EQUAL(20, first_hash_sent(c, "eth_getBlockByNumber", "[\"0x14\",false]"));
+
+  // without a block or for methods without a block parameter, the newest are sent
+  TEST_ASSERT_EQUAL(100, first_hash_sent(c, "eth_getBalance", "[\"0x0000000000000000000000000000000000000001\",\"latest\"]"));
+  TEST_ASSERT_EQUAL(100, first_hash_sent(c, "eth_sendRawTransaction", "[\"0x14\"]"));
+
+  in3_free(c);
+  _free(last_payload);
+  last_payload = NULL;
+}
+
+static void test_persistence() {
+  in3_storage_handler_t storage = {.get_item = cache_get_item, .set_item = cache_set_item, .cptr = NULL};
+  in3_t*                c       = in3_for_chain(0x5);
+  c->cache                      = &storage;
+  c->max_verified_hashes        = 1000;
+  in3_chain_t* chain            = in3_find_chain(c, 0x5);
+  add_blocks(chain, c->max_verified_hashes, 1000, 1999, 1);
+
+  TEST_ASSERT_EQUAL(IN3_OK, in3_cache_store_weights(c, chain));
+  TEST_ASSERT_EQUAL(1, writes);
+
+  // unchanged hashes are not written again
+  TEST_ASSERT_EQUAL(IN3_OK, in3_cache_store_weights(c, chain));
+  TEST_ASSERT_EQUAL(1, writes);
+  bytes32_t hash;
+  hash_of(2000, hash);
+  in3_verified_hashes_add(chain, c->max_verified_hashes, 2000, hash);
+  TEST_ASSERT_EQUAL(IN3_OK, in3_cache_store_weights(c, chain));
+  TEST_ASSERT_EQUAL(2, writes);
+
+  // a new client reads them
+  in3_t* c2               = in3_for_chain(0x5);
+  c2->cache               = &storage;
+  c2->max_verified_hashes = 1000;
+  chain                   = in3_find_chain(c2, 0x5);
+  TEST_ASSERT_EQUAL(IN3_OK, in3_cache_update_nodelist(c2, chain));
+  TEST_ASSERT_EQUAL(1000, in3_verified_hashes_len(chain, c2->max_verified_hashes));
+  TEST_ASSERT_EQUAL(1001, chain->verified_hashes[0].block_number);
+  TEST_ASSERT_NOT_NULL(in3_verified_hashes_find(chain, c2->max_verified_hashes, 2000));
+
+  c->cache = c2->cache = NULL;
+  in3_free(c);
+  in3_free(c2);
+  for (int i = 0; i < MAX_ENTRIES && keys[i]; i++) {
+    _free(keys[i]);
+    _free(values[i].data);
+  }
+}
+
+int main() {
+  in3_log_set_quiet(true);
+  in3_register_eth_basic();
+  TESTS_BEGIN();
+  RUN_TEST(test_add_find);
+  RUN_TEST(test_eviction);
+  RUN_TEST(test_range);
+  RUN_TEST(test_select);
+  RUN_TEST(test_request_block);
+  RUN_TEST(test_persistence);
+  return TESTS_END();
+}
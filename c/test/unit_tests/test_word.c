@@ -0,0 +1,152 @@
+/*******************************************************************************
+ * This file is part of the Incubed project.
+ * Sources: https://github.com/slockit/in3-c
+ * 
+ * Copyright (C) 2018-2020 slock.it GmbH, Blockchains LLC
+ * 
+ * 
+ * COMMERCIAL LICENSE USAGE
+ * 
+ * Licensees holding a valid commercial license may use this file in accordance 
+ * with the commercial license agreement provided with the Software or, alternatively, 
+ * in accordance with the terms contained in a written agreement between you and 
+ * slock.it GmbH/Blockchains LLC. For licensing terms and conditions or further 
+ * information please contact slock.it at in3@slock.it.
+ * 	
+ * Alternatively, this file may be used under the AGPL license as follows:
+ *    
+ * AGPL LICENSE USAGE
+ * 
+ * This program is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Affero General Public License as published by the Free Software 
+ * Foundation, either version 3 of the License, or (at your option) any later version.
+ *  
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY 
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A 
+ * PARTICULAR PURPOSE. See the GNU Affero General Public License for more details.
+ * [Permissions of this strong copyleft license are conditioned on making available 
+ * complete source code of licensed works and modifications, which include larger 
+ * works using a licensed work, under the same license. Copyright and license notices 
+ * must be preserved. Contributors provide an express grant of patent rights.]
+ * You should have received a copy of the GNU Affero General Public License along 
+ * with this program. If not, see <https://www.gnu.org/licenses/>.
+ *******************************************************************************/
+#ifndef TEST
+#define TEST
+#endif
+#ifndef TEST
+#define DEBUG
+#endif
+
+#include "../../src/core/util/bytes.h"
+#include "../../src/core/util/log.h"
+#include "../../src/core/util/utils.h"
+#include "../../src/verifier/eth1/evm/word.h"
+#include "../test_utils.h"
+#include <stdio.h>
+#include <string.h>
+
+#ifdef EVM_FAST_MATH
+
+#define MAX_WORD "ffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffff"
+#define MIN_INT "8000000000000000000000000000000000000000000000000000000000000000"
+#define NEAR_MAX "ffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffff43" // 2^256 - 189
+
+/** creates a word from a hex string without leading zeros */
+static evm_word_t word(const char* hex) {
+  uint8_t    data[32];
+  evm_word_t w;
+  evm_word_from_bytes(&w, data, hex_to_bytes(hex, -1, data, 32));
+  return w;
+}
+
+/** compares the word with the hex string without leading zeros */
+static void assert_word(const char* expected, const evm_word_t* w) {
+  uint8_t data[32];
+  char    hex[65];
+  evm_word_to_bytes(w, data);
+  bytes_to_hex(data, 32, hex);
+  char* p = hex;
+  while (*p == '0' && p[1]) p++;
+  TEST_ASSERT_EQUAL_STRING(expected, p);
+}
+
+static void divmod(const char* a, const char* b, const char* q, const char* r) {
+  evm_word_t wa = word(a), wb = word(b), wq, wr;
+  evm_word_divmod(&wq, &wr, &wa, &wb);
+  assert_word(q, &wq);
+  assert_word(r, &wr);
+}
+
+static void sdivmod(const char* a, const char* b, const char* q, const char* r) {
+  evm_word_t wa = word(a), wb = word(b), wq, wr;
+  evm_word_sdivmod(&wq, &wr, &wa, &wb);
+  assert_word(q, &wq);
+  assert_word(r, &wr);
+}
+
+static void test_div() {
+  // the first estimate of the quotient digit is too large, so the divisor is added back
+  divmod("7fffffffffffffff800000000000000000000000000000000000000000000000", "800000000000000000000000000000000000000000000001",
+         "fffffffffffffffe", "7fffffffffffffffffffffffffffffff0000000000000002");
+
+  // a divisor with a single limb
+  divmod(MAX_WORD, "7", "2492492492492492492492492492492492492492492492492492492492492492", "1");
+
+  // dividend and divisor with the same number of limbs
+  divmod(MAX_WORD, "8000000000000000000000000000000000000000000000000000000000000001",
+         "1", "7ffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffe");
+
+  // smaller dividend and division by zero
+  divmod("5", "8000000000000000000000000000000000000001", "0", "5");
+  divmod(MAX_WORD, "0", "0", "0");
+}
+
+static void test_sdiv() {
+  // -2^255 / -1 overflows and stays -2^255
+  sdivmod(MIN_INT, MAX_WORD, MIN_INT, "0");
+
+  // the quotient is rounded towards zero and the remainder has the sign of the dividend
+  sdivmod("fffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffff9", "3",
+          "fffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffe", MAX_WORD);
+  sdivmod("7", "fffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffd",
+          "fffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffe", "1");
+  sdivmod("8000000000000000000000000000000000000000000000000000000000000005", "bffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffd",
+          "1", "c000000000000000000000000000000000000000000000000000000000000008");
+
+  // 0x80 is positive, only the top bit of the full word is the sign
+  sdivmod("80", "2", "40", "0");
+  sdivmod("80", "3", "2a", "2");
+}
+
+static void test_mod() {
+  evm_word_t a = word(MAX_WORD), b = word("fffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffe"), m = word(NEAR_MAX), r;
+
+  // the 512-bit product is reduced
+  evm_word_mulmod(&r, &a, &b, &m);
+  assert_word("8954", &r);
+
+  // the 257-bit sum is reduced
+  evm_word_addmod(&r, &a, &a, &m);
+  assert_word("178", &r);
+
+  // modulo 0 is 0
+  m = word("0");
+  evm_word_mulmod(&r, &a, &b, &m);
+  assert_word("0", &r);
+  evm_word_addmod(&r, &a, &a, &m);
+  assert_word("0", &r);
+}
+
+#endif
+
+int main() {
+  in3_log_set_quiet(true);
+  TESTS_BEGIN();
+#ifdef EVM_FAST_MATH
+  RUN_TEST(test_div);
+  RUN_TEST(test_sdiv);
+  RUN_TEST(test_mod);
+#endif
+  return TESTS_END();
+}